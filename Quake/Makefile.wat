@@ -213,6 +213,7 @@ OBJS = strlcat.obj &
 	crc.obj &
 	cvar.obj &
 	cfgfile.obj &
+	tasks.obj &
 	host.obj &
 	host_cmd.obj &
 	mathlib.obj &
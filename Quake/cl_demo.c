@@ -23,6 +23,9 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 static void CL_FinishTimeDemo (void);
 
+cvar_t	timedemo_worst = {"timedemo_worst", "5", CVAR_NONE};	// slowest frames to list
+cvar_t	timedemo_csv = {"timedemo_csv", "0", CVAR_NONE};	// write every frame to timedemo_<demo>.csv
+
 /*
 ==============================================================================
 
@@ -64,28 +67,42 @@ void CL_StopPlayback (void)
 
 /*
 ====================
-CL_WriteDemoMessage
+CL_WriteDemoMessageCut
 
-Dumps the current net message, prefixed by the length and view angles
+Dumps the current net message without the bytes from start to end,
+prefixed by the length and view angles
 ====================
 */
-static void CL_WriteDemoMessage (void)
+void CL_WriteDemoMessageCut (int start, int end)
 {
 	int	len;
 	int	i;
 	float	f;
 
-	len = LittleLong (net_message.cursize);
+	len = LittleLong (net_message.cursize - (end - start));
 	fwrite (&len, 4, 1, cls.demofile);
 	for (i = 0; i < 3; i++)
 	{
 		f = LittleFloat (cl.viewangles[i]);
 		fwrite (&f, 4, 1, cls.demofile);
 	}
-	fwrite (net_message.data, net_message.cursize, 1, cls.demofile);
+	fwrite (net_message.data, start, 1, cls.demofile);
+	fwrite (net_message.data + end, net_message.cursize - end, 1, cls.demofile);
 	fflush (cls.demofile);
 }
 
+/*
+====================
+CL_WriteDemoMessage
+
+Dumps the current net message, prefixed by the length and view angles
+====================
+*/
+static void CL_WriteDemoMessage (void)
+{
+	CL_WriteDemoMessageCut (0, 0);
+}
+
 static int CL_GetDemoMessage (void)
 {
 	int		i;
@@ -165,7 +182,9 @@ int CL_GetMessage (void)
 			break;
 	}
 
-	if (cls.demorecording)
+	// while delta frames are draining, CL_ParseServerMessage records
+	// the message once it knows what to cut out of it
+	if (cls.demorecording && !cl.deltadraining)
 		CL_WriteDemoMessage ();
 
 	if (cls.signon < 2)
@@ -368,6 +387,16 @@ void CL_Record_f (void)
 
 		CL_WriteDemoMessage();
 
+		// other engines can't play delta entity frames, so have the
+		// server go back to fast updates, and keep the frames it sends
+		// before it hears about it out of the demo
+		if (cl.deltasequence)
+		{
+			MSG_WriteByte (&cls.message, clc_stringcmd);
+			MSG_WriteString (&cls.message, "deltaents 0");
+			cl.deltadraining = true;
+		}
+
 		// restore net_message
 		net_message.data = data;
 		net_message.cursize = cursize;
@@ -454,6 +483,235 @@ void CL_PlayDemo_f (void)
 	key_dest = key_game;
 }
 
+/*
+==============================================================================
+
+TIMEDEMO STATISTICS
+
+Every counted frame of a timedemo is kept, split into the phases of
+tdphase_t, so the report can show the spread of frame times and which phase
+the slow frames spent their time in, not just the average.
+==============================================================================
+*/
+
+typedef struct
+{
+	float	ms[TD_NUMPHASES];
+	float	total;
+} tdframe_t;
+
+static const char *const td_phasenames[TD_NUMPHASES] =
+{
+	"server", "parse", "scene", "draw", "present", "sound", "other"
+};
+
+static tdframe_t	*td_frames;
+static int			td_numframes;
+static int			td_maxframes;
+static tdframe_t	td_current;
+static double		td_marktime;
+static char			td_name[MAX_QPATH];
+
+/*
+====================
+CL_TimeDemoMark
+
+Charges the time since the previous mark to phase
+====================
+*/
+void CL_TimeDemoMark (tdphase_t phase)
+{
+	double	now;
+
+	if (!cls.timedemo)
+		return;
+
+	now = Sys_DoubleTime ();
+	td_current.ms[phase] += (now - td_marktime) * 1000.0;
+	td_marktime = now;
+}
+
+/*
+====================
+CL_TimeDemoEndFrame
+
+Called at the end of every host frame; keeps the frame if the timedemo counts it
+====================
+*/
+void CL_TimeDemoEndFrame (void)
+{
+	tdframe_t	*frame;
+	int			i;
+
+	if (!cls.timedemo)
+		return;
+
+	CL_TimeDemoMark (TD_OTHER);
+
+// the first frame didn't count
+	if (host_framecount > cls.td_startframe)
+	{
+		if (td_numframes == td_maxframes)
+		{
+			td_maxframes = q_max (td_maxframes * 2, 4096);
+			td_frames = (tdframe_t *) realloc (td_frames, td_maxframes * sizeof(*td_frames));
+			if (!td_frames)
+				Sys_Error ("CL_TimeDemoEndFrame: out of memory");
+		}
+		frame = &td_frames[td_numframes++];
+		*frame = td_current;
+		frame->total = 0.f;
+		for (i = 0; i < TD_NUMPHASES; i++)
+			frame->total += frame->ms[i];
+	}
+
+	memset (&td_current, 0, sizeof(td_current));
+}
+
+static int CL_CompareFloats (const void *a, const void *b)
+{
+	float fa = *(const float *) a;
+	float fb = *(const float *) b;
+
+	return (fa > fb) - (fa < fb);
+}
+
+static int CL_CompareFramesSlowest (const void *a, const void *b)
+{
+	float fa = td_frames[*(const int *) a].total;
+	float fb = td_frames[*(const int *) b].total;
+
+	return (fa < fb) - (fa > fb);
+}
+
+/*
+====================
+CL_TimeDemoPercentile
+
+Nearest-rank percentile of an ascending array
+====================
+*/
+static float CL_TimeDemoPercentile (const float *sorted, int count, float percent)
+{
+	int rank = (int) ceil (percent / 100.f * count) - 1;
+
+	return sorted[CLAMP (0, rank, count - 1)];
+}
+
+/*
+====================
+CL_TimeDemoWriteCSV
+====================
+*/
+static void CL_TimeDemoWriteCSV (void)
+{
+	char	relname[MAX_QPATH + 16];
+	char	name[MAX_OSPATH];
+	FILE	*f;
+	int		i, j;
+
+	q_snprintf (relname, sizeof(relname), "timedemo_%s.csv", td_name);
+	q_snprintf (name, sizeof(name), "%s/%s", com_gamedir, relname);
+	COM_CreatePath (name);
+	f = Sys_fopen (name, "w");
+	if (!f)
+	{
+		Con_Printf ("ERROR: couldn't open file %s.\n", relname);
+		return;
+	}
+
+	fprintf (f, "frame,total");
+	for (i = 0; i < TD_NUMPHASES; i++)
+		fprintf (f, ",%s", td_phasenames[i]);
+	fprintf (f, "\n");
+
+	for (i = 0; i < td_numframes; i++)
+	{
+		fprintf (f, "%d,%.3f", i + 1, td_frames[i].total);
+		for (j = 0; j < TD_NUMPHASES; j++)
+			fprintf (f, ",%.3f", td_frames[i].ms[j]);
+		fprintf (f, "\n");
+	}
+
+	fclose (f);
+	Con_Printf ("Wrote %s\n", relname);
+}
+
+/*
+====================
+CL_TimeDemoReport
+
+Frame time distribution per phase and the slowest frames, in milliseconds
+====================
+*/
+static void CL_TimeDemoReport (void)
+{
+	float	*sorted;
+	int		*order;
+	int		i, j, n, worst;
+	double	sum;
+
+	n = td_numframes;
+	if (!n)
+		return;
+
+	sorted = (float *) malloc (n * sizeof(*sorted));
+	order = (int *) malloc (n * sizeof(*order));
+	if (!sorted || !order)
+	{
+		free (sorted);
+		free (order);
+		Con_Printf ("Not enough memory for the timedemo report\n");
+		return;
+	}
+
+	Con_Printf ("%-8s %7s %7s %7s %7s %7s %7s\n", "ms", "min", "avg", "p50", "p95", "p99", "max");
+	for (j = -1; j < TD_NUMPHASES; j++)
+	{
+		sum = 0.0;
+		for (i = 0; i < n; i++)
+		{
+			sorted[i] = (j < 0) ? td_frames[i].total : td_frames[i].ms[j];
+			sum += sorted[i];
+		}
+		qsort (sorted, n, sizeof(*sorted), CL_CompareFloats);
+		Con_Printf ("%-8s %7.2f %7.2f %7.2f %7.2f %7.2f %7.2f\n",
+			(j < 0) ? "total" : td_phasenames[j],
+			sorted[0], sum / n,
+			CL_TimeDemoPercentile (sorted, n, 50.f),
+			CL_TimeDemoPercentile (sorted, n, 95.f),
+			CL_TimeDemoPercentile (sorted, n, 99.f),
+			sorted[n - 1]);
+	}
+
+	worst = CLAMP (0, (int) timedemo_worst.value, n);
+	if (worst)
+	{
+		for (i = 0; i < n; i++)
+			order[i] = i;
+		qsort (order, n, sizeof(*order), CL_CompareFramesSlowest);
+
+		Con_Printf ("%-8s %7s", "frame", "total");
+		for (j = 0; j < TD_NUMPHASES; j++)
+			Con_Printf (" %7s", td_phasenames[j]);
+		Con_Printf ("\n");
+		for (i = 0; i < worst; i++)
+		{
+			const tdframe_t *frame = &td_frames[order[i]];
+			Con_Printf ("%-8i %7.2f", order[i] + 1, frame->total);
+			for (j = 0; j < TD_NUMPHASES; j++)
+				Con_Printf (" %7.2f", frame->ms[j]);
+			Con_Printf ("\n");
+		}
+	}
+
+	free (sorted);
+	free (order);
+
+	if (timedemo_csv.value)
+		CL_TimeDemoWriteCSV ();
+}
+
 /*
 ====================
 CL_FinishTimeDemo
@@ -473,6 +731,12 @@ static void CL_FinishTimeDemo (void)
 	if (!time)
 		time = 1;
 	Con_Printf ("%i frames %5.1f seconds %5.1f fps\n", frames, time, frames/time);
+
+	CL_TimeDemoReport ();
+
+	free (td_frames);
+	td_frames = NULL;
+	td_numframes = td_maxframes = 0;
 }
 
 /*
@@ -503,5 +767,12 @@ void CL_TimeDemo_f (void)
 	cls.timedemo = true;
 	cls.td_startframe = host_framecount;
 	cls.td_lastframe = -1;	// get a new message this frame
+
+	COM_FileBase (Cmd_Argv(1), td_name, sizeof(td_name));
+	free (td_frames);
+	td_frames = NULL;
+	td_numframes = td_maxframes = 0;
+	memset (&td_current, 0, sizeof(td_current));
+	td_marktime = Sys_DoubleTime ();
 }
 
@@ -388,6 +388,15 @@ void CL_SendMove (const usercmd_t *cmd)
 		in_impulse = 0;
 	}
 
+//
+// acknowledge the last entity frame, once the server sends them
+//
+	if (cl.deltasequence)
+	{
+		MSG_WriteByte (&buf, clc_deltaack);
+		MSG_WriteLong (&buf, cl.deltasequence);
+	}
+
 //
 // deliver the message
 //
@@ -33,6 +33,7 @@ cvar_t	cl_color = {"_cl_color", "0", CVAR_ARCHIVE};
 
 cvar_t	cl_shownet = {"cl_shownet","0",CVAR_NONE};	// can be 0, 1, or 2
 cvar_t	cl_nolerp = {"cl_nolerp","0",CVAR_NONE};
+cvar_t	cl_deltaents = {"cl_deltaents","1",CVAR_ARCHIVE};	// ask servers for delta entity frames
 
 cvar_t	cfg_unbindall = {"cfg_unbindall", "1", CVAR_ARCHIVE};
 
@@ -85,6 +86,7 @@ void CL_ClearState (void)
 	memset (cl_lightstyle, 0, sizeof(cl_lightstyle));
 	memset (cl_temp_entities, 0, sizeof(cl_temp_entities));
 	memset (cl_beams, 0, sizeof(cl_beams));
+	CL_ClearDeltaFrames ();
 
 	//johnfitz -- cl_entities is now dynamically allocated
 	cl_max_edicts = CLAMP (MIN_EDICTS,(int)max_edicts.value,MAX_EDICTS);
@@ -173,6 +175,7 @@ void CL_EstablishConnection (const char *host)
 	cls.demonum = -1;			// not in the demo loop now
 	cls.state = ca_connected;
 	cls.signon = 0;				// need all the signon messages before playing
+	cls.signontime = realtime;
 	MSG_WriteByte (&cls.message, clc_nop);	// NAT Fix from ProQuake
 }
 
@@ -192,6 +195,14 @@ void CL_SignonReply (void)
 	switch (cls.signon)
 	{
 	case 1:
+		// not worth it on loopback, and demos must stay playable by other
+		// engines, so those keep the fast updates
+		if (cl_deltaents.value && cl.protocol != PROTOCOL_NETQUAKE
+			&& !NET_QSocketIsLoopback (cls.netcon) && !cls.demorecording)
+		{	// older servers ignore this
+			MSG_WriteByte (&cls.message, clc_stringcmd);
+			MSG_WriteString (&cls.message, "deltaents");
+		}
 		MSG_WriteByte (&cls.message, clc_stringcmd);
 		MSG_WriteString (&cls.message, "prespawn");
 		break;
@@ -216,6 +227,7 @@ void CL_SignonReply (void)
 
 	case 4:
 		SCR_EndLoadingPlaque ();		// allow normal screen updates
+		Con_DPrintf ("Signon took %.2f seconds\n", realtime - cls.signontime);
 		break;
 	}
 }
@@ -817,6 +829,9 @@ void CL_Init (void)
 	Cvar_RegisterVariable (&cl_anglespeedkey);
 	Cvar_RegisterVariable (&cl_shownet);
 	Cvar_RegisterVariable (&cl_nolerp);
+	Cvar_RegisterVariable (&cl_deltaents);
+	Cvar_RegisterVariable (&timedemo_worst);
+	Cvar_RegisterVariable (&timedemo_csv);
 	Cvar_RegisterVariable (&lookspring);
 	Cvar_RegisterVariable (&lookstrafe);
 	Cvar_RegisterVariable (&sensitivity);
@@ -839,6 +854,7 @@ void CL_Init (void)
 	Cmd_AddCommand ("stop", CL_Stop_f);
 	Cmd_AddCommand ("playdemo", CL_PlayDemo_f);
 	Cmd_AddCommand ("timedemo", CL_TimeDemo_f);
+	Cmd_AddCommand ("deltastats", CL_DeltaStats_f);
 
 	Cmd_AddCommand ("tracepos", CL_Tracepos_f); //johnfitz
 	Cmd_AddCommand ("viewpos", CL_Viewpos_f); //johnfitz
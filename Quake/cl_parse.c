@@ -90,7 +90,7 @@ const char *svc_strings[] =
 	"", // 51
 	"svc_achievement", // 52 -- used by the 2021 rerelease
 	"", // 53
-	"", // 54
+	"svc_deltaentities", // 54
 	"", // 55
 //johnfitz
 };
@@ -99,6 +99,10 @@ qboolean warn_about_nehahra_protocol; //johnfitz
 
 extern vec3_t	v_punchangles[2]; //johnfitz
 
+static int CL_ReadEntityState (int bits, const entity_state_t *from, entity_state_t *to);
+static void CL_SetEntityState (int num, const entity_state_t *state, int finish, qboolean step);
+static void CL_DeltaStatsUpdate (int num, const entity_state_t *state, int bits);
+
 //=============================================================================
 
 /*
@@ -416,24 +420,259 @@ void CL_ParseServerInfo (void)
 	memset(&dev_overflows, 0, sizeof(dev_overflows));
 }
 
+/*
+==============================================================================
+
+DELTA ENTITY FRAMES
+
+With cl_deltaents the client asks for svc_deltaentities frames during
+signon (see sv_main.c).  The last DELTA_BACKUP frames are kept so the
+server can delta against whichever one it last saw acknowledged, and the
+newest is acked with every move.
+
+Starting a demo mid-game sends "deltaents 0", and until the first fast
+updates come back the delta blocks are cut out of what gets recorded, so
+entities are missing from the first few frames of such a demo.
+
+For any kind of entity updates, including old demos, deltastats estimates
+what the same entity frames cost sent against the spawn baselines and as
+deltas against the previous frame.
+
+==============================================================================
+*/
+
+static entityframe_t	cl_deltaframes[DELTA_BACKUP];
+
+static entityframe_t	cl_statframes[2];	// this message's entities and the last
+#define	STAT_LERPFINISH		U_SIGNAL		// U_LERPFINISH, which doesn't fit their byte flags
+static int				cl_statcurrent;
+static int				cl_statnumframes;
+static double			cl_statbaseline, cl_statdelta, cl_statreceived;
+
+static int				cl_deltastart, cl_deltaend;	// svc_deltaentities in this message
+static qboolean			cl_fastupdates;				// this message had some
+
+static void CL_GrowEntityFrame (entityframe_t *frame, int count)
+{
+	if (count <= frame->maxents)
+		return;
+	count = q_max (count, frame->maxents * 2);
+	frame->nums = (int *) realloc (frame->nums, count * sizeof(*frame->nums));
+	frame->flags = (byte *) realloc (frame->flags, count * sizeof(*frame->flags));
+	frame->states = (entity_state_t *) realloc (frame->states, count * sizeof(*frame->states));
+	if (!frame->nums || !frame->flags || !frame->states)
+		Sys_Error ("CL_GrowEntityFrame: realloc() failed on %d entities", count);
+	frame->maxents = count;
+}
+
+static void CL_AddFrameEntity (entityframe_t *frame, int num, int flags, const entity_state_t *state)
+{
+	CL_GrowEntityFrame (frame, frame->numents + 1);
+	frame->nums[frame->numents] = num;
+	frame->flags[frame->numents] = flags;
+	frame->states[frame->numents] = *state;
+	frame->numents++;
+}
+
 /*
 ==================
-CL_ParseUpdate
+CL_KeepFrameEntity
 
-Parse an entity update message from the server
-If an entities model or origin changes from frame to frame, it must be
-relinked.  Other attributes can change without relinking.
+Carries entity j of the base frame over to the new one unchanged
 ==================
 */
-void CL_ParseUpdate (int bits)
+static void CL_KeepFrameEntity (entityframe_t *to, const entityframe_t *base, int j)
+{
+	int		num, flags;
+
+	num = base->nums[j];
+	flags = base->flags[j];
+	CL_AddFrameEntity (to, num, flags, &base->states[j]);
+	CL_SetEntityState (num, &base->states[j], -2, (flags & U_STEP) != 0);
+
+	if (CL_EntityNum (num)->lerpflags & LERP_FINISH)
+		flags |= U_LERPFINISH;
+	CL_DeltaStatsUpdate (num, &base->states[j], flags);
+}
+
+/*
+==================
+CL_ClearDeltaFrames
+
+Called for each new level, the server starts its frames over
+==================
+*/
+void CL_ClearDeltaFrames (void)
 {
 	int		i;
-	qmodel_t	*model;
-	int		modnum;
-	qboolean	forcelink;
-	entity_t	*ent;
-	int		num;
-	int		skin;
+
+	for (i = 0; i < DELTA_BACKUP; i++)
+		cl_deltaframes[i].sequence = 0;
+
+	cl_statframes[0].numents = cl_statframes[1].numents = 0;
+	cl_statnumframes = 0;
+	cl_statbaseline = cl_statdelta = cl_statreceived = 0;
+}
+
+/*
+==================
+CL_UpdateSize
+
+Bytes an entity update with these bits takes, not counting the entity number
+==================
+*/
+static int CL_UpdateSize (int bits)
+{
+	int		size, coord, angle;
+
+	if (cl.protocolflags & (PRFL_FLOATCOORD|PRFL_INT32COORD))
+		coord = 4;
+	else if (cl.protocolflags & PRFL_24BITCOORD)
+		coord = 3;
+	else
+		coord = 2;
+	if (cl.protocolflags & PRFL_FLOATANGLE)
+		angle = 4;
+	else if (cl.protocolflags & PRFL_SHORTANGLE)
+		angle = 2;
+	else
+		angle = 1;
+
+	if (bits >= 65536)
+		bits |= U_EXTEND1;
+	if (bits >= 16777216)
+		bits |= U_EXTEND2;
+	if (bits >= 256)
+		bits |= U_MOREBITS;
+
+	size = 1;
+	if (bits & U_MOREBITS)	size++;
+	if (bits & U_EXTEND1)	size++;
+	if (bits & U_EXTEND2)	size++;
+	if (bits & U_MODEL)		size++;
+	if (bits & U_FRAME)		size++;
+	if (bits & U_COLORMAP)	size++;
+	if (bits & U_SKIN)		size++;
+	if (bits & U_EFFECTS)	size++;
+	if (bits & U_ALPHA)		size++;
+	if (bits & U_FRAME2)	size++;
+	if (bits & U_MODEL2)	size++;
+	if (bits & U_LERPFINISH)	size++;
+	if (bits & U_ORIGIN1)	size += coord;
+	if (bits & U_ORIGIN2)	size += coord;
+	if (bits & U_ORIGIN3)	size += coord;
+	if (bits & U_ANGLE1)	size += angle;
+	if (bits & U_ANGLE2)	size += angle;
+	if (bits & U_ANGLE3)	size += angle;
+
+	return size;
+}
+
+/*
+==================
+CL_DeltaStatsUpdate
+
+Notes that entity num is in view with this state.  Of 'bits' only U_STEP and
+U_LERPFINISH are used.
+==================
+*/
+static void CL_DeltaStatsUpdate (int num, const entity_state_t *state, int bits)
+{
+	CL_AddFrameEntity (&cl_statframes[cl_statcurrent], num,
+		(bits & U_STEP) | ((bits & U_LERPFINISH) ? STAT_LERPFINISH : 0), state);
+}
+
+/*
+==================
+CL_DeltaStatsFrame
+
+Prices the entities seen in this message both ways
+==================
+*/
+static void CL_DeltaStatsFrame (void)
+{
+	entityframe_t	*cur, *prev;
+	entity_state_t	*from;
+	int				i, j, num, extra;
+
+	cur = &cl_statframes[cl_statcurrent];
+	if (!cur->numents)
+		return;
+	prev = &cl_statframes[cl_statcurrent ^ 1];
+
+	cl_statdelta += 1 + 4 + 4 + 2;	// svc, sequences, terminator
+	for (i = j = 0; i < cur->numents; i++)
+	{
+		num = cur->nums[i];
+		extra = (cur->flags[i] & U_STEP) | ((cur->flags[i] & STAT_LERPFINISH) ? U_LERPFINISH : 0);
+
+		cl_statbaseline += CL_UpdateSize (MSG_EntityDeltaBits (&cl_entities[num].baseline, &cur->states[i]) | extra
+				| ((num >= 256) ? U_LONGENTITY : 0)) + ((num >= 256) ? 2 : 1);
+
+		for ( ; j < prev->numents && prev->nums[j] < num; j++)
+			cl_statdelta += 2;	// removed
+		if (j < prev->numents && prev->nums[j] == num)
+		{
+			from = &prev->states[j];
+			if (!MSG_EntityDeltaBits (from, &cur->states[i]) && (extra & U_STEP) == (prev->flags[j] & U_STEP))
+			{
+				j++;
+				continue;	// free
+			}
+			j++;
+		}
+		else
+			from = &cl_entities[num].baseline;
+		cl_statdelta += 2 + CL_UpdateSize (MSG_EntityDeltaBits (from, &cur->states[i]) | extra);
+	}
+	cl_statdelta += 2 * (prev->numents - j);
+
+	cl_statnumframes++;
+	cl_statcurrent ^= 1;
+	cl_statframes[cl_statcurrent].numents = 0;
+}
+
+/*
+==================
+CL_DeltaStats_f
+
+deltastats: entity bandwidth since the level started
+==================
+*/
+void CL_DeltaStats_f (void)
+{
+	if (!cl_statnumframes)
+	{
+		Con_Printf ("no entity updates yet\n");
+		return;
+	}
+
+	Con_Printf ("%i entity frames, bytes per frame:\n", cl_statnumframes);
+	Con_Printf ("  received          %7.1f\n", cl_statreceived / cl_statnumframes);
+	Con_Printf ("  against baselines %7.1f\n", cl_statbaseline / cl_statnumframes);
+	Con_Printf ("  delta frames      %7.1f (%.0f%% less)\n", cl_statdelta / cl_statnumframes,
+				100.0 * (1.0 - cl_statdelta / q_max(cl_statbaseline, 1.0)));
+}
+
+/*
+==================
+CL_ParseDeltaEntities
+
+svc_deltaentities.  Entities of the base frame without an entry carry over
+unchanged; a frame against a base we don't have (a demo recorded in mid
+game) can't be decoded and is read past.
+==================
+*/
+static void CL_ParseDeltaEntities (void)
+{
+	entityframe_t	*base, *to;
+	entity_state_t	state;
+	const entity_state_t	*from;
+	int				sequence, basesequence;
+	int				start, word, num, bits, finish, j;
+	qboolean		valid;
+
+	start = msg_readcount - 1;
 
 	if (cls.signon == SIGNONS - 1)
 	{	// first update is the final signon stage
@@ -441,143 +680,157 @@ void CL_ParseUpdate (int bits)
 		CL_SignonReply ();
 	}
 
-	if (bits & U_MOREBITS)
+	sequence = MSG_ReadLong ();
+	basesequence = MSG_ReadLong ();
+
+	to = &cl_deltaframes[sequence & DELTA_MASK];
+	base = NULL;
+	valid = true;
+	if (basesequence)
 	{
-		i = MSG_ReadByte ();
-		bits |= (i<<8);
+		base = &cl_deltaframes[basesequence & DELTA_MASK];
+		if (base->sequence != basesequence || base == to)
+			valid = false;
+	}
+	if (valid)
+	{
+		to->sequence = 0;
+		to->numents = 0;
 	}
 
-	//johnfitz -- PROTOCOL_FITZQUAKE
-	if (cl.protocol == PROTOCOL_FITZQUAKE || cl.protocol == PROTOCOL_RMQ)
+	j = 0;
+	while (1)
 	{
+		if (msg_badread)
+			Host_Error ("CL_ParseDeltaEntities: bad entity frame");
+
+		word = MSG_ReadShort () & 0xFFFF;
+		num = word ? (word & ~DE_REMOVE) : MAX_EDICTS;
+
+	// whatever the base has before this entry didn't change
+		for ( ; valid && base && j < base->numents && base->nums[j] < num; j++)
+			CL_KeepFrameEntity (to, base, j);
+		if (!word)
+			break;
+
+		from = NULL;
+		if (valid && base && j < base->numents && base->nums[j] == num)
+			from = &base->states[j++];
+		if (word & DE_REMOVE)
+			continue;
+
+		bits = MSG_ReadByte ();
+		if (bits & U_MOREBITS)
+			bits |= MSG_ReadByte () << 8;
 		if (bits & U_EXTEND1)
-			bits |= MSG_ReadByte() << 16;
+			bits |= MSG_ReadByte () << 16;
 		if (bits & U_EXTEND2)
-			bits |= MSG_ReadByte() << 24;
+			bits |= MSG_ReadByte () << 24;
+
+		if (!from)
+			from = &CL_EntityNum (num)->baseline;
+		finish = CL_ReadEntityState (bits, from, &state);
+		if (!valid)
+			continue;
+
+		CL_AddFrameEntity (to, num, bits & U_STEP, &state);
+		CL_SetEntityState (num, &state, finish, (bits & U_STEP) != 0);
+		CL_DeltaStatsUpdate (num, &state, bits);
 	}
-	//johnfitz
 
-	if (bits & U_LONGENTITY)
-		num = MSG_ReadShort ();
-	else
-		num = MSG_ReadByte ();
+	if (!valid)
+	{
+		Con_DPrintf ("entity frame %i against missing frame %i skipped\n", sequence, basesequence);
+		return;
+	}
 
-	ent = CL_EntityNum (num);
+	cl_statreceived += msg_readcount - start;
+	to->sequence = sequence;
+	cl.deltasequence = sequence;
+}
 
-	if (ent->msgtime != cl.mtime[1])
-		forcelink = true;	// no previous frame to lerp from
-	else
-		forcelink = false;
+/*
+==================
+CL_DrainDeltaFrames
 
-	//johnfitz -- lerping
-	if (ent->msgtime + 0.2 < cl.mtime[0]) //more than 0.2 seconds since the last message (most entities think every 0.1 sec)
-		ent->lerpflags |= LERP_RESETANIM; //if we missed a think, we'd be lerping from the wrong frame
-	//johnfitz
+Records the message without its delta frame while the server hasn't
+switched back to fast updates yet
+==================
+*/
+static void CL_DrainDeltaFrames (void)
+{
+	if (cls.demorecording)
+		CL_WriteDemoMessageCut (cl_deltastart, cl_deltaend);
 
-	ent->msgtime = cl.mtime[0];
+	if (cl_fastupdates && cl_deltaend == cl_deltastart)
+	{
+		cl.deltadraining = false;
+		cl.deltasequence = 0;	// nothing left to ack
+	}
+}
+
+/*
+==================
+CL_ReadEntityState
+
+Reads the fields of an entity update into 'to', starting from 'from' for
+the ones that aren't sent.  Returns the U_LERPFINISH byte, or -1.
+==================
+*/
+static int CL_ReadEntityState (int bits, const entity_state_t *from, entity_state_t *to)
+{
+	int		finish;
+
+	*to = *from;
+	finish = -1;
 
 	if (bits & U_MODEL)
 	{
-		modnum = MSG_ReadByte ();
-		if (modnum >= MAX_MODELS)
+		to->modelindex = MSG_ReadByte ();
+		if (to->modelindex >= MAX_MODELS)
 			Host_Error ("CL_ParseModel: bad modnum");
 	}
-	else
-		modnum = ent->baseline.modelindex;
 
 	if (bits & U_FRAME)
-		ent->frame = MSG_ReadByte ();
-	else
-		ent->frame = ent->baseline.frame;
+		to->frame = MSG_ReadByte ();
 
 	if (bits & U_COLORMAP)
-		i = MSG_ReadByte();
-	else
-		i = ent->baseline.colormap;
-	if (!i)
-		ent->colormap = vid.colormap;
-	else
-	{
-		if (i > cl.maxclients)
-			Sys_Error ("i >= cl.maxclients");
-		ent->colormap = cl.scores[i-1].translations;
-	}
+		to->colormap = MSG_ReadByte();
+
 	if (bits & U_SKIN)
-		skin = MSG_ReadByte();
-	else
-		skin = ent->baseline.skin;
-	if (skin != ent->skinnum)
-	{
-		ent->skinnum = skin;
-		if (num > 0 && num <= cl.maxclients)
-			R_TranslateNewPlayerSkin (num - 1); //johnfitz -- was R_TranslatePlayerSkin
-	}
-	if (bits & U_EFFECTS)
-		ent->effects = MSG_ReadByte();
-	else
-		ent->effects = ent->baseline.effects;
+		to->skin = MSG_ReadByte();
 
-// shift the known values for interpolation
-	VectorCopy (ent->msg_origins[0], ent->msg_origins[1]);
-	VectorCopy (ent->msg_angles[0], ent->msg_angles[1]);
+	if (bits & U_EFFECTS)
+		to->effects = MSG_ReadByte();
 
 	if (bits & U_ORIGIN1)
-		ent->msg_origins[0][0] = MSG_ReadCoord (cl.protocolflags);
-	else
-		ent->msg_origins[0][0] = ent->baseline.origin[0];
+		to->origin[0] = MSG_ReadCoord (cl.protocolflags);
 	if (bits & U_ANGLE1)
-		ent->msg_angles[0][0] = MSG_ReadAngle(cl.protocolflags);
-	else
-		ent->msg_angles[0][0] = ent->baseline.angles[0];
+		to->angles[0] = MSG_ReadAngle(cl.protocolflags);
 
 	if (bits & U_ORIGIN2)
-		ent->msg_origins[0][1] = MSG_ReadCoord (cl.protocolflags);
-	else
-		ent->msg_origins[0][1] = ent->baseline.origin[1];
+		to->origin[1] = MSG_ReadCoord (cl.protocolflags);
 	if (bits & U_ANGLE2)
-		ent->msg_angles[0][1] = MSG_ReadAngle(cl.protocolflags);
-	else
-		ent->msg_angles[0][1] = ent->baseline.angles[1];
+		to->angles[1] = MSG_ReadAngle(cl.protocolflags);
 
 	if (bits & U_ORIGIN3)
-		ent->msg_origins[0][2] = MSG_ReadCoord (cl.protocolflags);
-	else
-		ent->msg_origins[0][2] = ent->baseline.origin[2];
+		to->origin[2] = MSG_ReadCoord (cl.protocolflags);
 	if (bits & U_ANGLE3)
-		ent->msg_angles[0][2] = MSG_ReadAngle(cl.protocolflags);
-	else
-		ent->msg_angles[0][2] = ent->baseline.angles[2];
-
-	//johnfitz -- lerping for movetype_step entities
-	if (bits & U_STEP)
-	{
-		ent->lerpflags |= LERP_MOVESTEP;
-		ent->forcelink = true;
-	}
-	else
-		ent->lerpflags &= ~LERP_MOVESTEP;
-	//johnfitz
+		to->angles[2] = MSG_ReadAngle(cl.protocolflags);
 
 	//johnfitz -- PROTOCOL_FITZQUAKE and PROTOCOL_NEHAHRA
 	if (cl.protocol == PROTOCOL_FITZQUAKE || cl.protocol == PROTOCOL_RMQ)
 	{
 		if (bits & U_ALPHA)
-			ent->alpha = MSG_ReadByte();
-		else
-			ent->alpha = ent->baseline.alpha;
+			to->alpha = MSG_ReadByte();
 		if (bits & U_SCALE)
 			MSG_ReadByte(); // PROTOCOL_RMQ: currently ignored
 		if (bits & U_FRAME2)
-			ent->frame = (ent->frame & 0x00FF) | (MSG_ReadByte() << 8);
+			to->frame = (to->frame & 0x00FF) | (MSG_ReadByte() << 8);
 		if (bits & U_MODEL2)
-			modnum = (modnum & 0x00FF) | (MSG_ReadByte() << 8);
+			to->modelindex = (to->modelindex & 0x00FF) | (MSG_ReadByte() << 8);
 		if (bits & U_LERPFINISH)
-		{
-			ent->lerpfinish = ent->msgtime + ((float)(MSG_ReadByte()) / 255);
-			ent->lerpflags |= LERP_FINISH;
-		}
-		else
-			ent->lerpflags &= ~LERP_FINISH;
+			finish = MSG_ReadByte();
 	}
 	else if (cl.protocol == PROTOCOL_NETQUAKE)
 	{
@@ -596,15 +849,91 @@ void CL_ParseUpdate (int bits)
 			b = MSG_ReadFloat(); //alpha
 			if (a == 2)
 				MSG_ReadFloat(); //fullbright (not using this yet)
-			ent->alpha = ENTALPHA_ENCODE(b);
+			to->alpha = ENTALPHA_ENCODE(b);
 		}
-		else
-			ent->alpha = ent->baseline.alpha;
 	}
 	//johnfitz
 
+	return finish;
+}
+
+/*
+==================
+CL_SetEntityState
+
+Moves entity num to a new state from the current message.  'finish' is the
+U_LERPFINISH byte, -1 to clear it or -2 to keep the current one, 'step'
+whether it is a movestep entity.
+==================
+*/
+static void CL_SetEntityState (int num, const entity_state_t *state, int finish, qboolean step)
+{
+	qmodel_t	*model;
+	qboolean	forcelink;
+	entity_t	*ent;
+
+	ent = CL_EntityNum (num);
+
+	if (ent->msgtime != cl.mtime[1])
+		forcelink = true;	// no previous frame to lerp from
+	else
+		forcelink = false;
+
+	//johnfitz -- lerping
+	if (ent->msgtime + 0.2 < cl.mtime[0]) //more than 0.2 seconds since the last message (most entities think every 0.1 sec)
+		ent->lerpflags |= LERP_RESETANIM; //if we missed a think, we'd be lerping from the wrong frame
+	//johnfitz
+
+	ent->msgtime = cl.mtime[0];
+
+	ent->frame = state->frame;
+
+	if (!state->colormap)
+		ent->colormap = vid.colormap;
+	else
+	{
+		if (state->colormap > cl.maxclients)
+			Sys_Error ("i >= cl.maxclients");
+		ent->colormap = cl.scores[state->colormap-1].translations;
+	}
+	if (state->skin != ent->skinnum)
+	{
+		ent->skinnum = state->skin;
+		if (num > 0 && num <= cl.maxclients)
+			R_TranslateNewPlayerSkin (num - 1); //johnfitz -- was R_TranslatePlayerSkin
+	}
+	ent->effects = state->effects;
+
+// shift the known values for interpolation
+	VectorCopy (ent->msg_origins[0], ent->msg_origins[1]);
+	VectorCopy (ent->msg_angles[0], ent->msg_angles[1]);
+	VectorCopy (state->origin, ent->msg_origins[0]);
+	VectorCopy (state->angles, ent->msg_angles[0]);
+
+	//johnfitz -- lerping for movetype_step entities
+	if (step)
+	{
+		ent->lerpflags |= LERP_MOVESTEP;
+		ent->forcelink = true;
+	}
+	else
+		ent->lerpflags &= ~LERP_MOVESTEP;
+	//johnfitz
+
+	ent->alpha = state->alpha;
+	if (cl.protocol == PROTOCOL_FITZQUAKE || cl.protocol == PROTOCOL_RMQ)
+	{
+		if (finish >= 0)
+		{
+			ent->lerpfinish = ent->msgtime + ((float)finish / 255);
+			ent->lerpflags |= LERP_FINISH;
+		}
+		else if (finish == -1)
+			ent->lerpflags &= ~LERP_FINISH;
+	}
+
 	//johnfitz -- moved here from above
-	model = cl.model_precache[modnum];
+	model = cl.model_precache[state->modelindex];
 	if (model != ent->model)
 	{
 		ent->model = model;
@@ -636,6 +965,57 @@ void CL_ParseUpdate (int bits)
 	}
 }
 
+/*
+==================
+CL_ParseUpdate
+
+Parse an entity update message from the server
+If an entities model or origin changes from frame to frame, it must be
+relinked.  Other attributes can change without relinking.
+==================
+*/
+void CL_ParseUpdate (int bits)
+{
+	int		i;
+	int		num;
+	int		finish, start;
+	entity_state_t	state;
+
+	start = msg_readcount - 1;
+
+	if (cls.signon == SIGNONS - 1)
+	{	// first update is the final signon stage
+		cls.signon = SIGNONS;
+		CL_SignonReply ();
+	}
+
+	if (bits & U_MOREBITS)
+	{
+		i = MSG_ReadByte ();
+		bits |= (i<<8);
+	}
+
+	//johnfitz -- PROTOCOL_FITZQUAKE
+	if (cl.protocol == PROTOCOL_FITZQUAKE || cl.protocol == PROTOCOL_RMQ)
+	{
+		if (bits & U_EXTEND1)
+			bits |= MSG_ReadByte() << 16;
+		if (bits & U_EXTEND2)
+			bits |= MSG_ReadByte() << 24;
+	}
+	//johnfitz
+
+	if (bits & U_LONGENTITY)
+		num = MSG_ReadShort ();
+	else
+		num = MSG_ReadByte ();
+
+	finish = CL_ReadEntityState (bits, &CL_EntityNum (num)->baseline, &state);
+	CL_SetEntityState (num, &state, finish, (bits & U_STEP) != 0);
+	CL_DeltaStatsUpdate (num, &state, bits);
+	cl_statreceived += msg_readcount - start;
+}
+
 /*
 ==================
 CL_ParseBaseline
@@ -962,6 +1342,8 @@ void CL_ParseServerMessage (void)
 //
 	MSG_BeginReading ();
 
+	cl_deltastart = cl_deltaend = 0;
+	cl_fastupdates = false;
 	lastcmd = 0;
 	while (1)
 	{
@@ -973,6 +1355,9 @@ void CL_ParseServerMessage (void)
 		if (cmd == -1)
 		{
 			SHOWNET("END OF MESSAGE");
+			CL_DeltaStatsFrame ();
+			if (cl.deltadraining)
+				CL_DrainDeltaFrames ();
 			return;		// end of message
 		}
 
@@ -980,6 +1365,7 @@ void CL_ParseServerMessage (void)
 		if (cmd & U_SIGNAL) //johnfitz -- was 128, changed for clarity
 		{
 			SHOWNET("fast update");
+			cl_fastupdates = true;
 			CL_ParseUpdate (cmd&127);
 			continue;
 		}
@@ -1250,6 +1636,12 @@ void CL_ParseServerMessage (void)
 			str = MSG_ReadString();
 			Con_DPrintf("Ignoring svc_achievement (%s)\n", str);
 			break;
+
+		case svc_deltaentities:
+			cl_deltastart = msg_readcount - 1;
+			CL_ParseDeltaEntities ();
+			cl_deltaend = msg_readcount;
+			break;
 		}
 
 		lastcmd = cmd; //johnfitz
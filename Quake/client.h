@@ -128,6 +128,7 @@ typedef struct
 
 // connection information
 	int		signon;			// 0 to SIGNONS
+	double	signontime;		// realtime the signon started, for the developer report
 	struct qsocket_s	*netcon;
 	sizebuf_t	message;		// writing buffer to send to server
 
@@ -225,6 +226,9 @@ typedef struct
 
 	unsigned	protocol; //johnfitz
 	unsigned	protocolflags;
+
+	int			deltasequence;	// last svc_deltaentities frame, acked with each move
+	qboolean	deltadraining;	// asked for fast updates again, delta frames still arriving
 } client_state_t;
 
 
@@ -252,6 +256,10 @@ extern	cvar_t	cl_autofire;
 
 extern	cvar_t	cl_shownet;
 extern	cvar_t	cl_nolerp;
+extern	cvar_t	cl_deltaents;
+
+extern	cvar_t	timedemo_worst;
+extern	cvar_t	timedemo_csv;
 
 extern	cvar_t	cfg_unbindall;
 
@@ -338,13 +346,33 @@ int CL_GetMessage (void);
 
 void CL_Stop_f (void);
 void CL_Record_f (void);
+void CL_WriteDemoMessageCut (int start, int end);
 void CL_PlayDemo_f (void);
 void CL_TimeDemo_f (void);
 
+// where the time of a timedemo frame goes; each mark charges the time since
+// the previous one to a phase, and everything unmarked lands in TD_OTHER
+typedef enum
+{
+	TD_SERVER,		// local server and client input
+	TD_PARSE,		// reading server messages
+	TD_SCENE,		// view setup, visibility and particles
+	TD_DRAW,		// building and submitting draw calls
+	TD_PRESENT,		// post-processing and buffer swap
+	TD_SOUND,		// music, spatialization and mixing
+	TD_OTHER,		// input, console, the main loop
+	TD_NUMPHASES
+} tdphase_t;
+
+void CL_TimeDemoMark (tdphase_t phase);
+void CL_TimeDemoEndFrame (void);
+
 //
 // cl_parse.c
 //
 void CL_ParseServerMessage (void);
+void CL_ClearDeltaFrames (void);
+void CL_DeltaStats_f (void);
 void CL_NewTranslation (int slot);
 
 //
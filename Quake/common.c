@@ -41,6 +41,8 @@ static qboolean		com_modified;	// set true if using non-id files
 qboolean		fitzmode;
 
 static void COM_Path_f (void);
+static void COM_PathBenchmark_f (void);
+static FILE *COM_InflateToTempFile (FILE *f, long length);
 
 // if a packfile directory differs from this, it is assumed to be hacked
 #define PAK0_COUNT		339	/* id1/pak0.pak - v1.0x */
@@ -805,6 +807,60 @@ void MSG_WriteAngle (sizebuf_t *sb, float f, unsigned int flags)
 	else MSG_WriteByte (sb, Q_rint(f * 256.0 / 360.0) & 255); //johnfitz -- use Q_rint instead of (int)	}
 }
 
+/*
+==================
+MSG_EntityDeltaBits
+
+Returns the U_* field bits needed to turn entity state 'from' into 'to' in
+an update.  Update flags that don't follow from the state (U_STEP,
+U_LERPFINISH) and the header bits are left to the caller.
+==================
+*/
+int MSG_EntityDeltaBits (const entity_state_t *from, const entity_state_t *to)
+{
+	int		i, bits;
+	float	miss;
+
+	bits = 0;
+
+	for (i = 0; i < 3; i++)
+	{
+		miss = to->origin[i] - from->origin[i];
+		if (miss < -0.1 || miss > 0.1)
+			bits |= U_ORIGIN1<<i;
+	}
+
+	if (to->angles[0] != from->angles[0])
+		bits |= U_ANGLE1;
+	if (to->angles[1] != from->angles[1])
+		bits |= U_ANGLE2;
+	if (to->angles[2] != from->angles[2])
+		bits |= U_ANGLE3;
+
+	if (to->colormap != from->colormap)
+		bits |= U_COLORMAP;
+	if (to->skin != from->skin)
+		bits |= U_SKIN;
+	if (to->frame != from->frame)
+	{
+		bits |= U_FRAME;
+		if (to->frame & 0xFF00)
+			bits |= U_FRAME2;
+	}
+	if (to->effects != from->effects)
+		bits |= U_EFFECTS;
+	if (to->modelindex != from->modelindex)
+	{
+		bits |= U_MODEL;
+		if (to->modelindex & 0xFF00)
+			bits |= U_MODEL2;
+	}
+	if (to->alpha != from->alpha)
+		bits |= U_ALPHA;
+
+	return bits;
+}
+
 //johnfitz -- for PROTOCOL_FITZQUAKE
 void MSG_WriteAngle16 (sizebuf_t *sb, float f, unsigned int flags)
 {
@@ -1344,13 +1400,13 @@ being registered.
 */
 static void COM_CheckRegistered (void)
 {
-	int		h;
-	unsigned short	check[128];
+	unsigned short	stackbuf[129];	// +1 for the trailing 0 COM_LoadStackFile appends
+	unsigned short	*check;
 	int		i;
 
-	COM_OpenFile("gfx/pop.lmp", &h, NULL);
-
-	if (h == -1)
+	// loaded rather than read through a handle, since it may be deflated in a pk3
+	check = (unsigned short *) COM_LoadStackFile ("gfx/pop.lmp", stackbuf, sizeof(stackbuf), NULL);
+	if (!check)
 	{
 		Cvar_SetROM ("registered", "0");
 		Con_Printf ("Playing shareware version.\n");
@@ -1363,9 +1419,6 @@ static void COM_CheckRegistered (void)
 		return;
 	}
 
-	Sys_FileRead (h, check, sizeof(check));
-	COM_CloseFile (h);
-
 	for (i = 0; i < 128; i++)
 	{
 		if (pop[i] != (unsigned short)BigShort (check[i]))
@@ -1561,6 +1614,13 @@ int	file_from_pak;		// ZOID: global indicating that file came from a pak
 searchpath_t	*com_searchpaths;
 searchpath_t	*com_base_searchpaths;
 
+static qboolean		com_packindex = true;	// false: linear pack scans, for path_benchmark
+static unsigned int	com_numlookups;
+static unsigned int	com_nummisses;
+static qboolean		com_mapfiles = true;	// false: -nommap, always read into memory
+static int		com_fileofs;		// offset of the last found file in its pak
+static int		com_filecomplen;	// nonzero if it is deflated in a pk3
+
 /*
 ============
 COM_Path_f
@@ -1575,11 +1635,83 @@ static void COM_Path_f (void)
 	{
 		if (s->pack)
 		{
-			Con_Printf ("%s (%i files)\n", s->pack->filename, s->pack->numfiles);
+			Con_Printf ("%s (%i files, %u lookups, %u hits)\n", s->pack->filename, s->pack->numfiles,
+				s->pack->lookups, s->pack->hits);
 		}
 		else
 			Con_Printf ("%s\n", s->filename);
 	}
+	Con_Printf ("%u file lookups, %u not found\n", com_numlookups, com_nummisses);
+}
+
+/*
+============
+COM_IndexPackFile
+
+Builds the filename hash table of a pack. When a pack contains
+the same name more than once, the first entry wins, like it did
+with the linear scan.
+============
+*/
+static void COM_IndexPackFile (pack_t *pack)
+{
+	int		i, pos, mask;
+
+	pack->hashsize = 1;
+	while (pack->hashsize < pack->numfiles * 2) // 50% load factor at most
+		pack->hashsize <<= 1;
+	pack->hashtable = (int *) Z_Malloc (pack->hashsize * sizeof(int));
+	memset (pack->hashtable, -1, pack->hashsize * sizeof(int));
+
+	mask = pack->hashsize - 1;
+	for (i = 0; i < pack->numfiles; i++)
+	{
+		for (pos = COM_HashString (pack->files[i].name) & mask; pack->hashtable[pos] != -1; pos = (pos + 1) & mask)
+		{
+			if (!strcmp (pack->files[pack->hashtable[pos]].name, pack->files[i].name))
+				break;
+		}
+		if (pack->hashtable[pos] == -1)
+			pack->hashtable[pos] = i;
+	}
+}
+
+/*
+============
+COM_FindPackFile
+
+Returns the index of filename in pack, or -1
+============
+*/
+static int COM_FindPackFile (pack_t *pack, const char *filename, unsigned int hash)
+{
+	int		i, pos, mask;
+
+	pack->lookups++;
+
+	if (!com_packindex)
+	{
+		for (i = 0; i < pack->numfiles; i++)
+		{
+			if (!strcmp (pack->files[i].name, filename))
+			{
+				pack->hits++;
+				return i;
+			}
+		}
+		return -1;
+	}
+
+	mask = pack->hashsize - 1;
+	for (pos = hash & mask; (i = pack->hashtable[pos]) != -1; pos = (pos + 1) & mask)
+	{
+		if (!strcmp (pack->files[i].name, filename))
+		{
+			pack->hits++;
+			return i;
+		}
+	}
+	return -1;
 }
 
 /*
@@ -1664,11 +1796,15 @@ static int COM_FindFile (const char *filename, int *handle, FILE **file,
 	char		netpath[MAX_OSPATH];
 	pack_t		*pak;
 	int		i, findtime;
+	unsigned int	hash;
 
 	if (file && handle)
 		Sys_Error ("COM_FindFile: both handle and file set");
 
 	file_from_pak = 0;
+	com_filecomplen = 0;
+	com_numlookups++;
+	hash = COM_HashString (filename);
 
 //
 // search through the path, one element at a time
@@ -1678,12 +1814,13 @@ static int COM_FindFile (const char *filename, int *handle, FILE **file,
 		if (search->pack)	/* look through all the pak file elements */
 		{
 			pak = search->pack;
-			for (i = 0; i < pak->numfiles; i++)
+			i = COM_FindPackFile (pak, filename, hash);
+			if (i != -1)
 			{
-				if (strcmp(pak->files[i].name, filename) != 0)
-					continue;
 				// found it!
 				com_filesize = pak->files[i].filelen;
+				com_fileofs = pak->files[i].filepos;
+				com_filecomplen = pak->files[i].complen;
 				file_from_pak = 1;
 				if (path_id)
 					*path_id = search->path_id;
@@ -1719,6 +1856,7 @@ static int COM_FindFile (const char *filename, int *handle, FILE **file,
 			if (findtime == -1)
 				continue;
 
+			com_fileofs = 0;
 			if (path_id)
 				*path_id = search->path_id;
 			if (handle)
@@ -1748,6 +1886,8 @@ static int COM_FindFile (const char *filename, int *handle, FILE **file,
 		Con_DPrintf ("FindFile: can't find %s\n", filename);
 	else	Con_DPrintf2("FindFile: can't find %s\n", filename);
 
+	com_nummisses++;
+
 	if (handle)
 		*handle = -1;
 	if (file)
@@ -1770,6 +1910,82 @@ qboolean COM_FileExists (const char *filename, unsigned int *path_id)
 	return (ret == -1) ? false : true;
 }
 
+/*
+============
+COM_PathBenchmarkPass
+
+Looks up every file the current map precaches, along with the
+external .lit/.vis/.ent probes. Returns the number of lookups.
+============
+*/
+static int COM_PathBenchmarkPass (void)
+{
+	static const char *const probes[] = {"lit", "vis", "ent"};
+	char	path[MAX_QPATH];
+	int	i, count = 0;
+
+	for (i = 1; i < MAX_MODELS && sv.model_precache[i]; i++)
+	{
+		if (sv.model_precache[i][0] == '*')
+			continue;
+		COM_FileExists (sv.model_precache[i], NULL);
+		count++;
+	}
+	for (i = 1; i < MAX_SOUNDS && sv.sound_precache[i]; i++)
+	{
+		q_snprintf (path, sizeof(path), "sound/%s", sv.sound_precache[i]);
+		COM_FileExists (path, NULL);
+		count++;
+	}
+	for (i = 0; i < (int) countof(probes); i++)
+	{
+		q_snprintf (path, sizeof(path), "maps/%s.%s", sv.name, probes[i]);
+		COM_FileExists (path, NULL);
+		count++;
+	}
+
+	return count;
+}
+
+/*
+============
+COM_PathBenchmark_f
+
+Times the precache lookups of the current map with linear pack
+scans and with the pack hash tables
+============
+*/
+static void COM_PathBenchmark_f (void)
+{
+	int		i, mode, passes, count = 0;
+	double		start, elapsed[2];
+	qboolean	oldindex = com_packindex;
+
+	if (!sv.active)
+	{
+		Con_Printf ("path_benchmark: no map loaded\n");
+		return;
+	}
+
+	passes = (Cmd_Argc () > 1) ? Q_atoi (Cmd_Argv (1)) : 100;
+	if (passes < 1)
+		passes = 1;
+
+	for (mode = 0; mode < 2; mode++)
+	{
+		com_packindex = (mode != 0);
+		start = Sys_DoubleTime ();
+		for (i = 0; i < passes; i++)
+			count = COM_PathBenchmarkPass ();
+		elapsed[mode] = Sys_DoubleTime () - start;
+	}
+	com_packindex = oldindex;
+
+	Con_Printf ("%i lookups x %i passes\n", count, passes);
+	Con_Printf ("linear: %.3f ms per pass\n", elapsed[0] * 1000.0 / passes);
+	Con_Printf ("hashed: %.3f ms per pass\n", elapsed[1] * 1000.0 / passes);
+}
+
 /*
 ===========
 COM_OpenFile
@@ -1789,12 +2005,23 @@ int COM_OpenFile (const char *filename, int *handle, unsigned int *path_id)
 COM_FOpenFile
 
 If the requested file is inside a packfile, a new FILE * will be opened
-into the file.
+into the file.  A deflated pk3 entry is inflated into a temporary file
+first; FS_fopen streams it instead.
 ===========
 */
 int COM_FOpenFile (const char *filename, FILE **file, unsigned int *path_id)
 {
-	return COM_FindFile (filename, NULL, file, path_id);
+	int		length;
+
+	length = COM_FindFile (filename, NULL, file, path_id);
+	if (length != -1 && com_filecomplen && *file)
+	{	// callers expect plain file data to read from
+		*file = COM_InflateToTempFile (*file, length);
+		if (!*file)
+			length = com_filesize = -1;
+	}
+
+	return length;
 }
 
 /*
@@ -1816,6 +2043,38 @@ void COM_CloseFile (int h)
 }
 
 
+/*
+============
+COM_InflateFile
+
+Reads the deflated pk3 entry h is positioned at and inflates it into the
+len bytes of buf in one go.
+============
+*/
+static void COM_InflateFile (int h, byte *buf, int len, int complen, const char *path)
+{
+	tinfl_decompressor	*inflator;
+	tinfl_status	status;
+	byte	*comp;
+	size_t	insize, outsize;
+
+	comp = (byte *) malloc (complen);
+	inflator = (tinfl_decompressor *) malloc (sizeof(tinfl_decompressor));
+	if (!comp || !inflator)
+		Sys_Error ("COM_LoadFile: not enough space to inflate %s", path);
+
+	insize = Sys_FileRead (h, comp, complen);
+	outsize = len;
+	tinfl_init (inflator);
+	status = tinfl_decompress (inflator, comp, &insize, buf, buf, &outsize,
+				TINFL_FLAG_USING_NON_WRAPPING_OUTPUT_BUF);
+	free (inflator);
+	free (comp);
+
+	if (status != TINFL_STATUS_DONE || outsize != (size_t) len)
+		Sys_Error ("COM_LoadFile: %s is corrupt", path);
+}
+
 /*
 ============
 COM_LoadFile
@@ -1840,7 +2099,7 @@ byte *COM_LoadFile (const char *path, int usehunk, unsigned int *path_id)
 	int		h;
 	byte	*buf;
 	char	base[32];
-	int		len;
+	int		len, complen;
 
 	buf = NULL;	// quiet compiler warning
 
@@ -1848,6 +2107,7 @@ byte *COM_LoadFile (const char *path, int usehunk, unsigned int *path_id)
 	len = COM_OpenFile (path, &h, path_id);
 	if (h == -1)
 		return NULL;
+	complen = com_filecomplen;
 
 // extract the filename base name for hunk tag
 	COM_FileBase (path, base, sizeof(base));
@@ -1884,7 +2144,10 @@ byte *COM_LoadFile (const char *path, int usehunk, unsigned int *path_id)
 
 	((byte *)buf)[len] = 0;
 
-	Sys_FileRead (h, buf, len);
+	if (complen)
+		COM_InflateFile (h, buf, len, complen, path);
+	else
+		Sys_FileRead (h, buf, len);
 	COM_CloseFile (h);
 
 	return buf;
@@ -1929,6 +2192,44 @@ byte *COM_LoadMallocFile (const char *path, unsigned int *path_id)
 	return COM_LoadFile (path, LOADFILE_MALLOC, path_id);
 }
 
+/*
+============
+COM_MapFile
+
+Returns a private copy-on-write view of the file straight out of the page
+cache, with com_filesize set, or NULL if the file can't be mapped (missing,
+deflated in a pk3, not word aligned inside its pak, -nommap, or no platform
+support), in which case the caller should load it the usual way.  The view
+is writable but is not '\0'-terminated, so it only suits binary loaders.
+Release it with COM_UnmapFile.
+============
+*/
+byte *COM_MapFile (const char *path, unsigned int *path_id)
+{
+	int	h, len;
+	byte	*data;
+
+	if (!com_mapfiles)
+		return NULL;
+
+	len = COM_OpenFile (path, &h, path_id);
+	if (h == -1)
+		return NULL;
+
+	data = NULL;
+	if (!com_filecomplen && (com_fileofs & (sizeof(int) - 1)) == 0)
+		data = (byte *) Sys_FileMap (h, com_fileofs, len);
+	COM_CloseFile (h);
+
+	com_filesize = len;
+	return data;
+}
+
+void COM_UnmapFile (byte *data, int length)
+{
+	Sys_FileUnmap (data, length);
+}
+
 byte *COM_LoadMallocFile_TextMode_OSPath (const char *path, long *len_out)
 {
 	FILE	*f;
@@ -2062,11 +2363,109 @@ static pack_t *COM_LoadPackFile (const char *packfile)
 	pack->handle = packhandle;
 	pack->numfiles = numpackfiles;
 	pack->files = newfiles;
+	COM_IndexPackFile (pack);
 
 	//Sys_Printf ("Added packfile %s (%i files)\n", packfile, numpackfiles);
 	return pack;
 }
 
+static size_t COM_ZipRead (void *opaque, mz_uint64 ofs, void *buf, size_t n)
+{
+	int	handle = *(int *)opaque;
+
+	Sys_FileSeek (handle, (int) ofs);
+	return Sys_FileRead (handle, buf, (int) n);
+}
+
+/*
+=================
+COM_LoadZipFile
+
+Takes an explicit (not game tree related) path to a pk3 file.
+
+Indexes the zip central directory into the same packfile_t table a pak
+uses, with filepos pointing past each local header at the file data, so
+stored entries are read exactly like pak entries.  Deflated entries are
+inflated on load.
+=================
+*/
+#define ZIP_LOCAL_HEADER_SIZE	30
+
+static pack_t *COM_LoadZipFile (const char *packfile)
+{
+	mz_zip_archive		archive;
+	mz_zip_archive_file_stat	stat;
+	byte		local[ZIP_LOCAL_HEADER_SIZE];
+	mz_uint64	dataofs;
+	int		i, numzipfiles;
+	packfile_t	*newfiles;
+	int		numpackfiles;
+	pack_t		*pack;
+	int		packhandle, packsize;
+
+	packsize = Sys_FileOpenRead (packfile, &packhandle);
+	if (packsize == -1)
+		return NULL;
+
+	memset (&archive, 0, sizeof(archive));
+	archive.m_pRead = COM_ZipRead;
+	archive.m_pIO_opaque = &packhandle;
+	if (!mz_zip_reader_init (&archive, packsize, 0))
+		Sys_Error ("%s is not a zip file", packfile);
+
+	numzipfiles = archive.m_total_files;
+	newfiles = (packfile_t *) Z_Malloc (q_max(numzipfiles, 1) * sizeof(packfile_t));
+
+	for (i = numpackfiles = 0; i < numzipfiles; i++)
+	{
+		if (!mz_zip_reader_file_stat (&archive, i, &stat) || stat.m_is_directory)
+			continue;
+		if (!stat.m_is_supported || (stat.m_method != 0 && stat.m_method != MZ_DEFLATED) ||
+		    stat.m_uncomp_size > INT_MAX || strlen (stat.m_filename) >= MAX_QPATH)
+		{
+			Sys_Printf ("WARNING: %s: can't use %s, ignored\n", packfile, stat.m_filename);
+			continue;
+		}
+
+		// the local header repeats the name, and its extra field may
+		// differ in size from the central directory's
+		if (COM_ZipRead (&packhandle, stat.m_local_header_ofs, local, sizeof(local)) != sizeof(local) ||
+		    local[0] != 'P' || local[1] != 'K' || local[2] != 3 || local[3] != 4)
+			Sys_Error ("Invalid zip file %s (bad local header for %s)", packfile, stat.m_filename);
+		dataofs = stat.m_local_header_ofs + sizeof(local) +
+				(local[26] | (local[27] << 8)) + (local[28] | (local[29] << 8));
+		if (dataofs + stat.m_comp_size > (mz_uint64) packsize)
+			Sys_Error ("Invalid zip file %s (%s runs past the end)", packfile, stat.m_filename);
+
+		q_strlcpy (newfiles[numpackfiles].name, stat.m_filename, sizeof(newfiles[numpackfiles].name));
+		newfiles[numpackfiles].filepos = (int) dataofs;
+		newfiles[numpackfiles].filelen = (int) stat.m_uncomp_size;
+		if (stat.m_method == MZ_DEFLATED && stat.m_uncomp_size)
+			newfiles[numpackfiles].complen = (int) stat.m_comp_size;
+		numpackfiles++;
+	}
+	mz_zip_reader_end (&archive);
+
+	if (!numpackfiles)
+	{
+		Sys_Printf ("WARNING: %s has no files, ignored\n", packfile);
+		Z_Free (newfiles);
+		Sys_FileClose (packhandle);
+		return NULL;
+	}
+
+	com_modified = true;	// not the original pak0
+
+	pack = (pack_t *) Z_Malloc (sizeof (pack_t));
+	q_strlcpy (pack->filename, packfile, sizeof(pack->filename));
+	pack->handle = packhandle;
+	pack->numfiles = numpackfiles;
+	pack->files = newfiles;
+	COM_IndexPackFile (pack);
+
+	return pack;
+}
+
 const char *COM_GetGameNames(qboolean full)
 {
 	if (full)
@@ -2080,6 +2479,72 @@ const char *COM_GetGameNames(qboolean full)
 //	return COM_SkipPath(com_gamedir);
 }
 
+static void COM_AddPackPath (pack_t *pak, unsigned int path_id)
+{
+	searchpath_t *search;
+
+	search = (searchpath_t *) Z_Malloc(sizeof(searchpath_t));
+	search->path_id = path_id;
+	search->pack = pak;
+	search->next = com_searchpaths;
+	com_searchpaths = search;
+}
+
+static int COM_SortZipNames (const void *a, const void *b)
+{
+	return q_strcasecmp (*(const char **)a, *(const char **)b);
+}
+
+/*
+=================
+COM_AddZipFiles
+
+Adds the pk3 files of com_gamedir that aren't named like the numbered
+paks, in alphabetical order so later names take priority.  numpaks is
+how many numbered paks were found, and pakN.pk3 beyond it is loaded
+here as well.
+=================
+*/
+static void COM_AddZipFiles (unsigned int path_id, int numpaks)
+{
+	findfile_t	*find;
+	char		**names;
+	int		i, num, max, n;
+	char		pakfile[MAX_OSPATH];
+	pack_t		*pak;
+
+	names = NULL;
+	num = max = 0;
+	for (find = Sys_FindFirst (com_gamedir, "pk3"); find; find = Sys_FindNext (find))
+	{
+		if (find->attribs & FA_DIRECTORY)
+			continue;
+		if (sscanf (find->name, "pak%d.pk3", &n) == 1 && n >= 0 && n < numpaks &&
+		    !strcmp (find->name, va("pak%d.pk3", n)))
+			continue;	// already added along with pakN.pak
+		if (num == max)
+		{
+			max = max ? max * 2 : 16;
+			names = (char **) Z_Realloc (names, max * sizeof(char *));
+		}
+		names[num++] = Z_Strdup (find->name);
+	}
+
+	if (!num)
+		return;
+	qsort (names, num, sizeof(char *), COM_SortZipNames);
+
+	for (i = 0; i < num; i++)
+	{
+		q_snprintf (pakfile, sizeof(pakfile), "%s/%s", com_gamedir, names[i]);
+		pak = COM_LoadZipFile (pakfile);
+		if (pak)
+			COM_AddPackPath (pak, path_id);
+		Z_Free (names[i]);
+	}
+	Z_Free (names);
+}
+
 /*
 =================
 COM_AddGameDirectory -- johnfitz -- modified based on topaz's tutorial
@@ -2091,7 +2556,7 @@ static void COM_AddGameDirectory (const char *dir)
 	int i;
 	unsigned int path_id;
 	searchpath_t *search;
-	pack_t *pak, *qspak;
+	pack_t *pak, *qspak, *pk3;
 	char pakfile[MAX_OSPATH];
 	qboolean been_here = false;
 
@@ -2126,10 +2591,13 @@ _add_path:
 	com_searchpaths = search;
 
 	// add any pak files in the format pak0.pak pak1.pak, ...
+	// each optionally followed by a pak0.pk3 pak1.pk3, ...
 	for (i = 0; ; i++)
 	{
 		q_snprintf (pakfile, sizeof(pakfile), "%s/pak%i.pak", com_gamedir, i);
 		pak = COM_LoadPackFile (pakfile);
+		q_snprintf (pakfile, sizeof(pakfile), "%s/pak%i.pk3", com_gamedir, i);
+		pk3 = COM_LoadZipFile (pakfile);
 		if (i != 0 || path_id != 1 || fitzmode)
 			qspak = NULL;
 		else {
@@ -2139,23 +2607,18 @@ _add_path:
 			qspak = COM_LoadPackFile (pakfile);
 			com_modified = old;
 		}
-		if (pak) {
-			search = (searchpath_t *) Z_Malloc(sizeof(searchpath_t));
-			search->path_id = path_id;
-			search->pack = pak;
-			search->next = com_searchpaths;
-			com_searchpaths = search;
-		}
-		if (qspak) {
-			search = (searchpath_t *) Z_Malloc(sizeof(searchpath_t));
-			search->path_id = path_id;
-			search->pack = qspak;
-			search->next = com_searchpaths;
-			com_searchpaths = search;
-		}
-		if (!pak) break;
+		if (pak)
+			COM_AddPackPath (pak, path_id);
+		if (qspak)
+			COM_AddPackPath (qspak, path_id);
+		if (pk3)
+			COM_AddPackPath (pk3, path_id);
+		if (!pak && !pk3) break;
 	}
 
+	// then any other pk3 files
+	COM_AddZipFiles (path_id, i);
+
 	if (!been_here && host_parms->userdir != host_parms->basedir)
 	{
 		been_here = true;
@@ -2176,6 +2639,7 @@ void COM_ResetGameDirectories(char *newgamedirs)
 		{
 			Sys_FileClose (com_searchpaths->pack->handle);
 			Z_Free (com_searchpaths->pack->files);
+			Z_Free (com_searchpaths->pack->hashtable);
 			Z_Free (com_searchpaths->pack);
 		}
 		search = com_searchpaths->next;
@@ -2312,8 +2776,12 @@ void COM_InitFilesystem (void) //johnfitz -- modified based on topaz's tutorial
 	Cvar_RegisterVariable (&registered);
 	Cvar_RegisterVariable (&cmdline);
 	Cmd_AddCommand ("path", COM_Path_f);
+	Cmd_AddCommand ("path_benchmark", COM_PathBenchmark_f);
 	Cmd_AddCommand ("game", COM_Game_f); //johnfitz
 
+	if (COM_CheckParm ("-nommap"))
+		com_mapfiles = false;
+
 	i = COM_CheckParm ("-basedir");
 	if (i && i < com_argc-1)
 		q_strlcpy (com_basedir, com_argv[i + 1], sizeof(com_basedir));
@@ -2385,8 +2853,172 @@ void COM_InitFilesystem (void) //johnfitz -- modified based on topaz's tutorial
 /* The following FS_*() stdio replacements are necessary if one is
  * to perform non-sequential reads on files reopened on pak files
  * because we need the bookkeeping about file start/end positions.
- * Allocating and filling in the fshandle_t structure is the users'
- * responsibility when the file is initially opened. */
+ * Allocating the fshandle_t structure is the users' responsibility,
+ * FS_fopen() fills it in. */
+
+/* A deflated pk3 entry is inflated on the fly through a window of
+ * TINFL_LZ_DICT_SIZE bytes.  Its start and length are offsets into
+ * the inflated data, so the codecs' tag skipping works unchanged.
+ * Seeking backwards restarts the inflater, seeking forwards inflates
+ * and discards. */
+typedef struct fszip_s
+{
+	long	datapos;	/* deflated data offset in the pk3 */
+	long	complen;	/* deflated data size */
+	long	compread;	/* deflated bytes read so far */
+	long	outpos;		/* inflated offset of the next byte handed out */
+	tinfl_status	status;
+	tinfl_decompressor	inflator;
+	size_t	inofs, inlen;
+	size_t	dictofs;	/* where tinfl writes next */
+	size_t	availofs, avail;	/* inflated bytes not handed out yet */
+	byte	in[16384];
+	byte	dict[TINFL_LZ_DICT_SIZE];
+} fszip_t;
+
+static void FS_ZipRestart (fshandle_t *fh)
+{
+	fszip_t *z = fh->zip;
+
+	tinfl_init (&z->inflator);
+	z->status = TINFL_STATUS_NEEDS_MORE_INPUT;
+	z->compread = z->outpos = 0;
+	z->inofs = z->inlen = 0;
+	z->dictofs = z->availofs = z->avail = 0;
+	fseek (fh->file, z->datapos, SEEK_SET);
+}
+
+/* the file must be positioned at the deflated data */
+static void FS_ZipOpen (fshandle_t *fh, long complen)
+{
+	fh->zip = (fszip_t *) malloc (sizeof(fszip_t));
+	if (!fh->zip)
+		Sys_Error ("FS_ZipOpen: out of memory");
+	fh->zip->datapos = ftell (fh->file);
+	fh->zip->complen = complen;
+	fh->start = 0;
+	FS_ZipRestart (fh);
+}
+
+/* inflates the next count bytes into ptr, or skips them if ptr is
+ * NULL.  returns the number of bytes produced. */
+static long FS_ZipInflate (fshandle_t *fh, byte *ptr, long count)
+{
+	fszip_t *z = fh->zip;
+	long done = 0;
+	size_t n, insize, outsize;
+
+	while (done < count)
+	{
+		if (z->avail)
+		{
+			n = q_min(z->avail, (size_t)(count - done));
+			if (ptr)
+				memcpy (ptr + done, z->dict + z->availofs, n);
+			z->availofs += n;
+			z->avail -= n;
+			z->outpos += n;
+			done += n;
+			continue;
+		}
+		if (z->status != TINFL_STATUS_NEEDS_MORE_INPUT &&
+		    z->status != TINFL_STATUS_HAS_MORE_OUTPUT)
+			break;	/* done or failed */
+
+		if (z->inofs == z->inlen && z->compread < z->complen)
+		{
+			n = q_min(sizeof(z->in), (size_t)(z->complen - z->compread));
+			n = fread (z->in, 1, n, fh->file);
+			if (!n)
+			{
+				z->status = TINFL_STATUS_FAILED;
+				break;
+			}
+			z->compread += n;
+			z->inofs = 0;
+			z->inlen = n;
+		}
+
+		insize = z->inlen - z->inofs;
+		outsize = TINFL_LZ_DICT_SIZE - z->dictofs;
+		z->status = tinfl_decompress (&z->inflator, z->in + z->inofs, &insize,
+				z->dict, z->dict + z->dictofs, &outsize,
+				(z->compread < z->complen) ? TINFL_FLAG_HAS_MORE_INPUT : 0);
+		z->inofs += insize;
+		z->availofs = z->dictofs;
+		z->avail = outsize;
+		z->dictofs = (z->dictofs + outsize) & (TINFL_LZ_DICT_SIZE - 1);
+	}
+
+	return done;
+}
+
+/* brings the inflater to the current position of fh */
+static qboolean FS_ZipSeek (fshandle_t *fh)
+{
+	fszip_t *z = fh->zip;
+	long target = fh->start + fh->pos;
+
+	if (target < z->outpos)
+		FS_ZipRestart (fh);
+	if (target > z->outpos)
+		FS_ZipInflate (fh, NULL, target - z->outpos);
+
+	return z->outpos == target;
+}
+
+long FS_fopen (const char *filename, fshandle_t *fh, unsigned int *path_id)
+{
+	FILE *f;
+	long length;
+
+	length = COM_FindFile (filename, NULL, &f, path_id);
+	if (length == -1 || !f)
+		return -1;
+
+	memset (fh, 0, sizeof(fshandle_t));
+	fh->file = f;
+	fh->pak = file_from_pak;
+	fh->length = length;
+	if (com_filecomplen)
+		FS_ZipOpen (fh, com_filecomplen);
+	else
+		fh->start = ftell (f);
+
+	return length;
+}
+
+/* for COM_FOpenFile() callers who can only deal with a FILE * */
+static FILE *COM_InflateToTempFile (FILE *f, long length)
+{
+	fshandle_t fh;
+	FILE *tmp;
+	byte buf[4096];
+	long n;
+
+	memset (&fh, 0, sizeof(fh));
+	fh.file = f;
+	fh.length = length;
+	FS_ZipOpen (&fh, com_filecomplen);
+
+	tmp = tmpfile ();
+	while (tmp && (n = (long) FS_fread (buf, 1, sizeof(buf), &fh)) > 0)
+	{
+		if (fwrite (buf, 1, n, tmp) != (size_t) n)
+			break;
+	}
+	if (tmp && ftell (tmp) != length)
+	{
+		Con_Printf ("Couldn't inflate %ld bytes into a temporary file\n", length);
+		fclose (tmp);
+		tmp = NULL;
+	}
+	FS_fclose (&fh);
+
+	if (tmp)
+		rewind (tmp);
+	return tmp;
+}
 
 size_t FS_fread(void *ptr, size_t size, size_t nmemb, fshandle_t *fh)
 {
@@ -2410,7 +3042,10 @@ size_t FS_fread(void *ptr, size_t size, size_t nmemb, fshandle_t *fh)
 	byte_size = nmemb * size;
 	if (byte_size > fh->length - fh->pos)	/* just read to end */
 		byte_size = fh->length - fh->pos;
-	bytes_read = fread(ptr, 1, byte_size, fh->file);
+	if (fh->zip)
+		bytes_read = FS_ZipSeek(fh) ? FS_ZipInflate(fh, (byte *) ptr, byte_size) : 0;
+	else
+		bytes_read = fread(ptr, 1, byte_size, fh->file);
 	fh->pos += bytes_read;
 
 	/* fread() must return the number of elements read,
@@ -2460,7 +3095,8 @@ int FS_fseek(fshandle_t *fh, long offset, int whence)
 	if (offset > fh->length)	/* just seek to end */
 		offset = fh->length;
 
-	ret = fseek(fh->file, fh->start + offset, SEEK_SET);
+	/* the inflater catches up on the next read */
+	ret = fh->zip ? 0 : fseek(fh->file, fh->start + offset, SEEK_SET);
 	if (ret < 0)
 		return ret;
 
@@ -2474,6 +3110,10 @@ int FS_fclose(fshandle_t *fh)
 		errno = EBADF;
 		return -1;
 	}
+	if (fh->zip) {
+		free(fh->zip);
+		fh->zip = NULL;
+	}
 	return fclose(fh->file);
 }
 
@@ -2490,7 +3130,8 @@ void FS_rewind(fshandle_t *fh)
 {
 	if (!fh) return;
 	clearerr(fh->file);
-	fseek(fh->file, fh->start, SEEK_SET);
+	if (!fh->zip)
+		fseek(fh->file, fh->start, SEEK_SET);
 	fh->pos = 0;
 }
 
@@ -2511,6 +3152,8 @@ int FS_ferror(fshandle_t *fh)
 		errno = EBADF;
 		return -1;
 	}
+	if (fh->zip && fh->zip->status < 0)
+		return -1;
 	return ferror(fh->file);
 }
 
@@ -2522,6 +3165,10 @@ int FS_fgetc(fshandle_t *fh)
 	}
 	if (fh->pos >= fh->length)
 		return EOF;
+	if (fh->zip) {
+		byte c;
+		return (FS_fread(&c, 1, 1, fh) == 1) ? c : EOF;
+	}
 	fh->pos += 1;
 	return fgetc(fh->file);
 }
@@ -2536,6 +3183,17 @@ char *FS_fgets(char *s, int size, fshandle_t *fh)
 	if (size > (fh->length - fh->pos) + 1)
 		size = (fh->length - fh->pos) + 1;
 
+	if (fh->zip) {
+		int i, c;
+		for (i = 0; i < size - 1 && (c = FS_fgetc(fh)) != EOF; ) {
+			s[i++] = c;
+			if (c == '\n')
+				break;
+		}
+		s[i] = 0;
+		return i ? s : NULL;
+	}
+
 	ret = fgets(s, size, fh->file);
 	fh->pos = ftell(fh->file) - fh->start;
 
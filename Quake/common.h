@@ -227,6 +227,7 @@ typedef struct
 {
 	char	name[MAX_QPATH];
 	int		filepos, filelen;
+	int		complen;	// pk3: size of the deflated data, 0 if stored
 } packfile_t;
 
 typedef struct pack_s
@@ -235,6 +236,9 @@ typedef struct pack_s
 	int		handle;
 	int		numfiles;
 	packfile_t	*files;
+	int		hashsize;	// power of two
+	int		*hashtable;	// indices into files, -1 for empty slots
+	unsigned int	lookups, hits;	// COM_FindFile stats, shown by "path"
 } pack_t;
 
 typedef struct searchpath_s
@@ -282,6 +286,11 @@ void COM_LoadCacheFile (const char *path, struct cache_user_s *cu,
 	// uses cache mem for allocating the buffer.
 byte *COM_LoadMallocFile (const char *path, unsigned int *path_id);
 	// allocates the buffer on the system mem (malloc).
+byte *COM_MapFile (const char *path, unsigned int *path_id);
+	// maps the file copy-on-write without reading it; returns NULL if it
+	// can't, and the caller falls back to one of the above.  the buffer
+	// is NOT '\0'-terminated.
+void COM_UnmapFile (byte *data, int length);
 
 // Opens the given path directly, ignoring search paths.
 // Returns NULL on failure, or else a '\0'-terminated malloc'ed buffer.
@@ -304,8 +313,8 @@ const char *COM_ParseStringNewline(const char *buffer);
 /* The following FS_*() stdio replacements are necessary if one is
  * to perform non-sequential reads on files reopened on pak files
  * because we need the bookkeeping about file start/end positions.
- * Allocating and filling in the fshandle_t structure is the users'
- * responsibility when the file is initially opened. */
+ * Allocating the fshandle_t structure is the users' responsibility,
+ * FS_fopen() fills it in. */
 
 typedef struct _fshandle_t
 {
@@ -314,8 +323,15 @@ typedef struct _fshandle_t
 	long start;	/* file or data start position */
 	long length;	/* file or data size */
 	long pos;	/* current position relative to start */
+	struct fszip_s *zip;	/* inflate state of a deflated pk3 entry, else NULL.
+				 * start and length are then offsets into the
+				 * inflated data rather than into the file. */
 } fshandle_t;
 
+long FS_fopen (const char *filename, fshandle_t *fh, unsigned int *path_id);
+	/* opens a file from the search path and fills in fh, returns
+	 * the length or -1 if not found. FS_fclose() to release it. */
+
 size_t FS_fread(void *ptr, size_t size, size_t nmemb, fshandle_t *fh);
 int FS_fseek(fshandle_t *fh, long offset, int whence);
 long FS_ftell(fshandle_t *fh);
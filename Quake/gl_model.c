@@ -36,6 +36,7 @@ qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash);
 
 cvar_t	external_ents = {"external_ents", "1", CVAR_ARCHIVE};
 cvar_t	external_vis = {"external_vis", "1", CVAR_ARCHIVE};
+cvar_t	mod_speeds = {"mod_speeds", "0", CVAR_NONE};
 
 static byte	*mod_novis;
 static int	mod_novis_capacity;
@@ -59,6 +60,7 @@ void Mod_Init (void)
 {
 	Cvar_RegisterVariable (&external_vis);
 	Cvar_RegisterVariable (&external_ents);
+	Cvar_RegisterVariable (&mod_speeds);
 
 	//johnfitz -- create notexture miptex
 	r_notexture_mip = (texture_t *) Hunk_AllocName (sizeof(texture_t), "r_notexture_mip");
@@ -309,7 +311,7 @@ qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash)
 {
 	byte	*buf;
 	byte	stackbuf[1024];		// avoid dirtying the cache heap
-	int	mod_type;
+	int	mod_type, mapped;
 
 	if (!mod->needload)
 	{
@@ -333,7 +335,10 @@ qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash)
 //
 // load the file
 //
-	buf = COM_LoadStackFile (mod->name, stackbuf, sizeof(stackbuf), & mod->path_id);
+	buf = COM_MapFile (mod->name, & mod->path_id);
+	mapped = buf ? com_filesize : 0;
+	if (!buf)
+		buf = COM_LoadStackFile (mod->name, stackbuf, sizeof(stackbuf), & mod->path_id);
 	if (!buf)
 	{
 		if (crash)
@@ -371,6 +376,9 @@ qmodel_t *Mod_LoadModel (qmodel_t *mod, qboolean crash)
 		break;
 	}
 
+	if (mapped)
+		COM_UnmapFile (buf, mapped);
+
 	return mod;
 }
 
@@ -499,6 +507,7 @@ void Mod_LoadTextures (lump_t *l)
 	loadmodel->numtextures = nummiptex + 2; //johnfitz -- need 2 dummy texture chains for missing textures
 	loadmodel->textures = (texture_t **) Hunk_AllocName (loadmodel->numtextures * sizeof(*loadmodel->textures) , loadname);
 
+	TexMgr_BeginImageBatch (); // preprocess the textures on the task threads
 	for (i=0 ; i<nummiptex ; i++)
 	{
 		m->dataofs[i] = LittleLong(m->dataofs[i]);
@@ -647,6 +656,7 @@ void Mod_LoadTextures (lump_t *l)
 		}
 		//johnfitz
 	}
+	TexMgr_EndImageBatch ();
 
 	//johnfitz -- last 2 slots in array should be filled with dummy textures
 	loadmodel->textures[loadmodel->numtextures-2] = r_notexture_mip; //for lightmapped surfs
@@ -932,11 +942,25 @@ _load_embedded:
 Mod_LoadVertexes
 =================
 */
+static void Mod_VertexesTask (void *data, int first, int last)
+{
+	dvertex_t	*in = (dvertex_t *)(mod_base + ((lump_t *)data)->fileofs) + first;
+	mvertex_t	*out = loadmodel->vertexes + first;
+	int			i;
+
+	for (i=first ; i<last ; i++, in++, out++)
+	{
+		out->position[0] = LittleFloat (in->point[0]);
+		out->position[1] = LittleFloat (in->point[1]);
+		out->position[2] = LittleFloat (in->point[2]);
+	}
+}
+
 void Mod_LoadVertexes (lump_t *l)
 {
 	dvertex_t	*in;
 	mvertex_t	*out;
-	int			i, count;
+	int			count;
 
 	in = (dvertex_t *)(mod_base + l->fileofs);
 	if (l->filelen % sizeof(*in))
@@ -947,12 +971,7 @@ void Mod_LoadVertexes (lump_t *l)
 	loadmodel->vertexes = out;
 	loadmodel->numvertexes = count;
 
-	for (i=0 ; i<count ; i++, in++, out++)
-	{
-		out->position[0] = LittleFloat (in->point[0]);
-		out->position[1] = LittleFloat (in->point[1]);
-		out->position[2] = LittleFloat (in->point[2]);
-	}
+	Tasks_Run (Mod_VertexesTask, l, count, 4096);
 }
 
 /*
@@ -960,10 +979,36 @@ void Mod_LoadVertexes (lump_t *l)
 Mod_LoadEdges
 =================
 */
+static void Mod_EdgesTask_L (void *data, int first, int last)
+{
+	dledge_t	*in = (dledge_t *)(mod_base + ((lump_t *)data)->fileofs) + first;
+	medge_t		*out = loadmodel->edges + first;
+	int			i;
+
+	for (i=first ; i<last ; i++, in++, out++)
+	{
+		out->v[0] = LittleLong(in->v[0]);
+		out->v[1] = LittleLong(in->v[1]);
+	}
+}
+
+static void Mod_EdgesTask_S (void *data, int first, int last)
+{
+	dsedge_t	*in = (dsedge_t *)(mod_base + ((lump_t *)data)->fileofs) + first;
+	medge_t		*out = loadmodel->edges + first;
+	int			i;
+
+	for (i=first ; i<last ; i++, in++, out++)
+	{
+		out->v[0] = (unsigned short)LittleShort(in->v[0]);
+		out->v[1] = (unsigned short)LittleShort(in->v[1]);
+	}
+}
+
 void Mod_LoadEdges (lump_t *l, int bsp2)
 {
 	medge_t *out;
-	int 	i, count;
+	int 	count;
 
 	if (bsp2)
 	{
@@ -978,11 +1023,7 @@ void Mod_LoadEdges (lump_t *l, int bsp2)
 		loadmodel->edges = out;
 		loadmodel->numedges = count;
 
-		for (i=0 ; i<count ; i++, in++, out++)
-		{
-			out->v[0] = LittleLong(in->v[0]);
-			out->v[1] = LittleLong(in->v[1]);
-		}
+		Tasks_Run (Mod_EdgesTask_L, l, count, 4096);
 	}
 	else
 	{
@@ -997,11 +1038,7 @@ void Mod_LoadEdges (lump_t *l, int bsp2)
 		loadmodel->edges = out;
 		loadmodel->numedges = count;
 
-		for (i=0 ; i<count ; i++, in++, out++)
-		{
-			out->v[0] = (unsigned short)LittleShort(in->v[0]);
-			out->v[1] = (unsigned short)LittleShort(in->v[1]);
-		}
+		Tasks_Run (Mod_EdgesTask_S, l, count, 4096);
 	}
 }
 
@@ -1064,10 +1101,11 @@ void Mod_LoadTexinfo (lump_t *l)
 ================
 CalcSurfaceExtents
 
-Fills in s->texturemins[] and s->extents[]
+Fills in s->texturemins[] and s->extents[].  Runs on the worker
+threads, so it returns false for bad extents instead of erroring out.
 ================
 */
-void CalcSurfaceExtents (msurface_t *s)
+static qboolean CalcSurfaceExtents (msurface_t *s)
 {
 	float	mins[2], maxs[2], val;
 	int		i,j, e;
@@ -1126,8 +1164,10 @@ void CalcSurfaceExtents (msurface_t *s)
 		s->extents[i] = (bmaxs[i] - bmins[i]) * 16;
 
 		if ( !(tex->flags & TEX_SPECIAL) && s->extents[i] > 2000) //johnfitz -- was 512 in glquake, 256 in winquake
-			Sys_Error ("Bad surface extents");
+			return false;
 	}
+
+	return true;
 }
 
 /*
@@ -1135,41 +1175,21 @@ void CalcSurfaceExtents (msurface_t *s)
 Mod_LoadFaces
 =================
 */
-void Mod_LoadFaces (lump_t *l, qboolean bsp2)
+static qboolean	mod_badextents;
+
+static void Mod_FillFaces (lump_t *l, qboolean bsp2, int first, int last)
 {
 	dsface_t	*ins;
 	dlface_t	*inl;
 	msurface_t 	*out;
-	int			i, count, surfnum, lofs;
+	int			i, surfnum, lofs;
 	int			planenum, side, texinfon;
 
-	if (bsp2)
-	{
-		ins = NULL;
-		inl = (dlface_t *)(mod_base + l->fileofs);
-		if (l->filelen % sizeof(*inl))
-			Sys_Error ("MOD_LoadBmodel: funny lump size in %s",loadmodel->name);
-		count = l->filelen / sizeof(*inl);
-	}
-	else
-	{
-		ins = (dsface_t *)(mod_base + l->fileofs);
-		inl = NULL;
-		if (l->filelen % sizeof(*ins))
-			Sys_Error ("MOD_LoadBmodel: funny lump size in %s",loadmodel->name);
-		count = l->filelen / sizeof(*ins);
-	}
-	out = (msurface_t *)Hunk_AllocName ( count*sizeof(*out), loadname);
-
-	//johnfitz -- warn mappers about exceeding old limits
-	if (count > 32767 && !bsp2)
-		Con_DWarning ("%i faces exceeds standard limit of 32767.\n", count);
-	//johnfitz
-
-	loadmodel->surfaces = out;
-	loadmodel->numsurfaces = count;
+	ins = (dsface_t *)(mod_base + l->fileofs) + first;
+	inl = (dlface_t *)(mod_base + l->fileofs) + first;
+	out = loadmodel->surfaces + first;
 
-	for (surfnum=0 ; surfnum<count ; surfnum++, out++)
+	for (surfnum=first ; surfnum<last ; surfnum++, out++)
 	{
 		texture_t *texture;
 		if (bsp2)
@@ -1206,7 +1226,8 @@ void Mod_LoadFaces (lump_t *l, qboolean bsp2)
 
 		out->texinfo = loadmodel->texinfo + texinfon;
 
-		CalcSurfaceExtents (out);
+		if (!CalcSurfaceExtents (out))
+			mod_badextents = true;	// reported after Tasks_Wait
 
 	// lighting info
 		if (loadmodel->bspversion == BSPVERSION_QUAKE64)
@@ -1229,10 +1250,7 @@ void Mod_LoadFaces (lump_t *l, qboolean bsp2)
 			if (out->texinfo->flags & TEX_SPECIAL)
 				out->flags |= SURF_DRAWTILED; 
 			else if (out->samples && !loadmodel->haslitwater)
-			{
-				Con_DPrintf ("Map has lit water\n");
-				loadmodel->haslitwater = true;
-			}
+				loadmodel->haslitwater = true;	// reported after Tasks_Wait
 
 			if (texture->type == TEXTYPE_LAVA)
 				out->flags |= SURF_DRAWLAVA;
@@ -1262,6 +1280,53 @@ void Mod_LoadFaces (lump_t *l, qboolean bsp2)
 	}
 }
 
+static void Mod_FacesTask_L (void *data, int first, int last)
+{
+	Mod_FillFaces ((lump_t *)data, true, first, last);
+}
+
+static void Mod_FacesTask_S (void *data, int first, int last)
+{
+	Mod_FillFaces ((lump_t *)data, false, first, last);
+}
+
+void Mod_LoadFaces (lump_t *l, qboolean bsp2)
+{
+	dsface_t	*ins;
+	dlface_t	*inl;
+	msurface_t 	*out;
+	int			count;
+
+	if (bsp2)
+	{
+		ins = NULL;
+		inl = (dlface_t *)(mod_base + l->fileofs);
+		if (l->filelen % sizeof(*inl))
+			Sys_Error ("MOD_LoadBmodel: funny lump size in %s",loadmodel->name);
+		count = l->filelen / sizeof(*inl);
+	}
+	else
+	{
+		ins = (dsface_t *)(mod_base + l->fileofs);
+		inl = NULL;
+		if (l->filelen % sizeof(*ins))
+			Sys_Error ("MOD_LoadBmodel: funny lump size in %s",loadmodel->name);
+		count = l->filelen / sizeof(*ins);
+	}
+	out = (msurface_t *)Hunk_AllocName ( count*sizeof(*out), loadname);
+
+	//johnfitz -- warn mappers about exceeding old limits
+	if (count > 32767 && !bsp2)
+		Con_DWarning ("%i faces exceeds standard limit of 32767.\n", count);
+	//johnfitz
+
+	loadmodel->surfaces = out;
+	loadmodel->numsurfaces = count;
+
+	mod_badextents = false;
+	Tasks_Run (bsp2 ? Mod_FacesTask_L : Mod_FacesTask_S, l, count, 256);
+}
+
 
 /*
 =================
@@ -1791,18 +1856,25 @@ void SoA_FillBoxLane(soa_aabb_t *boxes, int index, vec3_t mins, vec3_t maxs)
 Mod_PrepareSIMDData
 =================
 */
-void Mod_PrepareSIMDData (void)
-{
 #ifdef USE_SIMD
+static void Mod_SIMDDataTask (void *data, int first, int last)
+{
 	int i;
 
-	loadmodel->soa_leafbounds = Hunk_AllocName (6 * sizeof(float) * ((loadmodel->numleafs + 7) & ~7), "soa_leafbounds");
-
-	for (i = 0; i < loadmodel->numleafs; ++i)
+	for (i = first; i < last; ++i)
 	{
 		mleaf_t *leaf = &loadmodel->leafs[i + 1];
 		SoA_FillBoxLane(loadmodel->soa_leafbounds, i, leaf->minmaxs, leaf->minmaxs + 3);
 	}
+}
+#endif // def USE_SIMD
+
+void Mod_PrepareSIMDData (void)
+{
+#ifdef USE_SIMD
+	loadmodel->soa_leafbounds = Hunk_AllocName (6 * sizeof(float) * ((loadmodel->numleafs + 7) & ~7), "soa_leafbounds");
+
+	Tasks_Run (Mod_SIMDDataTask, NULL, loadmodel->numleafs, 4096);
 #endif // def USE_SIMD
 }
 
@@ -1811,13 +1883,63 @@ void Mod_PrepareSIMDData (void)
 Mod_LoadClipnodes
 =================
 */
+static qboolean	mod_badclipnodes;
+
+static void Mod_ClipnodesTask_L (void *data, int first, int last)
+{
+	dlclipnode_t	*inl = (dlclipnode_t *)(mod_base + ((lump_t *)data)->fileofs) + first;
+	mclipnode_t		*out = loadmodel->clipnodes + first;
+	int				i;
+
+	for (i=first ; i<last ; i++, out++, inl++)
+	{
+		out->planenum = LittleLong(inl->planenum);
+
+		//johnfitz -- bounds check
+		if (out->planenum < 0 || out->planenum >= loadmodel->numplanes)
+			mod_badclipnodes = true;	// reported after Tasks_Wait
+		//johnfitz
+
+		out->children[0] = LittleLong(inl->children[0]);
+		out->children[1] = LittleLong(inl->children[1]);
+		//Spike: FIXME: bounds check
+	}
+}
+
+static void Mod_ClipnodesTask_S (void *data, int first, int last)
+{
+	dsclipnode_t	*ins = (dsclipnode_t *)(mod_base + ((lump_t *)data)->fileofs) + first;
+	mclipnode_t		*out = loadmodel->clipnodes + first;
+	int				i, count = loadmodel->numclipnodes;
+
+	for (i=first ; i<last ; i++, out++, ins++)
+	{
+		out->planenum = LittleLong(ins->planenum);
+
+		//johnfitz -- bounds check
+		if (out->planenum < 0 || out->planenum >= loadmodel->numplanes)
+			mod_badclipnodes = true;	// reported after Tasks_Wait
+		//johnfitz
+
+		//johnfitz -- support clipnodes > 32k
+		out->children[0] = (unsigned short)LittleShort(ins->children[0]);
+		out->children[1] = (unsigned short)LittleShort(ins->children[1]);
+
+		if (out->children[0] >= count)
+			out->children[0] -= 65536;
+		if (out->children[1] >= count)
+			out->children[1] -= 65536;
+		//johnfitz
+	}
+}
+
 void Mod_LoadClipnodes (lump_t *l, qboolean bsp2)
 {
 	dsclipnode_t *ins;
 	dlclipnode_t *inl;
 
 	mclipnode_t *out; //johnfitz -- was dclipnode_t
-	int			i, count;
+	int			count;
 	hull_t		*hull;
 
 	if (bsp2)
@@ -1872,44 +1994,8 @@ void Mod_LoadClipnodes (lump_t *l, qboolean bsp2)
 	hull->clip_maxs[1] = 32;
 	hull->clip_maxs[2] = 64;
 
-	if (bsp2)
-	{
-		for (i=0 ; i<count ; i++, out++, inl++)
-		{
-			out->planenum = LittleLong(inl->planenum);
-
-			//johnfitz -- bounds check
-			if (out->planenum < 0 || out->planenum >= loadmodel->numplanes)
-				Host_Error ("Mod_LoadClipnodes: planenum out of bounds");
-			//johnfitz
-
-			out->children[0] = LittleLong(inl->children[0]);
-			out->children[1] = LittleLong(inl->children[1]);
-			//Spike: FIXME: bounds check
-		}
-	}
-	else
-	{
-		for (i=0 ; i<count ; i++, out++, ins++)
-		{
-			out->planenum = LittleLong(ins->planenum);
-
-			//johnfitz -- bounds check
-			if (out->planenum < 0 || out->planenum >= loadmodel->numplanes)
-				Host_Error ("Mod_LoadClipnodes: planenum out of bounds");
-			//johnfitz
-
-			//johnfitz -- support clipnodes > 32k
-			out->children[0] = (unsigned short)LittleShort(ins->children[0]);
-			out->children[1] = (unsigned short)LittleShort(ins->children[1]);
-
-			if (out->children[0] >= count)
-				out->children[0] -= 65536;
-			if (out->children[1] >= count)
-				out->children[1] -= 65536;
-			//johnfitz
-		}
-	}
+	mod_badclipnodes = false;
+	Tasks_Run (bsp2 ? Mod_ClipnodesTask_L : Mod_ClipnodesTask_S, l, count, 4096);
 }
 
 /*
@@ -1919,25 +2005,16 @@ Mod_MakeHull0
 Duplicate the drawing hull structure as a clipping hull
 =================
 */
-void Mod_MakeHull0 (void)
+static void Mod_MakeHull0Task (void *data, int first, int last)
 {
 	mnode_t		*in, *child;
 	mclipnode_t *out; //johnfitz -- was dclipnode_t
-	int			i, j, count;
-	hull_t		*hull;
-
-	hull = &loadmodel->hulls[0];
-
-	in = loadmodel->nodes;
-	count = loadmodel->numnodes;
-	out = (mclipnode_t *) Hunk_AllocName ( count*sizeof(*out), loadname);
+	int			i, j;
 
-	hull->clipnodes = out;
-	hull->firstclipnode = 0;
-	hull->lastclipnode = count-1;
-	hull->planes = loadmodel->planes;
+	in = loadmodel->nodes + first;
+	out = loadmodel->hulls[0].clipnodes + first;
 
-	for (i=0 ; i<count ; i++, out++, in++)
+	for (i=first ; i<last ; i++, out++, in++)
 	{
 		out->planenum = in->plane - loadmodel->planes;
 		for (j=0 ; j<2 ; j++)
@@ -1951,6 +2028,25 @@ void Mod_MakeHull0 (void)
 	}
 }
 
+void Mod_MakeHull0 (void)
+{
+	mclipnode_t *out; //johnfitz -- was dclipnode_t
+	int			count;
+	hull_t		*hull;
+
+	hull = &loadmodel->hulls[0];
+
+	count = loadmodel->numnodes;
+	out = (mclipnode_t *) Hunk_AllocName ( count*sizeof(*out), loadname);
+
+	hull->clipnodes = out;
+	hull->firstclipnode = 0;
+	hull->lastclipnode = count-1;
+	hull->planes = loadmodel->planes;
+
+	Tasks_Run (Mod_MakeHull0Task, NULL, count, 4096);
+}
+
 /*
 =================
 Mod_LoadMarksurfaces
@@ -2014,9 +2110,19 @@ void Mod_LoadMarksurfaces (lump_t *l, int bsp2)
 Mod_LoadSurfedges
 =================
 */
+static void Mod_SurfedgesTask (void *data, int first, int last)
+{
+	int		*in = (int *)(mod_base + ((lump_t *)data)->fileofs);
+	int		*out = loadmodel->surfedges;
+	int		i;
+
+	for (i=first ; i<last ; i++)
+		out[i] = LittleLong (in[i]);
+}
+
 void Mod_LoadSurfedges (lump_t *l)
 {
-	int		i, count;
+	int		count;
 	int		*in, *out;
 
 	in = (int *)(mod_base + l->fileofs);
@@ -2028,8 +2134,7 @@ void Mod_LoadSurfedges (lump_t *l)
 	loadmodel->surfedges = out;
 	loadmodel->numsurfedges = count;
 
-	for (i=0 ; i<count ; i++)
-		out[i] = LittleLong (in[i]);
+	Tasks_Run (Mod_SurfedgesTask, l, count, 16384);
 }
 
 
@@ -2038,24 +2143,14 @@ void Mod_LoadSurfedges (lump_t *l)
 Mod_LoadPlanes
 =================
 */
-void Mod_LoadPlanes (lump_t *l)
+static void Mod_PlanesTask (void *data, int first, int last)
 {
+	dplane_t 	*in = (dplane_t *)(mod_base + ((lump_t *)data)->fileofs) + first;
+	mplane_t	*out = loadmodel->planes + first;
 	int			i, j;
-	mplane_t	*out;
-	dplane_t 	*in;
-	int			count;
 	int			bits;
 
-	in = (dplane_t *)(mod_base + l->fileofs);
-	if (l->filelen % sizeof(*in))
-		Sys_Error ("MOD_LoadBmodel: funny lump size in %s",loadmodel->name);
-	count = l->filelen / sizeof(*in);
-	out = (mplane_t *) Hunk_AllocName ( count*2*sizeof(*out), loadname);
-
-	loadmodel->planes = out;
-	loadmodel->numplanes = count;
-
-	for (i=0 ; i<count ; i++, in++, out++)
+	for (i=first ; i<last ; i++, in++, out++)
 	{
 		bits = 0;
 		for (j=0 ; j<3 ; j++)
@@ -2071,6 +2166,24 @@ void Mod_LoadPlanes (lump_t *l)
 	}
 }
 
+void Mod_LoadPlanes (lump_t *l)
+{
+	mplane_t	*out;
+	dplane_t 	*in;
+	int			count;
+
+	in = (dplane_t *)(mod_base + l->fileofs);
+	if (l->filelen % sizeof(*in))
+		Sys_Error ("MOD_LoadBmodel: funny lump size in %s",loadmodel->name);
+	count = l->filelen / sizeof(*in);
+	out = (mplane_t *) Hunk_AllocName ( count*2*sizeof(*out), loadname);
+
+	loadmodel->planes = out;
+	loadmodel->numplanes = count;
+
+	Tasks_Run (Mod_PlanesTask, l, count, 4096);
+}
+
 /*
 =================
 RadiusFromBounds
@@ -2284,9 +2397,44 @@ static void Mod_LoadLeafsExternal(FILE* f)
 	Mod_ProcessLeafs_S((dsleaf_t *)in, filelen);
 }
 
+/*
+=================
+Mod_StageTime
+
+Returns the msec since the last call and the time spent waiting on the
+workers, for mod_speeds
+=================
+*/
+static double	mod_stagestart, mod_waittime;
+
+static double Mod_StageTime (void)
+{
+	double	now, msec;
+
+	now = Sys_DoubleTime ();
+	msec = (now - mod_stagestart) * 1000.0;
+	mod_stagestart = now;
+
+	return msec;
+}
+
+static void Mod_WaitTasks (void)
+{
+	double	start;
+
+	start = Sys_DoubleTime ();
+	Tasks_Wait ();
+	mod_waittime += (Sys_DoubleTime () - start) * 1000.0;
+}
+
 /*
 =================
 Mod_LoadBrushModel
+
+The lump loaders allocate on this thread and hand the byte swapping off
+to the workers, so they return before their data is ready.  Each stage
+below starts the conversion of the lumps the next one needs, does the
+GL, file and hunk work of its own in the meantime, then joins.
 =================
 */
 void Mod_LoadBrushModel (qmodel_t *mod, void *buffer)
@@ -2296,6 +2444,7 @@ void Mod_LoadBrushModel (qmodel_t *mod, void *buffer)
 	dheader_t	*header;
 	dmodel_t 	*bm;
 	float		radius; //johnfitz
+	double		lumps, faces, tree;
 
 	loadmodel->type = mod_brush;
 
@@ -2330,12 +2479,23 @@ void Mod_LoadBrushModel (qmodel_t *mod, void *buffer)
 
 // load into heap
 
+	mod_waittime = 0;
+	Mod_StageTime ();
+
+// stage 1: geometry lumps on the workers, textures and lighting here
 	Mod_LoadVertexes (&header->lumps[LUMP_VERTEXES]);
 	Mod_LoadEdges (&header->lumps[LUMP_EDGES], bsp2);
 	Mod_LoadSurfedges (&header->lumps[LUMP_SURFEDGES]);
+	Mod_LoadPlanes (&header->lumps[LUMP_PLANES]);
+	Mod_LoadClipnodes (&header->lumps[LUMP_CLIPNODES], bsp2);
 	Mod_LoadTextures (&header->lumps[LUMP_TEXTURES]);
 	Mod_LoadLighting (&header->lumps[LUMP_LIGHTING]);
-	Mod_LoadPlanes (&header->lumps[LUMP_PLANES]);
+	Mod_WaitTasks ();
+	if (mod_badclipnodes)
+		Host_Error ("Mod_LoadClipnodes: planenum out of bounds");
+	lumps = Mod_StageTime ();
+
+// stage 2: faces on the workers, marksurfaces and vis here
 	Mod_LoadTexinfo (&header->lumps[LUMP_TEXINFO]);
 	Mod_LoadFaces (&header->lumps[LUMP_FACES], bsp2);
 	Mod_LoadMarksurfaces (&header->lumps[LUMP_MARKSURFACES], bsp2);
@@ -2366,8 +2526,15 @@ void Mod_LoadBrushModel (qmodel_t *mod, void *buffer)
 	Mod_LoadVisibility (&header->lumps[LUMP_VISIBILITY]);
 	Mod_LoadLeafs (&header->lumps[LUMP_LEAFS], bsp2);
 visdone:
+	Mod_WaitTasks ();
+	if (mod_badextents)
+		Sys_Error ("Bad surface extents");
+	if (loadmodel->haslitwater)
+		Con_DPrintf ("Map has lit water\n");
+	faces = Mod_StageTime ();
+
+// stage 3: the hull0 and SIMD copies on the workers, the rest here
 	Mod_LoadNodes (&header->lumps[LUMP_NODES], bsp2);
-	Mod_LoadClipnodes (&header->lumps[LUMP_CLIPNODES], bsp2);
 	Mod_LoadEntities (&header->lumps[LUMP_ENTITIES]);
 	Mod_LoadSubmodels (&header->lumps[LUMP_MODELS]);
 
@@ -2378,6 +2545,12 @@ visdone:
 	mod->numframes = 2;		// regular and alternate animation
 
 	Mod_CheckWaterVis ();
+	Mod_WaitTasks ();
+	tree = Mod_StageTime ();
+
+	if (mod_speeds.value)
+		Con_Printf ("%s: %5.1f lumps %5.1f faces %5.1f tree, %5.1f waiting, %5.1f ms on %d threads\n",
+					mod->name, lumps, faces, tree, mod_waittime, lumps + faces + tree, Tasks_NumThreads ());
 
 //
 // set up the submodels (FIXME: this is confusing)
@@ -0,0 +1,509 @@
+/*
+ * gl_null.c -- an OpenGL driver that draws nothing, for headless builds
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* "make HEADLESS=1" links this in place of libGL.  every entry point the
+ * renderer uses is here and accepts its call, so the whole client runs up
+ * to the point of handing work to a GPU: names are handed out, shaders
+ * compile, framebuffers are complete and fences are always signalled.
+ * mapped buffers get real memory, so the copies into them still cost what
+ * they would with a driver.  the reported version and extensions are those
+ * of a typical desktop driver, minus bindless textures.
+ */
+
+#include "quakedef.h"
+
+static const char *const nullextensions[] =
+{
+	"GL_ARB_buffer_storage",
+	"GL_ARB_clip_control",
+	"GL_ARB_multi_bind",
+	"GL_EXT_texture_filter_anisotropic",
+};
+
+typedef struct
+{
+	byte		*data;		// allocated on first map
+	GLsizeiptr	size;
+} nullbuffer_t;
+
+static GLuint		nullnames;		// every kind of object shares one counter
+static nullbuffer_t	*nullbuffers;
+static GLuint		numnullbuffers;
+static GLuint		nullbindings[16][2];	// target, buffer
+static GLfloat		nullanisotropy = 1.f;
+static int			nullsync;
+
+/*
+================
+GLNull_GenNames
+================
+*/
+static void GLNull_GenNames (GLsizei n, GLuint *names)
+{
+	while (n-- > 0)
+		*names++ = ++nullnames;
+}
+
+/*
+================
+GLNull_BoundBuffer -- the buffer bound to target, for the calls that name a target rather than a buffer
+================
+*/
+static nullbuffer_t *GLNull_BoundBuffer (GLenum target)
+{
+	int i;
+
+	for (i = 0; i < (int) countof (nullbindings); i++)
+		if (nullbindings[i][0] == target)
+			return nullbindings[i][1] < numnullbuffers ? &nullbuffers[nullbindings[i][1]] : NULL;
+
+	return NULL;
+}
+
+/*
+================
+GLNull_Bind
+================
+*/
+static void GLNull_Bind (GLenum target, GLuint buffer)
+{
+	int i;
+
+	for (i = 0; i < (int) countof (nullbindings); i++)
+	{
+		if (nullbindings[i][0] == target || !nullbindings[i][0])
+		{
+			nullbindings[i][0] = target;
+			nullbindings[i][1] = buffer;
+			return;
+		}
+	}
+}
+
+/*
+================
+GLNull_SetBufferSize
+================
+*/
+static void GLNull_SetBufferSize (GLenum target, GLsizeiptr size)
+{
+	nullbuffer_t *buf = GLNull_BoundBuffer (target);
+
+	if (!buf)
+		return;
+	free (buf->data);
+	buf->data = NULL;
+	buf->size = size;
+}
+
+/*
+================================================================================
+
+	CORE AND EXTENSION FUNCTIONS
+
+looked up by name, in place of SDL_GL_GetProcAddress
+
+================================================================================
+*/
+
+static void APIENTRY GLNull_GenBuffers (GLsizei n, GLuint *buffers)
+{
+	GLuint last;
+
+	GLNull_GenNames (n, buffers);
+	last = nullnames + 1;
+	if (last > numnullbuffers)
+	{
+		nullbuffers = (nullbuffer_t *) realloc (nullbuffers, last * 2 * sizeof(*nullbuffers));
+		if (!nullbuffers)
+			Sys_Error ("GLNull_GenBuffers: realloc() failed");
+		memset (nullbuffers + numnullbuffers, 0, (last * 2 - numnullbuffers) * sizeof(*nullbuffers));
+		numnullbuffers = last * 2;
+	}
+}
+
+static void APIENTRY GLNull_DeleteBuffers (GLsizei n, const GLuint *buffers)
+{
+	for ( ; n > 0; n--, buffers++)
+	{
+		if (*buffers < numnullbuffers)
+		{
+			free (nullbuffers[*buffers].data);
+			nullbuffers[*buffers].data = NULL;
+			nullbuffers[*buffers].size = 0;
+		}
+	}
+}
+
+static void APIENTRY GLNull_BindBuffer (GLenum target, GLuint buffer)
+{
+	GLNull_Bind (target, buffer);
+}
+
+static void APIENTRY GLNull_BindBufferRange (GLenum target, GLuint index, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+	GLNull_Bind (target, buffer);
+}
+
+static void APIENTRY GLNull_BindBuffersRange (GLenum target, GLuint first, GLsizei count, const GLuint *buffers, const GLintptr *offsets, const GLsizeiptr *sizes)
+{
+	if (count > 0 && buffers)
+		GLNull_Bind (target, buffers[count - 1]);
+}
+
+static void APIENTRY GLNull_BufferData (GLenum target, GLsizeiptr size, const GLvoid *data, GLenum usage)
+{
+	GLNull_SetBufferSize (target, size);
+}
+
+static void APIENTRY GLNull_BufferStorage (GLenum target, GLsizeiptr size, const void *data, GLbitfield flags)
+{
+	GLNull_SetBufferSize (target, size);
+}
+
+static void *APIENTRY GLNull_MapBufferRange (GLenum target, GLintptr offset, GLsizeiptr length, GLbitfield access)
+{
+	nullbuffer_t *buf = GLNull_BoundBuffer (target);
+
+	if (!buf || offset + length > buf->size)
+		return NULL;
+	if (!buf->data)
+		buf->data = (byte *) calloc (1, buf->size);
+	return buf->data ? buf->data + offset : NULL;
+}
+
+static GLvoid *APIENTRY GLNull_MapBuffer (GLenum target, GLenum access)
+{
+	nullbuffer_t *buf = GLNull_BoundBuffer (target);
+
+	return buf ? GLNull_MapBufferRange (target, 0, buf->size, 0) : NULL;
+}
+
+static GLboolean APIENTRY GLNull_UnmapBuffer (GLenum target)
+{
+	return GL_TRUE;
+}
+
+static GLsync APIENTRY GLNull_FenceSync (GLenum condition, GLbitfield flags)
+{
+	return (GLsync) &nullsync;
+}
+
+static GLenum APIENTRY GLNull_ClientWaitSync (GLsync sync, GLbitfield flags, GLuint64 timeout)
+{
+	return GL_ALREADY_SIGNALED;
+}
+
+static GLuint APIENTRY GLNull_CreateProgram (void)
+{
+	return ++nullnames;
+}
+
+static GLuint APIENTRY GLNull_CreateShader (GLenum type)
+{
+	return ++nullnames;
+}
+
+static void APIENTRY GLNull_GetProgramiv (GLuint program, GLenum pname, GLint *params)
+{
+	*params = (pname == GL_LINK_STATUS) ? GL_TRUE : 0;
+}
+
+static void APIENTRY GLNull_GetShaderiv (GLuint shader, GLenum pname, GLint *params)
+{
+	*params = (pname == GL_COMPILE_STATUS) ? GL_TRUE : 0;
+}
+
+static void APIENTRY GLNull_GetProgramInfoLog (GLuint program, GLsizei bufSize, GLsizei *length, GLchar *infoLog)
+{
+	if (length)
+		*length = 0;
+	if (bufSize > 0)
+		*infoLog = 0;
+}
+
+static void APIENTRY GLNull_GetShaderInfoLog (GLuint shader, GLsizei bufSize, GLsizei *length, GLchar *infoLog)
+{
+	GLNull_GetProgramInfoLog (shader, bufSize, length, infoLog);
+}
+
+static GLint APIENTRY GLNull_GetUniformLocation (GLuint program, const GLchar *name)
+{
+	return -1;
+}
+
+static void APIENTRY GLNull_GetActiveUniform (GLuint program, GLuint index, GLsizei bufSize, GLsizei *length, GLint *size, GLenum *type, GLchar *name)
+{
+	GLNull_GetProgramInfoLog (program, bufSize, length, name);
+	*size = 0;
+	*type = GL_FLOAT;
+}
+
+static void APIENTRY GLNull_GenVertexArrays (GLsizei n, GLuint *arrays)
+{
+	GLNull_GenNames (n, arrays);
+}
+
+static void APIENTRY GLNull_GenFramebuffers (GLsizei n, GLuint *framebuffers)
+{
+	GLNull_GenNames (n, framebuffers);
+}
+
+static GLenum APIENTRY GLNull_CheckFramebufferStatus (GLenum target)
+{
+	return GL_FRAMEBUFFER_COMPLETE;
+}
+
+static const GLubyte *APIENTRY GLNull_GetStringi (GLenum name, GLuint index)
+{
+	if (name == GL_EXTENSIONS && index < countof (nullextensions))
+		return (const GLubyte *) nullextensions[index];
+	return NULL;
+}
+
+static void APIENTRY GLNull_GenSamplers (GLsizei n, GLuint *samplers)
+{
+	GLNull_GenNames (n, samplers);
+}
+
+static void APIENTRY GLNull_GenQueries (GLsizei n, GLuint *ids)
+{
+	GLNull_GenNames (n, ids);
+}
+
+static void APIENTRY GLNull_GetQueryiv (GLenum target, GLenum pname, GLint *params)
+{
+	*params = 0;
+}
+
+static void APIENTRY GLNull_GetQueryObjectiv (GLuint id, GLenum pname, GLint *params)
+{
+	*params = (pname == GL_QUERY_RESULT_AVAILABLE) ? GL_TRUE : 0;
+}
+
+static void APIENTRY GLNull_GetQueryObjectuiv (GLuint id, GLenum pname, GLuint *params)
+{
+	*params = (pname == GL_QUERY_RESULT_AVAILABLE) ? GL_TRUE : 0;
+}
+
+static void APIENTRY GLNull_GetQueryObjecti64v (GLuint id, GLenum pname, GLint64 *params)
+{
+	*params = (pname == GL_QUERY_RESULT_AVAILABLE) ? GL_TRUE : 0;
+}
+
+static void APIENTRY GLNull_GetQueryObjectui64v (GLuint id, GLenum pname, GLuint64 *params)
+{
+	*params = (pname == GL_QUERY_RESULT_AVAILABLE) ? GL_TRUE : 0;
+}
+
+static GLuint64 APIENTRY GLNull_GetTextureHandleARB (GLuint texture)
+{
+	return texture;
+}
+
+static GLuint64 APIENTRY GLNull_GetTextureSamplerHandleARB (GLuint texture, GLuint sampler)
+{
+	return texture;
+}
+
+static void APIENTRY GLNull_DrawElementsInstanced (GLenum mode, GLsizei count, GLenum type, const void *indices, GLsizei instancecount) {}
+static void APIENTRY GLNull_DrawElementsIndirect (GLenum mode, GLenum type, const void *indirect) {}
+static void APIENTRY GLNull_MultiDrawElementsIndirect (GLenum mode, GLenum type, const void *indirect, GLsizei drawcount, GLsizei stride) {}
+static void APIENTRY GLNull_BufferSubData (GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid *data) {}
+static void APIENTRY GLNull_FlushMappedBufferRange (GLenum target, GLintptr offset, GLsizeiptr length) {}
+static void APIENTRY GLNull_DeleteSync (GLsync sync) {}
+static void APIENTRY GLNull_WaitSync (GLsync sync, GLbitfield flags, GLuint64 timeout) {}
+static void APIENTRY GLNull_DeleteProgram (GLuint program) {}
+static void APIENTRY GLNull_UseProgram (GLuint program) {}
+static void APIENTRY GLNull_LinkProgram (GLuint program) {}
+static void APIENTRY GLNull_DeleteShader (GLuint shader) {}
+static void APIENTRY GLNull_ShaderSource (GLuint shader, GLsizei count, const GLchar* const *string, const GLint *length) {}
+static void APIENTRY GLNull_CompileShader (GLuint shader) {}
+static void APIENTRY GLNull_AttachShader (GLuint program, GLuint shader) {}
+static void APIENTRY GLNull_DetachShader (GLuint program, GLuint shader) {}
+static void APIENTRY GLNull_BindAttribLocation (GLuint program, GLuint index, const GLchar *name) {}
+static void APIENTRY GLNull_BindVertexArray (GLuint array) {}
+static void APIENTRY GLNull_DeleteVertexArrays (GLsizei n, const GLuint *arrays) {}
+static void APIENTRY GLNull_EnableVertexAttribArray (GLuint index) {}
+static void APIENTRY GLNull_DisableVertexAttribArray (GLuint index) {}
+static void APIENTRY GLNull_VertexAttribPointer (GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid *pointer) {}
+static void APIENTRY GLNull_Uniform1i (GLint location, GLint v0) {}
+static void APIENTRY GLNull_Uniform1f (GLint location, GLfloat v0) {}
+static void APIENTRY GLNull_Uniform2f (GLint location, GLfloat v0, GLfloat v1) {}
+static void APIENTRY GLNull_Uniform3f (GLint location, GLfloat v0, GLfloat v1, GLfloat v2) {}
+static void APIENTRY GLNull_Uniform4f (GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) {}
+static void APIENTRY GLNull_Uniform3fv (GLint location, GLsizei count, const GLfloat *value) {}
+static void APIENTRY GLNull_Uniform4fv (GLint location, GLsizei count, const GLfloat *value) {}
+static void APIENTRY GLNull_UniformMatrix4fv (GLint location, GLsizei count, GLboolean transpose, const GLfloat *value) {}
+static void APIENTRY GLNull_ActiveTexture (GLenum texture) {}
+static void APIENTRY GLNull_GenerateMipmap (GLenum target) {}
+static void APIENTRY GLNull_BindFramebuffer (GLenum target, GLuint framebuffer) {}
+static void APIENTRY GLNull_DeleteFramebuffers (GLsizei n, const GLuint *framebuffers) {}
+static void APIENTRY GLNull_FramebufferTexture2D (GLenum target, GLenum attachment, GLenum textarget, GLuint texture, GLint level) {}
+static void APIENTRY GLNull_BlitFramebuffer (GLint srcX0, GLint srcY0, GLint srcX1, GLint srcY1, GLint dstX0, GLint dstY0, GLint dstX1, GLint dstY1, GLbitfield mask, GLenum filter) {}
+static void APIENTRY GLNull_DebugMessageCallback (GLDEBUGPROC callback, const void *userParam) {}
+static void APIENTRY GLNull_ObjectLabel (GLenum identifier, GLuint name, GLsizei length, const GLchar *label) {}
+static void APIENTRY GLNull_PushDebugGroup (GLenum source, GLuint id, GLsizei length, const char * message) {}
+static void APIENTRY GLNull_PopDebugGroup (void) {}
+static void APIENTRY GLNull_TexStorage2D (GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height) {}
+static void APIENTRY GLNull_TexStorage3D (GLenum target, GLsizei levels, GLenum internalFormat, GLsizei width, GLsizei height, GLsizei depth) {}
+static void APIENTRY GLNull_TexStorage2DMultisample (GLenum target, GLsizei samples, GLenum internalFormat, GLsizei width, GLsizei height, GLboolean fixedsamplelocations) {}
+static void APIENTRY GLNull_TexImage3D (GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLsizei depth, GLint border, GLenum format, GLenum type, const GLvoid *pixels) {}
+static void APIENTRY GLNull_TexSubImage3D (GLenum target, GLint level, GLint xoffset, GLint yoffset, GLint zoffset, GLsizei width, GLsizei height, GLsizei depth, GLenum format, GLenum type, const GLvoid *pixels) {}
+static void APIENTRY GLNull_BindImageTexture (GLuint unit, GLuint texture, GLint level, GLboolean layered, GLint layer, GLenum access, GLenum format) {}
+static void APIENTRY GLNull_MemoryBarrier (GLbitfield barriers) {}
+static void APIENTRY GLNull_DispatchCompute (GLuint num_groups_x, GLuint num_groups_y, GLuint num_groups_z) {}
+static void APIENTRY GLNull_DeleteSamplers (GLsizei n, const GLuint *samplers) {}
+static void APIENTRY GLNull_SamplerParameteri (GLuint sampler, GLenum pname, GLint param) {}
+static void APIENTRY GLNull_SamplerParameterf (GLuint sampler, GLenum pname, GLfloat param) {}
+static void APIENTRY GLNull_BindSampler (GLuint unit, GLuint sampler) {}
+static void APIENTRY GLNull_DeleteQueries (GLsizei n, const GLuint *ids) {}
+static void APIENTRY GLNull_BeginQuery (GLenum target, GLuint id) {}
+static void APIENTRY GLNull_EndQuery (GLenum target) {}
+static void APIENTRY GLNull_QueryCounter (GLuint id, GLenum target) {}
+static void APIENTRY GLNull_BindTextures (GLuint first, GLsizei count, const GLuint *textures) {}
+static void APIENTRY GLNull_BindSamplers (GLuint first, GLsizei count, const GLuint *samplers) {}
+static void APIENTRY GLNull_BindImageTextures (GLuint first, GLsizei count, const GLuint *textures) {}
+static void APIENTRY GLNull_MakeTextureHandleResidentARB (GLuint64 handle) {}
+static void APIENTRY GLNull_MakeTextureHandleNonResidentARB (GLuint64 handle) {}
+static void APIENTRY GLNull_ClipControl (GLenum origin, GLenum depth) {}
+
+typedef struct
+{
+	const char	*name;
+	void		*func;
+} nullfunc_t;
+
+#define QGL_NULL_FUNC(ret, name, args) { "gl" #name, (void *) GLNull_##name },
+static const nullfunc_t nullfuncs[] =
+{
+	QGL_ALL_FUNCTIONS(QGL_NULL_FUNC)
+	{NULL, NULL}
+};
+#undef QGL_NULL_FUNC
+
+/*
+================
+GLNull_GetProcAddress
+================
+*/
+void *GLNull_GetProcAddress (const char *name)
+{
+	const nullfunc_t *f;
+
+	for (f = nullfuncs; f->name; f++)
+		if (!strcmp (f->name, name))
+			return f->func;
+
+	return NULL;
+}
+
+/*
+================================================================================
+
+	GL 1.1 FUNCTIONS
+
+linked against directly, so these keep the names and signatures libGL has
+
+================================================================================
+*/
+
+const GLubyte *APIENTRY glGetString (GLenum name)
+{
+	switch (name)
+	{
+	case GL_VENDOR:		return (const GLubyte *) "QuakeSpasm";
+	case GL_RENDERER:	return (const GLubyte *) "null renderer";
+	case GL_VERSION:	return (const GLubyte *) "4.6 null";
+	case GL_SHADING_LANGUAGE_VERSION:	return (const GLubyte *) "4.60";
+	default:			return NULL;
+	}
+}
+
+void APIENTRY glGetIntegerv (GLenum pname, GLint *params)
+{
+	switch (pname)
+	{
+	case GL_NUM_EXTENSIONS:		*params = countof (nullextensions); break;
+	case GL_MAJOR_VERSION:		*params = 4; break;
+	case GL_MINOR_VERSION:		*params = 6; break;
+	case GL_MAX_TEXTURE_SIZE:	*params = 16384; break;
+	case GL_MAX_COLOR_TEXTURE_SAMPLES:
+	case GL_MAX_DEPTH_TEXTURE_SAMPLES:	*params = 8; break;
+	case GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT:
+	case GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT:	*params = 256; break;
+	default:					*params = 0; break;
+	}
+}
+
+void APIENTRY glGetFloatv (GLenum pname, GLfloat *params)
+{
+	*params = (pname == GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT) ? 16.f : 0.f;
+}
+
+GLenum APIENTRY glGetError (void)
+{
+	return GL_NO_ERROR;
+}
+
+void APIENTRY glGenTextures (GLsizei n, GLuint *textures)
+{
+	GLNull_GenNames (n, textures);
+}
+
+void APIENTRY glTexParameterf (GLenum target, GLenum pname, GLfloat param)
+{
+	if (pname == GL_TEXTURE_MAX_ANISOTROPY_EXT)
+		nullanisotropy = param;
+}
+
+void APIENTRY glGetTexParameterfv (GLenum target, GLenum pname, GLfloat *params)
+{
+	*params = (pname == GL_TEXTURE_MAX_ANISOTROPY_EXT) ? nullanisotropy : 0.f;
+}
+
+void APIENTRY glViewport (GLint x, GLint y, GLsizei width, GLsizei height) {}
+void APIENTRY glTexParameteri (GLenum target, GLenum pname, GLint param) {}
+void APIENTRY glEnable (GLenum cap) {}
+void APIENTRY glDisable (GLenum cap) {}
+void APIENTRY glDepthRange (GLclampd near_val, GLclampd far_val) {}
+void APIENTRY glFinish (void) {}
+void APIENTRY glDrawArrays (GLenum mode, GLint first, GLsizei count) {}
+void APIENTRY glDeleteTextures (GLsizei n, const GLuint *textures) {}
+void APIENTRY glBlendFunc (GLenum sfactor, GLenum dfactor) {}
+void APIENTRY glTexImage2D (GLenum target, GLint level, GLint internalFormat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const GLvoid *pixels) {}
+void APIENTRY glPolygonMode (GLenum face, GLenum mode) {}
+void APIENTRY glDrawElements (GLenum mode, GLsizei count, GLenum type, const GLvoid *indices) {}
+void APIENTRY glBindTexture (GLenum target, GLuint texture) {}
+void APIENTRY glStencilOp (GLenum fail, GLenum zfail, GLenum zpass) {}
+void APIENTRY glStencilFunc (GLenum func, GLint ref, GLuint mask) {}
+void APIENTRY glPolygonOffset (GLfloat factor, GLfloat units) {}
+void APIENTRY glPixelStorei (GLenum pname, GLint param) {}
+void APIENTRY glGetTexImage (GLenum target, GLint level, GLenum format, GLenum type, GLvoid *pixels) {}
+void APIENTRY glDepthFunc (GLenum func) {}
+void APIENTRY glCullFace (GLenum mode) {}
+void APIENTRY glColorMask (GLboolean red, GLboolean green, GLboolean blue, GLboolean alpha) {}
+void APIENTRY glClearDepth (GLclampd depth) {}
+void APIENTRY glClearColor (GLclampf red, GLclampf green, GLclampf blue, GLclampf alpha) {}
+void APIENTRY glScissor (GLint x, GLint y, GLsizei width, GLsizei height) {}
+void APIENTRY glReadPixels (GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type, GLvoid *pixels) {}
+void APIENTRY glFrontFace (GLenum mode) {}
+void APIENTRY glDepthMask (GLboolean flag) {}
+void APIENTRY glColor3f (GLfloat red, GLfloat green, GLfloat blue) {}
+void APIENTRY glClear (GLbitfield mask) {}
@@ -1288,8 +1288,10 @@ void R_RenderView (void)
 		glFinish ();
 
 	R_SetupView (); //johnfitz -- this does everything that should be done once per frame
+	CL_TimeDemoMark (TD_SCENE);
 	R_RenderScene ();
 	R_WarpScaleView ();
+	CL_TimeDemoMark (TD_DRAW);
 
 	//johnfitz -- modified r_speeds output
 	time2 = Sys_DoubleTime ();
@@ -25,6 +25,14 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "quakedef.h"
 #include "glquake.h"
 
+#if defined(USE_SSE2) && (defined(__SSE2_MATH__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define	TEXMGR_SIMD
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(_MSC_VER)
+#define	TEXMGR_SIMD_AVX2
+#endif
+#endif
+
 const int	gl_solid_format = GL_RGB;
 const int	gl_alpha_format = GL_RGBA;
 
@@ -442,6 +450,9 @@ gltexture_t *TexMgr_NewTexture (void)
 }
 
 static void GL_DeleteTexture (gltexture_t *texture);
+static void TexMgr_DropQueuedImage (gltexture_t *glt);
+static void TexMgr_InitProcs (void);
+static void TexMgr_TexBench_f (void);
 
 //ericw -- workaround for preventing TexMgr_FreeTexture during TexMgr_ReloadImages
 static qboolean in_reload_images;
@@ -470,6 +481,7 @@ void TexMgr_FreeTexture (gltexture_t *kill)
 		kill->next = free_gltextures;
 		free_gltextures = kill;
 
+		TexMgr_DropQueuedImage(kill);
 		GL_DeleteTexture(kill);
 		numgltextures--;
 		return;
@@ -483,6 +495,7 @@ void TexMgr_FreeTexture (gltexture_t *kill)
 			kill->next = free_gltextures;
 			free_gltextures = kill;
 
+			TexMgr_DropQueuedImage(kill);
 			GL_DeleteTexture(kill);
 			numgltextures--;
 			return;
@@ -678,6 +691,9 @@ void TexMgr_Init (void)
 	// palette
 	TexMgr_LoadPalette ();
 
+	// image functions
+	TexMgr_InitProcs ();
+
 	Cvar_RegisterVariable (&gl_max_size);
 	Cvar_RegisterVariable (&gl_picmip);
 	gl_texturemode.string = glmodes[glmode_idx].name;
@@ -688,6 +704,7 @@ void TexMgr_Init (void)
 	Cmd_AddCommand ("gl_describetexturemodes", &TexMgr_DescribeTextureModes_f);
 	Cmd_AddCommand ("imagelist", &TexMgr_Imagelist_f);
 	Cmd_AddCommand ("imagedump", &TexMgr_Imagedump_f);
+	Cmd_AddCommand ("texbench", &TexMgr_TexBench_f);
 
 	// poll max size from hardware
 	glGetIntegerv (GL_MAX_TEXTURE_SIZE, &gl_max_texture_size);
@@ -815,22 +832,17 @@ static unsigned *TexMgr_MipMapH (unsigned *data, int width, int height, int dept
 
 /*
 ================
-TexMgr_ResampleTexture -- bilinear resample
+TexMgr_Resample -- bilinear resample into out
+
+textures are uploaded at their own size, so nothing resamples at load time;
+this and its SIMD version are kept for texbench
 ================
 */
-static unsigned *TexMgr_ResampleTexture (unsigned *in, int inwidth, int inheight, qboolean alpha)
+static void TexMgr_Resample (unsigned *out, int outwidth, int outheight, unsigned *in, int inwidth, int inheight, qboolean alpha)
 {
 	byte *nwpx, *nepx, *swpx, *sepx, *dest;
 	unsigned xfrac, yfrac, x, y, modx, mody, imodx, imody, injump, outjump;
-	unsigned *out;
-	int i, j, outwidth, outheight;
-
-	if (inwidth == TexMgr_Pad(inwidth) && inheight == TexMgr_Pad(inheight))
-		return in;
-
-	outwidth = TexMgr_Pad(inwidth);
-	outheight = TexMgr_Pad(inheight);
-	out = (unsigned *) Hunk_Alloc(outwidth*outheight*4);
+	int i, j;
 
 	xfrac = ((inwidth-1) << 16) / (outwidth-1);
 	yfrac = ((inheight-1) << 16) / (outheight-1);
@@ -868,8 +880,6 @@ static unsigned *TexMgr_ResampleTexture (unsigned *in, int inwidth, int inheight
 		outjump += outwidth;
 		y += yfrac;
 	}
-
-	return out;
 }
 
 /*
@@ -1010,19 +1020,239 @@ static void TexMgr_PadEdgeFixH (byte *data, int width, int height)
 TexMgr_8to32
 ================
 */
-static unsigned *TexMgr_8to32 (byte *in, int pixels, unsigned int *usepal)
+static void TexMgr_8to32 (unsigned *out, byte *in, int pixels, unsigned int *usepal)
 {
 	int i;
-	unsigned *out, *data;
-
-	out = data = (unsigned *) Hunk_Alloc(pixels*4);
 
 	for (i = 0; i < pixels; i++)
 		*out++ = usepal[*in++];
+}
+
+/*
+================================================================================
+
+	SIMD IMAGE PROCESSING
+
+the scalar functions above are the reference: each of these gives exactly the
+same bytes.  the box filter's (a + b) >> 1 is (a & b) + ((a ^ b) >> 1) a byte
+at a time, and the resample's weighted sums never pass 255 * 65536, so they
+are exact in single precision.
+
+================================================================================
+*/
+
+typedef struct
+{
+	const char	*name;
+	void		(*expand) (unsigned *out, byte *in, int pixels, unsigned int *usepal);
+	unsigned	*(*mipmapw) (unsigned *data, int width, int height, int depth);
+	unsigned	*(*mipmaph) (unsigned *data, int width, int height, int depth);
+	void		(*resample) (unsigned *out, int outwidth, int outheight, unsigned *in, int inwidth, int inheight, qboolean alpha);
+} texprocs_t;
+
+#ifdef TEXMGR_SIMD
+/*
+================
+TexMgr_MipMapWSSE2
+
+four output pixels at a time, reading ahead of what has been written
+================
+*/
+static unsigned *TexMgr_MipMapWSSE2 (unsigned *data, int width, int height, int depth)
+{
+	__m128i	a, b, even, odd, lowbits;
+	unsigned	*out, *in;
+	int	i, size;
+
+	if (!data)
+		return NULL;
+
+	out = in = data;
+	size = ((width*height)>>1)*depth;
+	lowbits = _mm_set1_epi8 (0x7f);
+
+	for (i = 0; i + 4 <= size; i += 4, out += 4, in += 8)
+	{
+		a = _mm_loadu_si128 ((__m128i *)in);
+		b = _mm_loadu_si128 ((__m128i *)(in + 4));
+		even = _mm_castps_si128 (_mm_shuffle_ps (_mm_castsi128_ps (a), _mm_castsi128_ps (b), _MM_SHUFFLE (2, 0, 2, 0)));
+		odd = _mm_castps_si128 (_mm_shuffle_ps (_mm_castsi128_ps (a), _mm_castsi128_ps (b), _MM_SHUFFLE (3, 1, 3, 1)));
+		a = _mm_and_si128 (_mm_srli_epi16 (_mm_xor_si128 (even, odd), 1), lowbits);
+		_mm_storeu_si128 ((__m128i *)out, _mm_add_epi8 (_mm_and_si128 (even, odd), a));
+	}
+
+	for ( ; i < size; i++, out++, in += 2)
+	{
+		byte *o = (byte *)out, *p = (byte *)in;
+		o[0] = (p[0] + p[4])>>1;
+		o[1] = (p[1] + p[5])>>1;
+		o[2] = (p[2] + p[6])>>1;
+		o[3] = (p[3] + p[7])>>1;
+	}
+
+	return data;
+}
+
+/*
+================
+TexMgr_MipMapHSSE2
+================
+*/
+static unsigned *TexMgr_MipMapHSSE2 (unsigned *data, int width, int height, int depth)
+{
+	__m128i	a, b, lowbits;
+	byte	*out, *in;
+	int	i, j, rowbytes;
+
+	if (!data)
+		return NULL;
+
+	out = in = (byte *)data;
+	height>>=1;
+	height*=depth;
+	rowbytes = width<<2;
+	lowbits = _mm_set1_epi8 (0x7f);
+
+	for (i = 0; i < height; i++, in += rowbytes)
+	{
+		for (j = 0; j + 16 <= rowbytes; j += 16, out += 16, in += 16)
+		{
+			a = _mm_loadu_si128 ((__m128i *)in);
+			b = _mm_loadu_si128 ((__m128i *)(in + rowbytes));
+			_mm_storeu_si128 ((__m128i *)out, _mm_add_epi8 (_mm_and_si128 (a, b),
+				_mm_and_si128 (_mm_srli_epi16 (_mm_xor_si128 (a, b), 1), lowbits)));
+		}
+		for ( ; j < rowbytes; j++, out++, in++)
+			out[0] = (in[0] + in[rowbytes])>>1;
+	}
 
 	return data;
 }
 
+/*
+================
+TexMgr_ResampleSSE2
+
+one pixel per vector, with the four channels side by side
+================
+*/
+static void TexMgr_ResampleSSE2 (unsigned *out, int outwidth, int outheight, unsigned *in, int inwidth, int inheight, qboolean alpha)
+{
+	__m128i	zero, opaque, v;
+	__m128	sum;
+	unsigned xfrac, yfrac, x, y, modx, mody, imodx, imody, injump, outjump;
+	unsigned *nwpx;
+	int i, j;
+
+	zero = _mm_setzero_si128 ();
+	opaque = _mm_set1_epi32 (alpha ? 0 : 0xff000000);
+
+#define	PIXELTOFLOATS(p)	_mm_cvtepi32_ps (_mm_unpacklo_epi16 (_mm_unpacklo_epi8 (_mm_cvtsi32_si128 ((int)(p)), zero), zero))
+
+	xfrac = ((inwidth-1) << 16) / (outwidth-1);
+	yfrac = ((inheight-1) << 16) / (outheight-1);
+	y = outjump = 0;
+
+	for (i = 0; i < outheight; i++)
+	{
+		mody = (y>>8) & 0xFF;
+		imody = 256 - mody;
+		injump = (y>>16) * inwidth;
+		x = 0;
+
+		for (j = 0; j < outwidth; j++)
+		{
+			modx = (x>>8) & 0xFF;
+			imodx = 256 - modx;
+
+			nwpx = in + (x>>16) + injump;
+
+			sum = _mm_mul_ps (PIXELTOFLOATS (nwpx[0]), _mm_set1_ps ((float)(imodx*imody)));
+			sum = _mm_add_ps (sum, _mm_mul_ps (PIXELTOFLOATS (nwpx[1]), _mm_set1_ps ((float)(modx*imody))));
+			sum = _mm_add_ps (sum, _mm_mul_ps (PIXELTOFLOATS (nwpx[inwidth]), _mm_set1_ps ((float)(imodx*mody))));
+			sum = _mm_add_ps (sum, _mm_mul_ps (PIXELTOFLOATS (nwpx[inwidth+1]), _mm_set1_ps ((float)(modx*mody))));
+
+			v = _mm_srli_epi32 (_mm_cvttps_epi32 (sum), 16);
+			v = _mm_packus_epi16 (_mm_packs_epi32 (v, v), zero);
+			out[outjump + j] = (unsigned)_mm_cvtsi128_si32 (_mm_or_si128 (v, opaque));
+
+			x += xfrac;
+		}
+		outjump += outwidth;
+		y += yfrac;
+	}
+
+#undef	PIXELTOFLOATS
+}
+
+#ifdef TEXMGR_SIMD_AVX2
+/*
+================
+TexMgr_8to32AVX2
+
+eight palette lookups per gather
+================
+*/
+#ifdef __GNUC__
+__attribute__((target("avx2")))
+#endif
+static void TexMgr_8to32AVX2 (unsigned *out, byte *in, int pixels, unsigned int *usepal)
+{
+	__m256i	indices;
+	int	i;
+
+	for (i = 0; i + 8 <= pixels; i += 8, in += 8, out += 8)
+	{
+		indices = _mm256_cvtepu8_epi32 (_mm_loadl_epi64 ((__m128i *)in));
+		_mm256_storeu_si256 ((__m256i *)out, _mm256_i32gather_epi32 ((const int *)usepal, indices, 4));
+	}
+
+	for ( ; i < pixels; i++)
+		*out++ = usepal[*in++];
+}
+#endif	/* TEXMGR_SIMD_AVX2 */
+#endif	/* TEXMGR_SIMD */
+
+static const texprocs_t texprocs[] = {
+	{"scalar", TexMgr_8to32, TexMgr_MipMapW, TexMgr_MipMapH, TexMgr_Resample},
+#ifdef TEXMGR_SIMD
+	{"sse2", TexMgr_8to32, TexMgr_MipMapWSSE2, TexMgr_MipMapHSSE2, TexMgr_ResampleSSE2},
+#ifdef TEXMGR_SIMD_AVX2
+	{"avx2", TexMgr_8to32AVX2, TexMgr_MipMapWSSE2, TexMgr_MipMapHSSE2, TexMgr_ResampleSSE2},
+#endif
+#endif
+};
+static int	numtexprocs = 1;	// how many of texprocs this cpu can run
+
+/*
+================
+TexMgr_InitProcs
+================
+*/
+static void TexMgr_InitProcs (void)
+{
+	numtexprocs = 1;
+#ifdef TEXMGR_SIMD
+	if (!SDL_HasSSE2 ())
+		return;
+	numtexprocs = 2;
+#ifdef TEXMGR_SIMD_AVX2
+	if (SDL_HasAVX2 ())
+		numtexprocs = 3;
+#endif
+#endif
+}
+
+/*
+================
+TexMgr_Procs -- the widest image functions the cpu has, unless r_simd is 0
+================
+*/
+static const texprocs_t *TexMgr_Procs (void)
+{
+	return use_simd ? &texprocs[numtexprocs - 1] : &texprocs[0];
+}
+
 /*
 ================
 TexMgr_PadImageW -- return image with width padded up to power-of-two dimentions
@@ -1110,84 +1340,80 @@ static void GL_TexImage (gltexture_t *glt, GLint level, GLint internalformat, GL
 	}
 }
 
+/*
+================================================================================
+
+	IMAGE PREPARATION
+
+loading an image is split in two: TexMgr_SetupImage* decides the texture's
+final size, flags and palette on the main thread, then TexMgr_PrepareImage
+does the pixel work -- palette expansion, edge fixes, mipping down and the
+mip chain -- touching nothing but the job and its buffers, so it can run on
+a task thread.  TexMgr_UploadImage hands the result to GL.
+
+================================================================================
+*/
+
+typedef struct
+{
+	gltexture_t	*glt;		// NULL if the texture was freed while queued
+	const texprocs_t *procs;
+	unsigned	flags;
+	GLenum		target;
+	int		width, height, depth;	// source size, after any padding
+	int		mipwidth, mipheight;	// level 0 size, after picmip and gl_max_size
+	int		source_width, source_height;
+	byte		*indexed;	// 8 bit source, expanded into data
+	unsigned	*usepal;
+	qboolean	padw, padh;
+	unsigned	*data;		// 32 bit image
+	unsigned	*mips;		// the rest of the mip chain, or NULL to make it while uploading
+	void		*alloc;		// queued jobs own their buffers
+} texjob_t;
+
 /*
 ================
-TexMgr_LoadImage32 -- handles 32bit source data
+TexMgr_SetupImage32 -- works out the size of level 0, for 32bit source data
 ================
 */
-static void TexMgr_LoadImage32 (gltexture_t *glt, unsigned *data)
+static void TexMgr_SetupImage32 (texjob_t *job, gltexture_t *glt, unsigned *data)
 {
-	int	internalformat,	miplevel, mipwidth, mipheight, picmip;
+	int	mipwidth, mipheight, picmip;
+
+	job->glt = glt;
+	job->procs = TexMgr_Procs ();
+	job->flags = glt->flags;
+	job->target = glt->target;
+	job->width = glt->width;
+	job->height = glt->height;
+	job->depth = glt->depth;
+	job->source_width = glt->source_width;
+	job->source_height = glt->source_height;
+	job->data = data;
 
 	// mipmap down
 	picmip = (glt->flags & TEXPREF_NOPICMIP) ? 0 : q_max((int)gl_picmip.value, 0);
 	mipwidth = TexMgr_SafeTextureSize (glt->width >> picmip);
 	mipheight = TexMgr_SafeTextureSize (glt->height >> picmip);
 	while ((int) glt->width > mipwidth)
-	{
-		TexMgr_MipMapW (data, glt->width, glt->height, glt->depth);
 		glt->width >>= 1;
-		if (glt->flags & TEXPREF_ALPHA && glt->target == GL_TEXTURE_2D)
-			TexMgr_AlphaEdgeFix ((byte *)data, glt->width, glt->height);
-	}
 	while ((int) glt->height > mipheight)
-	{
-		TexMgr_MipMapH (data, glt->width, glt->height, glt->depth);
 		glt->height >>= 1;
-		if (glt->flags & TEXPREF_ALPHA && glt->target == GL_TEXTURE_2D)
-			TexMgr_AlphaEdgeFix ((byte *)data, glt->width, glt->height);
-	}
-
-	// upload
-	GL_Bind (GL_TEXTURE0, glt);
-	internalformat = (glt->flags & TEXPREF_ALPHA) ? gl_alpha_format : gl_solid_format;
-	GL_TexImage (glt, 0, internalformat, glt->width, glt->height, GL_RGBA, GL_UNSIGNED_BYTE, data);
 
-	// upload mipmaps
-	if (glt->flags & TEXPREF_MIPMAP)
-	{
-		if (glt->flags & (TEXPREF_CUBEMAP|TEXPREF_ARRAY))
-		{
-			GL_GenerateMipmapFunc (glt->target);
-		}
-		else
-		{
-			mipwidth = glt->width;
-			mipheight = glt->height;
-
-			for (miplevel=1; mipwidth > 1 || mipheight > 1; miplevel++)
-			{
-				if (mipwidth > 1)
-				{
-					TexMgr_MipMapW (data, mipwidth, mipheight, glt->depth);
-					mipwidth >>= 1;
-				}
-				if (mipheight > 1)
-				{
-					TexMgr_MipMapH (data, mipwidth, mipheight, glt->depth);
-					mipheight >>= 1;
-				}
-				GL_TexImage (glt, miplevel, internalformat, mipwidth, mipheight, GL_RGBA, GL_UNSIGNED_BYTE, data);
-			}
-		}
-	}
-
-	// set filter modes
-	TexMgr_SetFilterModes (glt);
+	job->mipwidth = glt->width;
+	job->mipheight = glt->height;
 }
 
 /*
 ================
-TexMgr_LoadImage8 -- handles 8bit source data, then passes it to LoadImage32
+TexMgr_SetupImage8 -- picks the palette and pads 8bit source data, then sets it up like 32bit data
 ================
 */
-static void TexMgr_LoadImage8 (gltexture_t *glt, byte *data)
+static void TexMgr_SetupImage8 (texjob_t *job, gltexture_t *glt, byte *data)
 {
 	extern cvar_t gl_fullbrights;
-	qboolean padw = false, padh = false;
 	byte padbyte;
 	unsigned int *usepal;
-	int i;
 
 	// HACK HACK HACK -- taken from tomazquake
 	if (strstr(glt->name, "shot1sid") &&
@@ -1203,10 +1429,7 @@ static void TexMgr_LoadImage8 (gltexture_t *glt, byte *data)
 	// detect false alpha cases
 	if (glt->flags & TEXPREF_ALPHA && !(glt->flags & TEXPREF_CONCHARS))
 	{
-		for (i = 0; i < (int) (glt->width * glt->height * glt->depth); i++)
-			if (data[i] == 255) //transparent index
-				break;
-		if (i == (int) (glt->width * glt->height * glt->depth))
+		if (!memchr (data, 255, glt->width * glt->height * glt->depth)) //transparent index
 			glt->flags -= TEXPREF_ALPHA;
 	}
 
@@ -1239,38 +1462,508 @@ static void TexMgr_LoadImage8 (gltexture_t *glt, byte *data)
 	}
 
 	// pad each dimention, but only if it's not going to be downsampled later
+	job->padw = job->padh = false;
 	if (glt->flags & TEXPREF_PAD)
 	{
 		if ((int) glt->width < TexMgr_SafeTextureSize(glt->width))
 		{
 			data = TexMgr_PadImageW (data, glt->width, glt->height, padbyte);
 			glt->width = TexMgr_Pad(glt->width);
-			padw = true;
+			job->padw = true;
 		}
 		if ((int) glt->height < TexMgr_SafeTextureSize(glt->height))
 		{
 			data = TexMgr_PadImageH (data, glt->width, glt->height, padbyte);
 			glt->height = TexMgr_Pad(glt->height);
-			padh = true;
+			job->padh = true;
+		}
+	}
+
+	job->indexed = data;
+	job->usepal = usepal;
+	TexMgr_SetupImage32 (job, glt, NULL);
+}
+
+/*
+================
+TexMgr_PrepareImage -- the cpu side of loading an image.  safe to run on a task thread
+================
+*/
+static void TexMgr_PrepareImage (texjob_t *job)
+{
+	const texprocs_t *procs = job->procs;
+	unsigned *data = job->data, *mip, *next;
+	int width, height, depth, mipwidth, mipheight;
+	qboolean alphafix;
+
+	width = job->width;
+	height = job->height;
+	depth = job->depth;
+
+	if (job->indexed)
+	{
+		// convert to 32bit
+		procs->expand (data, job->indexed, width * height * depth, job->usepal);
+
+		// fix edges
+		if (job->flags & TEXPREF_ALPHA)
+			TexMgr_AlphaEdgeFix ((byte *)data, width, height);
+		else
+		{
+			if (job->padw)
+				TexMgr_PadEdgeFixW ((byte *)data, job->source_width, job->source_height);
+			if (job->padh)
+				TexMgr_PadEdgeFixH ((byte *)data, job->source_width, job->source_height);
+		}
+	}
+
+	// mipmap down
+	alphafix = (job->flags & TEXPREF_ALPHA) && job->target == GL_TEXTURE_2D;
+	while (width > job->mipwidth)
+	{
+		procs->mipmapw (data, width, height, depth);
+		width >>= 1;
+		if (alphafix)
+			TexMgr_AlphaEdgeFix ((byte *)data, width, height);
+	}
+	while (height > job->mipheight)
+	{
+		procs->mipmaph (data, width, height, depth);
+		height >>= 1;
+		if (alphafix)
+			TexMgr_AlphaEdgeFix ((byte *)data, width, height);
+	}
+
+	// mip chain, each level copied in after the last and filtered in place.
+	// every level is at most half the one before, so it all fits in the size of level 0
+	if (!job->mips)
+		return;
+	mip = data;
+	next = job->mips;
+	mipwidth = width;
+	mipheight = height;
+	while (mipwidth > 1 || mipheight > 1)
+	{
+		memcpy (next, mip, mipwidth * mipheight * depth * 4);
+		mip = next;
+		if (mipwidth > 1)
+		{
+			procs->mipmapw (mip, mipwidth, mipheight, depth);
+			mipwidth >>= 1;
+		}
+		if (mipheight > 1)
+		{
+			procs->mipmaph (mip, mipwidth, mipheight, depth);
+			mipheight >>= 1;
+		}
+		next = mip + mipwidth * mipheight * depth;
+	}
+}
+
+/*
+================
+TexMgr_UploadImage -- the gl side of loading an image
+================
+*/
+static void TexMgr_UploadImage (texjob_t *job)
+{
+	gltexture_t *glt = job->glt;
+	unsigned *data = job->data, *mip = job->mips;
+	int	internalformat,	miplevel, mipwidth, mipheight;
+
+	// upload
+	GL_Bind (GL_TEXTURE0, glt);
+	internalformat = (glt->flags & TEXPREF_ALPHA) ? gl_alpha_format : gl_solid_format;
+	GL_TexImage (glt, 0, internalformat, glt->width, glt->height, GL_RGBA, GL_UNSIGNED_BYTE, data);
+
+	// upload mipmaps
+	if (glt->flags & TEXPREF_MIPMAP)
+	{
+		if (glt->flags & (TEXPREF_CUBEMAP|TEXPREF_ARRAY))
+		{
+			GL_GenerateMipmapFunc (glt->target);
+		}
+		else
+		{
+			mipwidth = glt->width;
+			mipheight = glt->height;
+
+			for (miplevel=1; mipwidth > 1 || mipheight > 1; miplevel++)
+			{
+				if (mipwidth > 1)
+				{
+					if (!mip)
+						job->procs->mipmapw (data, mipwidth, mipheight, glt->depth);
+					mipwidth >>= 1;
+				}
+				if (mipheight > 1)
+				{
+					if (!mip)
+						job->procs->mipmaph (data, mipwidth, mipheight, glt->depth);
+					mipheight >>= 1;
+				}
+				if (mip)
+				{
+					data = mip;
+					mip += mipwidth * mipheight * glt->depth;
+				}
+				GL_TexImage (glt, miplevel, internalformat, mipwidth, mipheight, GL_RGBA, GL_UNSIGNED_BYTE, data);
+			}
+		}
+	}
+
+	// set filter modes
+	TexMgr_SetFilterModes (glt);
+}
+
+/*
+================
+TexMgr_FinishImage -- labels the texture and makes it resident, once its data is in
+================
+*/
+static void TexMgr_FinishImage (gltexture_t *glt)
+{
+	GL_ObjectLabelFunc (GL_TEXTURE, glt->texnum, -1, glt->name);
+	if (glt->flags & TEXPREF_BINDLESS && gl_bindless_able)
+	{
+		glt->bindless_handle = GL_GetTextureHandleARBFunc (glt->texnum);
+		GL_MakeTextureHandleResidentARBFunc (glt->bindless_handle);
+	}
+}
+
+/*
+================================================================================
+
+	IMAGE BATCHES
+
+between TexMgr_BeginImageBatch and TexMgr_EndImageBatch, 8 and 32bit images
+are copied into a queue instead of being loaded on the spot.  the queue is
+prepared on the task threads, then uploaded on the main thread whenever it
+fills up and when the batch ends.  a queued texture's size and flags are
+final as soon as TexMgr_LoadImage returns, but nothing may draw with it
+until the batch ends.
+
+================================================================================
+*/
+
+#define	MAX_QUEUED_IMAGES	256
+#define	MAX_QUEUED_BYTES	(64 * 1024 * 1024)
+
+static texjob_t	queuedimages[MAX_QUEUED_IMAGES];
+static int		numqueuedimages, queuedbytes;
+static int		imagebatchdepth;
+
+/*
+================
+TexMgr_PrepareImagesTask
+================
+*/
+static void TexMgr_PrepareImagesTask (void *data, int first, int last)
+{
+	texjob_t *jobs = (texjob_t *) data;
+
+	for ( ; first < last; first++)
+		TexMgr_PrepareImage (&jobs[first]);
+}
+
+/*
+================
+TexMgr_FlushImages -- prepares everything queued on the task threads, then uploads it
+================
+*/
+static void TexMgr_FlushImages (void)
+{
+	texjob_t *job;
+	int i;
+
+	if (!numqueuedimages)
+		return;
+
+	Tasks_Run (TexMgr_PrepareImagesTask, queuedimages, numqueuedimages, 1);
+	Tasks_Wait ();
+
+	for (i = 0, job = queuedimages; i < numqueuedimages; i++, job++)
+	{
+		if (job->glt)
+		{
+			TexMgr_UploadImage (job);
+			TexMgr_FinishImage (job->glt);
 		}
+		free (job->alloc);
 	}
 
-	// convert to 32bit
-	data = (byte *)TexMgr_8to32(data, glt->width * glt->height * glt->depth, usepal);
+	numqueuedimages = 0;
+	queuedbytes = 0;
+}
+
+/*
+================
+TexMgr_QueueImage -- copies a set up job into the queue, if a batch is open
+================
+*/
+static qboolean TexMgr_QueueImage (texjob_t *job)
+{
+	texjob_t *queued;
+	int pixels, level0, size;
+	byte *alloc;
+
+	if (!imagebatchdepth || Tasks_NumThreads () < 2 || (job->flags & (TEXPREF_CUBEMAP|TEXPREF_ARRAY)))
+		return false;
 
-	// fix edges
-	if (glt->flags & TEXPREF_ALPHA)
-		TexMgr_AlphaEdgeFix (data, glt->width, glt->height);
+	pixels = job->width * job->height * job->depth;
+	level0 = (job->flags & TEXPREF_MIPMAP) ? job->mipwidth * job->mipheight * job->depth : 0;
+	size = pixels * 4 + level0 * 4 + (job->indexed ? pixels : 0);
+
+	if (numqueuedimages == MAX_QUEUED_IMAGES || queuedbytes + size > MAX_QUEUED_BYTES)
+		TexMgr_FlushImages ();
+
+	alloc = (byte *) malloc (size);
+	if (!alloc)
+		return false;
+
+	queued = &queuedimages[numqueuedimages++];
+	*queued = *job;
+	queued->alloc = alloc;
+	queued->data = (unsigned *) alloc;
+	queued->mips = level0 ? queued->data + level0 : NULL;
+	if (job->indexed)
+	{
+		queued->indexed = alloc + pixels * 4 + level0 * 4;
+		memcpy (queued->indexed, job->indexed, pixels);
+	}
 	else
+		memcpy (queued->data, job->data, pixels * 4);
+	queuedbytes += size;
+
+	return true;
+}
+
+/*
+================
+TexMgr_DropQueuedImage -- forgets a texture that is freed before its batch is uploaded
+================
+*/
+static void TexMgr_DropQueuedImage (gltexture_t *glt)
+{
+	int i;
+
+	for (i = 0; i < numqueuedimages; i++)
+		if (queuedimages[i].glt == glt)
+			queuedimages[i].glt = NULL;
+}
+
+/*
+================
+TexMgr_BeginImageBatch
+================
+*/
+void TexMgr_BeginImageBatch (void)
+{
+	imagebatchdepth++;
+}
+
+/*
+================
+TexMgr_EndImageBatch -- uploads everything queued since the outermost TexMgr_BeginImageBatch
+================
+*/
+void TexMgr_EndImageBatch (void)
+{
+	if (imagebatchdepth > 0 && --imagebatchdepth == 0)
+		TexMgr_FlushImages ();
+}
+
+/*
+================
+TexMgr_AbortImageBatch -- throws the queue away.  called by Host_Error
+================
+*/
+void TexMgr_AbortImageBatch (void)
+{
+	int i;
+
+	for (i = 0; i < numqueuedimages; i++)
+		free (queuedimages[i].alloc);
+	numqueuedimages = 0;
+	queuedbytes = 0;
+	imagebatchdepth = 0;
+}
+
+/*
+================
+TexMgr_SetupBenchJob
+================
+*/
+static void TexMgr_SetupBenchJob (texjob_t *job, const texprocs_t *procs, byte *indexed, unsigned *data, int size)
+{
+	memset (job, 0, sizeof(*job));
+	job->procs = procs;
+	job->flags = TEXPREF_MIPMAP | TEXPREF_ALPHA;
+	job->target = GL_TEXTURE_2D;
+	job->width = job->height = job->source_width = job->source_height = size;
+	job->depth = 1;
+	job->mipwidth = job->mipheight = size >> 1;	// as if gl_picmip were 1
+	job->indexed = indexed;
+	job->usepal = d_8to24table_fbright_fence;
+	job->data = data;
+	job->mips = data + (size >> 1) * (size >> 1);
+}
+
+/*
+================
+TexMgr_TexBench_f
+
+texbench [size] [count]: runs the cpu side of image loading on random data
+with each version of the image functions, checks they give the same bytes
+as the scalar ones and prints the times.  then prepares count textures one
+after another and again on the task threads.  touches no gl state.
+================
+*/
+static void TexMgr_TexBench_f (void)
+{
+	texjob_t	job, *jobs;
+	byte		*indexed;
+	unsigned	*src, *ref[3], *out[3];
+	int			size, count, pixels, inwidth, bytes[3], i, j, bad;
+	double		start, times[3];
+
+	size = (Cmd_Argc() > 1) ? atoi (Cmd_Argv(1)) : 1024;
+	size = TexMgr_Pad (CLAMP (16, size, 4096));
+	count = (Cmd_Argc() > 2) ? atoi (Cmd_Argv(2)) : 16;
+	count = CLAMP (1, count, 256);
+	pixels = size * size;
+	inwidth = size * 3 / 4 + 1;	// resampled up to size
+
+	bytes[0] = pixels * 4;				// expanded
+	bytes[1] = pixels * 4 + pixels;		// prepared, with the mip chain
+	bytes[2] = pixels * 4 * 2;			// resampled, with and without alpha
+	indexed = (byte *) malloc (pixels);
+	src = (unsigned *) malloc ((inwidth + 1) * (inwidth + 1) * 4);	// the resample reads a pixel past the edge
+	for (i = 0; i < 3; i++)
+	{
+		ref[i] = (unsigned *) malloc (bytes[i]);
+		out[i] = (unsigned *) malloc (bytes[i]);
+		if (!ref[i] || !out[i])
+			Sys_Error ("TexMgr_TexBench_f: malloc() failed");
+	}
+	if (!indexed || !src)
+		Sys_Error ("TexMgr_TexBench_f: malloc() failed");
+
+	// noisy blocks with some transparent holes, so the edge fixes have work to do
+	for (i = 0; i < pixels; i++)
+		indexed[i] = ((i / 7) % 13 == 0) ? 255 : (rand () & 0xff);
+	for (i = 0; i < (inwidth + 1) * (inwidth + 1); i++)
+		src[i] = ((unsigned)rand () << 16) ^ (unsigned)rand ();
+
+	for (i = 0; i < numtexprocs; i++)
 	{
-		if (padw)
-			TexMgr_PadEdgeFixW (data, glt->source_width, glt->source_height);
-		if (padh)
-			TexMgr_PadEdgeFixH (data, glt->source_width, glt->source_height);
+		unsigned **dst = i ? out : ref;
+
+		memset (dst[1], 0, bytes[1]);
+
+		start = Sys_DoubleTime ();
+		texprocs[i].expand (dst[0], indexed, pixels, d_8to24table);
+		times[0] = Sys_DoubleTime () - start;
+
+		TexMgr_SetupBenchJob (&job, &texprocs[i], indexed, dst[1], size);
+		start = Sys_DoubleTime ();
+		TexMgr_PrepareImage (&job);
+		times[1] = Sys_DoubleTime () - start;
+
+		start = Sys_DoubleTime ();
+		texprocs[i].resample (dst[2], size, size, src, inwidth, inwidth, true);
+		times[2] = Sys_DoubleTime () - start;
+		texprocs[i].resample (dst[2] + pixels, size, size, src, inwidth, inwidth, false);
+
+		bad = 0;
+		for (j = 0; i && j < 3; j++)
+			bad += memcmp (ref[j], out[j], bytes[j]) != 0;
+
+		Con_Printf ("%-6s expand %7.3f ms, prepare %7.3f ms, resample %7.3f ms%s\n", texprocs[i].name,
+			times[0] * 1000.0, times[1] * 1000.0, times[2] * 1000.0, !i ? "" : bad ? ", MISMATCH" : ", matches scalar");
 	}
 
-	// upload it
-	TexMgr_LoadImage32 (glt, (unsigned *)data);
+	// the whole cpu side, a texture at a time and then batched
+	jobs = (texjob_t *) malloc (count * sizeof(texjob_t));
+	if (!jobs)
+		Sys_Error ("TexMgr_TexBench_f: malloc() failed");
+	for (i = 0; i < count; i++)
+	{
+		unsigned *data = (unsigned *) malloc (bytes[1]);
+		if (!data)
+			break;
+		TexMgr_SetupBenchJob (&jobs[i], TexMgr_Procs (), indexed, data, size);
+		jobs[i].alloc = data;
+	}
+	count = i;
+
+	start = Sys_DoubleTime ();
+	TexMgr_PrepareImagesTask (jobs, 0, count);
+	times[0] = Sys_DoubleTime () - start;
+
+	start = Sys_DoubleTime ();
+	Tasks_Run (TexMgr_PrepareImagesTask, jobs, count, 1);
+	Tasks_Wait ();
+	times[1] = Sys_DoubleTime () - start;
+
+	Con_Printf ("%d %dx%d textures: %.1f ms serial, %.1f ms on %d threads (%.2fx)\n", count, size, size,
+		times[0] * 1000.0, times[1] * 1000.0, Tasks_NumThreads (), times[0] / q_max (times[1], 1e-9));
+
+	for (i = 0; i < count; i++)
+		free (jobs[i].alloc);
+	free (jobs);
+	for (i = 0; i < 3; i++)
+	{
+		free (ref[i]);
+		free (out[i]);
+	}
+	free (src);
+	free (indexed);
+}
+
+/*
+================
+TexMgr_LoadJob -- queues a set up job, or prepares and uploads it right away
+================
+*/
+static void TexMgr_LoadJob (texjob_t *job)
+{
+	if (TexMgr_QueueImage (job))
+		return;
+
+	if (!job->data)
+		job->data = (unsigned *) Hunk_Alloc (job->width * job->height * job->depth * 4);
+	TexMgr_PrepareImage (job);
+	TexMgr_UploadImage (job);
+	TexMgr_FinishImage (job->glt);
+}
+
+/*
+================
+TexMgr_LoadImage32 -- handles 32bit source data
+================
+*/
+static void TexMgr_LoadImage32 (gltexture_t *glt, unsigned *data)
+{
+	texjob_t job;
+
+	memset (&job, 0, sizeof(job));
+	TexMgr_SetupImage32 (&job, glt, data);
+	TexMgr_LoadJob (&job);
+}
+
+/*
+================
+TexMgr_LoadImage8 -- handles 8bit source data
+================
+*/
+static void TexMgr_LoadImage8 (gltexture_t *glt, byte *data)
+{
+	texjob_t job;
+
+	memset (&job, 0, sizeof(job));
+	TexMgr_SetupImage8 (&job, glt, data);
+	TexMgr_LoadJob (&job);
 }
 
 /*
@@ -1286,6 +1979,7 @@ static void TexMgr_LoadLightmap (gltexture_t *glt, byte *data)
 
 	// set filter modes
 	TexMgr_SetFilterModes (glt);
+	TexMgr_FinishImage (glt);
 }
 
 /*
@@ -1372,13 +2066,6 @@ gltexture_t *TexMgr_LoadImageEx (qmodel_t *owner, const char *name, int width, i
 		break;
 	}
 
-	GL_ObjectLabelFunc (GL_TEXTURE, glt->texnum, -1, glt->name);
-	if (flags & TEXPREF_BINDLESS && gl_bindless_able)
-	{
-		glt->bindless_handle = GL_GetTextureHandleARBFunc (glt->texnum);
-		GL_MakeTextureHandleResidentARBFunc (glt->bindless_handle);
-	}
-
 	Hunk_FreeToLowMark(mark);
 
 	return glt;
@@ -1526,13 +2213,6 @@ invalid:	Con_Printf ("TexMgr_ReloadImage: invalid source for %s\n", glt->name);
 		break;
 	}
 
-	GL_ObjectLabelFunc (GL_TEXTURE, glt->texnum, -1, glt->name);
-	if (glt->flags & TEXPREF_BINDLESS && gl_bindless_able)
-	{
-		glt->bindless_handle = GL_GetTextureHandleARBFunc (glt->texnum);
-		GL_MakeTextureHandleResidentARBFunc (glt->bindless_handle);
-	}
-
 	Hunk_FreeToLowMark(mark);
 }
 
@@ -1557,11 +2237,13 @@ void TexMgr_ReloadImages (void)
 // switching to a boolean flag.
 	in_reload_images = true;
 
+	TexMgr_BeginImageBatch ();
 	for (glt = active_gltextures; glt; glt = glt->next)
 	{
 		glGenTextures(1, &glt->texnum);
 		TexMgr_ReloadImage (glt, -1, -1);
 	}
+	TexMgr_EndImageBatch ();
 	
 	in_reload_images = false;
 }
@@ -1575,9 +2257,11 @@ void TexMgr_ReloadNobrightImages (void)
 {
 	gltexture_t *glt;
 
+	TexMgr_BeginImageBatch ();
 	for (glt = active_gltextures; glt; glt = glt->next)
 		if (glt->flags & TEXPREF_NOBRIGHT)
 			TexMgr_ReloadImage(glt, -1, -1);
+	TexMgr_EndImageBatch ();
 }
 
 /*
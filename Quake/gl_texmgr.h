@@ -117,6 +117,9 @@ gltexture_t *TexMgr_LoadImageEx (qmodel_t *owner, const char *name, int width, i
 void TexMgr_ReloadImage (gltexture_t *glt, int shirt, int pants);
 void TexMgr_ReloadImages (void);
 void TexMgr_ReloadNobrightImages (void);
+void TexMgr_BeginImageBatch (void);
+void TexMgr_EndImageBatch (void);
+void TexMgr_AbortImageBatch (void);
 
 int TexMgr_Pad(int s);
 int TexMgr_SafeTextureSize (int s);
@@ -410,7 +410,12 @@ static qboolean VID_SetMode (int width, int height, int refreshrate, int bpp, qb
 	/* Create the window if needed, hidden */
 	if (!draw_context)
 	{
+#ifdef HEADLESS
+		flags = SDL_WINDOW_HIDDEN;	// gl_null.c stands in for the context
+		fullscreen = false;
+#else
 		flags = SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN;
+#endif
 
 		if (vid_borderless.value)
 			flags |= SDL_WINDOW_BORDERLESS;
@@ -465,6 +470,7 @@ static qboolean VID_SetMode (int width, int height, int refreshrate, int bpp, qb
 	SDL_RaiseWindow (draw_context);
 
 	/* Create GL context if needed */
+#ifndef HEADLESS
 	if (!gl_context) {
 		gl_context = SDL_GL_CreateContext(draw_context);
 		if (!gl_context)
@@ -501,6 +507,7 @@ static qboolean VID_SetMode (int width, int height, int refreshrate, int bpp, qb
 				);
 		}
 	}
+#endif
 
 	vid.width = VID_GetCurrentWidth();
 	vid.height = VID_GetCurrentHeight();
@@ -557,7 +564,11 @@ static void VID_ApplyVSync (void)
 		Con_SafePrintf ("VSync interval %d too high, clamping to %d\n", abs(interval), MAX_INTERVAL);
 		interval = interval < 0 ? -MAX_INTERVAL : MAX_INTERVAL;
 	}
+#ifdef HEADLESS
+	if (interval != 0)
+#else
 	if (SDL_GL_SetSwapInterval (interval) != 0)
+#endif
 	{
 		if (interval == 0)
 			Con_SafePrintf ("Could not disable vsync\n");
@@ -902,7 +913,11 @@ qboolean GL_InitFunctions (const glfunc_t *funcs, qboolean required)
 
 	while (funcs->name)
 	{
+#ifdef HEADLESS
+		if ((*funcs->ptr = GLNull_GetProcAddress (funcs->name)) == NULL)
+#else
 		if ((*funcs->ptr = SDL_GL_GetProcAddress (funcs->name)) == NULL)
+#endif
 		{
 			if (required)
 			{
@@ -1224,13 +1239,17 @@ GL_EndRendering
 */
 void GL_EndRendering (void)
 {
+	CL_TimeDemoMark (TD_DRAW);
 	GL_PostProcess ();
 	GL_DynamicBuffersEndFrame ();
 
+#ifndef HEADLESS
 	if (!scr_skipupdate)
 	{
 		SDL_GL_SwapWindow(draw_context);
 	}
+#endif
+	CL_TimeDemoMark (TD_PRESENT);
 }
 
 
@@ -1357,6 +1376,9 @@ VID_Init
 void	VID_Init (void)
 {
 	static char vid_center[] = "SDL_VIDEO_CENTERED=center";
+#ifdef HEADLESS
+	static char vid_dummy[] = "SDL_VIDEODRIVER=dummy";
+#endif
 	int		p, width, height, refreshrate, bpp;
 	int		display_width, display_height, display_refreshrate, display_bpp;
 	qboolean	fullscreen;
@@ -1404,6 +1426,9 @@ void	VID_Init (void)
 	Cmd_AddCommand ("vid_describemodes", VID_DescribeModes_f);
 
 	putenv (vid_center);	/* SDL_putenv is problematic in versions <= 1.2.9 */
+#ifdef HEADLESS
+	putenv (vid_dummy);	/* no display needed, nothing is ever drawn */
+#endif
 
 	if (SDL_InitSubSystem(SDL_INIT_VIDEO) < 0)
 		Sys_Error("Couldn't init SDL video: %s", SDL_GetError());
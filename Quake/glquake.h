@@ -49,20 +49,6 @@ typedef enum {
 	pt_static, pt_grav, pt_slowgrav, pt_fire, pt_explode, pt_explode2, pt_blob, pt_blob2
 } ptype_t;
 
-// !!! if this is changed, it must be changed in d_ifacea.h too !!!
-typedef struct particle_s
-{
-// driver-usable fields
-	vec3_t		org;
-	float		color;
-// drivers never touch the following fields
-	struct particle_s	*next;
-	vec3_t		vel;
-	float		ramp;
-	float		die;
-	ptype_t		type;
-} particle_t;
-
 
 //====================================================
 
@@ -237,6 +223,10 @@ extern	qboolean	gl_clipcontrol_able;
 QGL_ALL_FUNCTIONS(QGL_DECLARE_FUNC)
 #undef QGL_DECLARE_FUNC
 
+#ifdef HEADLESS
+void *GLNull_GetProcAddress (const char *name);	// gl_null.c
+#endif
+
 void GL_BeginGroup (const char *name);
 void GL_EndGroup (void);
 
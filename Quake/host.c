@@ -77,6 +77,8 @@ cvar_t	coop = {"coop","0",CVAR_NONE};			// 0 or 1
 
 cvar_t	pausable = {"pausable","1",CVAR_NONE};
 
+cvar_t	savebinary = {"savebinary","1",CVAR_ARCHIVE};	// add a binary chunk to savegames
+
 cvar_t	developer = {"developer","0",CVAR_NONE};
 
 cvar_t	temp1 = {"temp1","0",CVAR_NONE};
@@ -170,6 +172,9 @@ void Host_Error (const char *error, ...)
 		Sys_Error ("Host_Error: recursively entered");
 	inerror = true;
 
+	Tasks_Wait ();	// don't free anything a worker is still writing to
+	TexMgr_AbortImageBatch ();
+
 	SCR_EndLoadingPlaque ();		// reenable screen updates
 
 	va_start (argptr,error);
@@ -300,6 +305,7 @@ void Host_InitLocal (void)
 	Cvar_RegisterVariable (&campaign);
 
 	Cvar_RegisterVariable (&pausable);
+	Cvar_RegisterVariable (&savebinary);
 
 	Cvar_RegisterVariable (&temp1);
 
@@ -655,6 +661,34 @@ void Host_GetConsoleCommands (void)
 	}
 }
 
+/*
+===================
+Host_ServerPoll
+
+Called by the dedicated server main loop whenever console or network input
+arrives between ticks: runs typed commands, accepts new connections and
+reads client moves as soon as they land instead of at the next tick.
+===================
+*/
+void Host_ServerPoll (void)
+{
+	if (setjmp (host_abortserver) )
+		return;			// something bad happened, or the server disconnected
+
+	Host_GetConsoleCommands ();
+	Cbuf_Execute ();
+
+	NET_Poll ();
+
+	if (!sv.active)
+		return;
+
+	NET_Batch (true);
+	SV_CheckForNewClients ();
+	SV_PollClients ();
+	NET_Batch (false);
+}
+
 /*
 ==================
 Host_ServerFrame
@@ -671,6 +705,9 @@ void Host_ServerFrame (void)
 // set the time and clear the general datagram
 	SV_ClearDatagram ();
 
+// queue datagrams for the frame and send them together at the end
+	NET_Batch (true);
+
 // check for new clients
 	SV_CheckForNewClients ();
 
@@ -700,6 +737,8 @@ void Host_ServerFrame (void)
 
 // send all messages to the clients
 	SV_SendClientMessages ();
+
+	NET_Batch (false);
 }
 
 typedef struct summary_s {
@@ -819,6 +858,8 @@ void _Host_Frame (double time)
 
 	CL_AccumulateCmd ();
 
+	CL_TimeDemoMark (TD_OTHER);
+
 	//Run the server+networking (client->server->client), at a different rate from everyt
 	if (accumtime >= host_netinterval)
 	{
@@ -842,10 +883,12 @@ void _Host_Frame (double time)
 		host_frametime = realframetime;
 		Cbuf_Waited();
 	}
+	CL_TimeDemoMark (TD_SERVER);
 
 // fetch results from server
 	if (cls.state == ca_connected)
 		CL_ReadFromServer ();
+	CL_TimeDemoMark (TD_PARSE);
 
 // update video
 	if (host_speeds.value)
@@ -854,6 +897,7 @@ void _Host_Frame (double time)
 	SCR_UpdateScreen ();
 
 	CL_RunParticles (); //johnfitz -- seperated from rendering
+	CL_TimeDemoMark (TD_SCENE);
 
 	if (host_speeds.value)
 		time2 = Sys_DoubleTime ();
@@ -869,6 +913,7 @@ void _Host_Frame (double time)
 		S_Update (vec3_origin, vec3_origin, vec3_origin, vec3_origin);
 
 	CDAudio_Update();
+	CL_TimeDemoMark (TD_SOUND);
 	UpdateWindowTitle();
 
 	if (host_speeds.value)
@@ -881,14 +926,39 @@ void _Host_Frame (double time)
 					pass1+pass2+pass3, pass1, pass2, pass3);
 	}
 
+	CL_TimeDemoEndFrame ();
 	host_framecount++;
 
 }
 
+static double	tick_latetotal, tick_latemax, tick_idletotal;
+static int	tick_count;
+
+/*
+==================
+Host_TickStats
+
+The dedicated server loop reports how late each tick started relative to
+its schedule and how long it slept waiting for input beforehand; the
+totals are printed with serverprofile.
+==================
+*/
+void Host_TickStats (double late, double idle)
+{
+	if (!serverprofile.value)
+		return;
+
+	tick_latetotal += late;
+	if (late > tick_latemax)
+		tick_latemax = late;
+	tick_idletotal += idle;
+	tick_count++;
+}
+
 void Host_Frame (double time)
 {
 	double	time1, time2;
-	static double	timetotal;
+	static double	timetotal, walltotal;
 	static int		timecount;
 	int		i, c, m;
 
@@ -903,14 +973,13 @@ void Host_Frame (double time)
 	time2 = Sys_DoubleTime ();
 
 	timetotal += time2 - time1;
+	walltotal += time;
 	timecount++;
 
 	if (timecount < 1000)
 		return;
 
 	m = timetotal*1000/timecount;
-	timecount = 0;
-	timetotal = 0;
 	c = 0;
 	for (i = 0; i < svs.maxclients; i++)
 	{
@@ -918,7 +987,18 @@ void Host_Frame (double time)
 			c++;
 	}
 
-	Con_Printf ("serverprofile: %2i clients %2i msec\n",  c,  m);
+	if (tick_count && walltotal > 0)
+		Con_Printf ("serverprofile: %2i clients %2i msec, jitter %.2f avg %.2f max msec, %2i%% idle\n",
+				c, m, tick_latetotal*1000/tick_count, tick_latemax*1000,
+				(int)(100*tick_idletotal/walltotal));
+	else
+		Con_Printf ("serverprofile: %2i clients %2i msec\n",  c,  m);
+
+	timecount = 0;
+	timetotal = 0;
+	walltotal = 0;
+	tick_count = 0;
+	tick_latetotal = tick_latemax = tick_idletotal = 0;
 }
 
 /*
@@ -948,6 +1028,7 @@ void Host_Init (void)
 	Cvar_Init (); //johnfitz
 	COM_Init ();
 	COM_InitFilesystem ();
+	Tasks_Init ();
 	Host_InitLocal ();
 	W_LoadWadFile (); //johnfitz -- filename is now hard-coded for honesty
 	if (cls.state != ca_dedicated)
@@ -1040,6 +1121,7 @@ void Host_Shutdown(void)
 	Host_WriteConfiguration ();
 
 	NET_Shutdown ();
+	Tasks_Shutdown ();
 
 	if (cls.state != ca_dedicated)
 	{
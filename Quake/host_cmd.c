@@ -24,6 +24,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include "quakedef.h"
 
 extern cvar_t	pausable;
+extern cvar_t	savebinary;
 
 int	current_skill;
 
@@ -869,6 +870,7 @@ static void Host_Reconnect_f (void)
 
 	SCR_BeginLoadingPlaque ();
 	cls.signon = 0;		// need new connection messages
+	cls.signontime = realtime;
 }
 
 /*
@@ -904,6 +906,12 @@ LOAD / SAVE GAME
 
 #define	SAVEGAME_VERSION	5
 
+// the binary chunk follows the text after a 0 byte, so older engines
+// stop reading before it.  the file ends with the chunk offset and the
+// ident again, so it can be found without parsing the text.
+#define	SAVEGAME_BINARY_IDENT	(('B'<<24)+('S'<<16)+('S'<<8)+'Q')	// "QSSB"
+#define	SAVEGAME_BINARY_VERSION	1
+
 /*
 ===============
 Host_SavegameComment
@@ -941,6 +949,381 @@ static void Host_SavegameComment (char *text)
 	text[SAVEGAME_COMMENT_LENGTH] = '\0';
 }
 
+/*
+===============
+Host_WriteSaveText
+
+Lightstyles, globals and edicts as text
+===============
+*/
+static void Host_WriteSaveText (FILE *f)
+{
+	int	i;
+
+	for (i = 0; i < MAX_LIGHTSTYLES; i++)
+	{
+		if (sv.lightstyles[i])
+			fprintf (f, "%s\n", sv.lightstyles[i]);
+		else
+			fprintf (f,"m\n");
+	}
+
+	ED_WriteGlobals (f);
+	for (i = 0; i < sv.num_edicts; i++)
+	{
+		ED_Write (f, EDICT_NUM(i));
+		fflush (f);
+	}
+}
+
+/*
+===============
+Host_ParseSaveText
+===============
+*/
+static void Host_ParseSaveText (const char *data)
+{
+	int	i;
+	edict_t	*ent;
+	int	entnum;
+
+	for (i = 0; i < MAX_LIGHTSTYLES; i++)
+	{
+		data = COM_ParseStringNewline (data);
+		sv.lightstyles[i] = (const char *)Hunk_Strdup (com_token, "lightstyles");
+	}
+
+// load the edicts out of the savegame file
+	entnum = -1;		// -1 is the globals
+	while (*data)
+	{
+		data = COM_Parse (data);
+		if (!com_token[0])
+			break;		// end of file
+		if (strcmp(com_token,"{"))
+		{
+			Sys_Error ("First token isn't a brace");
+		}
+
+		if (entnum == -1)
+		{	// parse the global vars
+			data = ED_ParseGlobals (data);
+		}
+		else
+		{	// parse an edict
+			ent = EDICT_NUM(entnum);
+			if (entnum < sv.num_edicts)
+				ED_ClearEdict (ent);
+			else
+				memset (ent, 0, pr_edict_size);
+			data = ED_ParseEdict (data, ent);
+
+			// link it into the bsp tree
+			if (!ent->free)
+				SV_LinkEdict (ent, false);
+		}
+
+		entnum++;
+	}
+
+	sv.num_edicts = entnum;
+}
+
+/*
+===============
+Host_WriteSaveBinary
+
+The same as Host_WriteSaveText, for progs with a matching crc
+===============
+*/
+static void Host_WriteSaveBinary (FILE *f)
+{
+	int	i, header[2];
+
+	header[0] = LittleLong (SAVEGAME_BINARY_IDENT);
+	header[1] = LittleLong (SAVEGAME_BINARY_VERSION);
+	fwrite (header, sizeof(header), 1, f);
+
+	for (i = 0; i < MAX_LIGHTSTYLES; i++)
+	{
+		if (sv.lightstyles[i])
+			fwrite (sv.lightstyles[i], strlen (sv.lightstyles[i]) + 1, 1, f);
+		else
+			fwrite ("m", 2, 1, f);
+	}
+
+	ED_WriteBinary (f);
+}
+
+/*
+===============
+Host_ParseSaveBinary
+
+Returns false without changing anything if the chunk doesn't suit the
+current progs
+===============
+*/
+static qboolean Host_ParseSaveBinary (const byte *data, int length)
+{
+	const char	*styles[MAX_LIGHTSTYLES];
+	const byte	*p, *end;
+	int	i, header[2];
+	edict_t	*ent;
+	int	numedicts;
+
+	if (length < (int) sizeof(header))
+		return false;
+	memcpy (header, data, sizeof(header));
+	if (LittleLong (header[0]) != SAVEGAME_BINARY_IDENT || LittleLong (header[1]) != SAVEGAME_BINARY_VERSION)
+		return false;
+
+	p = data + sizeof(header);
+	end = data + length;
+	for (i = 0; i < MAX_LIGHTSTYLES; i++)
+	{
+		styles[i] = (const char *) p;
+		while (p < end && *p)
+			p++;
+		if (p == end)
+			return false;
+		p++;
+	}
+
+	numedicts = ED_ReadBinary (p, end - p);
+	if (numedicts < 0)
+		return false;
+
+	for (i = 0; i < MAX_LIGHTSTYLES; i++)
+		sv.lightstyles[i] = (const char *)Hunk_Strdup (styles[i], "lightstyles");
+
+	for (i = 0; i < numedicts; i++)
+	{
+		ent = EDICT_NUM(i);
+		if (!ent->free)
+			SV_LinkEdict (ent, false);
+	}
+
+	sv.num_edicts = numedicts;
+	return true;
+}
+
+/*
+===============
+Host_AppendSaveBinary
+===============
+*/
+static void Host_AppendSaveBinary (const char *name)
+{
+	FILE	*f;
+	int	trailer[2];
+
+	f = Sys_fopen (name, "ab");
+	if (!f)
+	{
+		Con_Printf ("ERROR: couldn't add binary data.\n");
+		return;
+	}
+
+	fseek (f, 0, SEEK_END);
+	fputc (0, f);	// ends the text for the parser
+	trailer[0] = LittleLong ((int) ftell (f));
+	trailer[1] = LittleLong (SAVEGAME_BINARY_IDENT);
+
+	Host_WriteSaveBinary (f);
+	fwrite (trailer, sizeof(trailer), 1, f);
+	fclose (f);
+}
+
+/*
+===============
+Host_LoadSaveBinary
+
+Restores the state from the binary chunk of a savegame, if it has one
+that suits the current progs
+===============
+*/
+static qboolean Host_LoadSaveBinary (const char *name)
+{
+	static byte	*data;
+
+	FILE	*f;
+	long	filelen;
+	int	trailer[2], ofs, length;
+	qboolean	ok;
+
+// avoid leaking if the previous load failed with a Host_Error
+	if (data != NULL)
+		free (data);
+	data = NULL;
+
+	f = Sys_fopen (name, "rb");
+	if (!f)
+		return false;
+
+	fseek (f, 0, SEEK_END);
+	filelen = ftell (f);
+	if (filelen < (long) sizeof(trailer)
+	 || fseek (f, filelen - sizeof(trailer), SEEK_SET)
+	 || fread (trailer, sizeof(trailer), 1, f) != 1
+	 || LittleLong (trailer[1]) != SAVEGAME_BINARY_IDENT)
+	{
+		fclose (f);
+		return false;
+	}
+
+	ofs = LittleLong (trailer[0]);
+	length = filelen - sizeof(trailer) - ofs;
+	if (ofs <= 0 || length <= 0 || fseek (f, ofs, SEEK_SET))
+	{
+		fclose (f);
+		return false;
+	}
+
+	data = (byte *) malloc (length);
+	if (!data || fread (data, length, 1, f) != 1)
+	{
+		fclose (f);
+		return false;
+	}
+	fclose (f);
+
+	ok = Host_ParseSaveBinary (data, length);
+	free (data);
+	data = NULL;
+
+	return ok;
+}
+
+/*
+===============
+Host_ReadTempFile
+
+Returns the contents of f with a 0 appended, in malloc'd memory
+===============
+*/
+static byte *Host_ReadTempFile (FILE *f, long *length)
+{
+	byte	*data;
+
+	*length = ftell (f);
+	rewind (f);
+	data = (byte *) malloc (*length + 1);
+	if (!data)
+		Sys_Error ("Host_ReadTempFile: out of memory");
+	if (fread (data, 1, *length, f) != (size_t) *length)
+		Sys_Error ("Host_ReadTempFile: read error");
+	data[*length] = 0;
+
+	return data;
+}
+
+/*
+===============
+Host_Savebench_f
+
+Round trips the current game through the text and binary savegame
+formats and reports the average times.  Afterwards the hunk and strings
+are freed back to where they were and the game is loaded again from its
+state before the runs, so all of them together cost what one load does.
+===============
+*/
+static void Host_Savebench_f (void)
+{
+	FILE	*f;
+	byte	*data, *before, *after;
+	long	textlength, binlength, beforelength, afterlength;
+	double	start, save[2], load[2];
+	int	i, count, mark, strmark;
+
+	if (cmd_source != src_command)
+		return;
+
+	if (!sv.active)
+	{
+		Con_Printf ("Not playing a local game.\n");
+		return;
+	}
+
+	count = (Cmd_Argc () > 1) ? Q_atoi (Cmd_Argv (1)) : 10;
+	count = CLAMP (1, count, 100);
+
+	if (!(f = tmpfile ()))
+	{
+		Con_Printf ("ERROR: couldn't open a temporary file.\n");
+		return;
+	}
+	Host_WriteSaveText (f);
+	before = Host_ReadTempFile (f, &beforelength);
+	fclose (f);
+
+	mark = Hunk_LowMark ();
+	strmark = PR_StringsMark ();
+
+	save[0] = save[1] = load[0] = load[1] = 0;
+	textlength = binlength = 0;
+	for (i = 0; i < count; i++)
+	{
+		if (!(f = tmpfile ()))
+			break;
+		start = Sys_DoubleTime ();
+		Host_WriteSaveText (f);
+		save[0] += Sys_DoubleTime () - start;
+		start = Sys_DoubleTime ();
+		data = Host_ReadTempFile (f, &textlength);
+		Host_ParseSaveText ((const char *) data);
+		load[0] += Sys_DoubleTime () - start;
+		free (data);
+		fclose (f);
+
+		if (!(f = tmpfile ()))
+			break;
+		start = Sys_DoubleTime ();
+		Host_WriteSaveBinary (f);
+		save[1] += Sys_DoubleTime () - start;
+		start = Sys_DoubleTime ();
+		data = Host_ReadTempFile (f, &binlength);
+		if (!Host_ParseSaveBinary (data, binlength))
+		{
+			Con_Printf ("ERROR: binary chunk rejected.\n");
+			free (data);
+			fclose (f);
+			break;
+		}
+		load[1] += Sys_DoubleTime () - start;
+		free (data);
+		fclose (f);
+	}
+
+	after = NULL;
+	afterlength = 0;
+	if ((f = tmpfile ()))
+	{
+		Host_WriteSaveText (f);
+		after = Host_ReadTempFile (f, &afterlength);
+		fclose (f);
+	}
+
+// drop what the loads allocated; the edicts still point at it until the
+// starting state is loaded over them
+	Hunk_FreeToLowMark (mark);
+	PR_FreeStringsToMark (strmark);
+	Host_ParseSaveText ((const char *) before);
+	ED_ResetFindIndex ();
+
+	if (i)
+	{
+		Con_Printf ("%i round trips, %i edicts\n", i, sv.num_edicts);
+		Con_Printf ("text:   %7.2f ms save %7.2f ms load %8ld bytes\n", save[0] * 1000 / i, load[0] * 1000 / i, textlength);
+		Con_Printf ("binary: %7.2f ms save %7.2f ms load %8ld bytes\n", save[1] * 1000 / i, load[1] * 1000 / i, binlength);
+		if (after && beforelength == afterlength && !memcmp (before, after, beforelength))
+			Con_Printf ("game state unchanged\n");
+		else
+			Con_Printf ("WARNING: game state changed by the round trips\n");
+	}
+	free (before);
+	free (after);
+}
+
 /*
 ===============
 Host_Savegame_f
@@ -1018,22 +1401,12 @@ static void Host_Savegame_f (void)
 	fprintf (f, "%s\n", sv.name);
 	fprintf (f, "%f\n",sv.time);
 
-// write the light styles
-	for (i = 0; i < MAX_LIGHTSTYLES; i++)
-	{
-		if (sv.lightstyles[i])
-			fprintf (f, "%s\n", sv.lightstyles[i]);
-		else
-			fprintf (f,"m\n");
-	}
-
-	ED_WriteGlobals (f);
-	for (i = 0; i < sv.num_edicts; i++)
-	{
-		ED_Write (f, EDICT_NUM(i));
-		fflush (f);
-	}
+	Host_WriteSaveText (f);
 	fclose (f);
+
+	if (savebinary.value)
+		Host_AppendSaveBinary (name);
+
 	Con_Printf ("done.\n");
 }
 
@@ -1052,8 +1425,6 @@ static void Host_Loadgame_f (void)
 	float	time, tfloat;
 	const char	*data;
 	int	i;
-	edict_t	*ent;
-	int	entnum;
 	int	version;
 	float	spawn_parms[NUM_SPAWN_PARMS];
 
@@ -1130,48 +1501,11 @@ static void Host_Loadgame_f (void)
 	sv.paused = true;		// pause until all clients connect
 	sv.loadgame = true;
 
-// load the light styles
-
-	for (i = 0; i < MAX_LIGHTSTYLES; i++)
-	{
-		data = COM_ParseStringNewline (data);
-		sv.lightstyles[i] = (const char *)Hunk_Strdup (com_token, "lightstyles");
-	}
-
-// load the edicts out of the savegame file
-	entnum = -1;		// -1 is the globals
-	while (*data)
-	{
-		data = COM_Parse (data);
-		if (!com_token[0])
-			break;		// end of file
-		if (strcmp(com_token,"{"))
-		{
-			Sys_Error ("First token isn't a brace");
-		}
-
-		if (entnum == -1)
-		{	// parse the global vars
-			data = ED_ParseGlobals (data);
-		}
-		else
-		{	// parse an edict
-			ent = EDICT_NUM(entnum);
-			if (entnum < sv.num_edicts)
-				ED_ClearEdict (ent);
-			else
-				memset (ent, 0, pr_edict_size);
-			data = ED_ParseEdict (data, ent);
-
-			// link it into the bsp tree
-			if (!ent->free)
-				SV_LinkEdict (ent, false);
-		}
+// load the light styles, globals and edicts, straight from the binary
+// chunk if the progs haven't changed since the game was saved
+	if (!Host_LoadSaveBinary (name))
+		Host_ParseSaveText (data);
 
-		entnum++;
-	}
-
-	sv.num_edicts = entnum;
 	sv.time = time;
 
 	free (start);
@@ -1820,7 +2154,7 @@ static void Host_Give_f (void)
 	case 's':
 		if (rogue)
 		{
-		    val = GetEdictFieldValue(sv_player, "ammo_shells1");
+		    val = GetEdictFieldEval(sv_player, ammo_shells1);
 		    if (val)
 			val->_float = v;
 		}
@@ -1830,7 +2164,7 @@ static void Host_Give_f (void)
 	case 'n':
 		if (rogue)
 		{
-		    val = GetEdictFieldValue(sv_player, "ammo_nails1");
+		    val = GetEdictFieldEval(sv_player, ammo_nails1);
 		    if (val)
 		    {
 			val->_float = v;
@@ -1847,7 +2181,7 @@ static void Host_Give_f (void)
 	case 'l':
 		if (rogue)
 		{
-		    val = GetEdictFieldValue(sv_player, "ammo_lava_nails");
+		    val = GetEdictFieldEval(sv_player, ammo_lava_nails);
 		    if (val)
 		    {
 			val->_float = v;
@@ -1860,7 +2194,7 @@ static void Host_Give_f (void)
 	case 'r':
 		if (rogue)
 		{
-		    val = GetEdictFieldValue(sv_player, "ammo_rockets1");
+		    val = GetEdictFieldEval(sv_player, ammo_rockets1);
 		    if (val)
 		    {
 			val->_float = v;
@@ -1877,7 +2211,7 @@ static void Host_Give_f (void)
 	case 'm':
 		if (rogue)
 		{
-		    val = GetEdictFieldValue(sv_player, "ammo_multi_rockets");
+		    val = GetEdictFieldEval(sv_player, ammo_multi_rockets);
 		    if (val)
 		    {
 			val->_float = v;
@@ -1894,7 +2228,7 @@ static void Host_Give_f (void)
 	case 'c':
 		if (rogue)
 		{
-		    val = GetEdictFieldValue(sv_player, "ammo_cells1");
+		    val = GetEdictFieldEval(sv_player, ammo_cells1);
 		    if (val)
 		    {
 			val->_float = v;
@@ -1911,7 +2245,7 @@ static void Host_Give_f (void)
 	case 'p':
 		if (rogue)
 		{
-		    val = GetEdictFieldValue(sv_player, "ammo_plasma");
+		    val = GetEdictFieldEval(sv_player, ammo_plasma);
 		    if (val)
 		    {
 			val->_float = v;
@@ -2234,6 +2568,7 @@ void Host_InitCommands (void)
 	Cmd_AddCommand ("ping", Host_Ping_f);
 	Cmd_AddCommand ("load", Host_Loadgame_f);
 	Cmd_AddCommand ("save", Host_Savegame_f);
+	Cmd_AddCommand ("savebench", Host_Savebench_f);
 	Cmd_AddCommand ("give", Host_Give_f);
 
 	Cmd_AddCommand ("startdemos", Host_Startdemos_f);
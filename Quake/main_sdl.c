@@ -79,6 +79,8 @@ int main(int argc, char *argv[])
 {
 	int		t;
 	double		time, oldtime, newtime;
+	double		deadline, idle;
+	qboolean	input;
 
 	host_parms = &parms;
 	parms.basedir = ".";
@@ -121,20 +123,29 @@ int main(int argc, char *argv[])
 	oldtime = Sys_DoubleTime();
 	if (isDedicated)
 	{
+		/* ticks are scheduled against absolute deadlines so that
+		   oversleeping on one does not push back all the following ones.
+		   between ticks, sleep until a packet or console line arrives
+		   and hand it to the server right away. */
+		deadline = oldtime + sys_ticrate.value;
 		while (1)
 		{
-			newtime = Sys_DoubleTime ();
-			time = newtime - oldtime;
-
-			while (time < sys_ticrate.value )
+			idle = 0;
+			while ((newtime = Sys_DoubleTime ()) < deadline)
 			{
-				SDL_Delay(1);
-				newtime = Sys_DoubleTime ();
-				time = newtime - oldtime;
+				input = Sys_WaitForInput (deadline);
+				idle += Sys_DoubleTime () - newtime;
+				if (input)
+					Host_ServerPoll ();
 			}
 
-			Host_Frame (time);
+			Host_TickStats (newtime - deadline, idle);
+			Host_Frame (newtime - oldtime);
 			oldtime = newtime;
+
+			deadline += sys_ticrate.value;
+			if (deadline < oldtime)	/* more than a tick behind, resync */
+				deadline = oldtime + sys_ticrate.value;
 		}
 	}
 	else
@@ -57,11 +57,16 @@ struct qsocket_s	*NET_Connect (const char *host);
 
 double NET_QSocketGetTime (const struct qsocket_s *sock);
 const char *NET_QSocketGetAddressString (const struct qsocket_s *sock);
+qboolean NET_QSocketIsLoopback (const struct qsocket_s *sock);
 
 qboolean NET_CanSendMessage (struct qsocket_s *sock);
 // Returns true or false if the given qsocket can currently accept a
 // message to be transmitted.
 
+qboolean NET_SendQueueEmpty (struct qsocket_s *sock);
+// Returns true once every reliable message sent on the qsocket has been
+// acknowledged.
+
 int	NET_GetMessage (struct qsocket_s *sock);
 // returns data in net_message sizebuf
 // returns 0 if no data is waiting
@@ -90,6 +95,17 @@ void	NET_Close (struct qsocket_s *sock);
 
 void	NET_Poll (void);
 
+void	NET_Batch (qboolean state);
+// While batching, outgoing datagrams may be queued; turning it off flushes
+// them.  The server batches each frame's sends.
+
+#ifndef _WIN32
+int	NET_GetSockets (int *fds, int maxfds, qboolean *pending);
+// Stores the readable-on-input descriptors of the network layer in fds,
+// returns how many were written.  Used by the dedicated server to block
+// until a packet arrives; *pending means one already has, so don't block.
+#endif
+
 
 // Server list related globals:
 extern	qboolean	slistInProgress;
@@ -42,6 +42,7 @@ net_driver_t net_drivers[] =
 		Loop_SendUnreliableMessage,
 		Loop_CanSendMessage,
 		Loop_CanSendUnreliableMessage,
+		Loop_SendQueueEmpty,
 		Loop_Close,
 		Loop_Shutdown
 	},
@@ -58,6 +59,7 @@ net_driver_t net_drivers[] =
 		Datagram_SendUnreliableMessage,
 		Datagram_CanSendMessage,
 		Datagram_CanSendUnreliableMessage,
+		Datagram_SendQueueEmpty,
 		Datagram_Close,
 		Datagram_Shutdown
 	}
@@ -79,8 +81,11 @@ net_landriver_t	net_landrivers[] =
 		UDP_CloseSocket,
 		UDP_Connect,
 		UDP_CheckNewConnections,
+		UDP_ListenSocket,
 		UDP_Read,
 		UDP_Write,
+		UDP_Batch,
+		UDP_Pending,
 		UDP_Broadcast,
 		UDP_AddrToString,
 		UDP_StringToAddr,
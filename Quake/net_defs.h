@@ -53,6 +53,11 @@ struct qsockaddr
 
 #define NET_PROTOCOL_VERSION	3
 
+// optional tail of CCREQ_CONNECT and CCREP_ACCEPT: both ends can run the
+// windowed reliable stream (net_dgrm.c).  older peers never send it and
+// ignore it when it is sent to them.
+#define NET_WINDOW_MAGIC	0x57494e44	// "WIND"
+
 /**
 
 This is the network info/connection protocol.  It is used to find Quake
@@ -67,6 +72,7 @@ General notes:
 CCREQ_CONNECT
 		string	game_name		"QUAKE"
 		byte	net_protocol_version	NET_PROTOCOL_VERSION
+		long	window_magic		NET_WINDOW_MAGIC (optional)
 
 CCREQ_SERVER_INFO
 		string	game_name		"QUAKE"
@@ -80,6 +86,7 @@ CCREQ_RULE_INFO
 
 CCREP_ACCEPT
 		long	port
+		long	window_magic		NET_WINDOW_MAGIC (optional)
 
 CCREP_REJECT
 		string	reason
@@ -157,6 +164,8 @@ typedef struct qsocket_s
 	struct qsockaddr	addr;
 	char		address[NET_NAMELEN];
 
+	struct netwindow_s	*window;	// windowed reliable stream, NULL for stop-and-wait
+
 } qsocket_t;
 
 extern qsocket_t	*net_activeSockets;
@@ -175,8 +184,11 @@ typedef struct
 	int		(*Close_Socket) (sys_socket_t socketid);
 	int		(*Connect) (sys_socket_t socketid, struct qsockaddr *addr);
 	sys_socket_t	(*CheckNewConnections) (void);
+	sys_socket_t	(*ListenSocket) (void);
 	int		(*Read) (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr);
 	int		(*Write) (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr);
+	void		(*Batch) (qboolean state);
+	qboolean	(*Pending) (sys_socket_t socketid);
 	int		(*Broadcast) (sys_socket_t socketid, byte *buf, int len);
 	const char *	(*AddrToString) (struct qsockaddr *addr);
 	int		(*StringToAddr) (const char *string, struct qsockaddr *addr);
@@ -206,6 +218,7 @@ typedef struct
 	int		(*SendUnreliableMessage) (qsocket_t *sock, sizebuf_t *data);
 	qboolean	(*CanSendMessage) (qsocket_t *sock);
 	qboolean	(*CanSendUnreliableMessage) (qsocket_t *sock);
+	qboolean	(*SendQueueEmpty) (qsocket_t *sock);
 	void		(*Close) (qsocket_t *sock);
 	void		(*Shutdown) (void);
 } net_driver_t;
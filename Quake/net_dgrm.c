@@ -129,6 +129,517 @@ static void NET_Ban_f (void)
 #endif	// BAN_TEST
 
 
+/*
+=============================================================================
+
+	SIMULATED NETWORK CONDITIONS
+
+net_fakelag holds back every datagram a connection sends by that many
+milliseconds and net_fakeloss drops that percentage of them, so a client and
+server on one machine behave as if far apart.  Connect to a listen server by
+its address rather than "local" so both directions pass through here, and
+"developer 1" reports how long each signon took.
+
+=============================================================================
+*/
+
+static cvar_t	net_fakelag = {"net_fakelag", "0", CVAR_NONE};
+static cvar_t	net_fakeloss = {"net_fakeloss", "0", CVAR_NONE};
+
+typedef struct fakepacket_s
+{
+	struct fakepacket_s	*next;
+	double				time;		// when it goes out
+	int					landriver;
+	sys_socket_t		socket;
+	struct qsockaddr	addr;
+	int					length;
+	byte				data[1];	// variable sized
+} fakepacket_t;
+
+static fakepacket_t	*fakehead, *faketail;
+
+/*
+==================
+Datagram_FlushFakeLag
+
+Sends the held back datagrams that are due
+==================
+*/
+static void Datagram_FlushFakeLag (void)
+{
+	fakepacket_t	*p;
+
+	while ((p = fakehead) != NULL && p->time <= net_time)
+	{
+		fakehead = p->next;
+		if (!fakehead)
+			faketail = NULL;
+		net_landrivers[p->landriver].Write (p->socket, p->data, p->length, &p->addr);
+		free (p);
+	}
+}
+
+/*
+==================
+Datagram_DropFakeLag
+
+Forgets the held back datagrams of a socket that is being closed
+==================
+*/
+static void Datagram_DropFakeLag (sys_socket_t socket)
+{
+	fakepacket_t	**link, *p;
+
+	faketail = NULL;
+	for (link = &fakehead; (p = *link) != NULL; )
+	{
+		if (p->socket == socket)
+		{
+			*link = p->next;
+			free (p);
+			continue;
+		}
+		faketail = p;
+		link = &p->next;
+	}
+}
+
+/*
+==================
+Datagram_Write
+
+Every datagram of an established connection goes out through here
+==================
+*/
+static int Datagram_Write (qsocket_t *sock, byte *data, int length)
+{
+	fakepacket_t	*p;
+
+	if (net_fakeloss.value > 0 && (rand () % 10000) < net_fakeloss.value * 100)
+		return length;
+
+	// keep the order of anything still held back when the lag is turned off
+	if (net_fakelag.value <= 0 && !fakehead)
+		return sfunc.Write (sock->socket, data, length, &sock->addr);
+
+	p = (fakepacket_t *) malloc (sizeof(fakepacket_t) + length);
+	if (!p)
+		return sfunc.Write (sock->socket, data, length, &sock->addr);
+
+	p->next = NULL;
+	p->time = net_time + q_max (net_fakelag.value, 0.f) / 1000.0;
+	p->landriver = sock->landriver;
+	p->socket = sock->socket;
+	p->addr = sock->addr;
+	p->length = length;
+	memcpy (p->data, data, length);
+
+	if (faketail)
+		faketail->next = p;
+	else
+		fakehead = p;
+	faketail = p;
+
+	return length;
+}
+
+/*
+=============================================================================
+
+	WINDOWED RELIABLE STREAM
+
+When both ends put NET_WINDOW_MAGIC in the connect handshake, reliable
+messages go out as a stream of small fragments with up to WINDOW_SIZE of them
+in flight, rather than one datagram per round trip.  More messages can be
+queued behind those in flight, so a big signon no longer holds up everything
+after it.
+
+DATA packets are the same as before: a sequence number per fragment and
+NETFLAG_EOM on the last fragment of a message.  An ACK carries the sequence
+the receiver expects next, then a 64 bit mask of the fragments after that
+which have already arrived.  A fragment is sent again when its round trip
+timeout runs out, or at once if three fragments sent after it have been
+acknowledged.  The window grows and is cut back the way TCP's does.
+
+=============================================================================
+*/
+
+static cvar_t	net_window = {"net_window", "1", CVAR_NONE};	// offer or accept windowed connections
+
+#define WINDOW_SIZE			64		// fragments in flight, and fragments held out of order
+#define WINDOW_QUEUE		128		// fragments queued to send, power of 2
+#define WINDOW_MINIMUM		16		// congestion window to start with and never cut below
+#define WINDOW_FRAGMENT		1400	// payload bytes, below a typical path MTU
+#define WINDOW_ACKSIZE		(NET_HEADERSIZE + 8)
+#define WINDOW_MESSAGE		((NET_MAXMESSAGE + WINDOW_FRAGMENT - 1) / WINDOW_FRAGMENT)
+
+typedef struct
+{
+	double		sendtime;		// last transmission, 0 if never sent
+	int			length;
+	qboolean	eom;
+	qboolean	present;		// acknowledged, or arrived
+	qboolean	resent;			// its ack says nothing about the round trip
+	byte		data[WINDOW_FRAGMENT];
+} netfragment_t;
+
+typedef struct netwindow_s
+{
+	netfragment_t	send[WINDOW_QUEUE];		// ackSequence to sendSequence
+	netfragment_t	receive[WINDOW_SIZE];	// after receiveSequence
+	double			srtt, rttvar;			// round trip estimate, 0 until measured
+	float			cwnd, ssthresh;			// congestion window, in fragments
+	unsigned int	recover;				// no further cut until this is acknowledged
+} netwindow_t;
+
+/*
+==================
+Window_Open
+==================
+*/
+static qboolean Window_Open (qsocket_t *sock)
+{
+	netwindow_t	*w;
+
+	w = (netwindow_t *) calloc (1, sizeof(netwindow_t));
+	if (!w)
+		return false;
+
+	w->cwnd = WINDOW_MINIMUM;
+	w->ssthresh = WINDOW_SIZE;
+	w->recover = sock->sendSequence;
+	sock->window = w;
+	return true;
+}
+
+/*
+==================
+Window_Close
+==================
+*/
+static void Window_Close (qsocket_t *sock)
+{
+	free (sock->window);
+	sock->window = NULL;
+}
+
+/*
+==================
+Window_Timeout
+==================
+*/
+static double Window_Timeout (const netwindow_t *w)
+{
+	if (!w->srtt)
+		return 1.0;
+	// acks are only read once a frame, so allow for that on top of the variation
+	return q_min (w->srtt + q_max (4 * w->rttvar, 0.05), 1.0);
+}
+
+/*
+==================
+Window_Loss
+
+Cuts the window in half, once per window of data
+==================
+*/
+static void Window_Loss (qsocket_t *sock, unsigned int sequence)
+{
+	netwindow_t	*w = sock->window;
+
+	if ((int) (sequence - w->recover) < 0)
+		return;
+
+	w->ssthresh = q_max (w->cwnd * 0.5f, (float) WINDOW_MINIMUM);
+	w->cwnd = w->ssthresh;
+	w->recover = sock->sendSequence;
+}
+
+/*
+==================
+Window_Acknowledge
+==================
+*/
+static void Window_Acknowledge (netwindow_t *w, netfragment_t *f)
+{
+	double	rtt;
+
+	if (f->present)
+		return;
+	f->present = true;
+
+	if (f->sendtime && !f->resent)
+	{
+		rtt = q_max (net_time - f->sendtime, 0.001);
+		if (!w->srtt)
+		{
+			w->srtt = rtt;
+			w->rttvar = rtt * 0.5;
+		}
+		else
+		{
+			w->rttvar = 0.75 * w->rttvar + 0.25 * fabs (w->srtt - rtt);
+			w->srtt = 0.875 * w->srtt + 0.125 * rtt;
+		}
+	}
+
+	if (w->cwnd < w->ssthresh)
+		w->cwnd += 1.f;
+	else
+		w->cwnd += 1.f / w->cwnd;
+	w->cwnd = q_min (w->cwnd, (float) WINDOW_SIZE);
+}
+
+/*
+==================
+Window_Transmit
+==================
+*/
+static int Window_Transmit (qsocket_t *sock, netfragment_t *f, unsigned int sequence)
+{
+	unsigned int	packetLen = NET_HEADERSIZE + f->length;
+
+	packetBuffer.length = BigLong(packetLen | NETFLAG_DATA | (f->eom ? NETFLAG_EOM : 0));
+	packetBuffer.sequence = BigLong(sequence);
+	Q_memcpy (packetBuffer.data, f->data, f->length);
+
+	if (f->sendtime)
+	{
+		f->resent = true;
+		packetsReSent++;
+	}
+	else
+		packetsSent++;
+	f->sendtime = net_time;
+	sock->lastSendTime = net_time;
+
+	return Datagram_Write (sock, (byte *)&packetBuffer, packetLen);
+}
+
+/*
+==================
+Window_Send
+
+Sends whatever the window allows: new fragments, and lost ones again
+==================
+*/
+static int Window_Send (qsocket_t *sock)
+{
+	netwindow_t		*w = sock->window;
+	netfragment_t	*f;
+	unsigned int	sequence, end;
+	double			timeout = Window_Timeout (w);
+	int				later;
+
+	end = sock->ackSequence + q_min ((int) w->cwnd, WINDOW_SIZE);
+	if ((int) (end - sock->sendSequence) > 0)
+		end = sock->sendSequence;
+
+	// count the acknowledged fragments, then walk forward with the number after each one
+	later = 0;
+	for (sequence = sock->ackSequence; sequence != end; sequence++)
+		later += w->send[sequence & (WINDOW_QUEUE - 1)].present;
+
+	for (sequence = sock->ackSequence; sequence != end; sequence++)
+	{
+		f = &w->send[sequence & (WINDOW_QUEUE - 1)];
+		if (f->present)
+		{
+			later--;
+			continue;
+		}
+
+		if (f->sendtime)
+		{
+			if (net_time - f->sendtime <= timeout && (later < 3 || net_time - f->sendtime <= w->srtt))
+				continue;
+			Window_Loss (sock, sequence);
+		}
+
+		if (Window_Transmit (sock, f, sequence) == -1)
+			return -1;
+	}
+
+	return 1;
+}
+
+/*
+==================
+Window_SendMessage
+==================
+*/
+static int Window_SendMessage (qsocket_t *sock, sizebuf_t *data)
+{
+	netwindow_t		*w = sock->window;
+	netfragment_t	*f;
+	int				offset, length;
+
+	if ((int) (sock->sendSequence - sock->ackSequence) + (data->cursize + WINDOW_FRAGMENT - 1) / WINDOW_FRAGMENT > WINDOW_QUEUE)
+	{
+		Con_DPrintf ("Window_SendMessage: queue full\n");
+		return 0;
+	}
+
+	for (offset = 0; offset < data->cursize; offset += length)
+	{
+		length = q_min (data->cursize - offset, WINDOW_FRAGMENT);
+		f = &w->send[sock->sendSequence++ & (WINDOW_QUEUE - 1)];
+		f->sendtime = 0;
+		f->length = length;
+		f->eom = (offset + length == data->cursize);
+		f->present = false;
+		f->resent = false;
+		Q_memcpy (f->data, data->data + offset, length);
+	}
+
+	return Window_Send (sock);
+}
+
+/*
+==================
+Window_CanSendMessage
+
+True while a message of any size still fits in the queue
+==================
+*/
+static qboolean Window_CanSendMessage (qsocket_t *sock)
+{
+	Window_Send (sock);
+	return WINDOW_QUEUE - (int) (sock->sendSequence - sock->ackSequence) >= WINDOW_MESSAGE;
+}
+
+/*
+==================
+Window_ReceiveAck
+==================
+*/
+static void Window_ReceiveAck (qsocket_t *sock, unsigned int sequence, unsigned int length)
+{
+	netwindow_t		*w = sock->window;
+	unsigned int	inflight, mask[2], s;
+	int				i;
+
+	inflight = sock->sendSequence - sock->ackSequence;
+	if (length != WINDOW_ACKSIZE || sequence - sock->ackSequence > inflight)
+	{
+		Con_DPrintf("Stale ACK received\n");
+		return;
+	}
+
+	for ( ; sock->ackSequence != sequence; sock->ackSequence++)
+		Window_Acknowledge (w, &w->send[sock->ackSequence & (WINDOW_QUEUE - 1)]);
+
+	mask[0] = BigLong(((unsigned int *)packetBuffer.data)[0]);
+	mask[1] = BigLong(((unsigned int *)packetBuffer.data)[1]);
+	for (i = 0; i < 64; i++)
+	{
+		s = sequence + 1 + i;
+		if (s - sock->ackSequence >= sock->sendSequence - sock->ackSequence)
+			break;
+		if (mask[i >> 5] & (1u << (i & 31)))
+			Window_Acknowledge (w, &w->send[s & (WINDOW_QUEUE - 1)]);
+	}
+}
+
+/*
+==================
+Window_SendAck
+==================
+*/
+static void Window_SendAck (qsocket_t *sock)
+{
+	netwindow_t		*w = sock->window;
+	unsigned int	ack[4], mask[2] = {0, 0};
+	unsigned int	next;
+	int				i;
+
+	// everything that arrived in order counts, delivered or not
+	for (next = sock->receiveSequence; next - sock->receiveSequence < WINDOW_SIZE; next++)
+		if (!w->receive[next & (WINDOW_SIZE - 1)].present)
+			break;
+
+	for (i = 0; next + 1 + i - sock->receiveSequence < WINDOW_SIZE; i++)
+		if (w->receive[(next + 1 + i) & (WINDOW_SIZE - 1)].present)
+			mask[i >> 5] |= 1u << (i & 31);
+
+	ack[0] = BigLong(WINDOW_ACKSIZE | NETFLAG_ACK);
+	ack[1] = BigLong(next);
+	ack[2] = BigLong(mask[0]);
+	ack[3] = BigLong(mask[1]);
+	Datagram_Write (sock, (byte *)ack, WINDOW_ACKSIZE);
+}
+
+/*
+==================
+Window_ReceiveData
+
+Keeps a fragment that arrived inside the window
+==================
+*/
+static void Window_ReceiveData (qsocket_t *sock, unsigned int sequence, unsigned int flags, unsigned int length)
+{
+	netfragment_t	*f;
+
+	if (sequence - sock->receiveSequence >= WINDOW_SIZE || length > WINDOW_FRAGMENT)
+	{
+		receivedDuplicateCount++;
+		return;
+	}
+
+	f = &sock->window->receive[sequence & (WINDOW_SIZE - 1)];
+	if (f->present)
+	{
+		receivedDuplicateCount++;
+		return;
+	}
+
+	f->present = true;
+	f->length = length;
+	f->eom = (flags & NETFLAG_EOM) != 0;
+	Q_memcpy (f->data, packetBuffer.data, length);
+}
+
+/*
+==================
+Window_Deliver
+
+Puts the next complete message in net_message: returns 1 if there is one,
+0 if not, -1 if the peer sent more than a message can hold
+==================
+*/
+static int Window_Deliver (qsocket_t *sock)
+{
+	netfragment_t	*f;
+
+	while ((f = &sock->window->receive[sock->receiveSequence & (WINDOW_SIZE - 1)])->present)
+	{
+		if (sock->receiveMessageLength + f->length > NET_MAXMESSAGE)
+		{
+			Con_Printf("Oversized reliable message from %s\n", sock->address);
+			return -1;
+		}
+
+		Q_memcpy (sock->receiveMessage + sock->receiveMessageLength, f->data, f->length);
+		sock->receiveMessageLength += f->length;
+		sock->receiveSequence++;
+		f->present = false;
+
+		if (f->eom)
+		{
+			SZ_Clear (&net_message);
+			SZ_Write (&net_message, sock->receiveMessage, sock->receiveMessageLength);
+			sock->receiveMessageLength = 0;
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+//=============================================================================
+
+
 int Datagram_SendMessage (qsocket_t *sock, sizebuf_t *data)
 {
 	unsigned int	packetLen;
@@ -146,6 +657,9 @@ int Datagram_SendMessage (qsocket_t *sock, sizebuf_t *data)
 		Sys_Error("SendMessage: called with canSend == false\n");
 #endif
 
+	if (sock->window)
+		return Window_SendMessage (sock, data);
+
 	Q_memcpy(sock->sendMessage, data->data, data->cursize);
 	sock->sendMessageLength = data->cursize;
 
@@ -167,7 +681,7 @@ int Datagram_SendMessage (qsocket_t *sock, sizebuf_t *data)
 
 	sock->canSend = false;
 
-	if (sfunc.Write (sock->socket, (byte *)&packetBuffer, packetLen, &sock->addr) == -1)
+	if (Datagram_Write (sock, (byte *)&packetBuffer, packetLen) == -1)
 		return -1;
 
 	sock->lastSendTime = net_time;
@@ -200,7 +714,7 @@ static int SendMessageNext (qsocket_t *sock)
 
 	sock->sendNext = false;
 
-	if (sfunc.Write (sock->socket, (byte *)&packetBuffer, packetLen, &sock->addr) == -1)
+	if (Datagram_Write (sock, (byte *)&packetBuffer, packetLen) == -1)
 		return -1;
 
 	sock->lastSendTime = net_time;
@@ -233,7 +747,7 @@ static int ReSendMessage (qsocket_t *sock)
 
 	sock->sendNext = false;
 
-	if (sfunc.Write (sock->socket, (byte *)&packetBuffer, packetLen, &sock->addr) == -1)
+	if (Datagram_Write (sock, (byte *)&packetBuffer, packetLen) == -1)
 		return -1;
 
 	sock->lastSendTime = net_time;
@@ -244,6 +758,9 @@ static int ReSendMessage (qsocket_t *sock)
 
 qboolean Datagram_CanSendMessage (qsocket_t *sock)
 {
+	if (sock->window)
+		return Window_CanSendMessage (sock);
+
 	if (sock->sendNext)
 		SendMessageNext (sock);
 
@@ -257,6 +774,26 @@ qboolean Datagram_CanSendUnreliableMessage (qsocket_t *sock)
 }
 
 
+/*
+==================
+Datagram_SendQueueEmpty
+
+A window can take new messages long before the old ones are through, so
+this is what tells that everything sent so far has been acknowledged
+==================
+*/
+qboolean Datagram_SendQueueEmpty (qsocket_t *sock)
+{
+	if (sock->window)
+	{
+		Window_Send (sock);
+		return sock->sendSequence == sock->ackSequence;
+	}
+
+	return Datagram_CanSendMessage (sock);
+}
+
+
 int Datagram_SendUnreliableMessage (qsocket_t *sock, sizebuf_t *data)
 {
 	int	packetLen;
@@ -275,7 +812,7 @@ int Datagram_SendUnreliableMessage (qsocket_t *sock, sizebuf_t *data)
 	packetBuffer.sequence = BigLong(sock->unreliableSendSequence++);
 	Q_memcpy (packetBuffer.data, data->data, data->cursize);
 
-	if (sfunc.Write (sock->socket, (byte *)&packetBuffer, packetLen, &sock->addr) == -1)
+	if (Datagram_Write (sock, (byte *)&packetBuffer, packetLen) == -1)
 		return -1;
 
 	packetsSent++;
@@ -292,7 +829,15 @@ int	Datagram_GetMessage (qsocket_t *sock)
 	unsigned int	sequence;
 	unsigned int	count;
 
-	if (!sock->canSend)
+	Datagram_FlushFakeLag ();
+
+	if (sock->window)
+	{
+		// a message may be complete among the fragments held out of order
+		if ((ret = Window_Deliver (sock)) != 0)
+			return ret;
+	}
+	else if (!sock->canSend)
 		if ((net_time - sock->lastSendTime) > 1.0)
 			ReSendMessage (sock);
 
@@ -362,6 +907,12 @@ int	Datagram_GetMessage (qsocket_t *sock)
 			break;
 		}
 
+		if ((flags & NETFLAG_ACK) && sock->window)
+		{
+			Window_ReceiveAck (sock, sequence, length);
+			continue;
+		}
+
 		if (flags & NETFLAG_ACK)
 		{
 			if (sequence != (sock->sendSequence - 1))
@@ -394,11 +945,20 @@ int	Datagram_GetMessage (qsocket_t *sock)
 			continue;
 		}
 
+		if ((flags & NETFLAG_DATA) && sock->window)
+		{
+			Window_ReceiveData (sock, sequence, flags, length - NET_HEADERSIZE);
+			Window_SendAck (sock);
+			if ((ret = Window_Deliver (sock)) != 0)
+				break;
+			continue;
+		}
+
 		if (flags & NETFLAG_DATA)
 		{
 			packetBuffer.length = BigLong(NET_HEADERSIZE | NETFLAG_ACK);
 			packetBuffer.sequence = BigLong(sequence);
-			sfunc.Write (sock->socket, (byte *)&packetBuffer, NET_HEADERSIZE, &readaddr);
+			Datagram_Write (sock, (byte *)&packetBuffer, NET_HEADERSIZE);
 
 			if (sequence != sock->receiveSequence)
 			{
@@ -426,7 +986,12 @@ int	Datagram_GetMessage (qsocket_t *sock)
 		}
 	}
 
-	if (sock->sendNext)
+	if (sock->window)
+	{
+		if (Window_Send (sock) == -1)
+			return -1;
+	}
+	else if (sock->sendNext)
 		SendMessageNext (sock);
 
 	return ret;
@@ -438,6 +1003,12 @@ static void PrintStats(qsocket_t *s)
 	Con_Printf("canSend = %4u   \n", s->canSend);
 	Con_Printf("sendSeq = %4u   ", s->sendSequence);
 	Con_Printf("recvSeq = %4u   \n", s->receiveSequence);
+	if (s->window)
+	{
+		Con_Printf("inFlight = %3u   ", s->sendSequence - s->ackSequence);
+		Con_Printf("window = %5.1f   ", s->window->cwnd);
+		Con_Printf("rtt = %4.0f ms\n", s->window->srtt * 1000);
+	}
 	Con_Printf("\n");
 }
 
@@ -790,6 +1361,9 @@ int Datagram_Init (void)
 	myDriverLevel = net_driverlevel;
 
 	Cmd_AddCommand ("net_stats", NET_Stats_f);
+	Cvar_RegisterVariable (&net_window);
+	Cvar_RegisterVariable (&net_fakelag);
+	Cvar_RegisterVariable (&net_fakeloss);
 
 	if (safemode || COM_CheckParm("-nolan"))
 		return -1;
@@ -838,6 +1412,8 @@ void Datagram_Shutdown (void)
 
 void Datagram_Close (qsocket_t *sock)
 {
+	Window_Close (sock);
+	Datagram_DropFakeLag (sock->socket);
 	sfunc.Close_Socket(sock->socket);
 }
 
@@ -866,6 +1442,7 @@ static qsocket_t *_Datagram_CheckNewConnections (void)
 	int			command;
 	int			control;
 	int			ret;
+	qboolean	windowed;
 
 	acceptsock = dfunc.CheckNewConnections();
 	if (acceptsock == INVALID_SOCKET)
@@ -996,6 +1573,8 @@ static qsocket_t *_Datagram_CheckNewConnections (void)
 		return NULL;
 	}
 
+	windowed = msg_readcount + 4 <= net_message.cursize && MSG_ReadLong() == NET_WINDOW_MAGIC && net_window.value;
+
 #ifdef BAN_TEST
 	// check for a ban
 	if (clientaddr.qsa_family == AF_INET)
@@ -1035,6 +1614,8 @@ static qsocket_t *_Datagram_CheckNewConnections (void)
 				MSG_WriteByte(&net_message, CCREP_ACCEPT);
 				dfunc.GetSocketAddr(s->socket, &newaddr);
 				MSG_WriteLong(&net_message, dfunc.GetSocketPort(&newaddr));
+				if (s->window)
+					MSG_WriteLong(&net_message, NET_WINDOW_MAGIC);
 				*((int *)net_message.data) = BigLong(NETFLAG_CTL | (net_message.cursize & NETFLAG_LENGTH_MASK));
 				dfunc.Write (acceptsock, net_message.data, net_message.cursize, &clientaddr);
 				SZ_Clear(&net_message);
@@ -1084,6 +1665,8 @@ static qsocket_t *_Datagram_CheckNewConnections (void)
 	sock->landriver = net_landriverlevel;
 	sock->addr = clientaddr;
 	Q_strcpy(sock->address, dfunc.AddrToString(&clientaddr));
+	if (windowed)
+		Window_Open (sock);	// stays stop-and-wait if this fails
 
 	// send him back the info about the server connection he has been allocated
 	SZ_Clear(&net_message);
@@ -1093,6 +1676,8 @@ static qsocket_t *_Datagram_CheckNewConnections (void)
 	dfunc.GetSocketAddr(newsock, &newaddr);
 	MSG_WriteLong(&net_message, dfunc.GetSocketPort(&newaddr));
 //	MSG_WriteString(&net_message, dfunc.AddrToString(&newaddr));
+	if (sock->window)
+		MSG_WriteLong(&net_message, NET_WINDOW_MAGIC);
 	*((int *)net_message.data) = BigLong(NETFLAG_CTL | (net_message.cursize & NETFLAG_LENGTH_MASK));
 	dfunc.Write (acceptsock, net_message.data, net_message.cursize, &clientaddr);
 	SZ_Clear(&net_message);
@@ -1276,6 +1861,8 @@ static qsocket_t *_Datagram_Connect (const char *host)
 		MSG_WriteByte(&net_message, CCREQ_CONNECT);
 		MSG_WriteString(&net_message, "QUAKE");
 		MSG_WriteByte(&net_message, NET_PROTOCOL_VERSION);
+		if (net_window.value)
+			MSG_WriteLong(&net_message, NET_WINDOW_MAGIC);
 		*((int *)net_message.data) = BigLong(NETFLAG_CTL | (net_message.cursize & NETFLAG_LENGTH_MASK));
 		dfunc.Write (newsock, net_message.data, net_message.cursize, &sendaddr);
 		SZ_Clear(&net_message);
@@ -1363,6 +1950,13 @@ static qsocket_t *_Datagram_Connect (const char *host)
 	{
 		Q_memcpy(&sock->addr, &sendaddr, sizeof(struct qsockaddr));
 		dfunc.SetSocketPort (&sock->addr, MSG_ReadLong());
+		if (msg_readcount + 4 <= net_message.cursize && MSG_ReadLong() == NET_WINDOW_MAGIC && !Window_Open (sock))
+		{
+			reason = "Out of memory";
+			Con_Printf("%s\n", reason);
+			Q_strcpy(m_return_reason, reason);
+			goto ErrorReturn;
+		}
 	}
 	else
 	{
@@ -1390,6 +1984,7 @@ static qsocket_t *_Datagram_Connect (const char *host)
 	return sock;
 
 ErrorReturn:
+	Window_Close(sock);
 	NET_FreeQSocket(sock);
 ErrorReturn2:
 	dfunc.Close_Socket(newsock);
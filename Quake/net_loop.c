@@ -235,6 +235,12 @@ qboolean Loop_CanSendUnreliableMessage (qsocket_t *sock)
 }
 
 
+qboolean Loop_SendQueueEmpty (qsocket_t *sock)
+{
+	return Loop_CanSendMessage (sock);
+}
+
+
 void Loop_Close (qsocket_t *sock)
 {
 	if (sock->driverdata)
@@ -33,6 +33,7 @@ int		Loop_SendMessage (qsocket_t *sock, sizebuf_t *data);
 int		Loop_SendUnreliableMessage (qsocket_t *sock, sizebuf_t *data);
 qboolean	Loop_CanSendMessage (qsocket_t *sock);
 qboolean	Loop_CanSendUnreliableMessage (qsocket_t *sock);
+qboolean	Loop_SendQueueEmpty (qsocket_t *sock);
 void		Loop_Close (qsocket_t *sock);
 void		Loop_Shutdown (void);
 
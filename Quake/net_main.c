@@ -166,6 +166,12 @@ const char *NET_QSocketGetAddressString (const qsocket_t *s)
 }
 
 
+qboolean NET_QSocketIsLoopback (const qsocket_t *s)
+{
+	return IS_LOOP_DRIVER(s->driver);
+}
+
+
 static void NET_Listen_f (void)
 {
 	if (Cmd_Argc () != 2)
@@ -672,13 +678,39 @@ qboolean NET_CanSendMessage (qsocket_t *sock)
 }
 
 
+/*
+==================
+NET_SendQueueEmpty
+
+Returns true once every reliable message sent on the qsocket has been
+acknowledged, which NET_CanSendMessage doesn't say on a windowed socket.
+==================
+*/
+qboolean NET_SendQueueEmpty (qsocket_t *sock)
+{
+	if (!sock)
+		return false;
+
+	if (sock->disconnected)
+		return false;
+
+	SetNetTime();
+
+	return sfunc.SendQueueEmpty(sock);
+}
+
+
 int NET_SendToAll (sizebuf_t *data, double blocktime)
 {
 	double		start;
 	int			i;
 	int			count = 0;
 	qboolean	msg_init[MAX_SCOREBOARD];	/* did we write the message to the client's connection	*/
-	qboolean	msg_sent[MAX_SCOREBOARD];	/* did the msg arrive its destination (canSend state).	*/
+	qboolean	msg_sent[MAX_SCOREBOARD];	/* did the msg arrive its destination (send queue empty). */
+
+	/* this waits on replies, so nothing may sit in a batch.  also
+	   the way out of a server frame that was aborted by an error. */
+	NET_Batch (false);
 
 	for (i = 0, host_client = svs.clients; i < svs.maxclients; i++, host_client++)
 	{
@@ -730,7 +762,7 @@ int NET_SendToAll (sizebuf_t *data, double blocktime)
 
 			if (! msg_sent[i])
 			{
-				if (NET_CanSendMessage (host_client->netconnection))
+				if (NET_SendQueueEmpty (host_client->netconnection))
 				{
 					msg_sent[i] = true;
 				}
@@ -863,6 +895,77 @@ void NET_Shutdown (void)
 }
 
 
+/*
+====================
+NET_Batch
+
+While batching, lan drivers may hold outgoing datagrams back and send them
+together when batching is turned off again.
+====================
+*/
+void NET_Batch (qboolean state)
+{
+	int		i;
+
+	for (i = 0; i < net_numlandrivers; i++)
+	{
+		if (net_landrivers[i].initialized)
+			net_landrivers[i].Batch (state);
+	}
+}
+
+#ifndef _WIN32
+/*
+====================
+NET_GetSockets
+
+Fills fds with the listening sockets of every initialized lan driver and
+the sockets of all connected datagram qsockets, so that a dedicated server
+can sleep until one of them becomes readable.  Returns the number of
+descriptors stored.
+
+The listening sockets are left out while no map is running: nothing reads
+them then, so a single stray packet would keep them readable and the
+server would never sleep.  *pending is set if a driver already holds data
+read from one of the sockets, which poll won't see.
+====================
+*/
+int NET_GetSockets (int *fds, int maxfds, qboolean *pending)
+{
+	qsocket_t	*s;
+	sys_socket_t	sock;
+	int		i, count;
+
+	count = 0;
+	*pending = false;
+	for (i = 0; i < net_numlandrivers && count < maxfds && sv.active; i++)
+	{
+		if (!net_landrivers[i].initialized)
+			continue;
+		sock = net_landrivers[i].ListenSocket ();
+		if (sock == INVALID_SOCKET)
+			continue;
+		fds[count++] = sock;
+		if (net_landrivers[i].Pending (sock))
+			*pending = true;
+	}
+
+	for (s = net_activeSockets; s && count < maxfds; s = s->next)
+	{
+		if (IS_LOOP_DRIVER(s->driver) || s->disconnected)
+			continue;
+		if (s->socket == INVALID_SOCKET)
+			continue;
+		fds[count++] = s->socket;
+		if (net_landrivers[s->landriver].Pending (s->socket))
+			*pending = true;
+	}
+
+	return count;
+}
+#endif	/* _WIN32 */
+
+
 static PollProcedure *pollProcedureList = NULL;
 
 void NET_Poll(void)
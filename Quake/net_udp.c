@@ -20,6 +20,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE	/* for recvmmsg and sendmmsg */
+#endif
+
 #include "q_stdinc.h"
 #include "arch_def.h"
 #include "net_sys.h"
@@ -35,6 +39,207 @@ static in_addr_t	myAddr;
 
 #include "net_udp.h"
 
+/*
+===============================================================================
+
+	DATAGRAM BATCHING
+
+Where the system provides recvmmsg and sendmmsg, every socket gets a small
+queue in each direction.  A read drains as many pending datagrams as the
+queue holds with one system call and hands them out one by one; between
+UDP_Batch (true) and UDP_Batch (false) writes are queued and then leave
+with one sendmmsg per socket.
+
+The first datagram of a read lands directly in the caller's buffer, the
+others in slots big enough for any datagram the protocol sends.  Datagrams
+waiting in the slots are invisible to poll, so UDP_Pending reports them.
+
+===============================================================================
+*/
+
+#if defined(MSG_WAITFORONE)
+#define	UDP_MMSG
+#endif
+
+#ifdef UDP_MMSG
+
+#define	UDP_BATCH	16
+#define	UDP_RXBATCH	8	// kept small, each slot takes a whole NET_DATAGRAMSIZE
+#define	UDP_SLOTSIZE	NET_DATAGRAMSIZE
+#define	UDP_TXSIZE	(64 * 1024)
+
+typedef struct udpbatch_s
+{
+	sys_socket_t		socket;
+	struct udpbatch_s	*next;
+
+	int			rxcount, rxnext;
+	struct mmsghdr		rxmsgs[UDP_RXBATCH];
+	struct iovec		rxiov[UDP_RXBATCH];
+	struct qsockaddr	rxaddr[UDP_RXBATCH];
+	byte			rxbuf[UDP_RXBATCH][UDP_SLOTSIZE];
+
+	int			txcount, txsize;
+	struct mmsghdr		txmsgs[UDP_BATCH];
+	struct iovec		txiov[UDP_BATCH];
+	struct qsockaddr	txaddr[UDP_BATCH];
+	byte			txbuf[UDP_TXSIZE];
+} udpbatch_t;
+
+static udpbatch_t	*udp_batches;
+static qboolean		udp_batching;
+
+static udpbatch_t *UDP_GetBatch (sys_socket_t socketid, qboolean create)
+{
+	udpbatch_t	*b;
+
+	for (b = udp_batches; b; b = b->next)
+	{
+		if (b->socket == socketid)
+			return b;
+	}
+	if (!create)
+		return NULL;
+
+	b = (udpbatch_t *) calloc (1, sizeof(udpbatch_t));
+	if (!b)
+		return NULL;
+	b->socket = socketid;
+	b->next = udp_batches;
+	udp_batches = b;
+	return b;
+}
+
+static void UDP_FlushBatch (udpbatch_t *b)
+{
+	int	i, ret;
+
+	for (i = 0; i < b->txcount; )
+	{
+		ret = sendmmsg (b->socket, &b->txmsgs[i], b->txcount - i, 0);
+		if (ret == SOCKET_ERROR)
+		{
+			int err = SOCKETERRNO;
+			if (err == NET_EWOULDBLOCK)
+				break;	// same as a dropped sendto
+			Con_SafePrintf ("UDP_Write, sendmmsg: %s\n", socketerror(err));
+			ret = 1;	// skip the datagram that failed
+		}
+		i += ret;
+	}
+
+	b->txcount = 0;
+	b->txsize = 0;
+}
+
+static void UDP_FreeBatch (sys_socket_t socketid)
+{
+	udpbatch_t	*b, **prev;
+
+	for (prev = &udp_batches; (b = *prev) != NULL; prev = &b->next)
+	{
+		if (b->socket != socketid)
+			continue;
+		UDP_FlushBatch (b);
+		*prev = b->next;
+		free (b);
+		return;
+	}
+}
+
+static int UDP_ReadBatch (udpbatch_t *b, byte *buf, int len, struct qsockaddr *addr)
+{
+	struct mmsghdr	*m;
+	int		i, ret;
+
+	while (b->rxnext < b->rxcount)
+	{
+		m = &b->rxmsgs[b->rxnext];
+		i = b->rxnext++;
+		if (m->msg_hdr.msg_flags & MSG_TRUNC)
+		{	// bigger than anything a quake peer sends
+			Con_DPrintf ("UDP_Read: datagram over %i bytes dropped\n", (int)UDP_SLOTSIZE);
+			continue;
+		}
+		ret = q_min ((int)m->msg_len, len);
+		memcpy (buf, b->rxbuf[i], ret);
+		if (addr)
+			*addr = b->rxaddr[i];
+		return ret;
+	}
+
+	b->rxcount = b->rxnext = 0;
+	for (i = 0; i < UDP_RXBATCH; i++)
+	{
+		if (i == 0)
+		{	// the first one goes straight to the caller
+			b->rxiov[i].iov_base = buf;
+			b->rxiov[i].iov_len = len;
+		}
+		else
+		{
+			b->rxiov[i].iov_base = b->rxbuf[i];
+			b->rxiov[i].iov_len = UDP_SLOTSIZE;
+		}
+		m = &b->rxmsgs[i];
+		memset (&m->msg_hdr, 0, sizeof(m->msg_hdr));
+		m->msg_hdr.msg_name = &b->rxaddr[i];
+		m->msg_hdr.msg_namelen = sizeof(struct qsockaddr);
+		m->msg_hdr.msg_iov = &b->rxiov[i];
+		m->msg_hdr.msg_iovlen = 1;
+	}
+
+	ret = recvmmsg (b->socket, b->rxmsgs, UDP_RXBATCH, 0, NULL);
+	if (ret == SOCKET_ERROR)
+	{
+		int err = SOCKETERRNO;
+		if (err == NET_EWOULDBLOCK || err == NET_ECONNREFUSED)
+			return 0;
+		Con_SafePrintf ("UDP_Read, recvmmsg: %s\n", socketerror(err));
+		return -1;
+	}
+
+	b->rxcount = ret;
+	b->rxnext = 1;
+	if (addr)
+		*addr = b->rxaddr[0];
+	return b->rxmsgs[0].msg_len;
+}
+
+static qboolean UDP_BatchPending (sys_socket_t socketid)
+{
+	udpbatch_t	*b = UDP_GetBatch (socketid, false);
+
+	return b && b->rxnext < b->rxcount;
+}
+
+#endif	/* UDP_MMSG */
+
+qboolean UDP_Pending (sys_socket_t socketid)
+{
+#ifdef UDP_MMSG
+	return UDP_BatchPending (socketid);
+#else
+	return false;
+#endif
+}
+
+void UDP_Batch (qboolean state)
+{
+#ifdef UDP_MMSG
+	udpbatch_t	*b;
+
+	udp_batching = state;
+	if (state)
+		return;
+	for (b = udp_batches; b; b = b->next)
+	{
+		if (b->txcount)
+			UDP_FlushBatch (b);
+	}
+#endif
+}
+
 //=============================================================================
 
 sys_socket_t UDP_Init (void)
@@ -172,6 +377,9 @@ ErrorReturn:
 
 int UDP_CloseSocket (sys_socket_t socketid)
 {
+#ifdef UDP_MMSG
+	UDP_FreeBatch (socketid);
+#endif
 	if (socketid == net_broadcastsocket)
 		net_broadcastsocket = 0;
 	return closesocket (socketid);
@@ -252,6 +460,12 @@ sys_socket_t UDP_CheckNewConnections (void)
 	if (net_acceptsocket == INVALID_SOCKET)
 		return INVALID_SOCKET;
 
+#ifdef UDP_MMSG
+	// already drained from the kernel by an earlier batched read
+	if (UDP_BatchPending (net_acceptsocket))
+		return net_acceptsocket;
+#endif
+
 	if (ioctl (net_acceptsocket, FIONREAD, &available) == -1)
 	{
 		int err = SOCKETERRNO;
@@ -266,11 +480,25 @@ sys_socket_t UDP_CheckNewConnections (void)
 
 //=============================================================================
 
+sys_socket_t UDP_ListenSocket (void)
+{
+	return net_acceptsocket;
+}
+
+//=============================================================================
+
 int UDP_Read (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr)
 {
 	socklen_t addrlen = sizeof(struct qsockaddr);
 	int ret;
 
+#ifdef UDP_MMSG
+	udpbatch_t	*b = UDP_GetBatch (socketid, true);
+
+	if (b)
+		return UDP_ReadBatch (b, buf, len, addr);
+#endif
+
 	ret = recvfrom (socketid, buf, len, 0, (struct sockaddr *)addr, &addrlen);
 	if (ret == SOCKET_ERROR)
 	{
@@ -328,6 +556,32 @@ int UDP_Write (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr
 {
 	int	ret;
 
+#ifdef UDP_MMSG
+	udpbatch_t	*b;
+
+	if (udp_batching && len <= UDP_TXSIZE && (b = UDP_GetBatch (socketid, true)) != NULL)
+	{
+		struct mmsghdr	*m;
+
+		if (b->txcount == UDP_BATCH || b->txsize + len > UDP_TXSIZE)
+			UDP_FlushBatch (b);
+
+		memcpy (b->txbuf + b->txsize, buf, len);
+		b->txaddr[b->txcount] = *addr;
+		b->txiov[b->txcount].iov_base = b->txbuf + b->txsize;
+		b->txiov[b->txcount].iov_len = len;
+		m = &b->txmsgs[b->txcount];
+		memset (&m->msg_hdr, 0, sizeof(m->msg_hdr));
+		m->msg_hdr.msg_name = &b->txaddr[b->txcount];
+		m->msg_hdr.msg_namelen = sizeof(struct qsockaddr);
+		m->msg_hdr.msg_iov = &b->txiov[b->txcount];
+		m->msg_hdr.msg_iovlen = 1;
+		b->txcount++;
+		b->txsize += len;
+		return len;
+	}
+#endif
+
 	ret = sendto (socketid, buf, len, 0, (struct sockaddr *)addr,
 							sizeof(struct qsockaddr));
 	if (ret == SOCKET_ERROR)
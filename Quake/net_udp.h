@@ -29,8 +29,11 @@ sys_socket_t  UDP_OpenSocket (int port);
 int  UDP_CloseSocket (sys_socket_t socketid);
 int  UDP_Connect (sys_socket_t socketid, struct qsockaddr *addr);
 sys_socket_t  UDP_CheckNewConnections (void);
+sys_socket_t  UDP_ListenSocket (void);
 int  UDP_Read (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr);
 int  UDP_Write (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr);
+void UDP_Batch (qboolean state);
+qboolean UDP_Pending (sys_socket_t socketid);
 int  UDP_Broadcast (sys_socket_t socketid, byte *buf, int len);
 const char *UDP_AddrToString (struct qsockaddr *addr);
 int  UDP_StringToAddr (const char *string, struct qsockaddr *addr);
@@ -42,6 +42,7 @@ net_driver_t net_drivers[] =
 		Loop_SendUnreliableMessage,
 		Loop_CanSendMessage,
 		Loop_CanSendUnreliableMessage,
+		Loop_SendQueueEmpty,
 		Loop_Close,
 		Loop_Shutdown
 	},
@@ -58,6 +59,7 @@ net_driver_t net_drivers[] =
 		Datagram_SendUnreliableMessage,
 		Datagram_CanSendMessage,
 		Datagram_CanSendUnreliableMessage,
+		Datagram_SendQueueEmpty,
 		Datagram_Close,
 		Datagram_Shutdown
 	}
@@ -81,8 +83,11 @@ net_landriver_t	net_landrivers[] =
 		WINS_CloseSocket,
 		WINS_Connect,
 		WINS_CheckNewConnections,
+		WINS_ListenSocket,
 		WINS_Read,
 		WINS_Write,
+		WINS_Batch,
+		WINS_Pending,
 		WINS_Broadcast,
 		WINS_AddrToString,
 		WINS_StringToAddr,
@@ -104,8 +109,11 @@ net_landriver_t	net_landrivers[] =
 		WIPX_CloseSocket,
 		WIPX_Connect,
 		WIPX_CheckNewConnections,
+		WIPX_ListenSocket,
 		WIPX_Read,
 		WIPX_Write,
+		WIPX_Batch,
+		WIPX_Pending,
 		WIPX_Broadcast,
 		WIPX_AddrToString,
 		WIPX_StringToAddr,
@@ -348,6 +348,13 @@ sys_socket_t WINS_CheckNewConnections (void)
 
 //=============================================================================
 
+sys_socket_t WINS_ListenSocket (void)
+{
+	return net_acceptsocket;
+}
+
+//=============================================================================
+
 int WINS_Read (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr)
 {
 	socklen_t addrlen = sizeof(struct qsockaddr);
@@ -425,6 +432,18 @@ int WINS_Write (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *add
 
 //=============================================================================
 
+void WINS_Batch (qboolean state)
+{
+	// writes always go out immediately
+}
+
+qboolean WINS_Pending (sys_socket_t socketid)
+{
+	return false;	// reads always come straight from the socket
+}
+
+//=============================================================================
+
 const char *WINS_AddrToString (struct qsockaddr *addr)
 {
 	static char buffer[22];
@@ -29,8 +29,11 @@ sys_socket_t  WINS_OpenSocket (int port);
 int  WINS_CloseSocket (sys_socket_t socketid);
 int  WINS_Connect (sys_socket_t socketid, struct qsockaddr *addr);
 sys_socket_t  WINS_CheckNewConnections (void);
+sys_socket_t  WINS_ListenSocket (void);
 int  WINS_Read (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr);
 int  WINS_Write (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr);
+void WINS_Batch (qboolean state);
+qboolean WINS_Pending (sys_socket_t socketid);
 int  WINS_Broadcast (sys_socket_t socketid, byte *buf, int len);
 const char *WINS_AddrToString (struct qsockaddr *addr);
 int  WINS_StringToAddr (const char *string, struct qsockaddr *addr);
@@ -239,6 +239,15 @@ sys_socket_t WIPX_CheckNewConnections (void)
 
 //=============================================================================
 
+sys_socket_t WIPX_ListenSocket (void)
+{
+	if (net_acceptsocket == INVALID_SOCKET)
+		return INVALID_SOCKET;
+	return ipxsocket[net_acceptsocket];
+}
+
+//=============================================================================
+
 static byte netpacketBuffer[NET_DATAGRAMSIZE + 4];
 
 int WIPX_Read (sys_socket_t handle, byte *buf, int len, struct qsockaddr *addr)
@@ -300,6 +309,18 @@ int WIPX_Write (sys_socket_t handle, byte *buf, int len, struct qsockaddr *addr)
 
 //=============================================================================
 
+void WIPX_Batch (qboolean state)
+{
+	// writes always go out immediately
+}
+
+qboolean WIPX_Pending (sys_socket_t socketid)
+{
+	return false;	// reads always come straight from the socket
+}
+
+//=============================================================================
+
 const char *WIPX_AddrToString (struct qsockaddr *addr)
 {
 	static char buf[28];
@@ -29,8 +29,11 @@ sys_socket_t  WIPX_OpenSocket (int port);
 int  WIPX_CloseSocket (sys_socket_t socketid);
 int  WIPX_Connect (sys_socket_t socketid, struct qsockaddr *addr);
 sys_socket_t  WIPX_CheckNewConnections (void);
+sys_socket_t  WIPX_ListenSocket (void);
 int  WIPX_Read (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr);
 int  WIPX_Write (sys_socket_t socketid, byte *buf, int len, struct qsockaddr *addr);
+void WIPX_Batch (qboolean state);
+qboolean WIPX_Pending (sys_socket_t socketid);
 int  WIPX_Broadcast (sys_socket_t socketid, byte *buf, int len);
 const char *WIPX_AddrToString (struct qsockaddr *addr);
 int  WIPX_StringToAddr (const char *string, struct qsockaddr *addr);
@@ -967,44 +967,13 @@ findradius (origin, radius)
 */
 static void PF_findradius (void)
 {
-	edict_t	*ent, *chain;
-	float	rad;
 	float	*org;
-	int		i;
-
-	chain = (edict_t *)sv.edicts;
+	float	rad;
 
 	org = G_VECTOR(OFS_PARM0);
 	rad = G_FLOAT(OFS_PARM1);
-	rad *= rad;
-
-	ent = NEXT_EDICT(sv.edicts);
-	for (i = 1; i < sv.num_edicts; i++, ent = NEXT_EDICT(ent))
-	{
-		float d, lensq;
-		if (ent->free)
-			continue;
-		if (ent->v.solid == SOLID_NOT)
-			continue;
 
-		d = org[0] - (ent->v.origin[0] + (ent->v.mins[0] + ent->v.maxs[0]) * 0.5);
-		lensq = d * d;
-		if (lensq > rad)
-			continue;
-		d = org[1] - (ent->v.origin[1] + (ent->v.mins[1] + ent->v.maxs[1]) * 0.5);
-		lensq += d * d;
-		if (lensq > rad)
-			continue;
-		d = org[2] - (ent->v.origin[2] + (ent->v.mins[2] + ent->v.maxs[2]) * 0.5);
-		lensq += d * d;
-		if (lensq > rad)
-			continue;
-
-		ent->v.chain = EDICT_TO_PROG(chain);
-		chain = ent;
-	}
-
-	RETURN_EDICT(chain);
+	RETURN_EDICT(SV_FindRadius (org, rad, sv_findradiusgrid.value != 0));
 }
 
 /*
@@ -1079,6 +1048,13 @@ static void PF_Find (void)
 	if (!s)
 		PR_RunError ("PF_Find: bad search string");
 
+	ed = ED_FindString (e, f, s);
+	if (ed)
+	{
+		RETURN_EDICT(ed);
+		return;
+	}
+
 	for (e++ ; e < sv.num_edicts ; e++)
 	{
 		ed = EDICT_NUM(e);
@@ -1387,9 +1363,14 @@ vector aim(entity, missilespeed)
 cvar_t	sv_aim = {"sv_aim", "1", CVAR_NONE}; // ericw -- turn autoaim off by default. was 0.93
 static void PF_aim (void)
 {
+	static edict_t	**checks;
+	static vec3_t	*starts, *ends;
+	static float	*dists;
+	static trace_t	*traces;
+	static int		maxchecks;
 	edict_t	*ent, *check, *bestent;
 	vec3_t	start, dir, end, bestdir;
-	int		i, j;
+	int		i, j, numchecks;
 	trace_t	tr;
 	float	dist, bestdist;
 	float	speed;
@@ -1417,6 +1398,20 @@ static void PF_aim (void)
 	bestdist = sv_aim.value;
 	bestent = NULL;
 
+	if (maxchecks < sv.num_edicts)
+	{
+		maxchecks = sv.num_edicts;
+		checks = (edict_t **) realloc (checks, maxchecks * sizeof(*checks));
+		starts = (vec3_t *) realloc (starts, maxchecks * sizeof(*starts));
+		ends = (vec3_t *) realloc (ends, maxchecks * sizeof(*ends));
+		dists = (float *) realloc (dists, maxchecks * sizeof(*dists));
+		traces = (trace_t *) realloc (traces, maxchecks * sizeof(*traces));
+		if (!checks || !starts || !ends || !dists || !traces)
+			Sys_Error ("PF_aim: out of memory");
+	}
+
+// gather everything that could be aimed at and trace to them all at once
+	numchecks = 0;
 	check = NEXT_EDICT(sv.edicts);
 	for (i = 1; i < sv.num_edicts; i++, check = NEXT_EDICT(check) )
 	{
@@ -1433,11 +1428,23 @@ static void PF_aim (void)
 		dist = DotProduct (dir, pr_global_struct->v_forward);
 		if (dist < bestdist)
 			continue;	// to far to turn
-		tr = SV_Move (start, vec3_origin, vec3_origin, end, false, ent);
-		if (tr.ent == check)
+		checks[numchecks] = check;
+		dists[numchecks] = dist;
+		VectorCopy (start, starts[numchecks]);
+		VectorCopy (end, ends[numchecks]);
+		numchecks++;
+	}
+
+	SV_MoveBatch (numchecks, starts, vec3_origin, vec3_origin, ends, false, ent, traces);
+
+	for (i = 0; i < numchecks; i++)
+	{
+		if (dists[i] < bestdist)
+			continue;	// to far to turn
+		if (traces[i].ent == checks[i])
 		{	// can shoot at this one
-			bestdist = dist;
-			bestent = check;
+			bestdist = dists[i];
+			bestent = checks[i];
 		}
 	}
 
@@ -32,11 +32,39 @@ static	const char	**pr_knownstrings;
 static	int		pr_maxknownstrings;
 static	int		pr_numknownstrings;
 static	const char **pr_firstfreeknownstring; // free list (singly linked)
+
+static	int		*pr_interntable;	// slots of interned strings by text, -1 if empty
+static	int		pr_internsize;		// power of two
+static	int		pr_numinterned;
+static	int		pr_internlookups, pr_internhits, pr_internsaved;
+static	int		*pr_enginetable;	// slots by string address, -1 if empty
+static	int		pr_enginesize;		// power of two
+static	int		pr_numengine;
 static	ddef_t		*pr_fielddefs;
 static	ddef_t		*pr_globaldefs;
 
 qboolean	pr_alpha_supported; //johnfitz
 
+pr_extfields_t	pr_extfields;
+
+static const struct
+{
+	const char	*name;
+	int		*ofs;
+} pr_extfielddefs[] =
+{
+	{ "alpha",		&pr_extfields.alpha },
+	{ "gravity",		&pr_extfields.gravity },
+	{ "items2",		&pr_extfields.items2 },
+	{ "ammo_shells1",	&pr_extfields.ammo_shells1 },
+	{ "ammo_nails1",	&pr_extfields.ammo_nails1 },
+	{ "ammo_lava_nails",	&pr_extfields.ammo_lava_nails },
+	{ "ammo_rockets1",	&pr_extfields.ammo_rockets1 },
+	{ "ammo_multi_rockets",	&pr_extfields.ammo_multi_rockets },
+	{ "ammo_cells1",	&pr_extfields.ammo_cells1 },
+	{ "ammo_plasma",	&pr_extfields.ammo_plasma },
+};
+
 dstatement_t	*pr_statements;
 globalvars_t	*pr_global_struct;
 float		*pr_globals;		// same as pr_global_struct
@@ -56,7 +84,11 @@ int		type_size[8] = {
 };
 
 static ddef_t	*ED_FieldAtOfs (int ofs);
+static ddef_t	*ED_FindField (const char *name);
 static qboolean	ED_ParseEpair (void *base, ddef_t *key, const char *s);
+static qboolean	PR_IsValidString (const char *p);
+static string_t	PR_InternString (const char *s, int size);
+static void	PR_ClearStringTables (void);
 
 #define	MAX_FIELD_LEN	64
 #define	GEFV_CACHESIZE	2
@@ -224,6 +256,7 @@ void ED_ClearEdict (edict_t *e)
 {
 	memset (&e->v, 0, progs->entityfields * 4);
 	ED_RemoveFromFreeList (e);
+	ED_TouchFindIndex (e);
 }
 
 /*
@@ -260,6 +293,7 @@ edict_t *ED_Alloc (void)
 
 	e = EDICT_NUM(sv.num_edicts++);
 	memset(e, 0, pr_edict_size); // ericw -- switched sv.edicts to malloc(), so we are accessing uninitialized memory and must fully zero it, not just ED_ClearEdict
+	ED_TouchFindIndex (e);
 
 	return e;
 }
@@ -292,6 +326,370 @@ void ED_Free (edict_t *ed)
 	ed->freetime = sv.time;
 }
 
+/*
+=============================================================================
+
+FIND INDEX
+
+find() on the fields in pr_findfieldnames is answered from a hash of each
+edict's string, with the edict numbers in each bucket kept in order so the
+results come out as a walk over the edicts would give them.  Edicts whose
+indexed strings may have changed are queued and reindexed by the next
+find: QuakeC string stores report themselves through ED_StringStored, and
+engine code that writes entity fields calls ED_TouchFindIndex.  Only
+progs and interned strings are hashed, since their text never changes;
+any other string, like a temp from ftos() that gets rewritten in place,
+goes in a volatile bucket that every lookup walks and compares as it is
+at that moment.
+
+=============================================================================
+*/
+
+cvar_t	pr_findindex = {"pr_findindex", "1", CVAR_NONE};
+
+#define	MAX_FIND_FIELDS	3
+#define	FIND_BUCKETS	1024		// must be a power of two
+#define	FIND_BADSTRING	FIND_BUCKETS	// bucket for invalid string offsets
+#define	FIND_VOLATILE	(FIND_BUCKETS + 1)	// bucket for strings that may be rewritten
+
+typedef struct
+{
+	int		num, max;
+	int		*ents;			// edict numbers, ascending
+} findbucket_t;
+
+typedef struct
+{
+	int		ofs;			// field offset in ints
+	int		*bucketof;		// by edict number, -1 when not indexed
+	findbucket_t	buckets[FIND_BUCKETS + 2];
+} findfield_t;
+
+static const char *pr_findfieldnames[MAX_FIND_FIELDS] = {"classname", "targetname", "target"};
+
+static findfield_t	pr_findfields[MAX_FIND_FIELDS];
+static int		pr_numfindfields;
+static int		pr_findmaxedicts;	// size of the per edict arrays
+static int		pr_findnumedicts;	// edicts below this have been indexed
+static int		*pr_finddirty;		// queued edict numbers
+static int		pr_numfinddirty;
+static byte		*pr_findisdirty;
+
+/*
+=================
+ED_ResetFindIndex
+
+Drops everything indexed and looks up the fields again.  Called for new
+progs, and whenever edicts were rewritten wholesale.
+=================
+*/
+void ED_ResetFindIndex (void)
+{
+	findfield_t	*ff;
+	ddef_t		*def;
+	int			i, j;
+
+	for (i = 0; i < MAX_FIND_FIELDS; i++)
+	{
+		ff = &pr_findfields[i];
+		for (j = 0; j < FIND_BUCKETS + 2; j++)
+			ff->buckets[j].num = 0;
+		for (j = 0; j < pr_findmaxedicts; j++)
+			ff->bucketof[j] = -1;
+	}
+	if (pr_findmaxedicts)
+		memset (pr_findisdirty, 0, pr_findmaxedicts);
+	pr_numfinddirty = 0;
+	pr_findnumedicts = 1;	// the world is never returned
+
+	pr_numfindfields = 0;
+	for (i = 0; i < MAX_FIND_FIELDS; i++)
+	{
+		def = ED_FindField (pr_findfieldnames[i]);
+		if (def && (def->type & ~DEF_SAVEGLOBAL) == ev_string)
+			pr_findfields[pr_numfindfields++].ofs = def->ofs;
+	}
+}
+
+static void ED_FindBucketRemove (findbucket_t *fb, int e)
+{
+	int		lo, hi, mid;
+
+	for (lo = 0, hi = fb->num; lo < hi; )
+	{
+		mid = (lo + hi) >> 1;
+		if (fb->ents[mid] < e)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	if (lo < fb->num && fb->ents[lo] == e)
+	{
+		memmove (fb->ents + lo, fb->ents + lo + 1, (fb->num - lo - 1) * sizeof(int));
+		fb->num--;
+	}
+}
+
+static void ED_FindBucketInsert (findbucket_t *fb, int e)
+{
+	int		lo, hi, mid;
+
+	if (fb->num == fb->max)
+	{
+		fb->max = q_max (fb->max * 2, 16);
+		fb->ents = (int *) realloc (fb->ents, fb->max * sizeof(int));
+		if (!fb->ents)
+			Sys_Error ("ED_FindBucketInsert: realloc() failed on %d edicts", fb->max);
+	}
+	for (lo = 0, hi = fb->num; lo < hi; )
+	{
+		mid = (lo + hi) >> 1;
+		if (fb->ents[mid] < e)
+			lo = mid + 1;
+		else
+			hi = mid;
+	}
+	memmove (fb->ents + lo + 1, fb->ents + lo, (fb->num - lo) * sizeof(int));
+	fb->ents[lo] = e;
+	fb->num++;
+}
+
+/*
+=================
+ED_FindBucketFor
+
+Progs and interned strings are filed by their text, everything else may
+still be rewritten and goes in the volatile bucket
+=================
+*/
+static int ED_FindBucketFor (int num)
+{
+	const char	*str;
+	int			h, hash, mask;
+
+	str = PR_GetStringQuiet (num);
+	if (!str)
+		return FIND_BADSTRING;
+	hash = COM_HashString (str);
+	if (num >= 0)
+		return hash & (FIND_BUCKETS - 1);
+
+	mask = pr_internsize - 1;
+	for (h = hash & mask; pr_internsize && pr_interntable[h] >= 0; h = (h + 1) & mask)
+	{
+		if (pr_interntable[h] == -1 - num)
+			return hash & (FIND_BUCKETS - 1);
+	}
+	return FIND_VOLATILE;
+}
+
+/*
+=================
+ED_ReindexFind
+
+Files edict e under its current strings
+=================
+*/
+static void ED_ReindexFind (int e)
+{
+	findfield_t	*ff;
+	edict_t		*ed;
+	int			i, b;
+
+	ed = EDICT_NUM(e);
+	for (i = 0, ff = pr_findfields; i < pr_numfindfields; i++, ff++)
+	{
+		b = ED_FindBucketFor (((int *)&ed->v)[ff->ofs]);
+		if (ff->bucketof[e] == b)
+			continue;
+		if (ff->bucketof[e] >= 0)
+			ED_FindBucketRemove (&ff->buckets[ff->bucketof[e]], e);
+		ED_FindBucketInsert (&ff->buckets[b], e);
+		ff->bucketof[e] = b;
+	}
+}
+
+static void ED_QueueFind (int e)
+{
+	if (e < 1 || e >= pr_findnumedicts || pr_findisdirty[e])
+		return;		// edicts past pr_findnumedicts get indexed when first seen
+	pr_findisdirty[e] = true;
+	pr_finddirty[pr_numfinddirty++] = e;
+}
+
+/*
+=================
+ED_TouchFindIndex
+
+Queues the edict for reindexing after engine code changed its fields
+=================
+*/
+void ED_TouchFindIndex (edict_t *ed)
+{
+	if (pr_numfindfields)
+		ED_QueueFind (NUM_FOR_EDICT(ed));
+}
+
+/*
+=================
+ED_ShrinkEdicts
+
+Gives the free edicts at the end back until there are num, for benchmarks
+that spawn their own edicts and free them again
+=================
+*/
+void ED_ShrinkEdicts (int num)
+{
+	edict_t	*ed;
+
+	while (sv.num_edicts > num)
+	{
+		ed = EDICT_NUM(sv.num_edicts - 1);
+		if (!ed->free)
+			break;
+		ED_RemoveFromFreeList (ed);
+		ed->free = true;
+		sv.num_edicts--;
+	}
+	if (pr_findnumedicts > sv.num_edicts)
+		ED_ResetFindIndex ();
+}
+
+/*
+=================
+ED_StringStored
+
+Called by the interpreter after a string store through an entity field
+pointer
+=================
+*/
+void ED_StringStored (eval_t *ptr)
+{
+	int		ofs, e, i;
+
+	if (!pr_numfindfields)
+		return;
+
+	ofs = (byte *)ptr - (byte *)sv.edicts;
+	e = ofs / pr_edict_size;
+	ofs = (ofs - e * pr_edict_size - (int)offsetof(edict_t, v)) >> 2;
+	for (i = 0; i < pr_numfindfields; i++)
+	{
+		if (pr_findfields[i].ofs == ofs)
+		{
+			ED_QueueFind (e);
+			return;
+		}
+	}
+}
+
+/*
+=================
+ED_UpdateFindIndex
+=================
+*/
+static void ED_UpdateFindIndex (void)
+{
+	int		i, j, e;
+
+	if (sv.max_edicts > pr_findmaxedicts)
+	{
+		for (i = 0; i < MAX_FIND_FIELDS; i++)
+		{
+			pr_findfields[i].bucketof = (int *) realloc (pr_findfields[i].bucketof, sv.max_edicts * sizeof(int));
+			if (!pr_findfields[i].bucketof)
+				Sys_Error ("ED_UpdateFindIndex: realloc() failed on %d edicts", sv.max_edicts);
+			for (j = pr_findmaxedicts; j < sv.max_edicts; j++)
+				pr_findfields[i].bucketof[j] = -1;
+		}
+		pr_finddirty = (int *) realloc (pr_finddirty, sv.max_edicts * sizeof(int));
+		pr_findisdirty = (byte *) realloc (pr_findisdirty, sv.max_edicts);
+		if (!pr_finddirty || !pr_findisdirty)
+			Sys_Error ("ED_UpdateFindIndex: realloc() failed on %d edicts", sv.max_edicts);
+		memset (pr_findisdirty + pr_findmaxedicts, 0, sv.max_edicts - pr_findmaxedicts);
+		pr_findmaxedicts = sv.max_edicts;
+	}
+
+	for (i = 0; i < pr_numfinddirty; i++)
+	{
+		e = pr_finddirty[i];
+		pr_findisdirty[e] = false;
+		ED_ReindexFind (e);
+	}
+	pr_numfinddirty = 0;
+
+	for ( ; pr_findnumedicts < sv.num_edicts; pr_findnumedicts++)
+		ED_ReindexFind (pr_findnumedicts);
+}
+
+/*
+=================
+ED_FindString
+
+Returns the first edict after start whose string field f is s, or NULL
+when the field isn't indexed and the caller has to look for itself
+=================
+*/
+edict_t *ED_FindString (int start, int f, const char *s)
+{
+	findfield_t		*ff;
+	findbucket_t	*fb[3];
+	int				pos[3];
+	int				i, lo, hi, mid, e, which;
+	edict_t			*ed;
+
+	if (!pr_findindex.value)
+		return NULL;
+	for (i = 0, ff = pr_findfields; i < pr_numfindfields; i++, ff++)
+		if (ff->ofs == f)
+			break;
+	if (i == pr_numfindfields)
+		return NULL;
+
+	ED_UpdateFindIndex ();
+
+// walk the bucket for s along with the bad strings, so a bad string hit
+// before the match still raises the error it always did, and with the
+// volatile strings, which are compared by what they say now
+	fb[0] = &ff->buckets[COM_HashString (s) & (FIND_BUCKETS - 1)];
+	fb[1] = &ff->buckets[FIND_BADSTRING];
+	fb[2] = &ff->buckets[FIND_VOLATILE];
+	for (i = 0; i < 3; i++)
+	{
+		for (lo = 0, hi = fb[i]->num; lo < hi; )
+		{
+			mid = (lo + hi) >> 1;
+			if (fb[i]->ents[mid] <= start)
+				lo = mid + 1;
+			else
+				hi = mid;
+		}
+		pos[i] = lo;
+	}
+
+	while (1)
+	{
+		which = -1;
+		for (i = 0; i < 3; i++)
+		{
+			if (pos[i] < fb[i]->num && (which < 0 || fb[i]->ents[pos[i]] < fb[which]->ents[pos[which]]))
+				which = i;
+		}
+		if (which < 0)
+			break;
+		e = fb[which]->ents[pos[which]++];
+		if (e >= sv.num_edicts)
+			break;
+		ed = EDICT_NUM(e);
+		if (ed->free)
+			continue;
+		if (!strcmp (E_STRING(ed, f), s))
+			return ed;
+	}
+
+	return sv.edicts;
+}
+
 //===========================================================================
 
 /*
@@ -415,6 +813,25 @@ static dfunction_t *ED_FindFunction (const char *fn_name)
 	return NULL;
 }
 
+/*
+============
+PR_FindExtFields
+
+Resolves the offsets of the optional fields in pr_extfields
+============
+*/
+static void PR_FindExtFields (void)
+{
+	ddef_t	*def;
+	int	i;
+
+	for (i = 0; i < (int) countof(pr_extfielddefs); i++)
+	{
+		def = ED_FindField (pr_extfielddefs[i].name);
+		*pr_extfielddefs[i].ofs = def ? def->ofs : -1;
+	}
+}
+
 /*
 ============
 GetEdictFieldValue
@@ -799,6 +1216,26 @@ static void ED_Count (void)
 	Con_Printf ("step      :%3i\n", step);
 }
 
+/*
+=============
+ED_StringCount
+
+For debugging
+=============
+*/
+static void ED_StringCount (void)
+{
+	if (!sv.active)
+		return;
+
+	Con_Printf ("known strings :%6i\n", pr_numknownstrings);
+	Con_Printf ("interned      :%6i\n", pr_numinterned);
+	Con_Printf ("intern lookups:%6i\n", pr_internlookups);
+	Con_Printf ("shared        :%6i (%.1f%%)\n", pr_internhits,
+		pr_internlookups ? 100.0 * pr_internhits / pr_internlookups : 0.0);
+	Con_Printf ("bytes saved   :%6i\n", pr_internsaved);
+}
+
 
 /*
 ==============================================================================
@@ -882,6 +1319,331 @@ const char *ED_ParseGlobals (const char *data)
 	return data;
 }
 
+/*
+==============================================================================
+
+BINARY SAVEGAMES
+
+The globals and edicts in their in-memory layout, for progs with the same
+crc as the ones that wrote them.  Strings owned by the progs are kept as
+offsets, all others go into a string table written first.  Entity
+references are kept as edict numbers, because pr_edict_size depends on
+the build.
+==============================================================================
+*/
+
+#define	BINSAVE_NONE	-1
+#define	BINSAVE_RAW		0
+#define	BINSAVE_STRING	1
+#define	BINSAVE_ENTITY	2
+
+static const byte	*binsave_p, *binsave_end;
+
+/*
+=============
+ED_BinarySlots
+
+Returns what each int of the edict fields holds, in temp memory
+=============
+*/
+static byte *ED_BinarySlots (void)
+{
+	byte	*slots;
+	ddef_t	*d;
+	int		i, type;
+
+	slots = (byte *) Z_Malloc (progs->entityfields);
+	for (i = 1; i < progs->numfielddefs; i++)
+	{
+		d = &pr_fielddefs[i];
+		if (d->ofs < 0 || d->ofs >= progs->entityfields)
+			continue;
+		type = d->type & ~DEF_SAVEGLOBAL;
+		if (type == ev_string)
+			slots[d->ofs] = BINSAVE_STRING;
+		else if (type == ev_entity)
+			slots[d->ofs] = BINSAVE_ENTITY;
+	}
+
+	return slots;
+}
+
+/*
+=============
+ED_GlobalSlot
+
+What a global holds, BINSAVE_NONE for those ED_WriteGlobals skips
+=============
+*/
+static int ED_GlobalSlot (ddef_t *def)
+{
+	int		type;
+
+	if ( !(def->type & DEF_SAVEGLOBAL) )
+		return BINSAVE_NONE;
+	type = def->type & ~DEF_SAVEGLOBAL;
+	if (type == ev_string)
+		return BINSAVE_STRING;
+	if (type == ev_entity)
+		return BINSAVE_ENTITY;
+	if (type == ev_float)
+		return BINSAVE_RAW;
+	return BINSAVE_NONE;
+}
+
+static void ED_WriteBinaryInt (FILE *f, int v)
+{
+	v = LittleLong (v);
+	fwrite (&v, 4, 1, f);
+}
+
+static int ED_ReadBinaryInt (void)
+{
+	int		v;
+
+	if (binsave_end - binsave_p < 4)
+		Host_Error ("ED_ReadBinary: unexpected end of data");
+	memcpy (&v, binsave_p, 4);
+	binsave_p += 4;
+	return LittleLong (v);
+}
+
+/*
+=============
+ED_BinaryString
+
+Returns the table index + 1 for an engine or allocated string, adding it
+to the table if needed, or 0 for strings the progs own
+=============
+*/
+static int ED_BinaryString (int s, int *map, int *order, int *numstrings, int *strbytes)
+{
+	int		k;
+
+	if (s >= 0)
+		return 0;
+	k = -1 - s;
+	if (k >= pr_numknownstrings || !PR_IsValidString (pr_knownstrings[k]))
+		return 0;
+	if (!map[k])
+	{
+		order[*numstrings] = k;
+		map[k] = ++*numstrings;
+		*strbytes += strlen (pr_knownstrings[k]) + 1;
+	}
+	return map[k];
+}
+
+/*
+=============
+ED_WriteBinaryValue
+=============
+*/
+static void ED_WriteBinaryValue (FILE *f, int slot, int v, int *map)
+{
+	if (slot == BINSAVE_STRING)
+	{
+		if (v < 0)
+			v = (-v - 1 < pr_numknownstrings && map[-v - 1]) ? -map[-v - 1] : 0;
+		else if (v >= pr_stringssize)
+			v = 0;
+	}
+	else if (slot == BINSAVE_ENTITY)
+		v /= pr_edict_size;
+	ED_WriteBinaryInt (f, v);
+}
+
+/*
+=============
+ED_WriteBinary
+
+For savegames
+=============
+*/
+void ED_WriteBinary (FILE *f)
+{
+	byte	*slots;
+	int		*map, *order;
+	int		i, j, numstrings, strbytes, numglobals, slot;
+	edict_t	*ed;
+	const char	*s;
+
+	slots = ED_BinarySlots ();
+	map = (int *) Z_Malloc ((pr_numknownstrings + 1) * sizeof(int));
+	order = (int *) Z_Malloc ((pr_numknownstrings + 1) * sizeof(int));
+
+// gather the strings that don't belong to the progs
+	numstrings = strbytes = numglobals = 0;
+	for (i = 0; i < progs->numglobaldefs; i++)
+	{
+		slot = ED_GlobalSlot (&pr_globaldefs[i]);
+		if (slot == BINSAVE_NONE)
+			continue;
+		numglobals++;
+		if (slot == BINSAVE_STRING)
+			ED_BinaryString (G_INT(pr_globaldefs[i].ofs), map, order, &numstrings, &strbytes);
+	}
+	for (i = 0; i < sv.num_edicts; i++)
+	{
+		ed = EDICT_NUM(i);
+		if (ed->free)
+			continue;
+		for (j = 0; j < progs->entityfields; j++)
+		{
+			if (slots[j] == BINSAVE_STRING)
+				ED_BinaryString (((int *)&ed->v)[j], map, order, &numstrings, &strbytes);
+		}
+	}
+
+	ED_WriteBinaryInt (f, pr_crc);
+	ED_WriteBinaryInt (f, progs->entityfields);
+	ED_WriteBinaryInt (f, progs->numglobaldefs);
+
+	ED_WriteBinaryInt (f, numstrings);
+	ED_WriteBinaryInt (f, strbytes);
+	for (i = 0; i < numstrings; i++)
+	{
+		s = pr_knownstrings[order[i]];
+		fwrite (s, strlen (s) + 1, 1, f);
+	}
+
+	ED_WriteBinaryInt (f, numglobals);
+	for (i = 0; i < progs->numglobaldefs; i++)
+	{
+		slot = ED_GlobalSlot (&pr_globaldefs[i]);
+		if (slot != BINSAVE_NONE)
+			ED_WriteBinaryValue (f, slot, G_INT(pr_globaldefs[i].ofs), map);
+	}
+
+	ED_WriteBinaryInt (f, sv.num_edicts);
+	for (i = 0; i < sv.num_edicts; i++)
+	{
+		ed = EDICT_NUM(i);
+		ED_WriteBinaryInt (f, ed->free);
+		if (ed->free)
+			continue;
+		ED_WriteBinaryInt (f, ed->alpha);
+		for (j = 0; j < progs->entityfields; j++)
+			ED_WriteBinaryValue (f, slots[j], ((int *)&ed->v)[j], map);
+	}
+
+	Z_Free (order);
+	Z_Free (map);
+	Z_Free (slots);
+}
+
+/*
+=============
+ED_ReadBinaryValue
+=============
+*/
+static int ED_ReadBinaryValue (int slot, const int *strings, int numstrings)
+{
+	int		v;
+
+	v = ED_ReadBinaryInt ();
+	if (slot == BINSAVE_STRING)
+	{
+		if (v < 0)
+		{
+			if (-v > numstrings)
+				Host_Error ("ED_ReadBinary: bad string %d", v);
+			v = strings[-v - 1];
+		}
+		else if (v >= pr_stringssize)
+			Host_Error ("ED_ReadBinary: bad string %d", v);
+	}
+	else if (slot == BINSAVE_ENTITY)
+	{
+		if (v < 0 || v >= sv.max_edicts)
+			Host_Error ("ED_ReadBinary: bad edict %d", v);
+		v *= pr_edict_size;
+	}
+	return v;
+}
+
+/*
+=============
+ED_ReadBinary
+
+Restores what ED_WriteBinary wrote and returns the number of edicts, or
+-1 without touching anything if the data is for different progs.  Like
+the text path, the caller links the edicts.
+=============
+*/
+int ED_ReadBinary (const byte *data, int length)
+{
+	byte	*slots;
+	int		*strings;
+	int		i, j, numstrings, strbytes, numedicts, slot, len;
+	edict_t	*ed;
+	const char	*s;
+
+	binsave_p = data;
+	binsave_end = data + length;
+
+	if (length < 12)
+		return -1;
+	if (ED_ReadBinaryInt () != pr_crc
+	 || ED_ReadBinaryInt () != progs->entityfields
+	 || ED_ReadBinaryInt () != progs->numglobaldefs)
+		return -1;
+
+	numstrings = ED_ReadBinaryInt ();
+	strbytes = ED_ReadBinaryInt ();
+	if (numstrings < 0 || numstrings > strbytes || strbytes > binsave_end - binsave_p
+	 || (strbytes && binsave_p[strbytes - 1]))
+		Host_Error ("ED_ReadBinary: bad string table");
+	strings = (int *) Z_Malloc ((numstrings + 1) * sizeof(int));
+	for (i = 0, s = (const char *)binsave_p; i < numstrings; i++, s += len)
+	{
+		if (s >= (const char *)binsave_p + strbytes)
+			Host_Error ("ED_ReadBinary: bad string table");
+		len = strlen (s) + 1;
+		strings[i] = PR_InternString (s, len);
+	}
+	binsave_p += strbytes;
+
+	if (ED_ReadBinaryInt () < 0)	// number of globals, implied by the progs
+		Host_Error ("ED_ReadBinary: bad globals");
+	for (i = 0; i < progs->numglobaldefs; i++)
+	{
+		slot = ED_GlobalSlot (&pr_globaldefs[i]);
+		if (slot != BINSAVE_NONE)
+			G_INT(pr_globaldefs[i].ofs) = ED_ReadBinaryValue (slot, strings, numstrings);
+	}
+
+	numedicts = ED_ReadBinaryInt ();
+	if (numedicts < 1 || numedicts > sv.max_edicts)
+		Host_Error ("ED_ReadBinary: bad edict count %d", numedicts);
+
+	slots = ED_BinarySlots ();
+	for (i = 0; i < numedicts; i++)
+	{
+		ed = EDICT_NUM(i);
+		if (i < sv.num_edicts)
+			ED_ClearEdict (ed);
+		else
+			memset (ed, 0, pr_edict_size);
+
+		if (ED_ReadBinaryInt ())
+		{
+			ED_AddToFreeList (ed);
+			continue;
+		}
+		ed->alpha = ED_ReadBinaryInt ();
+		for (j = 0; j < progs->entityfields; j++)
+			((int *)&ed->v)[j] = ED_ReadBinaryValue (slots[j], strings, numstrings);
+	}
+
+	Z_Free (slots);
+	Z_Free (strings);
+
+	ED_ResetFindIndex ();
+
+	return numedicts;
+}
+
 //============================================================================
 
 
@@ -892,13 +1654,21 @@ ED_NewString
 */
 static string_t ED_NewString (const char *string)
 {
+	static char	*buf;
+	static int	bufsize;
 	char	*new_p;
 	int		i, l;
-	string_t	num;
 
 	l = strlen(string) + 1;
-	num = PR_AllocString (l, &new_p);
+	if (l > bufsize)
+	{
+		bufsize = q_max (l, 1024);
+		buf = (char *) realloc (buf, bufsize);
+		if (!buf)
+			Sys_Error ("ED_NewString: realloc() failed on %d bytes", bufsize);
+	}
 
+	new_p = buf;
 	for (i = 0; i < l; i++)
 	{
 		if (string[i] == '\\' && i < l-1)
@@ -913,7 +1683,7 @@ static string_t ED_NewString (const char *string)
 			*new_p++ = string[i];
 	}
 
-	return num;
+	return PR_InternString (buf, new_p - buf);
 }
 
 
@@ -1102,6 +1872,8 @@ const char *ED_ParseEdict (const char *data, edict_t *ent)
 
 	if (!init)
 		ED_AddToFreeList (ent);
+	if (ent != sv.edicts)
+		ED_TouchFindIndex (ent);
 
 	return data;
 }
@@ -1210,6 +1982,8 @@ void PR_LoadProgs (void)
 
 	CRC_Init (&pr_crc);
 
+	// not COM_MapFile: progs is written to and used for the whole map,
+	// so it can't be left backed by a file that may be rewritten meanwhile
 	progs = (dprograms_t *)COM_LoadHunkFile ("progs.dat", NULL);
 	if (!progs)
 		Host_Error ("PR_LoadProgs: couldn't load progs.dat");
@@ -1240,6 +2014,7 @@ void PR_LoadProgs (void)
 		Z_Free ((void *)pr_knownstrings);
 	pr_knownstrings = NULL;
 	pr_firstfreeknownstring = NULL;
+	PR_ClearStringTables ();
 	PR_SetEngineString("");
 
 	pr_globaldefs = (ddef_t *)((byte *)progs + progs->ofs_globaldefs);
@@ -1302,6 +2077,9 @@ void PR_LoadProgs (void)
 	pr_edict_size &= ~(sizeof(void *) - 1);
 
 	PR_InitHashTables ();
+	PR_FindExtFields ();
+	PR_DecodeProgs ();
+	ED_ResetFindIndex ();
 }
 
 
@@ -1315,7 +2093,9 @@ void PR_Init (void)
 	Cmd_AddCommand ("edict", ED_PrintEdict_f);
 	Cmd_AddCommand ("edicts", ED_PrintEdicts);
 	Cmd_AddCommand ("edictcount", ED_Count);
+	Cmd_AddCommand ("stringcount", ED_StringCount);
 	Cmd_AddCommand ("profile", PR_Profile_f);
+	Cmd_AddCommand ("pr_peephole_stats", PR_PeepholeStats_f);
 	Cvar_RegisterVariable (&nomonsters);
 	Cvar_RegisterVariable (&gamecfg);
 	Cvar_RegisterVariable (&scratch1);
@@ -1327,6 +2107,9 @@ void PR_Init (void)
 	Cvar_RegisterVariable (&saved2);
 	Cvar_RegisterVariable (&saved3);
 	Cvar_RegisterVariable (&saved4);
+	Cvar_RegisterVariable (&pr_peephole);
+	Cvar_SetCallback (&pr_peephole, PR_Peephole_f);
+	Cvar_RegisterVariable (&pr_findindex);
 }
 
 
@@ -1354,6 +2137,96 @@ int NUM_FOR_EDICT(edict_t *e)
 
 #define	PR_STRING_ALLOCSLOTS	256
 
+/*
+============
+PR_ClearStringTables
+
+Forgets the interned and engine strings, along with pr_knownstrings
+============
+*/
+static void PR_ClearStringTables (void)
+{
+	if (pr_interntable)
+		Z_Free (pr_interntable);
+	pr_interntable = NULL;
+	pr_internsize = pr_numinterned = 0;
+	pr_internlookups = pr_internhits = pr_internsaved = 0;
+
+	if (pr_enginetable)
+		Z_Free (pr_enginetable);
+	pr_enginetable = NULL;
+	pr_enginesize = pr_numengine = 0;
+}
+
+static int PR_EngineStringHash (const char *s)
+{
+	return (int)(((uintptr_t)s >> 2) * 2654435761u) & (pr_enginesize - 1);
+}
+
+/*
+============
+PR_FindEngineString
+
+Returns the first known string slot pointing at s, or -1
+============
+*/
+static int PR_FindEngineString (const char *s)
+{
+	int		h;
+
+	if (!pr_enginesize)
+		return -1;
+	for (h = PR_EngineStringHash (s); pr_enginetable[h] >= 0; h = (h + 1) & (pr_enginesize - 1))
+	{
+		if (pr_knownstrings[pr_enginetable[h]] == s)
+			return pr_enginetable[h];
+	}
+	return -1;
+}
+
+/*
+============
+PR_AddEngineString
+
+Records slot i under its address, unless an earlier slot already has it
+============
+*/
+static void PR_AddEngineString (int i)
+{
+	int		*old;
+	int		oldsize, j, h;
+
+	if (pr_numengine * 2 >= pr_enginesize)
+	{
+		old = pr_enginetable;
+		oldsize = pr_enginesize;
+		pr_enginesize = q_max (pr_enginesize * 2, 1024);
+		pr_enginetable = (int *) Z_Malloc (pr_enginesize * sizeof(int));
+		for (j = 0; j < pr_enginesize; j++)
+			pr_enginetable[j] = -1;
+		pr_numengine = 0;
+		for (j = 0; j < oldsize; j++)
+		{
+			if (old[j] < 0)
+				continue;
+			for (h = PR_EngineStringHash (pr_knownstrings[old[j]]); pr_enginetable[h] >= 0; h = (h + 1) & (pr_enginesize - 1))
+				;
+			pr_enginetable[h] = old[j];
+			pr_numengine++;
+		}
+		if (old)
+			Z_Free (old);
+	}
+
+	for (h = PR_EngineStringHash (pr_knownstrings[i]); pr_enginetable[h] >= 0; h = (h + 1) & (pr_enginesize - 1))
+	{
+		if (pr_knownstrings[pr_enginetable[h]] == pr_knownstrings[i])
+			return;
+	}
+	pr_enginetable[h] = i;
+	pr_numengine++;
+}
+
 static int PR_AllocStringSlot (void)
 {
 	ptrdiff_t i;
@@ -1409,6 +2282,23 @@ const char *PR_GetString (int num)
 	}
 }
 
+/*
+============
+PR_GetStringQuiet
+
+Like PR_GetString, but returns NULL for a bad string instead of raising an
+error, for code running on worker threads
+============
+*/
+const char *PR_GetStringQuiet (int num)
+{
+	if (num >= 0 && num < pr_stringssize)
+		return pr_strings + num;
+	else if (num < 0 && num >= -pr_numknownstrings)
+		return pr_knownstrings[-1 - num];
+	return NULL;
+}
+
 int PR_SetEngineString (const char *s)
 {
 	int		i;
@@ -1422,15 +2312,14 @@ int PR_SetEngineString (const char *s)
 	if (s >= pr_strings && s <= pr_strings + pr_stringssize - 2)
 		return (int)(s - pr_strings);
 #endif
-	for (i = 0; i < pr_numknownstrings; i++)
-	{
-		if (pr_knownstrings[i] == s)
-			return -1 - i;
-	}
+	i = PR_FindEngineString (s);
+	if (i >= 0)
+		return -1 - i;
 	// new unknown engine string
 	//Con_DPrintf ("PR_SetEngineString: new engine string %p\n", s);
 	i = PR_AllocStringSlot ();
 	pr_knownstrings[i] = s;
+	PR_AddEngineString (i);
 	return -1 - i;
 }
 
@@ -1442,8 +2331,136 @@ int PR_AllocString (int size, char **ptr)
 		return 0;
 	i = PR_AllocStringSlot ();
 	pr_knownstrings[i] = (char *)Hunk_AllocName(size, "string");
+	PR_AddEngineString (i);
 	if (ptr)
 		*ptr = (char *) pr_knownstrings[i];
 	return -1 - i;
 }
 
+/*
+============
+PR_StringsMark
+
+Taken along with a hunk low mark, for PR_FreeStringsToMark
+============
+*/
+int PR_StringsMark (void)
+{
+	return pr_numknownstrings;
+}
+
+/*
+============
+PR_FreeStringsToMark
+
+Forgets the strings made since the mark, after the hunk was freed back to
+where it was then.  Nothing may still refer to them.
+============
+*/
+void PR_FreeStringsToMark (int mark)
+{
+	int		*old;
+	int		i, h, mask;
+
+	if (pr_internsize)
+	{
+		old = pr_interntable;
+		mask = pr_internsize - 1;
+		pr_interntable = (int *) Z_Malloc (pr_internsize * sizeof(int));
+		for (i = 0; i < pr_internsize; i++)
+			pr_interntable[i] = -1;
+		pr_numinterned = 0;
+		for (i = 0; i < pr_internsize; i++)
+		{
+			if (old[i] < 0 || old[i] >= mark)
+				continue;
+			for (h = COM_HashString (pr_knownstrings[old[i]]) & mask; pr_interntable[h] >= 0; h = (h + 1) & mask)
+				;
+			pr_interntable[h] = old[i];
+			pr_numinterned++;
+		}
+		Z_Free (old);
+	}
+
+	if (pr_enginesize)
+	{
+		old = pr_enginetable;
+		mask = pr_enginesize - 1;
+		pr_enginetable = (int *) Z_Malloc (pr_enginesize * sizeof(int));
+		for (i = 0; i < pr_enginesize; i++)
+			pr_enginetable[i] = -1;
+		pr_numengine = 0;
+		for (i = 0; i < pr_enginesize; i++)
+		{
+			if (old[i] < 0 || old[i] >= mark)
+				continue;
+			for (h = PR_EngineStringHash (pr_knownstrings[old[i]]); pr_enginetable[h] >= 0; h = (h + 1) & mask)
+				;
+			pr_enginetable[h] = old[i];
+			pr_numengine++;
+		}
+		Z_Free (old);
+	}
+
+	pr_numknownstrings = mark;
+}
+
+/*
+============
+PR_InternString
+
+Returns the string_t of a read-only copy of s (size bytes including the
+terminator), shared with any earlier string of the same text.  Only for
+strings that are never written after they are made, like entity fields
+from the map or a savegame: QuakeC compares strings by text, so sharing
+the copy can't be told apart from separate ones.
+============
+*/
+static string_t PR_InternString (const char *s, int size)
+{
+	int		*old;
+	int		oldsize, i, h, mask;
+	char	*dst = NULL;
+	string_t	num;
+
+	pr_internlookups++;
+
+	if (pr_numinterned * 2 >= pr_internsize)
+	{
+		old = pr_interntable;
+		oldsize = pr_internsize;
+		pr_internsize = q_max (pr_internsize * 2, 1024);
+		pr_interntable = (int *) Z_Malloc (pr_internsize * sizeof(int));
+		mask = pr_internsize - 1;
+		for (i = 0; i < pr_internsize; i++)
+			pr_interntable[i] = -1;
+		for (i = 0; i < oldsize; i++)
+		{
+			if (old[i] < 0)
+				continue;
+			for (h = COM_HashString (pr_knownstrings[old[i]]) & mask; pr_interntable[h] >= 0; h = (h + 1) & mask)
+				;
+			pr_interntable[h] = old[i];
+		}
+		if (old)
+			Z_Free (old);
+	}
+
+	mask = pr_internsize - 1;
+	for (h = COM_HashString (s) & mask; pr_interntable[h] >= 0; h = (h + 1) & mask)
+	{
+		if (!strcmp (pr_knownstrings[pr_interntable[h]], s))
+		{
+			pr_internhits++;
+			pr_internsaved += size;
+			return -1 - pr_interntable[h];
+		}
+	}
+
+	num = PR_AllocString (size, &dst);
+	memcpy (dst, s, size);
+	pr_interntable[h] = -1 - num;
+	pr_numinterned++;
+	return num;
+}
+
@@ -40,6 +40,74 @@ dfunction_t	*pr_xfunction;
 int		pr_xstatement;
 int		pr_argc;
 
+#define	PR_RUNAWAY_LIMIT	100000
+
+// direct-threaded dispatch needs the GCC "labels as values" extension,
+// everything else gets the switch-based loop
+#if defined(__GNUC__) && !defined(PR_NO_THREADED)
+#define	PR_THREADED	1
+#else
+#define	PR_THREADED	0
+#endif
+
+// engine-private opcodes, only found in the decoded instruction stream
+enum
+{
+	OP_BADOP = OP_BITOR + 1,
+	OP_NOP,
+
+	// superinstructions built by PR_PeepholeProgs, each one standing
+	// for the statement in its own slot plus the one right after it
+	OP_ADD_F_STORE,
+	OP_SUB_F_STORE,
+	OP_MUL_F_STORE,
+	OP_DIV_F_STORE,
+	OP_LOAD_F_STORE,
+	OP_ADD_V_STORE,
+	OP_SUB_V_STORE,
+	OP_MUL_VF_STORE,
+	OP_LOAD_V_STORE,
+
+	OP_EQ_F_IFNOT,
+	OP_NE_F_IFNOT,
+	OP_LT_IFNOT,
+	OP_LE_IFNOT,
+	OP_GT_IFNOT,
+	OP_GE_IFNOT,
+	OP_EQ_E_IFNOT,
+	OP_NE_E_IFNOT,
+	OP_EQ_S_IFNOT,
+	OP_NE_S_IFNOT,
+	OP_NOT_F_IFNOT,
+	OP_NOT_S_IFNOT,
+	OP_NOT_FNC_IFNOT,
+	OP_AND_IFNOT,
+	OP_OR_IFNOT,
+	OP_BITAND_IFNOT,
+	OP_LOAD_F_IFNOT,
+
+	OP_ADDRESS_STOREP_F,
+	OP_ADDRESS_STOREP_V,
+
+	NUM_PR_OPS
+};
+
+// pre-decoded statement, built by PR_DecodeProgs
+typedef struct prinstr_s
+{
+#if PR_THREADED
+	const void	*handler;
+#endif
+	eval_t		*a, *b, *c;	// resolved global operands
+	int		op;		// OP_* with equivalent opcodes folded together
+	int		jump;		// relative branch for IF/IFNOT/GOTO, argc for CALLn
+} prinstr_t;
+
+static prinstr_t	*pr_instrs;	// same indexing as pr_statements
+#if PR_THREADED
+static const void *const *pr_handlers;
+#endif
+
 static const char *pr_opnames[] =
 {
 	"DONE",
@@ -344,53 +412,1077 @@ static int PR_LeaveFunction (void)
 
 /*
 ====================
-PR_ExecuteProgram
+PR_SetOp
+====================
+*/
+static void PR_SetOp (prinstr_t *in, int op)
+{
+	in->op = op;
+#if PR_THREADED
+	in->handler = pr_handlers[op] ? pr_handlers[op] : pr_handlers[OP_BADOP];
+#endif
+}
 
-The interpretation main loop
+/*
+====================
+PR_DecodeStatement
+
+Translates a single progs statement into its pre-decoded form:
+operands are resolved to global pointers, opcodes that share
+semantics are folded into one handler and branch/argc immediates
+are moved out of the operand slots.
 ====================
 */
-#define OPA ((eval_t *)&pr_globals[(unsigned short)st->a])
-#define OPB ((eval_t *)&pr_globals[(unsigned short)st->b])
-#define OPC ((eval_t *)&pr_globals[(unsigned short)st->c])
+static void PR_DecodeStatement (const dstatement_t *in, prinstr_t *out)
+{
+	int op = in->op;
 
-void PR_ExecuteProgram (func_t fnum)
+	out->a = (eval_t *)&pr_globals[(unsigned short)in->a];
+	out->b = (eval_t *)&pr_globals[(unsigned short)in->b];
+	out->c = (eval_t *)&pr_globals[(unsigned short)in->c];
+	out->jump = 0;
+
+	switch (op)
+	{
+	case OP_DONE:
+		op = OP_RETURN;
+		break;
+
+	case OP_EQ_FNC:
+		op = OP_EQ_E;
+		break;
+	case OP_NE_FNC:
+		op = OP_NE_E;
+		break;
+
+	case OP_NOT_ENT:	// edict 0 is always at offset 0
+		op = OP_NOT_FNC;
+		break;
+
+	case OP_LOAD_S:
+	case OP_LOAD_ENT:
+	case OP_LOAD_FLD:
+	case OP_LOAD_FNC:
+		op = OP_LOAD_F;
+		break;
+
+	case OP_STORE_S:
+	case OP_STORE_ENT:
+	case OP_STORE_FLD:
+	case OP_STORE_FNC:
+		op = OP_STORE_F;
+		break;
+
+	case OP_STOREP_ENT:
+	case OP_STOREP_FLD:
+	case OP_STOREP_FNC:
+		op = OP_STOREP_F;
+		break;
+	// OP_STOREP_S stays apart so string stores can update the find index
+
+	case OP_IF:
+	case OP_IFNOT:
+		out->jump = in->b;
+		out->b = NULL;
+		break;
+
+	case OP_GOTO:
+		out->jump = in->a;
+		out->a = NULL;
+		break;
+
+	case OP_CALL0:
+	case OP_CALL1:
+	case OP_CALL2:
+	case OP_CALL3:
+	case OP_CALL4:
+	case OP_CALL5:
+	case OP_CALL6:
+	case OP_CALL7:
+	case OP_CALL8:
+		out->jump = op - OP_CALL0;
+		op = OP_CALL0;
+		break;
+
+	default:
+		if ((unsigned int)op > OP_BITOR)
+			op = OP_BADOP;
+		break;
+	}
+
+	PR_SetOp (out, op);
+}
+
+static int PR_ExecuteThreaded (int s, int exitdepth, int *pprofile);
+
+/*
+=============================================================================
+
+PEEPHOLE OPTIMIZER
+
+Rewrites the decoded stream in place. Every rewritten instruction stays in
+the slot of the statement it came from, so pr_xstatement, PR_StackTrace and
+PR_PrintStatement keep referring to the original statements, and branches
+into the middle of a fused pair still find the unfused second statement.
+
+=============================================================================
+*/
+
+cvar_t	pr_peephole = {"pr_peephole", "1", CVAR_NONE};
+
+static qboolean	pr_rebuildinstrs;	// pr_peephole changed while QuakeC was running
+
+typedef struct
+{
+	int		first, second;	// decoded opcodes of the pair
+	int		link;		// operand of the second statement reading first's result
+	int		fused;
+	const char	*name;
+} prfusion_t;
+
+#define	LINK_A	0
+#define	LINK_B	1
+
+static const prfusion_t pr_fusions[] =
+{
+	{OP_ADD_F,	OP_STORE_F,	LINK_A,	OP_ADD_F_STORE,		"ADD_F+STORE"},
+	{OP_SUB_F,	OP_STORE_F,	LINK_A,	OP_SUB_F_STORE,		"SUB_F+STORE"},
+	{OP_MUL_F,	OP_STORE_F,	LINK_A,	OP_MUL_F_STORE,		"MUL_F+STORE"},
+	{OP_DIV_F,	OP_STORE_F,	LINK_A,	OP_DIV_F_STORE,		"DIV_F+STORE"},
+	{OP_LOAD_F,	OP_STORE_F,	LINK_A,	OP_LOAD_F_STORE,	"LOAD+STORE"},
+	{OP_ADD_V,	OP_STORE_V,	LINK_A,	OP_ADD_V_STORE,		"ADD_V+STORE_V"},
+	{OP_SUB_V,	OP_STORE_V,	LINK_A,	OP_SUB_V_STORE,		"SUB_V+STORE_V"},
+	{OP_MUL_VF,	OP_STORE_V,	LINK_A,	OP_MUL_VF_STORE,	"MUL_VF+STORE_V"},
+	{OP_LOAD_V,	OP_STORE_V,	LINK_A,	OP_LOAD_V_STORE,	"LOAD_V+STORE_V"},
+
+	{OP_EQ_F,	OP_IFNOT,	LINK_A,	OP_EQ_F_IFNOT,		"EQ_F+IFNOT"},
+	{OP_NE_F,	OP_IFNOT,	LINK_A,	OP_NE_F_IFNOT,		"NE_F+IFNOT"},
+	{OP_LT,		OP_IFNOT,	LINK_A,	OP_LT_IFNOT,		"LT+IFNOT"},
+	{OP_LE,		OP_IFNOT,	LINK_A,	OP_LE_IFNOT,		"LE+IFNOT"},
+	{OP_GT,		OP_IFNOT,	LINK_A,	OP_GT_IFNOT,		"GT+IFNOT"},
+	{OP_GE,		OP_IFNOT,	LINK_A,	OP_GE_IFNOT,		"GE+IFNOT"},
+	{OP_EQ_E,	OP_IFNOT,	LINK_A,	OP_EQ_E_IFNOT,		"EQ_E+IFNOT"},
+	{OP_NE_E,	OP_IFNOT,	LINK_A,	OP_NE_E_IFNOT,		"NE_E+IFNOT"},
+	{OP_EQ_S,	OP_IFNOT,	LINK_A,	OP_EQ_S_IFNOT,		"EQ_S+IFNOT"},
+	{OP_NE_S,	OP_IFNOT,	LINK_A,	OP_NE_S_IFNOT,		"NE_S+IFNOT"},
+	{OP_NOT_F,	OP_IFNOT,	LINK_A,	OP_NOT_F_IFNOT,		"NOT_F+IFNOT"},
+	{OP_NOT_S,	OP_IFNOT,	LINK_A,	OP_NOT_S_IFNOT,		"NOT_S+IFNOT"},
+	{OP_NOT_FNC,	OP_IFNOT,	LINK_A,	OP_NOT_FNC_IFNOT,	"NOT_ENT+IFNOT"},
+	{OP_AND,	OP_IFNOT,	LINK_A,	OP_AND_IFNOT,		"AND+IFNOT"},
+	{OP_OR,		OP_IFNOT,	LINK_A,	OP_OR_IFNOT,		"OR+IFNOT"},
+	{OP_BITAND,	OP_IFNOT,	LINK_A,	OP_BITAND_IFNOT,	"BITAND+IFNOT"},
+	{OP_LOAD_F,	OP_IFNOT,	LINK_A,	OP_LOAD_F_IFNOT,	"LOAD+IFNOT"},
+
+	{OP_ADDRESS,	OP_STOREP_F,	LINK_B,	OP_ADDRESS_STOREP_F,	"ADDRESS+STOREP"},
+	{OP_ADDRESS,	OP_STOREP_V,	LINK_B,	OP_ADDRESS_STOREP_V,	"ADDRESS+STOREP_V"},
+};
+
+#define	NUM_PR_FUSIONS	(sizeof(pr_fusions) / sizeof(pr_fusions[0]))
+
+static int	pr_numfused[NUM_PR_FUSIONS];
+static int	pr_numfolded;
+static int	pr_numthreaded;
+
+/*
+====================
+PR_StatementDest
+
+Returns the first global written by a statement, and how many
+(0 if the statement doesn't write to globals).
+====================
+*/
+static int PR_StatementDest (const dstatement_t *st, int *count)
+{
+	switch (st->op)
+	{
+	case OP_MUL_FV:
+	case OP_MUL_VF:
+	case OP_ADD_V:
+	case OP_SUB_V:
+	case OP_LOAD_V:
+		*count = 3;
+		return (unsigned short)st->c;
+
+	case OP_STORE_V:
+		*count = 3;
+		return (unsigned short)st->b;
+
+	case OP_STORE_F:
+	case OP_STORE_S:
+	case OP_STORE_ENT:
+	case OP_STORE_FLD:
+	case OP_STORE_FNC:
+		*count = 1;
+		return (unsigned short)st->b;
+
+	case OP_DONE:
+	case OP_RETURN:
+	case OP_STOREP_F:
+	case OP_STOREP_V:
+	case OP_STOREP_S:
+	case OP_STOREP_ENT:
+	case OP_STOREP_FLD:
+	case OP_STOREP_FNC:
+	case OP_IF:
+	case OP_IFNOT:
+	case OP_GOTO:
+	case OP_CALL0:
+	case OP_CALL1:
+	case OP_CALL2:
+	case OP_CALL3:
+	case OP_CALL4:
+	case OP_CALL5:
+	case OP_CALL6:
+	case OP_CALL7:
+	case OP_CALL8:
+	case OP_STATE:
+		*count = 0;
+		return 0;
+
+	default:
+		*count = 1;
+		return (unsigned short)st->c;
+	}
+}
+
+/*
+====================
+PR_FindConstants
+
+Flags the globals whose value can never change: anything past the
+system globals that isn't a function parm/local, isn't saved in
+savegames and is never the destination of a statement.
+====================
+*/
+static void PR_FindConstants (byte *isconst)
+{
+	int		i, j, ofs, count;
+	int		numsys = sizeof(globalvars_t) / 4;
+	ddef_t		*globaldefs;
+	dfunction_t	*f;
+
+	if (progs->numglobals <= numsys)
+		return;
+	memset (isconst + numsys, 1, progs->numglobals - numsys);
+
+	for (i = 0, f = pr_functions; i < progs->numfunctions; i++, f++)
+	{
+		if (f->first_statement < 0)
+			continue;
+		for (j = 0; j < f->locals; j++)
+			if ((unsigned int)(f->parm_start + j) < (unsigned int)progs->numglobals)
+				isconst[f->parm_start + j] = 0;
+	}
+
+	globaldefs = (ddef_t *)((byte *)progs + progs->ofs_globaldefs);
+	for (i = 0; i < progs->numglobaldefs; i++)
+	{
+		if (!(globaldefs[i].type & DEF_SAVEGLOBAL))
+			continue;
+		count = type_size[globaldefs[i].type & 7];
+		for (j = 0; j < count; j++)
+			if (globaldefs[i].ofs + j < progs->numglobals)
+				isconst[globaldefs[i].ofs + j] = 0;
+	}
+
+	for (i = 0; i < progs->numstatements; i++)
+	{
+		ofs = PR_StatementDest (&pr_statements[i], &count);
+		for (j = 0; j < count; j++)
+			if (ofs + j < progs->numglobals)
+				isconst[ofs + j] = 0;
+	}
+}
+
+/*
+====================
+PR_FoldConstant
+
+Replaces a scalar statement whose inputs are all constant by a
+store of its result. The folded value lives in the instruction's
+own jump field, which then serves as the source operand.
+====================
+*/
+static qboolean PR_FoldConstant (const dstatement_t *st, prinstr_t *in, const byte *isconst)
+{
+	unsigned short	a = st->a, b = st->b;
+	float		fa, fb, result;
+
+	if (a >= progs->numglobals || !isconst[a])
+		return false;
+	fa = pr_globals[a];
+
+	switch (st->op)
+	{
+	case OP_IF:
+	case OP_IFNOT:
+		if (!G_INT(a) == (st->op == OP_IFNOT))
+			PR_SetOp (in, OP_GOTO);	// always taken
+		else
+			PR_SetOp (in, OP_NOP);	// never taken
+		return true;
+
+	case OP_NOT_F:
+		result = !fa;
+		break;
+
+	default:
+		if (b >= progs->numglobals || !isconst[b])
+			return false;
+		fb = pr_globals[b];
+		switch (st->op)
+		{
+		case OP_ADD_F:	result = fa + fb; break;
+		case OP_SUB_F:	result = fa - fb; break;
+		case OP_MUL_F:	result = fa * fb; break;
+		case OP_DIV_F:	result = fa / fb; break;
+		case OP_BITAND:	result = (int)fa & (int)fb; break;
+		case OP_BITOR:	result = (int)fa | (int)fb; break;
+		case OP_AND:	result = fa && fb; break;
+		case OP_OR:	result = fa || fb; break;
+		case OP_EQ_F:	result = fa == fb; break;
+		case OP_NE_F:	result = fa != fb; break;
+		case OP_LT:	result = fa < fb; break;
+		case OP_LE:	result = fa <= fb; break;
+		case OP_GT:	result = fa > fb; break;
+		case OP_GE:	result = fa >= fb; break;
+		default:
+			return false;
+		}
+		break;
+	}
+
+	memcpy (&in->jump, &result, sizeof(result));
+	in->b = in->c;
+	in->a = (eval_t *)&in->jump;
+	in->c = NULL;
+	PR_SetOp (in, OP_STORE_F);
+	return true;
+}
+
+/*
+====================
+PR_PeepholeProgs
+====================
+*/
+static void PR_PeepholeProgs (void)
+{
+	int			i, j, target, hops;
+	int			numstatements = progs->numstatements;
+	byte			*isconst;
+	prinstr_t		*in;
+	const prfusion_t	*fuse;
+	eval_t			*link;
+
+	memset (pr_numfused, 0, sizeof(pr_numfused));
+	pr_numfolded = 0;
+	pr_numthreaded = 0;
+
+// constant folding
+	isconst = (byte *) Z_Malloc (progs->numglobals);
+	PR_FindConstants (isconst);
+	for (i = 0; i < numstatements; i++)
+		if (PR_FoldConstant (&pr_statements[i], &pr_instrs[i], isconst))
+			pr_numfolded++;
+	Z_Free (isconst);
+
+// jump threading: branches to a GOTO go straight to its target
+	for (i = 0, in = pr_instrs; i < numstatements; i++, in++)
+	{
+		if (in->op != OP_IF && in->op != OP_IFNOT && in->op != OP_GOTO)
+			continue;
+		target = i + in->jump;
+		for (hops = 0; hops < 16; hops++)
+		{
+			if (target < 0 || target >= numstatements || target == i)
+				break;
+			if (pr_instrs[target].op != OP_GOTO || !pr_instrs[target].jump)
+				break;
+			target += pr_instrs[target].jump;
+		}
+		if (target >= 0 && target < numstatements && target - i != in->jump)
+		{
+			in->jump = target - i;
+			pr_numthreaded++;
+		}
+	}
+
+// superinstructions
+	for (i = 0, in = pr_instrs; i < numstatements - 1; i++, in++)
+	{
+		for (j = 0, fuse = pr_fusions; j < (int) NUM_PR_FUSIONS; j++, fuse++)
+		{
+			if (in->op != fuse->first || in[1].op != fuse->second)
+				continue;
+			link = fuse->link == LINK_A ? in[1].a : in[1].b;
+			if (link != in->c)
+				continue;
+			PR_SetOp (in, fuse->fused);
+			pr_numfused[j]++;
+			break;
+		}
+	}
+}
+
+/*
+====================
+PR_BuildInstrs
+====================
+*/
+static void PR_BuildInstrs (void)
 {
+	int	i;
+
+	pr_rebuildinstrs = false;
+	for (i = 0; i < progs->numstatements; i++)
+		PR_DecodeStatement (&pr_statements[i], &pr_instrs[i]);
+	if (pr_peephole.value)
+		PR_PeepholeProgs ();
+}
+
+/*
+====================
+PR_Peephole_f
+
+pr_peephole cvar callback: rebuilds the stream of the running progs.  If
+QuakeC set it, the stream is still in use, so the rebuild waits until
+PR_ExecuteProgram is next entered from the engine.
+====================
+*/
+void PR_Peephole_f (cvar_t *var)
+{
+	if (!sv.active || !pr_instrs)
+		return;
+	if (pr_depth)
+	{
+		pr_rebuildinstrs = true;
+		return;
+	}
+	PR_BuildInstrs ();
+}
+
+/*
+====================
+PR_PeepholeStats_f
+
+Reports how much of the loaded progs the peephole pass rewrote.
+====================
+*/
+void PR_PeepholeStats_f (void)
+{
+	int	i, fused;
+
+	if (!sv.active || !pr_instrs)
+	{
+		Con_Printf ("no progs loaded\n");
+		return;
+	}
+
+	if (!pr_peephole.value)
+	{
+		Con_Printf ("%i statements, pr_peephole is off\n", progs->numstatements);
+		return;
+	}
+
+	fused = 0;
+	for (i = 0; i < (int) NUM_PR_FUSIONS; i++)
+	{
+		if (pr_numfused[i])
+			Con_Printf ("%7i %s\n", pr_numfused[i], pr_fusions[i].name);
+		fused += pr_numfused[i];
+	}
+	Con_Printf ("%i statements, %i fused pairs covering %.1f%%, %i folded, %i jumps threaded\n",
+		progs->numstatements, fused, progs->numstatements ? 200.0 * fused / progs->numstatements : 0.0,
+		pr_numfolded, pr_numthreaded);
+}
+
+/*
+====================
+PR_DecodeProgs
+
+Builds the pre-decoded instruction stream for the loaded progs.
+Called from PR_LoadProgs once pr_statements and pr_globals are in
+host byte order; the stream is indexed exactly like pr_statements.
+====================
+*/
+void PR_DecodeProgs (void)
+{
+#if PR_THREADED
+	if (!pr_handlers)
+		PR_ExecuteThreaded (-1, 0, NULL);
+#endif
+
+	pr_instrs = (prinstr_t *) Hunk_AllocName (progs->numstatements * sizeof(prinstr_t), "prinstrs");
+	PR_BuildInstrs ();
+}
+
+/*
+====================
+PR_ExecuteThreaded
+
+The fast interpreter loop, running over the pre-decoded stream.
+Statements are only counted at control transfers (a straight run
+from seg to st is st - seg + 1 statements), and the runaway check
+is only done on backward branches, since nothing else can loop.
+Returns -1 once the function at exitdepth has returned, or the
+current statement number if tracing was enabled by a builtin.
+====================
+*/
+#if PR_THREADED
+#define PR_OP(op)		op_##op:
+#define PR_NEXT()		goto *(++st)->handler
+#define PR_DISPATCH_BEGIN	PR_NEXT();
+#define PR_DISPATCH_END
+#else
+#define PR_OP(op)		case op:
+#define PR_NEXT()		continue
+#define PR_DISPATCH_BEGIN	for (;;) { switch ((++st)->op) {
+#define PR_DISPATCH_END		} }
+#endif
+
+#define PR_JUMP(ofs)								\
+	do {									\
+		int jump = (ofs);						\
+		profile += st - seg + 1;					\
+		st += jump - 1;		/* -1 to offset the ++st */		\
+		seg = st + 1;							\
+		if (jump <= 0 && profile > PR_RUNAWAY_LIMIT)			\
+			goto runaway;						\
+	} while (0)
+
+static FUNC_NOINLINE int PR_ExecuteThreaded (int s, int exitdepth, int *pprofile)
+{
+	prinstr_t	*st, *seg;
 	eval_t		*ptr;
-	dstatement_t	*st;
-	dfunction_t	*f, *newf;
-	int profile, startprofile;
+	dfunction_t	*newf;
 	edict_t		*ed;
-	int		exitdepth;
+	int		profile, startprofile;
 
-	if (!fnum || fnum >= progs->numfunctions)
+#if PR_THREADED
+	static const void *const handlers[NUM_PR_OPS] =
 	{
-		if (pr_global_struct->self)
-			ED_Print (PROG_TO_EDICT(pr_global_struct->self));
-		Host_Error ("PR_ExecuteProgram: NULL function");
+		[OP_ADD_F]	= &&op_OP_ADD_F,
+		[OP_ADD_V]	= &&op_OP_ADD_V,
+		[OP_SUB_F]	= &&op_OP_SUB_F,
+		[OP_SUB_V]	= &&op_OP_SUB_V,
+		[OP_MUL_F]	= &&op_OP_MUL_F,
+		[OP_MUL_V]	= &&op_OP_MUL_V,
+		[OP_MUL_FV]	= &&op_OP_MUL_FV,
+		[OP_MUL_VF]	= &&op_OP_MUL_VF,
+		[OP_DIV_F]	= &&op_OP_DIV_F,
+		[OP_BITAND]	= &&op_OP_BITAND,
+		[OP_BITOR]	= &&op_OP_BITOR,
+		[OP_GE]		= &&op_OP_GE,
+		[OP_LE]		= &&op_OP_LE,
+		[OP_GT]		= &&op_OP_GT,
+		[OP_LT]		= &&op_OP_LT,
+		[OP_AND]	= &&op_OP_AND,
+		[OP_OR]		= &&op_OP_OR,
+		[OP_NOT_F]	= &&op_OP_NOT_F,
+		[OP_NOT_V]	= &&op_OP_NOT_V,
+		[OP_NOT_S]	= &&op_OP_NOT_S,
+		[OP_NOT_FNC]	= &&op_OP_NOT_FNC,
+		[OP_EQ_F]	= &&op_OP_EQ_F,
+		[OP_EQ_V]	= &&op_OP_EQ_V,
+		[OP_EQ_S]	= &&op_OP_EQ_S,
+		[OP_EQ_E]	= &&op_OP_EQ_E,
+		[OP_NE_F]	= &&op_OP_NE_F,
+		[OP_NE_V]	= &&op_OP_NE_V,
+		[OP_NE_S]	= &&op_OP_NE_S,
+		[OP_NE_E]	= &&op_OP_NE_E,
+		[OP_STORE_F]	= &&op_OP_STORE_F,
+		[OP_STORE_V]	= &&op_OP_STORE_V,
+		[OP_STOREP_F]	= &&op_OP_STOREP_F,
+		[OP_STOREP_V]	= &&op_OP_STOREP_V,
+		[OP_STOREP_S]	= &&op_OP_STOREP_S,
+		[OP_ADDRESS]	= &&op_OP_ADDRESS,
+		[OP_LOAD_F]	= &&op_OP_LOAD_F,
+		[OP_LOAD_V]	= &&op_OP_LOAD_V,
+		[OP_IFNOT]	= &&op_OP_IFNOT,
+		[OP_IF]		= &&op_OP_IF,
+		[OP_GOTO]	= &&op_OP_GOTO,
+		[OP_CALL0]	= &&op_OP_CALL0,
+		[OP_RETURN]	= &&op_OP_RETURN,
+		[OP_STATE]	= &&op_OP_STATE,
+		[OP_BADOP]	= &&op_OP_BADOP,
+		[OP_NOP]	= &&op_OP_NOP,
+		[OP_ADD_F_STORE]	= &&op_OP_ADD_F_STORE,
+		[OP_SUB_F_STORE]	= &&op_OP_SUB_F_STORE,
+		[OP_MUL_F_STORE]	= &&op_OP_MUL_F_STORE,
+		[OP_DIV_F_STORE]	= &&op_OP_DIV_F_STORE,
+		[OP_LOAD_F_STORE]	= &&op_OP_LOAD_F_STORE,
+		[OP_ADD_V_STORE]	= &&op_OP_ADD_V_STORE,
+		[OP_SUB_V_STORE]	= &&op_OP_SUB_V_STORE,
+		[OP_MUL_VF_STORE]	= &&op_OP_MUL_VF_STORE,
+		[OP_LOAD_V_STORE]	= &&op_OP_LOAD_V_STORE,
+		[OP_EQ_F_IFNOT]	= &&op_OP_EQ_F_IFNOT,
+		[OP_NE_F_IFNOT]	= &&op_OP_NE_F_IFNOT,
+		[OP_LT_IFNOT]	= &&op_OP_LT_IFNOT,
+		[OP_LE_IFNOT]	= &&op_OP_LE_IFNOT,
+		[OP_GT_IFNOT]	= &&op_OP_GT_IFNOT,
+		[OP_GE_IFNOT]	= &&op_OP_GE_IFNOT,
+		[OP_EQ_E_IFNOT]	= &&op_OP_EQ_E_IFNOT,
+		[OP_NE_E_IFNOT]	= &&op_OP_NE_E_IFNOT,
+		[OP_EQ_S_IFNOT]	= &&op_OP_EQ_S_IFNOT,
+		[OP_NE_S_IFNOT]	= &&op_OP_NE_S_IFNOT,
+		[OP_NOT_F_IFNOT]	= &&op_OP_NOT_F_IFNOT,
+		[OP_NOT_S_IFNOT]	= &&op_OP_NOT_S_IFNOT,
+		[OP_NOT_FNC_IFNOT]	= &&op_OP_NOT_FNC_IFNOT,
+		[OP_AND_IFNOT]	= &&op_OP_AND_IFNOT,
+		[OP_OR_IFNOT]	= &&op_OP_OR_IFNOT,
+		[OP_BITAND_IFNOT]	= &&op_OP_BITAND_IFNOT,
+		[OP_LOAD_F_IFNOT]	= &&op_OP_LOAD_F_IFNOT,
+		[OP_ADDRESS_STOREP_F]	= &&op_OP_ADDRESS_STOREP_F,
+		[OP_ADDRESS_STOREP_V]	= &&op_OP_ADDRESS_STOREP_V,
+	};
+
+	if (s < 0)
+	{ // PR_DecodeProgs wants the handler addresses
+		pr_handlers = handlers;
+		return -1;
 	}
+#endif
 
-	f = &pr_functions[fnum];
+	profile = startprofile = *pprofile;
+	st = &pr_instrs[s];
+	seg = st + 1;
+
+	PR_DISPATCH_BEGIN
+
+	PR_OP(OP_ADD_F)
+		st->c->_float = st->a->_float + st->b->_float;
+		PR_NEXT();
+	PR_OP(OP_ADD_V)
+		st->c->vector[0] = st->a->vector[0] + st->b->vector[0];
+		st->c->vector[1] = st->a->vector[1] + st->b->vector[1];
+		st->c->vector[2] = st->a->vector[2] + st->b->vector[2];
+		PR_NEXT();
+
+	PR_OP(OP_SUB_F)
+		st->c->_float = st->a->_float - st->b->_float;
+		PR_NEXT();
+	PR_OP(OP_SUB_V)
+		st->c->vector[0] = st->a->vector[0] - st->b->vector[0];
+		st->c->vector[1] = st->a->vector[1] - st->b->vector[1];
+		st->c->vector[2] = st->a->vector[2] - st->b->vector[2];
+		PR_NEXT();
+
+	PR_OP(OP_MUL_F)
+		st->c->_float = st->a->_float * st->b->_float;
+		PR_NEXT();
+	PR_OP(OP_MUL_V)
+		st->c->_float = st->a->vector[0] * st->b->vector[0] +
+				st->a->vector[1] * st->b->vector[1] +
+				st->a->vector[2] * st->b->vector[2];
+		PR_NEXT();
+	PR_OP(OP_MUL_FV)
+		st->c->vector[0] = st->a->_float * st->b->vector[0];
+		st->c->vector[1] = st->a->_float * st->b->vector[1];
+		st->c->vector[2] = st->a->_float * st->b->vector[2];
+		PR_NEXT();
+	PR_OP(OP_MUL_VF)
+		st->c->vector[0] = st->b->_float * st->a->vector[0];
+		st->c->vector[1] = st->b->_float * st->a->vector[1];
+		st->c->vector[2] = st->b->_float * st->a->vector[2];
+		PR_NEXT();
+
+	PR_OP(OP_DIV_F)
+		st->c->_float = st->a->_float / st->b->_float;
+		PR_NEXT();
+
+	PR_OP(OP_BITAND)
+		st->c->_float = (int)st->a->_float & (int)st->b->_float;
+		PR_NEXT();
+	PR_OP(OP_BITOR)
+		st->c->_float = (int)st->a->_float | (int)st->b->_float;
+		PR_NEXT();
+
+	PR_OP(OP_GE)
+		st->c->_float = st->a->_float >= st->b->_float;
+		PR_NEXT();
+	PR_OP(OP_LE)
+		st->c->_float = st->a->_float <= st->b->_float;
+		PR_NEXT();
+	PR_OP(OP_GT)
+		st->c->_float = st->a->_float > st->b->_float;
+		PR_NEXT();
+	PR_OP(OP_LT)
+		st->c->_float = st->a->_float < st->b->_float;
+		PR_NEXT();
+	PR_OP(OP_AND)
+		st->c->_float = st->a->_float && st->b->_float;
+		PR_NEXT();
+	PR_OP(OP_OR)
+		st->c->_float = st->a->_float || st->b->_float;
+		PR_NEXT();
+
+	PR_OP(OP_NOT_F)
+		st->c->_float = !st->a->_float;
+		PR_NEXT();
+	PR_OP(OP_NOT_V)
+		st->c->_float = !st->a->vector[0] && !st->a->vector[1] && !st->a->vector[2];
+		PR_NEXT();
+	PR_OP(OP_NOT_S)
+		st->c->_float = !st->a->string || !*PR_GetString(st->a->string);
+		PR_NEXT();
+	PR_OP(OP_NOT_FNC)	// also OP_NOT_ENT
+		st->c->_float = !st->a->_int;
+		PR_NEXT();
+
+	PR_OP(OP_EQ_F)
+		st->c->_float = st->a->_float == st->b->_float;
+		PR_NEXT();
+	PR_OP(OP_EQ_V)
+		st->c->_float = (st->a->vector[0] == st->b->vector[0]) &&
+				(st->a->vector[1] == st->b->vector[1]) &&
+				(st->a->vector[2] == st->b->vector[2]);
+		PR_NEXT();
+	PR_OP(OP_EQ_S)
+		st->c->_float = !strcmp(PR_GetString(st->a->string), PR_GetString(st->b->string));
+		PR_NEXT();
+	PR_OP(OP_EQ_E)		// also OP_EQ_FNC
+		st->c->_float = st->a->_int == st->b->_int;
+		PR_NEXT();
+
+	PR_OP(OP_NE_F)
+		st->c->_float = st->a->_float != st->b->_float;
+		PR_NEXT();
+	PR_OP(OP_NE_V)
+		st->c->_float = (st->a->vector[0] != st->b->vector[0]) ||
+				(st->a->vector[1] != st->b->vector[1]) ||
+				(st->a->vector[2] != st->b->vector[2]);
+		PR_NEXT();
+	PR_OP(OP_NE_S)
+		st->c->_float = strcmp(PR_GetString(st->a->string), PR_GetString(st->b->string));
+		PR_NEXT();
+	PR_OP(OP_NE_E)		// also OP_NE_FNC
+		st->c->_float = st->a->_int != st->b->_int;
+		PR_NEXT();
+
+	PR_OP(OP_STORE_F)	// all single-word stores
+		st->b->_int = st->a->_int;
+		PR_NEXT();
+	PR_OP(OP_STORE_V)
+		st->b->vector[0] = st->a->vector[0];
+		st->b->vector[1] = st->a->vector[1];
+		st->b->vector[2] = st->a->vector[2];
+		PR_NEXT();
+
+	PR_OP(OP_STOREP_F)	// all single-word stores
+		ptr = (eval_t *)((byte *)sv.edicts + st->b->_int);
+		ptr->_int = st->a->_int;
+		PR_NEXT();
+	PR_OP(OP_STOREP_S)
+		ptr = (eval_t *)((byte *)sv.edicts + st->b->_int);
+		ptr->_int = st->a->_int;
+		ED_StringStored (ptr);
+		PR_NEXT();
+	PR_OP(OP_STOREP_V)
+		ptr = (eval_t *)((byte *)sv.edicts + st->b->_int);
+		ptr->vector[0] = st->a->vector[0];
+		ptr->vector[1] = st->a->vector[1];
+		ptr->vector[2] = st->a->vector[2];
+		PR_NEXT();
+
+	PR_OP(OP_ADDRESS)
+		ed = PROG_TO_EDICT(st->a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);	// Make sure it's in range
+#endif
+		if (ed == (edict_t *)sv.edicts && sv.state == ss_active)
+		{
+			pr_xstatement = st - pr_instrs;
+			PR_RunError("assignment to world entity");
+		}
+		if (sv_trackchanges)
+			SV_EdictChanged (ed);
+		st->c->_int = (byte *)((int *)&ed->v + st->b->_int) - (byte *)sv.edicts;
+		PR_NEXT();
 
-	pr_trace = false;
+	PR_OP(OP_LOAD_F)	// all single-word loads
+		ed = PROG_TO_EDICT(st->a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);	// Make sure it's in range
+#endif
+		st->c->_int = ((eval_t *)((int *)&ed->v + st->b->_int))->_int;
+		PR_NEXT();
+	PR_OP(OP_LOAD_V)
+		ed = PROG_TO_EDICT(st->a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);	// Make sure it's in range
+#endif
+		ptr = (eval_t *)((int *)&ed->v + st->b->_int);
+		st->c->vector[0] = ptr->vector[0];
+		st->c->vector[1] = ptr->vector[1];
+		st->c->vector[2] = ptr->vector[2];
+		PR_NEXT();
+
+	PR_OP(OP_IFNOT)
+		if (!st->a->_int)
+			PR_JUMP(st->jump);
+		PR_NEXT();
+	PR_OP(OP_IF)
+		if (st->a->_int)
+			PR_JUMP(st->jump);
+		PR_NEXT();
+	PR_OP(OP_GOTO)
+		PR_JUMP(st->jump);
+		PR_NEXT();
+
+	PR_OP(OP_CALL0)		// all OP_CALLn, argc in st->jump
+		profile += st - seg + 1;
+		seg = st + 1;
+		pr_xfunction->profile += profile - startprofile;
+		startprofile = profile;
+		pr_xstatement = st - pr_instrs;
+		pr_argc = st->jump;
+		if (!st->a->function)
+			PR_RunError("NULL function");
+		newf = &pr_functions[st->a->function];
+		if (newf->first_statement < 0)
+		{ // Built-in function
+			int i = -newf->first_statement;
+			if (i >= pr_numbuiltins)
+				PR_RunError("Bad builtin call number %d", i);
+			pr_builtins[i]();
+			if (pr_trace)
+			{ // PF_traceon, continue in the slow loop
+				*pprofile = profile;
+				return st - pr_instrs;
+			}
+			PR_NEXT();
+		}
+		// Normal function
+		st = &pr_instrs[PR_EnterFunction(newf)];
+		seg = st + 1;
+		PR_NEXT();
 
-// make a stack frame
-	exitdepth = pr_depth;
+	PR_OP(OP_RETURN)	// also OP_DONE
+		profile += st - seg + 1;
+		pr_xfunction->profile += profile - startprofile;
+		startprofile = profile;
+		pr_xstatement = st - pr_instrs;
+		pr_globals[OFS_RETURN] = st->a->vector[0];
+		pr_globals[OFS_RETURN + 1] = st->a->vector[1];
+		pr_globals[OFS_RETURN + 2] = st->a->vector[2];
+		st = &pr_instrs[PR_LeaveFunction()];
+		seg = st + 1;
+		if (pr_depth == exitdepth)
+		{ // Done
+			*pprofile = profile;
+			return -1;
+		}
+		PR_NEXT();
+
+	PR_OP(OP_STATE)
+		ed = PROG_TO_EDICT(pr_global_struct->self);
+		ed->v.nextthink = pr_global_struct->time + 0.1;
+		ed->v.frame = st->a->_float;
+		ed->v.think = st->b->function;
+		PR_NEXT();
+
+	PR_OP(OP_NOP)
+		PR_NEXT();
+
+// superinstructions: st[1] is the statement that was fused into st,
+// it keeps its own decoded operands so it can still be branched to
+
+#define PR_OP_STORE_F(op, expr)						\
+	PR_OP(op)							\
+		st->c->_float = (expr);					\
+		st[1].b->_int = st->c->_int;				\
+		st++;							\
+		PR_NEXT();
+
+	PR_OP_STORE_F(OP_ADD_F_STORE, st->a->_float + st->b->_float)
+	PR_OP_STORE_F(OP_SUB_F_STORE, st->a->_float - st->b->_float)
+	PR_OP_STORE_F(OP_MUL_F_STORE, st->a->_float * st->b->_float)
+	PR_OP_STORE_F(OP_DIV_F_STORE, st->a->_float / st->b->_float)
 
-	st = &pr_statements[PR_EnterFunction(f)];
-	startprofile = profile = 0;
+#undef PR_OP_STORE_F
+
+	PR_OP(OP_LOAD_F_STORE)
+		ed = PROG_TO_EDICT(st->a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);	// Make sure it's in range
+#endif
+		st->c->_int = ((eval_t *)((int *)&ed->v + st->b->_int))->_int;
+		st[1].b->_int = st->c->_int;
+		st++;
+		PR_NEXT();
+
+#define PR_OP_STORE_V(op, expr0, expr1, expr2)				\
+	PR_OP(op)							\
+		st->c->vector[0] = (expr0);				\
+		st->c->vector[1] = (expr1);				\
+		st->c->vector[2] = (expr2);				\
+		st[1].b->vector[0] = st->c->vector[0];			\
+		st[1].b->vector[1] = st->c->vector[1];			\
+		st[1].b->vector[2] = st->c->vector[2];			\
+		st++;							\
+		PR_NEXT();
+
+	PR_OP_STORE_V(OP_ADD_V_STORE,
+		st->a->vector[0] + st->b->vector[0],
+		st->a->vector[1] + st->b->vector[1],
+		st->a->vector[2] + st->b->vector[2])
+	PR_OP_STORE_V(OP_SUB_V_STORE,
+		st->a->vector[0] - st->b->vector[0],
+		st->a->vector[1] - st->b->vector[1],
+		st->a->vector[2] - st->b->vector[2])
+	PR_OP_STORE_V(OP_MUL_VF_STORE,
+		st->b->_float * st->a->vector[0],
+		st->b->_float * st->a->vector[1],
+		st->b->_float * st->a->vector[2])
+
+#undef PR_OP_STORE_V
+
+	PR_OP(OP_LOAD_V_STORE)
+		ed = PROG_TO_EDICT(st->a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);	// Make sure it's in range
+#endif
+		ptr = (eval_t *)((int *)&ed->v + st->b->_int);
+		st->c->vector[0] = ptr->vector[0];
+		st->c->vector[1] = ptr->vector[1];
+		st->c->vector[2] = ptr->vector[2];
+		st[1].b->vector[0] = st->c->vector[0];
+		st[1].b->vector[1] = st->c->vector[1];
+		st[1].b->vector[2] = st->c->vector[2];
+		st++;
+		PR_NEXT();
+
+#define PR_OP_IFNOT(op, expr)						\
+	PR_OP(op)							\
+		st->c->_float = (expr);					\
+		st++;							\
+		if (!st->a->_int)					\
+			PR_JUMP(st->jump);				\
+		PR_NEXT();
+
+	PR_OP_IFNOT(OP_EQ_F_IFNOT, st->a->_float == st->b->_float)
+	PR_OP_IFNOT(OP_NE_F_IFNOT, st->a->_float != st->b->_float)
+	PR_OP_IFNOT(OP_LT_IFNOT, st->a->_float < st->b->_float)
+	PR_OP_IFNOT(OP_LE_IFNOT, st->a->_float <= st->b->_float)
+	PR_OP_IFNOT(OP_GT_IFNOT, st->a->_float > st->b->_float)
+	PR_OP_IFNOT(OP_GE_IFNOT, st->a->_float >= st->b->_float)
+	PR_OP_IFNOT(OP_EQ_E_IFNOT, st->a->_int == st->b->_int)
+	PR_OP_IFNOT(OP_NE_E_IFNOT, st->a->_int != st->b->_int)
+	PR_OP_IFNOT(OP_EQ_S_IFNOT, !strcmp(PR_GetString(st->a->string), PR_GetString(st->b->string)))
+	PR_OP_IFNOT(OP_NE_S_IFNOT, strcmp(PR_GetString(st->a->string), PR_GetString(st->b->string)))
+	PR_OP_IFNOT(OP_NOT_F_IFNOT, !st->a->_float)
+	PR_OP_IFNOT(OP_NOT_S_IFNOT, !st->a->string || !*PR_GetString(st->a->string))
+	PR_OP_IFNOT(OP_NOT_FNC_IFNOT, !st->a->_int)
+	PR_OP_IFNOT(OP_AND_IFNOT, st->a->_float && st->b->_float)
+	PR_OP_IFNOT(OP_OR_IFNOT, st->a->_float || st->b->_float)
+	PR_OP_IFNOT(OP_BITAND_IFNOT, (int)st->a->_float & (int)st->b->_float)
+
+#undef PR_OP_IFNOT
+
+	PR_OP(OP_LOAD_F_IFNOT)
+		ed = PROG_TO_EDICT(st->a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);	// Make sure it's in range
+#endif
+		st->c->_int = ((eval_t *)((int *)&ed->v + st->b->_int))->_int;
+		st++;
+		if (!st->a->_int)
+			PR_JUMP(st->jump);
+		PR_NEXT();
+
+	PR_OP(OP_ADDRESS_STOREP_F)
+		ed = PROG_TO_EDICT(st->a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);	// Make sure it's in range
+#endif
+		if (ed == (edict_t *)sv.edicts && sv.state == ss_active)
+		{
+			pr_xstatement = st - pr_instrs;
+			PR_RunError("assignment to world entity");
+		}
+		if (sv_trackchanges)
+			SV_EdictChanged (ed);
+		st->c->_int = (byte *)((int *)&ed->v + st->b->_int) - (byte *)sv.edicts;
+		st++;
+		ptr = (eval_t *)((byte *)sv.edicts + st->b->_int);
+		ptr->_int = st->a->_int;
+		PR_NEXT();
+	PR_OP(OP_ADDRESS_STOREP_V)
+		ed = PROG_TO_EDICT(st->a->edict);
+#ifdef PARANOID
+		NUM_FOR_EDICT(ed);	// Make sure it's in range
+#endif
+		if (ed == (edict_t *)sv.edicts && sv.state == ss_active)
+		{
+			pr_xstatement = st - pr_instrs;
+			PR_RunError("assignment to world entity");
+		}
+		if (sv_trackchanges)
+			SV_EdictChanged (ed);
+		st->c->_int = (byte *)((int *)&ed->v + st->b->_int) - (byte *)sv.edicts;
+		st++;
+		ptr = (eval_t *)((byte *)sv.edicts + st->b->_int);
+		ptr->vector[0] = st->a->vector[0];
+		ptr->vector[1] = st->a->vector[1];
+		ptr->vector[2] = st->a->vector[2];
+		PR_NEXT();
+
+	PR_OP(OP_BADOP)
+#if !PR_THREADED
+	default:
+#endif
+		pr_xstatement = st - pr_instrs;
+		PR_RunError("Bad opcode %i", pr_statements[pr_xstatement].op);
+
+	PR_DISPATCH_END
+
+runaway:
+	pr_xstatement = seg - pr_instrs;
+	PR_RunError("runaway loop error");
+}
+
+#undef PR_JUMP
+#undef PR_OP
+#undef PR_NEXT
+#undef PR_DISPATCH_BEGIN
+#undef PR_DISPATCH_END
+
+/*
+====================
+PR_ExecuteTraced
+
+The slow interpreter loop, used while pr_trace is set. Works on the
+raw statements, printing each one and checking for runaway loops as
+it goes. Returns -1 once the function at exitdepth has returned, or
+the current statement number if tracing was disabled by a builtin.
+====================
+*/
+#define OPA ((eval_t *)&pr_globals[(unsigned short)st->a])
+#define OPB ((eval_t *)&pr_globals[(unsigned short)st->b])
+#define OPC ((eval_t *)&pr_globals[(unsigned short)st->c])
+
+static FUNC_NOINLINE int PR_ExecuteTraced (int s, int exitdepth, int *pprofile)
+{
+	eval_t		*ptr;
+	dstatement_t	*st;
+	dfunction_t	*newf;
+	int profile, startprofile;
+	edict_t		*ed;
+
+	st = &pr_statements[s];
+	startprofile = profile = *pprofile;
 
     while (1)
     {
 	st++;	/* next statement */
 
-	if (++profile > 100000)
+	if (++profile > PR_RUNAWAY_LIMIT)
 	{
 		pr_xstatement = st - pr_statements;
 		PR_RunError("runaway loop error");
 	}
 
-	if (pr_trace)
-		PR_PrintStatement(st);
+	PR_PrintStatement(st);
 
 	switch (st->op)
 	{
@@ -530,11 +1622,15 @@ void PR_ExecuteProgram (func_t fnum)
 	case OP_STOREP_F:
 	case OP_STOREP_ENT:
 	case OP_STOREP_FLD:	// integers
-	case OP_STOREP_S:
 	case OP_STOREP_FNC:	// pointers
 		ptr = (eval_t *)((byte *)sv.edicts + OPB->_int);
 		ptr->_int = OPA->_int;
 		break;
+	case OP_STOREP_S:
+		ptr = (eval_t *)((byte *)sv.edicts + OPB->_int);
+		ptr->_int = OPA->_int;
+		ED_StringStored (ptr);
+		break;
 	case OP_STOREP_V:
 		ptr = (eval_t *)((byte *)sv.edicts + OPB->_int);
 		ptr->vector[0] = OPA->vector[0];
@@ -552,6 +1648,8 @@ void PR_ExecuteProgram (func_t fnum)
 			pr_xstatement = st - pr_statements;
 			PR_RunError("assignment to world entity");
 		}
+		if (sv_trackchanges)
+			SV_EdictChanged (ed);
 		OPC->_int = (byte *)((int *)&ed->v + OPB->_int) - (byte *)sv.edicts;
 		break;
 
@@ -614,6 +1712,11 @@ void PR_ExecuteProgram (func_t fnum)
 			if (i >= pr_numbuiltins)
 				PR_RunError("Bad builtin call number %d", i);
 			pr_builtins[i]();
+			if (!pr_trace)
+			{ // PF_traceoff, back to the fast loop
+				*pprofile = profile;
+				return st - pr_statements;
+			}
 			break;
 		}
 		// Normal function
@@ -631,7 +1734,8 @@ void PR_ExecuteProgram (func_t fnum)
 		st = &pr_statements[PR_LeaveFunction()];
 		if (pr_depth == exitdepth)
 		{ // Done
-			return;
+			*pprofile = profile;
+			return -1;
 		}
 		break;
 
@@ -652,3 +1756,44 @@ void PR_ExecuteProgram (func_t fnum)
 #undef OPB
 #undef OPC
 
+/*
+====================
+PR_ExecuteProgram
+
+The interpretation main loop
+====================
+*/
+void PR_ExecuteProgram (func_t fnum)
+{
+	dfunction_t	*f;
+	int		s, profile;
+	int		exitdepth;
+
+	if (!fnum || fnum >= progs->numfunctions)
+	{
+		if (pr_global_struct->self)
+			ED_Print (PROG_TO_EDICT(pr_global_struct->self));
+		Host_Error ("PR_ExecuteProgram: NULL function");
+	}
+
+	if (pr_rebuildinstrs && !pr_depth)
+		PR_BuildInstrs ();
+
+	f = &pr_functions[fnum];
+
+	pr_trace = false;
+
+// make a stack frame
+	exitdepth = pr_depth;
+
+	s = PR_EnterFunction(f);
+	profile = 0;
+
+	do
+	{
+		if (pr_trace)
+			s = PR_ExecuteTraced (s, exitdepth, &profile);
+		else
+			s = PR_ExecuteThreaded (s, exitdepth, &profile);
+	} while (s >= 0);
+}
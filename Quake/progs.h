@@ -42,6 +42,7 @@ typedef struct edict_s
 	qboolean	free;			/* don't modify directly, use ED_AddToFreeList/ED_RemoveFromFreeList */
 	link_t		freechain;
 	link_t		area;			/* linked to a division node or leaf */
+	struct areanode_s	*areanode;	/* the node area is linked to */
 
 	int		num_leafs;
 	int		leafnums[MAX_ENT_LEAFS];
@@ -72,16 +73,30 @@ extern	int		pr_edict_size;	/* in bytes */
 void PR_Init (void);
 
 void PR_ExecuteProgram (func_t fnum);
+void PR_DecodeProgs (void);
 void PR_LoadProgs (void);
 
 const char *PR_GetString (int num);
+const char *PR_GetStringQuiet (int num);
 int PR_SetEngineString (const char *s);
 int PR_AllocString (int bufferlength, char **ptr);
+int PR_StringsMark (void);
+void PR_FreeStringsToMark (int mark);
 
 void PR_Profile_f (void);
+void PR_PeepholeStats_f (void);
+void PR_Peephole_f (cvar_t *var);
+
+extern	cvar_t	pr_peephole;
 
 edict_t *ED_Alloc (void);
 void ED_Free (edict_t *ed);
+void ED_ShrinkEdicts (int num);
+
+void ED_ResetFindIndex (void);
+void ED_TouchFindIndex (edict_t *ed);
+void ED_StringStored (eval_t *ptr);
+edict_t *ED_FindString (int start, int f, const char *s);
 void ED_ClearEdict (edict_t *e);
 
 void ED_Print (edict_t *ed);
@@ -91,6 +106,9 @@ const char *ED_ParseEdict (const char *data, edict_t *ent);
 void ED_WriteGlobals (FILE *f);
 const char *ED_ParseGlobals (const char *data);
 
+void ED_WriteBinary (FILE *f);
+int ED_ReadBinary (const byte *data, int length);
+
 void ED_LoadFromFile (const char *data);
 
 /*
@@ -142,5 +160,26 @@ void ED_PrintNum (int ent);
 
 eval_t *GetEdictFieldValue(edict_t *ed, const char *field);
 
+/* optional fields the engine knows about, resolved once by PR_LoadProgs.
+   offsets are in ints from ed->v, -1 if the progs don't define the field */
+typedef struct
+{
+	int	alpha;
+	int	gravity;
+	int	items2;
+	int	ammo_shells1;
+	int	ammo_nails1;
+	int	ammo_lava_nails;
+	int	ammo_rockets1;
+	int	ammo_multi_rockets;
+	int	ammo_cells1;
+	int	ammo_plasma;
+} pr_extfields_t;
+
+extern	pr_extfields_t	pr_extfields;
+
+#define	GetEdictFieldEval(e,fld)	(pr_extfields.fld < 0 ? NULL : (eval_t *)((int *)&(e)->v + pr_extfields.fld))
+#define	GetEdictFieldFloat(e,fld,def)	(pr_extfields.fld < 0 ? (def) : E_FLOAT(e, pr_extfields.fld))
+
 #endif	/* _QUAKE_PROGS_H */
 
@@ -206,6 +206,10 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 //Note: same value as svcdp_effect!
 #define svc_achievement				52		// [string] id
 
+// delta entity frames, only sent to clients that asked with "deltaents"
+#define	svc_deltaentities		54	// [long] sequence [long] delta base, 0 for the baselines
+									// then [short] entity number <update>..., [short] 0
+
 //
 // client to server
 //
@@ -214,6 +218,7 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define	clc_disconnect	2
 #define	clc_move		3		// [usercmd_t]
 #define	clc_stringcmd	4		// [string] message
+#define	clc_deltaack	5		// [long] last entity frame received, 0 asks for a full one
 
 //
 // temp entity events
@@ -248,6 +253,27 @@ typedef struct
 	int		effects;
 } entity_state_t;
 
+// svc_deltaentities: the entity number of each entry may carry this flag,
+// otherwise it is followed by update bits and fields as in a fast update,
+// relative to the entity's state in the delta base (or its baseline if it
+// wasn't there).  Entities of the base that have no entry are unchanged.
+#define	DE_REMOVE		(1<<15)	// entity left the view, no data follows
+
+#define	DELTA_BACKUP	32		// entity frames kept on both ends, power of two
+#define	DELTA_MASK		(DELTA_BACKUP - 1)
+
+typedef struct
+{
+	int				sequence;	// 0 if the frame isn't valid
+	int				numents;
+	int				maxents;
+	int				*nums;		// sorted entity numbers
+	byte			*flags;		// U_STEP if the entity was sent as movestep
+	entity_state_t	*states;
+} entityframe_t;
+
+int MSG_EntityDeltaBits (const entity_state_t *from, const entity_state_t *to);	// common.c
+
 typedef struct
 {
 	vec3_t	viewangles;
@@ -230,6 +230,7 @@ typedef struct
 
 #include "cmd.h"
 #include "crc.h"
+#include "tasks.h"
 
 #include "progs.h"
 #include "server.h"
@@ -317,6 +318,8 @@ FUNC_NORETURN void Host_EndGame (const char *message, ...) FUNC_PRINTF(1,2);
 #pragma aux Host_EndGame aborts;
 #endif
 void Host_Frame (double time);
+void Host_ServerPoll (void);
+void Host_TickStats (double late, double idle);
 void Host_Quit_f (void);
 void Host_ClientCommands (const char *fmt, ...) FUNC_PRINTF(1,2);
 void Host_ShutdownServer (qboolean crash);
@@ -23,20 +23,46 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 
 #include "quakedef.h"
 
+#if defined(USE_SSE2) && (defined(__SSE2_MATH__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define	PART_SIMD
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(_MSC_VER)
+#define	PART_SIMD_AVX
+#endif
+#endif
+
 #define MAX_PARTICLES			2048	// default max # of particles at one
 										//  time
 #define ABSOLUTE_MIN_PARTICLES	512		// no fewer than this no matter what's
 										//  on the command line
 
+#define NUM_PARTICLETYPES		(pt_blob2 + 1)
+
 int		ramp1[8] = {0x6f, 0x6d, 0x6b, 0x69, 0x67, 0x65, 0x63, 0x61};
 int		ramp2[8] = {0x6f, 0x6e, 0x6d, 0x6c, 0x6b, 0x6a, 0x68, 0x66};
 int		ramp3[8] = {0x6d, 0x6b, 6, 5, 4, 3};
 
-particle_t	*active_particles, *free_particles, *particles;
+typedef struct
+{
+	int		num;		// live particles are [0, num)
+	int		max;
+	float	*org[3];	// a separate 32 byte aligned array per field
+	float	*vel[3];
+	float	*ramp;
+	float	*die;
+	byte	*color;
+	void	*mem;
+} partpool_t;
+
+static partpool_t	partpools[NUM_PARTICLETYPES];	// one per ptype_t
+static int			r_activeparticles;
+static int			numpartkernels = 1;	// how many of partkernels this cpu can run
 
 vec3_t			r_pright, r_pup, r_ppn;
 
-int			r_numparticles;
+int			r_numparticles;		// most particles alive at once
+
+static void R_PartBench_f (void);
 
 gltexture_t *particletexture, *particletexture1, *particletexture2, *particletexture3, *particletexture4; //johnfitz
 float texturescalefactor; //johnfitz -- compensate for apparent size of different particle textures
@@ -166,14 +192,120 @@ void R_InitParticles (void)
 		r_numparticles = MAX_PARTICLES;
 	}
 
-	particles = (particle_t *)
-			Hunk_AllocName (r_numparticles * sizeof(particle_t), "particles");
+	numpartkernels = 1;
+#ifdef PART_SIMD
+	if (SDL_HasSSE2 ())
+		numpartkernels = 2;
+#ifdef PART_SIMD_AVX
+	if (SDL_HasSSE2 () && SDL_HasAVX ())
+		numpartkernels = 3;
+#endif
+#endif
 
 	R_InitParticleTextures (); //johnfitz
 
 	Cvar_RegisterVariable (&r_particles); //johnfitz
 	Cvar_SetCallback (&r_particles, R_SetParticleTexture_f);
 	R_SetParticleTexture_f (&r_particles); // set default
+
+	Cmd_AddCommand ("partbench", R_PartBench_f);
+}
+
+/*
+==============================================================================
+
+PARTICLE POOLS
+
+Particles of each ptype_t live in their own pool, with every field in an
+array of its own, so a pool is updated by one loop with no per-particle
+type switch, four or eight particles at a time with SSE2 or AVX.  The
+emitters append to the end of a pool and dead particles are replaced by
+the pool's last one, so the live particles are always [0, num).  Pools
+grow as needed, while r_numparticles still limits the total.
+
+==============================================================================
+*/
+
+typedef struct
+{
+	float		frametime;
+	float		velscale[3];	// vel += vel * velscale
+	float		grav;			// then vel[2] += grav
+	float		ramprate;		// ramp += ramprate, for pools with a ramp table
+	float		ramplimit;		// ramp that kills the particle
+	const int	*ramp;			// colors along the ramp, NULL for none
+} partstep_t;
+
+typedef void (*partkernel_t) (partpool_t *pool, const partstep_t *step, int first);
+
+/*
+===============
+R_GrowParticlePool
+===============
+*/
+static void R_GrowParticlePool (partpool_t *pool, int count)
+{
+	partpool_t	grown;
+	float		*f;
+	int			j;
+
+	grown = *pool;
+	grown.max = q_max (pool->max * 2, 256);	// keeps each array a multiple of 32 bytes
+	while (grown.max < count)
+		grown.max *= 2;
+
+	grown.mem = malloc (grown.max * (8 * sizeof(float) + 1) + 31);
+	if (!grown.mem)
+		Sys_Error ("R_GrowParticlePool: couldn't allocate %i particles", grown.max);
+
+	f = (float *) (((uintptr_t) grown.mem + 31) & ~(uintptr_t) 31);
+	for (j = 0; j < 3; j++, f += grown.max)
+		grown.org[j] = f;
+	for (j = 0; j < 3; j++, f += grown.max)
+		grown.vel[j] = f;
+	grown.ramp = f;
+	f += grown.max;
+	grown.die = f;
+	f += grown.max;
+	grown.color = (byte *) f;
+
+	if (pool->num)
+	{
+		for (j = 0; j < 3; j++)
+		{
+			memcpy (grown.org[j], pool->org[j], pool->num * sizeof(float));
+			memcpy (grown.vel[j], pool->vel[j], pool->num * sizeof(float));
+		}
+		memcpy (grown.ramp, pool->ramp, pool->num * sizeof(float));
+		memcpy (grown.die, pool->die, pool->num * sizeof(float));
+		memcpy (grown.color, pool->color, pool->num);
+	}
+
+	free (pool->mem);
+	*pool = grown;
+}
+
+/*
+===============
+R_AllocParticles
+
+Adds up to count particles to the end of a pool, as many as r_numparticles
+allows.  Returns how many, starting at *first; the caller fills them in.
+===============
+*/
+static int R_AllocParticles (partpool_t *pool, int count, int *first)
+{
+	*first = pool->num;
+	count = q_min (count, r_numparticles - r_activeparticles);
+	if (count <= 0)
+		return 0;
+
+	if (pool->num + count > pool->max)
+		R_GrowParticlePool (pool, pool->num + count);
+
+	pool->num += count;
+	r_activeparticles += count;
+	return count;
 }
 
 /*
@@ -191,8 +323,8 @@ float	timescale = 0.01;
 
 void R_EntityParticles (entity_t *ent)
 {
-	int		i;
-	particle_t	*p;
+	int		i, j, n, first;
+	partpool_t	*pool;
 	float		angle;
 	float		sp, sy, cp, cy;
 //	float		sr, cr;
@@ -213,7 +345,10 @@ void R_EntityParticles (entity_t *ent)
 		}
 	}
 
-	for (i = 0; i < NUMVERTEXNORMALS; i++)
+	pool = &partpools[pt_explode];
+	n = R_AllocParticles (pool, NUMVERTEXNORMALS, &first);
+
+	for (i = 0; i < n; i++)
 	{
 		angle = cl.time * avelocities[i][0];
 		sy = sin(angle);
@@ -229,20 +364,15 @@ void R_EntityParticles (entity_t *ent)
 		forward[1] = cp*sy;
 		forward[2] = -sp;
 
-		if (!free_particles)
-			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
+		pool->die[first + i] = cl.time + 0.01;
+		pool->color[first + i] = 0x6f;
+		pool->ramp[first + i] = 0;
 
-		p->die = cl.time + 0.01;
-		p->color = 0x6f;
-		p->type = pt_explode;
-
-		p->org[0] = ent->origin[0] + r_avertexnormals[i][0]*dist + forward[0]*beamlength;
-		p->org[1] = ent->origin[1] + r_avertexnormals[i][1]*dist + forward[1]*beamlength;
-		p->org[2] = ent->origin[2] + r_avertexnormals[i][2]*dist + forward[2]*beamlength;
+		for (j=0 ; j<3 ; j++)
+		{
+			pool->org[j][first + i] = ent->origin[j] + r_avertexnormals[i][j]*dist + forward[j]*beamlength;
+			pool->vel[j][first + i] = 0;
+		}
 	}
 }
 
@@ -255,12 +385,9 @@ void R_ClearParticles (void)
 {
 	int		i;
 
-	free_particles = &particles[0];
-	active_particles = NULL;
-
-	for (i=0 ;i<r_numparticles ; i++)
-		particles[i].next = &particles[i+1];
-	particles[r_numparticles-1].next = NULL;
+	for (i = 0; i < NUM_PARTICLETYPES; i++)
+		partpools[i].num = 0;
+	r_activeparticles = 0;
 }
 
 /*
@@ -274,7 +401,8 @@ void R_ReadPointFile_f (void)
 	vec3_t	org;
 	int		r;
 	int		c;
-	particle_t	*p;
+	int		i, j;
+	partpool_t	*pool;
 	char	name[MAX_QPATH];
 
 	if (cls.state != ca_connected)
@@ -292,6 +420,7 @@ void R_ReadPointFile_f (void)
 	Con_Printf ("Reading %s...\n", name);
 	c = 0;
 	org[0] = org[1] = org[2] = 0; // silence pesky compiler warnings
+	pool = &partpools[pt_static];
 	for ( ;; )
 	{
 		r = fscanf (f,"%f %f %f\n", &org[0], &org[1], &org[2]);
@@ -299,21 +428,19 @@ void R_ReadPointFile_f (void)
 			break;
 		c++;
 
-		if (!free_particles)
+		if (!R_AllocParticles (pool, 1, &i))
 		{
 			Con_Printf ("Not enough free particles\n");
 			break;
 		}
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
 
-		p->die = 99999;
-		p->color = (-c)&15;
-		p->type = pt_static;
-		VectorCopy (vec3_origin, p->vel);
-		VectorCopy (org, p->org);
+		pool->die[i] = 99999;
+		pool->color[i] = (-c)&15;
+		for (j=0 ; j<3 ; j++)
+		{
+			pool->org[j][i] = org[j];
+			pool->vel[j][i] = 0;
+		}
 	}
 
 	fclose (f);
@@ -349,44 +476,48 @@ void R_ParseParticleEffect (void)
 
 /*
 ===============
-R_ParticleExplosion
+R_ScatterParticles
+
+Puts particles first..first+count-1 of a pool within 16 units of org,
+flying off in random directions
 ===============
 */
-void R_ParticleExplosion (vec3_t org)
+static void R_ScatterParticles (partpool_t *pool, int first, int count, vec3_t org)
 {
-	int			i, j;
-	particle_t	*p;
+	int		i, j;
 
-	for (i=0 ; i<1024 ; i++)
+	for (i = first; i < first + count; i++)
 	{
-		if (!free_particles)
-			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
-		p->die = cl.time + 5;
-		p->color = ramp1[0];
-		p->ramp = rand()&3;
-		if (i & 1)
+		for (j=0 ; j<3 ; j++)
 		{
-			p->type = pt_explode;
-			for (j=0 ; j<3 ; j++)
-			{
-				p->org[j] = org[j] + ((rand()%32)-16);
-				p->vel[j] = (rand()%512)-256;
-			}
+			pool->org[j][i] = org[j] + ((rand()%32)-16);
+			pool->vel[j][i] = (rand()%512)-256;
 		}
-		else
+	}
+}
+
+/*
+===============
+R_ParticleExplosion
+===============
+*/
+void R_ParticleExplosion (vec3_t org)
+{
+	static const ptype_t	types[2] = {pt_explode, pt_explode2};
+	int			i, t, n, first;
+	partpool_t	*pool;
+
+	for (t = 0; t < 2; t++)
+	{
+		pool = &partpools[types[t]];
+		n = R_AllocParticles (pool, 512, &first);
+		for (i = first; i < first + n; i++)
 		{
-			p->type = pt_explode2;
-			for (j=0 ; j<3 ; j++)
-			{
-				p->org[j] = org[j] + ((rand()%32)-16);
-				p->vel[j] = (rand()%512)-256;
-			}
+			pool->die[i] = cl.time + 5;
+			pool->color[i] = ramp1[0];
+			pool->ramp[i] = rand()&3;
 		}
+		R_ScatterParticles (pool, first, n, org);
 	}
 }
 
@@ -397,30 +528,19 @@ R_ParticleExplosion2
 */
 void R_ParticleExplosion2 (vec3_t org, int colorStart, int colorLength)
 {
-	int			i, j;
-	particle_t	*p;
+	int			i, n, first;
+	partpool_t	*pool;
 	int			colorMod = 0;
 
-	for (i=0; i<512; i++)
+	pool = &partpools[pt_blob];
+	n = R_AllocParticles (pool, 512, &first);
+	for (i = first; i < first + n; i++)
 	{
-		if (!free_particles)
-			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
-		p->die = cl.time + 0.3;
-		p->color = colorStart + (colorMod % colorLength);
+		pool->die[i] = cl.time + 0.3;
+		pool->color[i] = colorStart + (colorMod % colorLength);
 		colorMod++;
-
-		p->type = pt_blob;
-		for (j=0 ; j<3 ; j++)
-		{
-			p->org[j] = org[j] + ((rand()%32)-16);
-			p->vel[j] = (rand()%512)-256;
-		}
 	}
+	R_ScatterParticles (pool, first, n, org);
 }
 
 /*
@@ -430,41 +550,26 @@ R_BlobExplosion
 */
 void R_BlobExplosion (vec3_t org)
 {
-	int			i, j;
-	particle_t	*p;
+	int			i, n, first;
+	partpool_t	*pool;
 
-	for (i=0 ; i<1024 ; i++)
+	pool = &partpools[pt_blob];
+	n = R_AllocParticles (pool, 512, &first);
+	for (i = first; i < first + n; i++)
 	{
-		if (!free_particles)
-			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
-		p->die = cl.time + 1 + (rand()&8)*0.05;
+		pool->die[i] = cl.time + 1 + (rand()&8)*0.05;
+		pool->color[i] = 66 + rand()%6;
+	}
+	R_ScatterParticles (pool, first, n, org);
 
-		if (i & 1)
-		{
-			p->type = pt_blob;
-			p->color = 66 + rand()%6;
-			for (j=0 ; j<3 ; j++)
-			{
-				p->org[j] = org[j] + ((rand()%32)-16);
-				p->vel[j] = (rand()%512)-256;
-			}
-		}
-		else
-		{
-			p->type = pt_blob2;
-			p->color = 150 + rand()%6;
-			for (j=0 ; j<3 ; j++)
-			{
-				p->org[j] = org[j] + ((rand()%32)-16);
-				p->vel[j] = (rand()%512)-256;
-			}
-		}
+	pool = &partpools[pt_blob2];
+	n = R_AllocParticles (pool, 512, &first);
+	for (i = first; i < first + n; i++)
+	{
+		pool->die[i] = cl.time + 1 + (rand()&8)*0.05;
+		pool->color[i] = 150 + rand()%6;
 	}
+	R_ScatterParticles (pool, first, n, org);
 }
 
 /*
@@ -474,52 +579,25 @@ R_RunParticleEffect
 */
 void R_RunParticleEffect (vec3_t org, vec3_t dir, int color, int count)
 {
-	int			i, j;
-	particle_t	*p;
+	int			i, j, n, first;
+	partpool_t	*pool;
+
+	if (count == 1024)
+	{	// rocket explosion
+		R_ParticleExplosion (org);
+		return;
+	}
 
-	for (i=0 ; i<count ; i++)
+	pool = &partpools[pt_slowgrav];
+	n = R_AllocParticles (pool, count, &first);
+	for (i = first; i < first + n; i++)
 	{
-		if (!free_particles)
-			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
-
-		if (count == 1024)
-		{	// rocket explosion
-			p->die = cl.time + 5;
-			p->color = ramp1[0];
-			p->ramp = rand()&3;
-			if (i & 1)
-			{
-				p->type = pt_explode;
-				for (j=0 ; j<3 ; j++)
-				{
-					p->org[j] = org[j] + ((rand()%32)-16);
-					p->vel[j] = (rand()%512)-256;
-				}
-			}
-			else
-			{
-				p->type = pt_explode2;
-				for (j=0 ; j<3 ; j++)
-				{
-					p->org[j] = org[j] + ((rand()%32)-16);
-					p->vel[j] = (rand()%512)-256;
-				}
-			}
-		}
-		else
+		pool->die[i] = cl.time + 0.1*(rand()%5);
+		pool->color[i] = (color&~7) + (rand()&7);
+		for (j=0 ; j<3 ; j++)
 		{
-			p->die = cl.time + 0.1*(rand()%5);
-			p->color = (color&~7) + (rand()&7);
-			p->type = pt_slowgrav;
-			for (j=0 ; j<3 ; j++)
-			{
-				p->org[j] = org[j] + ((rand()&15)-8);
-				p->vel[j] = dir[j]*15;// + (rand()%300)-150;
-			}
+			pool->org[j][i] = org[j] + ((rand()&15)-8);
+			pool->vel[j][i] = dir[j]*15;// + (rand()%300)-150;
 		}
 	}
 }
@@ -531,38 +609,36 @@ R_LavaSplash
 */
 void R_LavaSplash (vec3_t org)
 {
-	int			i, j, k;
-	particle_t	*p;
+	int			i, j, k, p, n, first;
+	partpool_t	*pool;
 	float		vel;
 	vec3_t		dir;
 
-	for (i=-16 ; i<16 ; i++)
-		for (j=-16 ; j<16 ; j++)
-			for (k=0 ; k<1 ; k++)
-			{
-				if (!free_particles)
-					return;
-				p = free_particles;
-				free_particles = p->next;
-				p->next = active_particles;
-				active_particles = p;
-
-				p->die = cl.time + 2 + (rand()&31) * 0.02;
-				p->color = 224 + (rand()&7);
-				p->type = pt_slowgrav;
-
-				dir[0] = j*8 + (rand()&7);
-				dir[1] = i*8 + (rand()&7);
-				dir[2] = 256;
-
-				p->org[0] = org[0] + dir[0];
-				p->org[1] = org[1] + dir[1];
-				p->org[2] = org[2] + (rand()&63);
-
-				VectorNormalize (dir);
-				vel = 50 + (rand()&63);
-				VectorScale (dir, vel, p->vel);
-			}
+	pool = &partpools[pt_slowgrav];
+	n = R_AllocParticles (pool, 32*32, &first);
+	for (k = 0; k < n; k++)
+	{
+		i = k / 32 - 16;
+		j = k % 32 - 16;
+		p = first + k;
+
+		pool->die[p] = cl.time + 2 + (rand()&31) * 0.02;
+		pool->color[p] = 224 + (rand()&7);
+
+		dir[0] = j*8 + (rand()&7);
+		dir[1] = i*8 + (rand()&7);
+		dir[2] = 256;
+
+		pool->org[0][p] = org[0] + dir[0];
+		pool->org[1][p] = org[1] + dir[1];
+		pool->org[2][p] = org[2] + (rand()&63);
+
+		VectorNormalize (dir);
+		vel = 50 + (rand()&63);
+		pool->vel[0][p] = dir[0] * vel;
+		pool->vel[1][p] = dir[1] * vel;
+		pool->vel[2][p] = dir[2] * vel;
+	}
 }
 
 /*
@@ -572,38 +648,36 @@ R_TeleportSplash
 */
 void R_TeleportSplash (vec3_t org)
 {
-	int			i, j, k;
-	particle_t	*p;
+	int			i, j, k, p, n, first;
+	partpool_t	*pool;
 	float		vel;
 	vec3_t		dir;
 
-	for (i=-16 ; i<16 ; i+=4)
-		for (j=-16 ; j<16 ; j+=4)
-			for (k=-24 ; k<32 ; k+=4)
-			{
-				if (!free_particles)
-					return;
-				p = free_particles;
-				free_particles = p->next;
-				p->next = active_particles;
-				active_particles = p;
-
-				p->die = cl.time + 0.2 + (rand()&7) * 0.02;
-				p->color = 7 + (rand()&7);
-				p->type = pt_slowgrav;
-
-				dir[0] = j*8;
-				dir[1] = i*8;
-				dir[2] = k*8;
-
-				p->org[0] = org[0] + i + (rand()&3);
-				p->org[1] = org[1] + j + (rand()&3);
-				p->org[2] = org[2] + k + (rand()&3);
-
-				VectorNormalize (dir);
-				vel = 50 + (rand()&63);
-				VectorScale (dir, vel, p->vel);
-			}
+	pool = &partpools[pt_slowgrav];
+	n = R_AllocParticles (pool, 8*8*14, &first);
+	for (p = first; p < first + n; p++)
+	{
+		i = (p - first) / (8*14) * 4 - 16;		// -16..12 in steps of 4
+		j = (p - first) / 14 % 8 * 4 - 16;		// -16..12
+		k = (p - first) % 14 * 4 - 24;			// -24..28
+
+		pool->die[p] = cl.time + 0.2 + (rand()&7) * 0.02;
+		pool->color[p] = 7 + (rand()&7);
+
+		dir[0] = j*8;
+		dir[1] = i*8;
+		dir[2] = k*8;
+
+		pool->org[0][p] = org[0] + i + (rand()&3);
+		pool->org[1][p] = org[1] + j + (rand()&3);
+		pool->org[2][p] = org[2] + k + (rand()&3);
+
+		VectorNormalize (dir);
+		vel = 50 + (rand()&63);
+		pool->vel[0][p] = dir[0] * vel;
+		pool->vel[1][p] = dir[1] * vel;
+		pool->vel[2][p] = dir[2] * vel;
+	}
 }
 
 /*
@@ -615,10 +689,10 @@ FIXME -- rename function and use #defined types instead of numbers
 */
 void R_RocketTrail (vec3_t start, vec3_t end, int type)
 {
-	vec3_t		vec;
+	vec3_t		vec, pos;
 	float		len;
-	int			j;
-	particle_t	*p;
+	int			i, j, n, first;
+	partpool_t	*pool;
 	int			dec;
 	static int	tracercount;
 
@@ -632,196 +706,504 @@ void R_RocketTrail (vec3_t start, vec3_t end, int type)
 		type -= 128;
 	}
 
-	while (len > 0)
+	switch (type)
 	{
-		len -= dec;
+	case 0:
+	case 1:
+		pool = &partpools[pt_fire];
+		break;
+	case 2:
+	case 4:
+		pool = &partpools[pt_grav];
+		break;
+	case 3:
+	case 5:
+	case 6:
+		pool = &partpools[pt_static];
+		break;
+	default:
+		return;
+	}
 
-		if (!free_particles)
-			return;
-		p = free_particles;
-		free_particles = p->next;
-		p->next = active_particles;
-		active_particles = p;
+	if (len <= 0)
+		return;
+	if (type == 4)
+		dec += 3;	// slight blood
+	n = R_AllocParticles (pool, (int)ceil (len / dec), &first);
 
-		VectorCopy (vec3_origin, p->vel);
-		p->die = cl.time + 2;
+	VectorCopy (start, pos);
+	for (i = first; i < first + n; i++)
+	{
+		for (j=0 ; j<3 ; j++)
+			pool->vel[j][i] = 0;
+		pool->die[i] = cl.time + 2;
 
 		switch (type)
 		{
 			case 0:	// rocket trail
-				p->ramp = (rand()&3);
-				p->color = ramp3[(int)p->ramp];
-				p->type = pt_fire;
+				pool->ramp[i] = (rand()&3);
+				pool->color[i] = ramp3[(int)pool->ramp[i]];
 				for (j=0 ; j<3 ; j++)
-					p->org[j] = start[j] + ((rand()%6)-3);
+					pool->org[j][i] = pos[j] + ((rand()%6)-3);
 				break;
 
 			case 1:	// smoke smoke
-				p->ramp = (rand()&3) + 2;
-				p->color = ramp3[(int)p->ramp];
-				p->type = pt_fire;
+				pool->ramp[i] = (rand()&3) + 2;
+				pool->color[i] = ramp3[(int)pool->ramp[i]];
 				for (j=0 ; j<3 ; j++)
-					p->org[j] = start[j] + ((rand()%6)-3);
+					pool->org[j][i] = pos[j] + ((rand()%6)-3);
 				break;
 
 			case 2:	// blood
-				p->type = pt_grav;
-				p->color = 67 + (rand()&3);
+			case 4:	// slight blood
+				pool->color[i] = 67 + (rand()&3);
 				for (j=0 ; j<3 ; j++)
-					p->org[j] = start[j] + ((rand()%6)-3);
+					pool->org[j][i] = pos[j] + ((rand()%6)-3);
 				break;
 
 			case 3:
 			case 5:	// tracer
-				p->die = cl.time + 0.5;
-				p->type = pt_static;
+				pool->die[i] = cl.time + 0.5;
 				if (type == 3)
-					p->color = 52 + ((tracercount&4)<<1);
+					pool->color[i] = 52 + ((tracercount&4)<<1);
 				else
-					p->color = 230 + ((tracercount&4)<<1);
+					pool->color[i] = 230 + ((tracercount&4)<<1);
 
 				tracercount++;
 
-				VectorCopy (start, p->org);
+				for (j=0 ; j<3 ; j++)
+					pool->org[j][i] = pos[j];
 				if (tracercount & 1)
 				{
-					p->vel[0] = 30*vec[1];
-					p->vel[1] = 30*-vec[0];
+					pool->vel[0][i] = 30*vec[1];
+					pool->vel[1][i] = 30*-vec[0];
 				}
 				else
 				{
-					p->vel[0] = 30*-vec[1];
-					p->vel[1] = 30*vec[0];
+					pool->vel[0][i] = 30*-vec[1];
+					pool->vel[1][i] = 30*vec[0];
 				}
 				break;
 
-			case 4:	// slight blood
-				p->type = pt_grav;
-				p->color = 67 + (rand()&3);
-				for (j=0 ; j<3 ; j++)
-					p->org[j] = start[j] + ((rand()%6)-3);
-				len -= 3;
-				break;
-
 			case 6:	// voor trail
-				p->color = 9*16 + 8 + (rand()&3);
-				p->type = pt_static;
-				p->die = cl.time + 0.3;
+				pool->color[i] = 9*16 + 8 + (rand()&3);
+				pool->die[i] = cl.time + 0.3;
 				for (j=0 ; j<3 ; j++)
-					p->org[j] = start[j] + ((rand()&15)-8);
+					pool->org[j][i] = pos[j] + ((rand()&15)-8);
 				break;
 		}
 
-		VectorAdd (start, vec, start);
+		VectorAdd (pos, vec, pos);
 	}
 }
 
 /*
 ===============
-CL_RunParticles -- johnfitz -- all the particle behavior, separated from R_DrawParticles
+R_MoveParticles
+
+Updates particles first..num-1 of a pool, the way the per-type code in
+CL_RunParticles always has: org by the old velocity, then the velocity,
+then the ramp.  The SIMD versions do the same float operations in the
+same order, so all of them give identical results.
 ===============
 */
-void CL_RunParticles (void)
+static void R_MoveParticles (partpool_t *pool, const partstep_t *step, int first)
 {
-	particle_t		*p, *kill;
-	int				i;
-	float			time1, time2, time3, dvel, frametime, grav;
-	extern	cvar_t	sv_gravity;
+	float	*org, *vel, scale, accel;
+	int		i, j;
 
-	frametime = cl.time - cl.oldtime;
-	time3 = frametime * 15;
-	time2 = frametime * 10;
-	time1 = frametime * 5;
-	grav = frametime * sv_gravity.value * 0.05;
-	dvel = 4*frametime;
+	for (j = 0; j < 3; j++)
+	{
+		org = pool->org[j];
+		vel = pool->vel[j];
+		scale = step->velscale[j];
+		accel = (j == 2) ? step->grav : 0;
+		for (i = first; i < pool->num; i++)
+		{
+			org[i] += vel[i] * step->frametime;
+			vel[i] += vel[i] * scale;
+			vel[i] += accel;
+		}
+	}
 
-	for ( ;; )
+	if (step->ramp)
 	{
-		kill = active_particles;
-		if (kill && kill->die < cl.time)
+		for (i = first; i < pool->num; i++)
 		{
-			active_particles = kill->next;
-			kill->next = free_particles;
-			free_particles = kill;
-			continue;
+			pool->ramp[i] += step->ramprate;
+			if (pool->ramp[i] >= step->ramplimit)
+				pool->die[i] = -1;
 		}
-		break;
 	}
+}
+
+#ifdef PART_SIMD
+/*
+===============
+R_MoveParticlesSSE2
+
+Four particles at a time
+===============
+*/
+static void R_MoveParticlesSSE2 (partpool_t *pool, const partstep_t *step, int first)
+{
+	__m128	frametime, scale, accel, limit, rate, dead, v, r, d, mask;
+	float	*org, *vel;
+	int		i, j, n;
 
-	for (p=active_particles ; p ; p=p->next)
+	n = first + ((pool->num - first) & ~3);
+
+	frametime = _mm_set1_ps (step->frametime);
+	for (j = 0; j < 3; j++)
 	{
-		for ( ;; )
+		org = pool->org[j];
+		vel = pool->vel[j];
+		scale = _mm_set1_ps (step->velscale[j]);
+		accel = _mm_set1_ps ((j == 2) ? step->grav : 0);
+		for (i = first; i < n; i += 4)
 		{
-			kill = p->next;
-			if (kill && kill->die < cl.time)
-			{
-				p->next = kill->next;
-				kill->next = free_particles;
-				free_particles = kill;
-				continue;
-			}
-			break;
+			v = _mm_load_ps (vel + i);
+			_mm_store_ps (org + i, _mm_add_ps (_mm_load_ps (org + i), _mm_mul_ps (v, frametime)));
+			v = _mm_add_ps (v, _mm_mul_ps (v, scale));
+			_mm_store_ps (vel + i, _mm_add_ps (v, accel));
 		}
+	}
+
+	if (step->ramp)
+	{
+		rate = _mm_set1_ps (step->ramprate);
+		limit = _mm_set1_ps (step->ramplimit);
+		dead = _mm_set1_ps (-1);
+		for (i = first; i < n; i += 4)
+		{
+			r = _mm_add_ps (_mm_load_ps (pool->ramp + i), rate);
+			_mm_store_ps (pool->ramp + i, r);
+			mask = _mm_cmpge_ps (r, limit);
+			d = _mm_load_ps (pool->die + i);
+			_mm_store_ps (pool->die + i, _mm_or_ps (_mm_and_ps (mask, dead), _mm_andnot_ps (mask, d)));
+		}
+	}
+
+	R_MoveParticles (pool, step, n);
+}
 
-		p->org[0] += p->vel[0]*frametime;
-		p->org[1] += p->vel[1]*frametime;
-		p->org[2] += p->vel[2]*frametime;
+#ifdef PART_SIMD_AVX
+/*
+===============
+R_MoveParticlesAVX
 
-		switch (p->type)
+Eight particles at a time
+===============
+*/
+#ifdef __GNUC__
+__attribute__((target("avx")))
+#endif
+static void R_MoveParticlesAVX (partpool_t *pool, const partstep_t *step, int first)
+{
+	__m256	frametime, scale, accel, limit, rate, dead, v, r, d, mask;
+	float	*org, *vel;
+	int		i, j, n;
+
+	n = first + ((pool->num - first) & ~7);
+
+	frametime = _mm256_set1_ps (step->frametime);
+	for (j = 0; j < 3; j++)
+	{
+		org = pool->org[j];
+		vel = pool->vel[j];
+		scale = _mm256_set1_ps (step->velscale[j]);
+		accel = _mm256_set1_ps ((j == 2) ? step->grav : 0);
+		for (i = first; i < n; i += 8)
 		{
-		case pt_static:
-			break;
-		case pt_fire:
-			p->ramp += time1;
-			if (p->ramp >= 6)
-				p->die = -1;
-			else
-				p->color = ramp3[(int)p->ramp];
-			p->vel[2] += grav;
-			break;
+			v = _mm256_load_ps (vel + i);
+			_mm256_store_ps (org + i, _mm256_add_ps (_mm256_load_ps (org + i), _mm256_mul_ps (v, frametime)));
+			v = _mm256_add_ps (v, _mm256_mul_ps (v, scale));
+			_mm256_store_ps (vel + i, _mm256_add_ps (v, accel));
+		}
+	}
 
-		case pt_explode:
-			p->ramp += time2;
-			if (p->ramp >=8)
-				p->die = -1;
-			else
-				p->color = ramp1[(int)p->ramp];
-			for (i=0 ; i<3 ; i++)
-				p->vel[i] += p->vel[i]*dvel;
-			p->vel[2] -= grav;
-			break;
+	if (step->ramp)
+	{
+		rate = _mm256_set1_ps (step->ramprate);
+		limit = _mm256_set1_ps (step->ramplimit);
+		dead = _mm256_set1_ps (-1);
+		for (i = first; i < n; i += 8)
+		{
+			r = _mm256_add_ps (_mm256_load_ps (pool->ramp + i), rate);
+			_mm256_store_ps (pool->ramp + i, r);
+			mask = _mm256_cmp_ps (r, limit, _CMP_GE_OQ);
+			d = _mm256_load_ps (pool->die + i);
+			_mm256_store_ps (pool->die + i, _mm256_blendv_ps (d, dead, mask));
+		}
+	}
 
-		case pt_explode2:
-			p->ramp += time3;
-			if (p->ramp >=8)
-				p->die = -1;
-			else
-				p->color = ramp2[(int)p->ramp];
-			for (i=0 ; i<3 ; i++)
-				p->vel[i] -= p->vel[i]*frametime;
-			p->vel[2] -= grav;
-			break;
+	R_MoveParticlesSSE2 (pool, step, n);
+}
+#endif	/* PART_SIMD_AVX */
+#endif	/* PART_SIMD */
 
-		case pt_blob:
-			for (i=0 ; i<3 ; i++)
-				p->vel[i] += p->vel[i]*dvel;
-			p->vel[2] -= grav;
-			break;
+static const partkernel_t	partkernels[] =
+{
+	R_MoveParticles,
+#ifdef PART_SIMD
+	R_MoveParticlesSSE2,
+#ifdef PART_SIMD_AVX
+	R_MoveParticlesAVX,
+#endif
+#endif
+};
+static const char	*partkernelnames[] = {"scalar", "sse2", "avx"};
 
-		case pt_blob2:
-			for (i=0 ; i<2 ; i++)
-				p->vel[i] -= p->vel[i]*dvel;
-			p->vel[2] -= grav;
-			break;
+/*
+===============
+R_KillParticles
 
-		case pt_grav:
-		case pt_slowgrav:
-			p->vel[2] -= grav;
+Removes the particles that died before time, moving the last live particle
+into each hole
+===============
+*/
+static void R_KillParticles (partpool_t *pool, double time)
+{
+	int		i, j, last;
+
+	for (i = 0; i < pool->num; )
+	{
+		if (pool->die[i] >= time)
+		{
+			i++;
+			continue;
+		}
+
+		last = --pool->num;
+		r_activeparticles--;
+		if (i == last)
 			break;
+		for (j = 0; j < 3; j++)
+		{
+			pool->org[j][i] = pool->org[j][last];
+			pool->vel[j][i] = pool->vel[j][last];
 		}
+		pool->ramp[i] = pool->ramp[last];
+		pool->die[i] = pool->die[last];
+		pool->color[i] = pool->color[last];
+	}
+}
+
+/*
+===============
+R_ParticleStep
+
+What a frame does to particles of the given type
+===============
+*/
+static void R_ParticleStep (ptype_t type, float frametime, float grav, partstep_t *step)
+{
+	float	dvel = 4*frametime;
+
+	memset (step, 0, sizeof(*step));
+	step->frametime = frametime;
+	step->grav = -grav;
+
+	switch (type)
+	{
+	case pt_static:
+		step->grav = 0;
+		break;
+
+	case pt_fire:
+		step->ramprate = frametime * 5;
+		step->ramplimit = 6;
+		step->ramp = ramp3;
+		step->grav = grav;
+		break;
+
+	case pt_explode:
+		step->ramprate = frametime * 10;
+		step->ramplimit = 8;
+		step->ramp = ramp1;
+		step->velscale[0] = step->velscale[1] = step->velscale[2] = dvel;
+		break;
+
+	case pt_explode2:
+		step->ramprate = frametime * 15;
+		step->ramplimit = 8;
+		step->ramp = ramp2;
+		step->velscale[0] = step->velscale[1] = step->velscale[2] = -frametime;
+		break;
+
+	case pt_blob:
+		step->velscale[0] = step->velscale[1] = step->velscale[2] = dvel;
+		break;
+
+	case pt_blob2:
+		step->velscale[0] = step->velscale[1] = -dvel;
+		break;
+
+	case pt_grav:
+	case pt_slowgrav:
+		break;
 	}
 }
 
+/*
+===============
+R_UpdateParticles
+===============
+*/
+static void R_UpdateParticles (double time, float frametime, partkernel_t kernel)
+{
+	partpool_t	*pool;
+	partstep_t	step;
+	float		grav;
+	int			t, i;
+	extern	cvar_t	sv_gravity;
+
+	grav = frametime * sv_gravity.value * 0.05;
+
+	for (t = 0; t < NUM_PARTICLETYPES; t++)
+	{
+		pool = &partpools[t];
+		R_KillParticles (pool, time);
+		if (!pool->num)
+			continue;
+
+		R_ParticleStep ((ptype_t) t, frametime, grav, &step);
+		kernel (pool, &step, 0);
+
+		if (step.ramp)
+		{
+			for (i = 0; i < pool->num; i++)
+				if (pool->ramp[i] < step.ramplimit)
+					pool->color[i] = step.ramp[(int)pool->ramp[i]];
+		}
+	}
+}
+
+/*
+===============
+CL_RunParticles -- johnfitz -- all the particle behavior, separated from R_DrawParticles
+===============
+*/
+void CL_RunParticles (void)
+{
+	R_UpdateParticles (cl.time, cl.time - cl.oldtime, partkernels[use_simd ? numpartkernels - 1 : 0]);
+}
+
+/*
+===============
+R_HashBlock
+
+FNV-1a, for comparing the pools partbench leaves
+===============
+*/
+static unsigned int R_HashBlock (const void *data, size_t size, unsigned int hash)
+{
+	const byte	*p = (const byte *) data;
+
+	while (size--)
+		hash = (hash ^ *p++) * 16777619u;
+	return hash;
+}
+
+/*
+===============
+R_HashParticles
+===============
+*/
+static unsigned int R_HashParticles (void)
+{
+	partpool_t		*pool;
+	unsigned int	hash;
+	int				t, j;
+
+	hash = 2166136261u;
+	for (t = 0; t < NUM_PARTICLETYPES; t++)
+	{
+		pool = &partpools[t];
+		hash = R_HashBlock (&pool->num, sizeof(pool->num), hash);
+		for (j = 0; j < 3; j++)
+		{
+			hash = R_HashBlock (pool->org[j], pool->num * sizeof(float), hash);
+			hash = R_HashBlock (pool->vel[j], pool->num * sizeof(float), hash);
+		}
+		hash = R_HashBlock (pool->ramp, pool->num * sizeof(float), hash);
+		hash = R_HashBlock (pool->die, pool->num * sizeof(float), hash);
+		hash = R_HashBlock (pool->color, pool->num, hash);
+	}
+	return hash;
+}
+
+/*
+===============
+R_PartBench_f
+
+partbench [explosions] [frames]: sets off that many rocket explosions at
+once and runs them for that many 72 fps frames with each update kernel,
+checks the kernels all agree and prints the times.  Clears the particles
+in view, and needs no map.
+===============
+*/
+static void R_PartBench_f (void)
+{
+	double		oldtime, time, spawn, update, start;
+	int			saved, explosions, frames, i, k, count;
+	unsigned int	hash, first;
+	vec3_t		org;
+
+	explosions = (Cmd_Argc() > 1) ? Q_atoi (Cmd_Argv(1)) : 64;
+	frames = (Cmd_Argc() > 2) ? Q_atoi (Cmd_Argv(2)) : 50;
+	explosions = q_max (explosions, 1);
+	frames = q_max (frames, 1);
+
+	saved = r_numparticles;
+	oldtime = cl.oldtime;
+	time = cl.time;
+	r_numparticles = q_max (r_numparticles, explosions * 1024);
+
+	first = 0;
+	for (k = 0; k < numpartkernels; k++)
+	{
+		R_ClearParticles ();
+		srand (1);
+		cl.time = 1;
+
+		start = Sys_DoubleTime ();
+		for (i = 0; i < explosions; i++)
+		{
+			org[0] = (rand() & 1023) - 512;
+			org[1] = (rand() & 1023) - 512;
+			org[2] = (rand() & 255);
+			R_ParticleExplosion (org);
+		}
+		spawn = Sys_DoubleTime () - start;
+
+		count = 0;
+		start = Sys_DoubleTime ();
+		for (i = 0; i < frames; i++)
+		{
+			cl.oldtime = cl.time;
+			cl.time += 1.0 / 72;
+			R_UpdateParticles (cl.time, cl.time - cl.oldtime, partkernels[k]);
+			count += r_activeparticles;
+		}
+		update = Sys_DoubleTime () - start;
+
+		Con_Printf ("%-7s spawn %7.3f ms, update %7.3f ms/frame, %7.2f Mparticles/s\n", partkernelnames[k],
+			spawn * 1000.0, update * 1000.0 / frames, count / q_max (update, 1e-9) / 1e6);
+
+		hash = R_HashParticles ();
+		if (!k)
+			first = hash;
+		else if (hash != first)
+			Con_Printf ("%s: particles differ from scalar\n", partkernelnames[k]);
+	}
+
+	R_ClearParticles ();
+	r_numparticles = saved;
+	cl.oldtime = oldtime;
+	cl.time = time;
+}
+
 /*
 ===============
 R_FlushParticleBatch
@@ -852,8 +1234,10 @@ R_DrawParticles_Real -- johnfitz -- moved all non-drawing code to CL_RunParticle
 */
 static void R_DrawParticles_Real (qboolean showtris)
 {
-	particle_t		*p;
+	partpool_t		*pool;
+	vec3_t			org;
 	float			scale;
+	int				t, i;
 	vec3_t			up, right, p_up, p_right; //johnfitz -- p_ vectors
 	GLubyte			color[4] = {255, 255, 255, 255}, *c; //johnfitz -- particle transparency
 	extern	cvar_t	r_particles; //johnfitz
@@ -863,7 +1247,7 @@ static void R_DrawParticles_Real (qboolean showtris)
 	if (!r_particles.value)
 		return;
 
-	if (!active_particles)
+	if (!r_activeparticles)
 		return;
 
 	GL_BeginGroup ("Particles");
@@ -878,12 +1262,17 @@ static void R_DrawParticles_Real (qboolean showtris)
 	VectorScale (vright, 1.5, right);
 
 	numpartverts = 0;
-	for (p=active_particles ; p ; p=p->next)
+	for (t = 0; t < NUM_PARTICLETYPES; t++)
+	for (i = 0, pool = &partpools[t]; i < pool->num; i++)
 	{
+		org[0] = pool->org[0][i];
+		org[1] = pool->org[1][i];
+		org[2] = pool->org[2][i];
+
 		// hack a scale up to keep particles from disapearing
-		scale = (p->org[0] - r_origin[0]) * vpn[0]
-				+ (p->org[1] - r_origin[1]) * vpn[1]
-				+ (p->org[2] - r_origin[2]) * vpn[2];
+		scale = (org[0] - r_origin[0]) * vpn[0]
+				+ (org[1] - r_origin[1]) * vpn[1]
+				+ (org[2] - r_origin[2]) * vpn[2];
 		if (scale < 20)
 			scale = 1 + 0.08; //johnfitz -- added .08 to be consistent
 		else
@@ -894,11 +1283,11 @@ static void R_DrawParticles_Real (qboolean showtris)
 		if (!showtris)
 		{
 			//johnfitz -- particle transparency and fade out
-			c = (GLubyte *) &d_8to24table[(int)p->color];
+			c = (GLubyte *) &d_8to24table[pool->color[i]];
 			color[0] = c[0];
 			color[1] = c[1];
 			color[2] = c[2];
-			//alpha = CLAMP(0, p->die + 0.5 - cl.time, 1);
+			//alpha = CLAMP(0, pool->die[i] + 0.5 - cl.time, 1);
 			color[3] = 255; //(int)(alpha * 255);
 			//johnfitz
 		}
@@ -911,12 +1300,12 @@ static void R_DrawParticles_Real (qboolean showtris)
 			memcpy(&partverts[numpartverts].color, &color, 4 * sizeof(GLubyte));	\
 			++numpartverts
 
-		ADD_VERTEX(p->org);
+		ADD_VERTEX(org);
 
-		VectorMA (p->org, scale, up, p_up);
+		VectorMA (org, scale, up, p_up);
 		ADD_VERTEX(p_up);
 
-		VectorMA (p->org, scale, right, p_right);
+		VectorMA (org, scale, right, p_right);
 		ADD_VERTEX(p_right);
 
 		#undef ADD_VERTEX
@@ -112,6 +112,7 @@ typedef struct client_s
 
 // client known data for deltas
 	int				old_frags;
+	qboolean		deltaents;			// gets svc_deltaentities, see sv_main.c
 } client_t;
 
 
@@ -218,6 +219,11 @@ void SV_BroadcastPrintf (const char *fmt, ...) FUNC_PRINTF(1,2);
 
 void SV_Physics (void);
 
+extern	qboolean	sv_trackchanges;
+void SV_EdictChanged (edict_t *ent);
+// while sv_trackchanges is set, anything that changes an edict the way
+// clipping against it could notice calls this first
+
 qboolean SV_CheckBottom (edict_t *ent);
 qboolean SV_movestep (edict_t *ent, vec3_t move, qboolean relink);
 
@@ -227,6 +233,8 @@ void SV_MoveToGoal (void);
 
 void SV_CheckForNewClients (void);
 void SV_RunClients (void);
+void SV_PollClients (void);
+void SV_AckDeltaFrame (client_t *client, int sequence);
 void SV_SaveSpawnparms ();
 void SV_SpawnServer (const char *server);
 
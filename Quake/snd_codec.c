@@ -279,28 +279,21 @@ int S_CodecReadStream (snd_stream_t *stream, int bytes, void *buffer)
 snd_stream_t *S_CodecUtilOpen(const char *filename, snd_codec_t *codec, qboolean loop)
 {
 	snd_stream_t *stream;
-	FILE *handle;
-	qboolean pak;
-	long length;
-
-	/* Try to open the file */
-	length = (long) COM_FOpenFile(filename, &handle, NULL);
-	pak = file_from_pak;
-	if (length == -1)
+
+	/* Allocate a stream, Z_Malloc zeroes its content */
+	stream = (snd_stream_t *) Z_Malloc(sizeof(snd_stream_t));
+
+	/* Try to open the file: deflated pk3 entries get streamed */
+	if (FS_fopen(filename, &stream->fh, NULL) == -1)
 	{
 		Con_DPrintf("Couldn't open %s\n", filename);
+		Z_Free(stream);
 		return NULL;
 	}
 
-	/* Allocate a stream, Z_Malloc zeroes its content */
-	stream = (snd_stream_t *) Z_Malloc(sizeof(snd_stream_t));
 	stream->codec = codec;
 	stream->loop = loop;
-	stream->fh.file = handle;
-	stream->fh.start = ftell(handle);
-	stream->fh.pos = 0;
-	stream->fh.length = length;
-	stream->fh.pak = stream->pak = pak;
+	stream->pak = stream->fh.pak;
 	q_strlcpy(stream->name, filename, MAX_QPATH);
 
 	return stream;
@@ -308,7 +301,7 @@ snd_stream_t *S_CodecUtilOpen(const char *filename, snd_codec_t *codec, qboolean
 
 void S_CodecUtilClose(snd_stream_t **stream)
 {
-	fclose((*stream)->fh.file);
+	FS_fclose(&(*stream)->fh);
 	Z_Free(*stream);
 	*stream = NULL;
 }
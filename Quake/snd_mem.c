@@ -95,7 +95,7 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 	char	namebuffer[256];
 	byte	*data;
 	wavinfo_t	info;
-	int		len;
+	int		len, mapped;
 	float	stepscale;
 	sfxcache_t	*sc;
 	byte	stackbuf[1*1024];		// avoid dirtying the cache heap
@@ -113,7 +113,10 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 
 //	Con_Printf ("loading %s\n",namebuffer);
 
-	data = COM_LoadStackFile(namebuffer, stackbuf, sizeof(stackbuf), NULL);
+	data = COM_MapFile(namebuffer, NULL);
+	mapped = data ? com_filesize : 0;
+	if (!data)
+		data = COM_LoadStackFile(namebuffer, stackbuf, sizeof(stackbuf), NULL);
 
 	if (!data)
 	{
@@ -125,13 +128,13 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 	if (info.channels != 1)
 	{
 		Con_Printf ("%s is a stereo sample\n",s->name);
-		return NULL;
+		goto done;
 	}
 
 	if (info.width != 1 && info.width != 2)
 	{
 		Con_Printf("%s is not 8 or 16 bit\n", s->name);
-		return NULL;
+		goto done;
 	}
 
 	stepscale = (float)info.rate / shm->speed;
@@ -142,12 +145,12 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 	if (info.samples == 0 || len == 0)
 	{
 		Con_Printf("%s has zero samples\n", s->name);
-		return NULL;
+		goto done;
 	}
 
 	sc = (sfxcache_t *) Cache_Alloc ( &s->cache, len + sizeof(sfxcache_t), s->name);
 	if (!sc)
-		return NULL;
+		goto done;
 
 	sc->length = info.samples;
 	sc->loopstart = info.loopstart;
@@ -157,6 +160,10 @@ sfxcache_t *S_LoadSound (sfx_t *s)
 
 	ResampleSfx (s, sc->speed, sc->width, data + info.dataofs);
 
+done:
+	if (mapped)
+		COM_UnmapFile (data, mapped);
+
 	return sc;
 }
 
@@ -0,0 +1,103 @@
+/*
+ * snd_null.c -- a sound driver that mixes into memory, for headless builds
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+/* nothing plays the buffer back, so the play position is advanced by
+ * client time instead of by a sound card.  a timedemo then mixes the
+ * same amount of sound on every run, however fast the frames go.
+ */
+
+#include "quakedef.h"
+
+static double	nulltime;
+
+qboolean SNDDMA_Init (dma_t *dma)
+{
+	int	tmp, val;
+
+	memset ((void *) dma, 0, sizeof(dma_t));
+	shm = dma;
+
+	shm->samplebits = (loadas8bit.value) ? 8 : 16;
+	shm->signed8 = false;
+	shm->speed = snd_mixspeed.value;
+	shm->channels = 2;
+	tmp = (shm->speed / 40) * shm->channels * 10;	// about 1/4 second
+	val = 1;
+	while (val < tmp)
+		val <<= 1;
+	shm->samples = val;
+	shm->samplepos = 0;
+	shm->submission_chunk = 1;
+
+	shm->buffer = (unsigned char *) calloc (1, shm->samples * (shm->samplebits / 8));
+	if (!shm->buffer)
+	{
+		shm = NULL;
+		Con_Printf ("Failed allocating memory for null audio\n");
+		return false;
+	}
+
+	nulltime = cl.time;
+	Con_Printf ("Null audio: %d Hz, %d samples\n", shm->speed, shm->samples);
+
+	return true;
+}
+
+int SNDDMA_GetDMAPos (void)
+{
+	double	delta = cl.time - nulltime;
+	int		advance;
+
+	nulltime = cl.time;
+	if (delta <= 0 || delta > 1)
+		return shm->samplepos;	// a new map or demo, don't mix a backlog
+
+	advance = (int) (delta * shm->speed) * shm->channels;
+	advance = q_min (advance, shm->samples / 2);
+	shm->samplepos = (shm->samplepos + advance) & (shm->samples - 1);
+
+	return shm->samplepos;
+}
+
+void SNDDMA_Shutdown (void)
+{
+	if (shm)
+	{
+		Con_Printf ("Shutting down null sound\n");
+		free (shm->buffer);
+		shm->buffer = NULL;
+		shm = NULL;
+	}
+}
+
+void SNDDMA_LockBuffer (void)
+{
+}
+
+void SNDDMA_Submit (void)
+{
+}
+
+void SNDDMA_BlockSound (void)
+{
+}
+
+void SNDDMA_UnblockSound (void)
+{
+}
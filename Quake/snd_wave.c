@@ -34,10 +34,10 @@
 FGetLittleLong
 =================
 */
-static int FGetLittleLong (FILE *f, qboolean *ok)
+static int FGetLittleLong (fshandle_t *f, qboolean *ok)
 {
 	int		v;
-	*ok &= fread(&v, sizeof(v), 1, f) == 1;
+	*ok &= FS_fread(&v, sizeof(v), 1, f) == 1;
 	return LittleLong(v);
 }
 
@@ -46,10 +46,10 @@ static int FGetLittleLong (FILE *f, qboolean *ok)
 FGetLittleShort
 =================
 */
-static short FGetLittleShort(FILE *f, qboolean *ok)
+static short FGetLittleShort(fshandle_t *f, qboolean *ok)
 {
 	short	v;
-	*ok &= fread(&v, sizeof(v), 1, f) == 1;
+	*ok &= FS_fread(&v, sizeof(v), 1, f) == 1;
 	return LittleShort(v);
 }
 
@@ -58,14 +58,14 @@ static short FGetLittleShort(FILE *f, qboolean *ok)
 WAV_ReadChunkInfo
 =================
 */
-static int WAV_ReadChunkInfo(FILE *f, char *name)
+static int WAV_ReadChunkInfo(fshandle_t *f, char *name)
 {
 	int len, r;
 	qboolean ok = true;
 
 	name[4] = 0;
 
-	r = fread(name, 1, 4, f);
+	r = FS_fread(name, 1, 4, f);
 	if (r != 4)
 		return -1;
 
@@ -92,7 +92,7 @@ WAV_FindRIFFChunk
 Returns the length of the data in the chunk, or -1 if not found
 =================
 */
-static int WAV_FindRIFFChunk(FILE *f, const char *chunk)
+static int WAV_FindRIFFChunk(fshandle_t *f, const char *chunk)
 {
 	char	name[5];
 	int		len;
@@ -105,7 +105,7 @@ static int WAV_FindRIFFChunk(FILE *f, const char *chunk)
 		len = ((len + 1) & ~1);	/* pad by 2 . */
 
 		/* Not the right chunk - skip it */
-		fseek(f, len, SEEK_CUR);
+		FS_fseek(f, len, SEEK_CUR);
 	}
 
 	return -1;
@@ -116,14 +116,14 @@ static int WAV_FindRIFFChunk(FILE *f, const char *chunk)
 WAV_ReadRIFFHeader
 =================
 */
-static qboolean WAV_ReadRIFFHeader(const char *name, FILE *file, snd_info_t *info)
+static qboolean WAV_ReadRIFFHeader(const char *name, fshandle_t *file, snd_info_t *info)
 {
 	char dump[16];
 	int wav_format;
 	int fmtlen = 0;
 	qboolean ok = true;
 
-	if (fread(dump, 1, 12, file) < 12 ||
+	if (FS_fread(dump, 1, 12, file) < 12 ||
 	    strncmp(dump, "RIFF", 4) != 0 ||
 	    strncmp(&dump[8], "WAVE", 4) != 0)
 	{
@@ -170,7 +170,7 @@ static qboolean WAV_ReadRIFFHeader(const char *name, FILE *file, snd_info_t *inf
 	if (fmtlen > 16)
 	{
 		fmtlen -= 16;
-		fseek(file, fmtlen, SEEK_CUR);
+		FS_fseek(file, fmtlen, SEEK_CUR);
 	}
 
 	/* Scan for the data chunk */
@@ -203,22 +203,25 @@ S_WAV_CodecOpenStream
 */
 static qboolean S_WAV_CodecOpenStream(snd_stream_t *stream)
 {
-	long start = stream->fh.start;
+	long datapos;
 
-	/* Read the RIFF header */
-	/* The file reads are sequential, therefore no need
-	 * for the FS_*() functions: We will manipulate the
-	 * file by ourselves from now on. */
-	if (!WAV_ReadRIFFHeader(stream->name, stream->fh.file, &stream->info))
+	/* Read the RIFF header through the FS_*() functions,
+	 * so that deflated pk3 entries work, too. */
+	if (!WAV_ReadRIFFHeader(stream->name, &stream->fh, &stream->info))
 		return false;
 
-	stream->fh.start = ftell(stream->fh.file); /* reset to data position */
-	if (stream->fh.start - start + stream->info.size > stream->fh.length)
+	datapos = FS_ftell(&stream->fh);
+	if (datapos + stream->info.size > stream->fh.length)
 	{
 		Con_Printf("%s data size mismatch\n", stream->name);
 		return false;
 	}
 
+	/* reset to data position */
+	stream->fh.start += datapos;
+	stream->fh.length = stream->info.size;
+	stream->fh.pos = 0;
+
 	return true;
 }
 
@@ -236,8 +239,7 @@ int S_WAV_CodecReadStream(snd_stream_t *stream, int bytes, void *buffer)
 		return 0;
 	if (bytes > remaining)
 		bytes = remaining;
-	stream->fh.pos += bytes;
-	if (fread(buffer, 1, bytes, stream->fh.file) != bytes)
+	if (FS_fread(buffer, 1, bytes, &stream->fh) != (size_t) bytes)
 		Sys_Error ("S_WAV_CodecReadStream: read error on %d bytes (%s)", bytes, stream->name);
 	if (stream->info.width == 2)
 	{
@@ -30,7 +30,11 @@ static char	localmodels[MAX_MODELS][8];	// inline model names for precache
 
 int		sv_protocol = PROTOCOL_FITZQUAKE; //johnfitz
 
-extern qboolean	pr_alpha_supported; //johnfitz
+cvar_t	sv_deltaents = {"sv_deltaents", "1", CVAR_NONE};	// let clients ask for delta entity frames
+
+static void SV_Snapshotbench_f (void);
+static void SV_DeltaEnts_f (void);
+
 
 //============================================================================
 
@@ -78,6 +82,7 @@ void SV_Init (void)
 	extern	cvar_t	sv_gravity;
 	extern	cvar_t	sv_nostep;
 	extern	cvar_t	sv_freezenonclients;
+	extern	cvar_t	sv_parallelphysics;
 	extern	cvar_t	sv_friction;
 	extern	cvar_t	sv_edgefriction;
 	extern	cvar_t	sv_stopspeed;
@@ -103,9 +108,20 @@ void SV_Init (void)
 	Cvar_RegisterVariable (&sv_aim);
 	Cvar_RegisterVariable (&sv_nostep);
 	Cvar_RegisterVariable (&sv_freezenonclients);
+	Cvar_RegisterVariable (&sv_parallelphysics);
 	Cvar_RegisterVariable (&sv_altnoclip); //johnfitz
+	Cvar_RegisterVariable (&sv_findradiusgrid);
+	Cvar_RegisterVariable (&sv_simdtraces);
+	Cvar_SetCallback (&sv_simdtraces, SV_SIMDTraces_f);
+	SV_SIMDTraces_f (&sv_simdtraces);
+	Cvar_RegisterVariable (&sv_deltaents);
 
 	Cmd_AddCommand ("sv_protocol", &SV_Protocol_f); //johnfitz
+	Cmd_AddCommand ("snapshotbench", &SV_Snapshotbench_f);
+	Cmd_AddCommand ("findradiusbench", &SV_FindRadiusBench_f);
+	Cmd_AddCommand ("tracebench", &SV_TraceBench_f);
+	Cmd_AddCommand ("sv_areastats", &SV_AreaStats_f);
+	Cmd_AddCommand ("deltaents", &SV_DeltaEnts_f);
 
 	for (i=0 ; i<MAX_MODELS ; i++)
 		sprintf (localmodels[i], "*%i", i);
@@ -336,6 +352,7 @@ void SV_SendServerinfo (client_t *client)
 
 	client->sendsignon = true;
 	client->spawned = false;		// need prespawn, spawn, etc
+	client->deltaents = false;		// asked for again on each signon
 }
 
 /*
@@ -460,10 +477,68 @@ crosses a waterline.
 =============================================================================
 */
 
+#define	FATPVS_CACHE		8	// results kept, round robin
+#define	FATPVS_MAXLEAFS		16	// fatter ones aren't cached
+
+typedef struct
+{
+	int		numleafs;
+	mleaf_t	*leafs[FATPVS_MAXLEAFS];
+	byte	*pvs;
+} fatpvscache_t;
+
 static int	fatbytes;
 static byte	*fatpvs;
 static int	fatpvs_capacity;
 
+static mleaf_t	*fatleafs[FATPVS_MAXLEAFS];
+static int	numfatleafs;
+
+static fatpvscache_t	fatpvs_cache[FATPVS_CACHE];
+static qmodel_t	*fatpvs_cachemodel;
+static int	fatpvs_cachebytes;
+static int	fatpvs_cachenext;
+
+/*
+=============
+SV_FindFatLeafs
+
+Collects the leafs within 8 pixels of org; numfatleafs goes past
+FATPVS_MAXLEAFS if there are too many to remember
+=============
+*/
+static void SV_FindFatLeafs (vec3_t org, mnode_t *node)
+{
+	mplane_t	*plane;
+	float	d;
+
+	while (1)
+	{
+		if (node->contents < 0)
+		{
+			if (node->contents != CONTENTS_SOLID)
+			{
+				if (numfatleafs < FATPVS_MAXLEAFS)
+					fatleafs[numfatleafs] = (mleaf_t *)node;
+				numfatleafs++;
+			}
+			return;
+		}
+
+		plane = node->plane;
+		d = DotProduct (org, plane->normal) - plane->dist;
+		if (d > 8)
+			node = node->children[0];
+		else if (d < -8)
+			node = node->children[1];
+		else
+		{	// go down both
+			SV_FindFatLeafs (org, node->children[0]);
+			node = node->children[1];
+		}
+	}
+}
+
 void SV_AddToFatPVS (vec3_t org, mnode_t *node, qmodel_t *worldmodel) //johnfitz -- added worldmodel as a parameter
 {
 	int		i;
@@ -499,17 +574,82 @@ void SV_AddToFatPVS (vec3_t org, mnode_t *node, qmodel_t *worldmodel) //johnfitz
 	}
 }
 
+/*
+=============
+SV_ClearFatPVSCache
+
+The cache only holds the server's world, and is cleared for each map
+=============
+*/
+static void SV_ClearFatPVSCache (void)
+{
+	int		i;
+
+	fatpvs_cachemodel = NULL;
+	fatpvs_cachenext = 0;
+	for (i = 0; i < FATPVS_CACHE; i++)
+		fatpvs_cache[i].numleafs = 0;
+}
+
 /*
 =============
 SV_FatPVS
 
 Calculates a PVS that is the inclusive or of all leafs within 8 pixels of the
-given point.
+given point.  For the server's world the result is remembered by the set of
+leafs it came from, so a client that stays put doesn't decompress and merge
+the same rows every frame.
 =============
 */
 byte *SV_FatPVS (vec3_t org, qmodel_t *worldmodel) //johnfitz -- added worldmodel as a parameter
 {
+	fatpvscache_t	*c;
+	int		i, j;
+	byte	*pvs;
+
 	fatbytes = (worldmodel->numleafs+7)>>3; // ericw -- was +31, assumed to be a bug/typo
+
+	if (sv.active && worldmodel == sv.worldmodel)
+	{
+		if (fatpvs_cachemodel != worldmodel || fatpvs_cachebytes < fatbytes)
+		{
+			for (i = 0; i < FATPVS_CACHE; i++)
+			{
+				fatpvs_cache[i].numleafs = 0;
+				fatpvs_cache[i].pvs = (byte *) realloc (fatpvs_cache[i].pvs, fatbytes);
+				if (!fatpvs_cache[i].pvs)
+					Sys_Error ("SV_FatPVS: realloc() failed on %d bytes", fatbytes);
+			}
+			fatpvs_cachemodel = worldmodel;
+			fatpvs_cachebytes = fatbytes;
+		}
+
+		numfatleafs = 0;
+		SV_FindFatLeafs (org, worldmodel->nodes);
+		if (numfatleafs <= FATPVS_MAXLEAFS)
+		{
+			for (i = 0, c = fatpvs_cache; i < FATPVS_CACHE; i++, c++)
+			{
+				if (c->numleafs == numfatleafs && !memcmp (c->leafs, fatleafs, numfatleafs * sizeof(mleaf_t *)))
+					return c->pvs;
+			}
+
+			c = &fatpvs_cache[fatpvs_cachenext];
+			fatpvs_cachenext = (fatpvs_cachenext + 1) % FATPVS_CACHE;
+			c->numleafs = 0;	// in case Mod_LeafPVS errors out
+			Q_memset (c->pvs, 0, fatbytes);
+			for (i = 0; i < numfatleafs; i++)
+			{
+				pvs = Mod_LeafPVS (fatleafs[i], worldmodel);
+				for (j=0 ; j<fatbytes ; j++)
+					c->pvs[j] |= pvs[j];
+			}
+			c->numleafs = numfatleafs;
+			memcpy (c->leafs, fatleafs, numfatleafs * sizeof(mleaf_t *));
+			return c->pvs;
+		}
+	}
+
 	if (fatpvs == NULL || fatbytes > fatpvs_capacity)
 	{
 		fatpvs_capacity = fatbytes;
@@ -548,34 +688,403 @@ qboolean SV_VisibleToClient (edict_t *client, edict_t *test, qmodel_t *worldmode
 
 //=============================================================================
 
+/*
+==============================================================================
+
+CLIENT SNAPSHOTS
+
+Each spawned client's datagram is built into its own snapshot once physics
+is done for the frame.  Building only reads edict state (apart from the
+client's own damage and fixangle fields), so the snapshots are built on
+the worker threads and then sent in client order from the main thread.
+Everything that may print or raise an error is done before or after.
+
+==============================================================================
+*/
+
+typedef struct
+{
+	client_t	*client;	// NULL to build entity updates only
+	edict_t		*edict;		// the viewpoint
+	sizebuf_t	msg;
+	byte		*pvs;		// private copy of the viewpoint's fat pvs
+	int			pvsbytes;
+	unsigned int	*marks;
+	int			maxmarks;
+	int			*visible;	// entities in view, for delta frames
+	int			maxvisible;
+	qboolean	overflowed;	// ran out of room for entity updates
+	qboolean	nomem;		// couldn't grow a delta frame
+	int			badmodel;	// edict with an invalid model string, or 0
+	byte		buf[MAX_DATAGRAM];
+} snapshot_t;
+
+static snapshot_t	**sv_snapshots;
+static int		sv_maxsnapshots;
+
+/*
+==============================================================================
+
+DELTA ENTITY FRAMES
+
+A client that sends "deltaents" during signon gets its entity updates as
+svc_deltaentities frames.  The last DELTA_BACKUP frames sent to it are
+kept, and each new one is relative to the latest frame the client has
+acknowledged with clc_deltaack instead of the spawn baselines, so an
+entity that hasn't changed since costs nothing.  Without a usable ack the
+frame is relative to the baselines and lists every visible entity.
+"deltaents 0" switches the client back to fast updates, which a client
+that starts recording a demo asks for.
+
+==============================================================================
+*/
+
+#define	DELTA_MAXENTRY	48	// largest entry: number, four bit bytes, float coords
+
+typedef struct
+{
+	int				sequence;	// last frame built
+	int				acked;		// last frame the client has, 0 for none
+	entityframe_t	frames[DELTA_BACKUP];
+} clientdelta_t;
+
+static clientdelta_t	sv_deltas[MAX_SCOREBOARD];
+
+/*
+==================
+SV_DeltaEnts_f
+
+deltaents [0]: sent by the client with prespawn to ask for delta entity
+frames, or with 0 to go back to fast updates
+==================
+*/
+static void SV_DeltaEnts_f (void)
+{
+	clientdelta_t	*cd;
+	int				i;
+
+	if (cmd_source == src_command)
+	{
+		Con_Printf ("deltaents is not valid from the console\n");
+		return;
+	}
+
+	if (Cmd_Argc () > 1 && !atoi (Cmd_Argv (1)))
+	{
+		host_client->deltaents = false;
+		return;
+	}
+
+	if (!sv_deltaents.value || sv.protocol == PROTOCOL_NETQUAKE)
+		return;		// the client keeps getting fast updates
+
+	cd = &sv_deltas[host_client - svs.clients];
+	cd->sequence = 0;
+	cd->acked = 0;
+	for (i = 0; i < DELTA_BACKUP; i++)
+		cd->frames[i].sequence = 0;
+	host_client->deltaents = true;
+}
+
+/*
+==================
+SV_AckDeltaFrame
+
+clc_deltaack: the client has entity frame 'sequence', or wants a full one
+==================
+*/
+void SV_AckDeltaFrame (client_t *client, int sequence)
+{
+	clientdelta_t	*cd;
+
+	if (!client->deltaents)
+		return;
+
+	cd = &sv_deltas[client - svs.clients];
+	if (sequence == 0 || (sequence > cd->acked && sequence <= cd->sequence))
+		cd->acked = sequence;
+}
+
+/*
+==================
+SV_GrowEntityFrame
+
+Runs on the workers, so failure is reported through the snapshot
+==================
+*/
+static qboolean SV_GrowEntityFrame (entityframe_t *frame, int count)
+{
+	void	*p;
+
+	if (count <= frame->maxents)
+		return true;
+	count = q_max (count, frame->maxents * 2);
+
+	if (!(p = realloc (frame->nums, count * sizeof(*frame->nums))))
+		return false;
+	frame->nums = (int *) p;
+	if (!(p = realloc (frame->flags, count * sizeof(*frame->flags))))
+		return false;
+	frame->flags = (byte *) p;
+	if (!(p = realloc (frame->states, count * sizeof(*frame->states))))
+		return false;
+	frame->states = (entity_state_t *) p;
+
+	frame->maxents = count;
+	return true;
+}
+
+/*
+==================
+SV_WriteDeltaEntities
+
+Writes the svc_deltaentities frame for the entities in snap->visible and
+records what the client will hold once it arrives
+==================
+*/
+static void SV_WriteDeltaEntities (snapshot_t *snap, int numvisible)
+{
+	clientdelta_t	*cd;
+	entityframe_t	*base, *to;
+	entity_state_t	state, *from;
+	sizebuf_t		*msg;
+	edict_t			*ent;
+	int				i, j, e, be, n, sequence;
+	int				bits, changed, step, fromflags;
+	qboolean		full;
+
+	msg = &snap->msg;
+	cd = &sv_deltas[snap->client - svs.clients];
+	sequence = cd->sequence + 1;
+
+	base = NULL;
+	if (cd->acked && sequence - cd->acked < DELTA_BACKUP)
+	{
+		base = &cd->frames[cd->acked & DELTA_MASK];
+		if (base->sequence != cd->acked)
+			base = NULL;
+	}
+
+	to = &cd->frames[sequence & DELTA_MASK];
+	to->sequence = 0;
+	if (!SV_GrowEntityFrame (to, numvisible + (base ? base->numents : 0)))
+	{
+		snap->nomem = true;
+		return;
+	}
+
+	if (msg->cursize + 11 > msg->maxsize)
+	{
+		snap->overflowed = true;
+		return;
+	}
+	MSG_WriteByte (msg, svc_deltaentities);
+	MSG_WriteLong (msg, sequence);
+	MSG_WriteLong (msg, base ? base->sequence : 0);
+
+// merge the visible entities with the ones in the base frame; both are
+// sorted.  once the datagram is full, the client keeps what it had
+	full = false;
+	n = 0;
+	for (i = j = 0; i < numvisible || (base && j < base->numents); )
+	{
+		e = (i < numvisible) ? snap->visible[i] : MAX_EDICTS;
+		be = (base && j < base->numents) ? base->nums[j] : MAX_EDICTS;
+
+		if (be < e)
+		{	// left the view
+			if (!full && msg->cursize + 2 + 2 <= msg->maxsize)
+				MSG_WriteShort (msg, be | DE_REMOVE);
+			else
+			{
+				full = true;
+				to->nums[n] = be;
+				to->flags[n] = base->flags[j];
+				to->states[n] = base->states[j];
+				n++;
+			}
+			j++;
+			continue;
+		}
+
+		ent = EDICT_NUM(e);
+		if (be == e)
+		{
+			from = &base->states[j];
+			fromflags = base->flags[j];
+			j++;
+		}
+		else
+		{
+			from = &ent->baseline;
+			fromflags = -1;		// not known to the client, always sent
+		}
+		i++;
+
+		VectorCopy (ent->v.origin, state.origin);
+		VectorCopy (ent->v.angles, state.angles);
+		state.modelindex = ent->v.modelindex;
+		state.frame = ent->v.frame;
+		state.colormap = ent->v.colormap;
+		state.skin = ent->v.skin;
+		state.alpha = ent->alpha;
+		state.effects = ent->v.effects;
+
+		changed = MSG_EntityDeltaBits (from, &state);
+		step = (ent->v.movetype == MOVETYPE_STEP) ? U_STEP : 0;
+
+		if (!changed && step == fromflags)
+		{	// unchanged, nothing to send
+			to->nums[n] = e;
+			to->flags[n] = fromflags;
+			to->states[n] = *from;
+			n++;
+			continue;
+		}
+
+		if (full || msg->cursize + DELTA_MAXENTRY + 2 > msg->maxsize)
+		{
+			full = true;
+			snap->overflowed = true;
+			if (fromflags != -1)
+			{
+				to->nums[n] = e;
+				to->flags[n] = fromflags;
+				to->states[n] = *from;
+				n++;
+			}
+			continue;
+		}
+
+		bits = changed | step;
+		if (ent->sendinterval)
+			bits |= U_LERPFINISH;
+		if (bits >= 65536)
+			bits |= U_EXTEND1;
+		if (bits >= 16777216)
+			bits |= U_EXTEND2;
+		if (bits >= 256)
+			bits |= U_MOREBITS;
+
+	//
+	// write the entry
+	//
+		MSG_WriteShort (msg, e);
+		MSG_WriteByte (msg, bits & 255);
+		if (bits & U_MOREBITS)
+			MSG_WriteByte (msg, bits>>8);
+		if (bits & U_EXTEND1)
+			MSG_WriteByte (msg, bits>>16);
+		if (bits & U_EXTEND2)
+			MSG_WriteByte (msg, bits>>24);
+
+		if (bits & U_MODEL)
+			MSG_WriteByte (msg, state.modelindex);
+		if (bits & U_FRAME)
+			MSG_WriteByte (msg, state.frame);
+		if (bits & U_COLORMAP)
+			MSG_WriteByte (msg, state.colormap);
+		if (bits & U_SKIN)
+			MSG_WriteByte (msg, state.skin);
+		if (bits & U_EFFECTS)
+			MSG_WriteByte (msg, state.effects);
+		if (bits & U_ORIGIN1)
+			MSG_WriteCoord (msg, state.origin[0], sv.protocolflags);
+		if (bits & U_ANGLE1)
+			MSG_WriteAngle (msg, state.angles[0], sv.protocolflags);
+		if (bits & U_ORIGIN2)
+			MSG_WriteCoord (msg, state.origin[1], sv.protocolflags);
+		if (bits & U_ANGLE2)
+			MSG_WriteAngle (msg, state.angles[1], sv.protocolflags);
+		if (bits & U_ORIGIN3)
+			MSG_WriteCoord (msg, state.origin[2], sv.protocolflags);
+		if (bits & U_ANGLE3)
+			MSG_WriteAngle (msg, state.angles[2], sv.protocolflags);
+		if (bits & U_ALPHA)
+			MSG_WriteByte (msg, state.alpha);
+		if (bits & U_FRAME2)
+			MSG_WriteByte (msg, state.frame >> 8);
+		if (bits & U_MODEL2)
+			MSG_WriteByte (msg, state.modelindex >> 8);
+		if (bits & U_LERPFINISH)
+			MSG_WriteByte (msg, (byte)(Q_rint((ent->v.nextthink-sv.time)*255)));
+
+	// origins within the epsilon weren't sent, the client keeps the old ones
+		for (bits = 0; bits < 3; bits++)
+		{
+			if (!(changed & (U_ORIGIN1<<bits)))
+				state.origin[bits] = from->origin[bits];
+		}
+		to->nums[n] = e;
+		to->flags[n] = step;
+		to->states[n] = state;
+		n++;
+	}
+
+	MSG_WriteShort (msg, 0);
+
+	to->numents = n;
+	to->sequence = sequence;
+	cd->sequence = sequence;
+}
+
 /*
 =============
 SV_WriteEntitiesToClient
 
 =============
 */
-void SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg)
+static void SV_WriteEntitiesToClient (snapshot_t *snap)
 {
 	int		e, i;
-	int		bits;
+	int		bits, numvisible;
+	qboolean	delta;
 	byte	*pvs;
-	vec3_t	org;
 	float	miss;
 	edict_t	*ent;
-
-// find the client's PVS
-	VectorAdd (clent->v.origin, clent->v.view_ofs, org);
-	pvs = SV_FatPVS (org, sv.worldmodel);
+	edict_t	*clent;
+	sizebuf_t	*msg;
+	unsigned int	*marks;
+	const char	*model;
+
+	clent = snap->edict;
+	msg = &snap->msg;
+	pvs = snap->pvs;
+	delta = snap->client && snap->client->deltaents;
+	numvisible = 0;
+
+// mark the entities recorded in the visible leafs.  this is only a coarse
+// filter, the leafnums are still checked below
+	marks = snap->marks;
+	memset (marks, 0, ((sv.max_edicts + 31) >> 5) * sizeof(*marks));
+	SV_MarkPVSEdicts (pvs, marks);
+	e = NUM_FOR_EDICT(clent);
+	marks[e >> 5] |= 1u << (e & 31);
 
 // send over all entities (excpet the client) that touch the pvs
-	ent = NEXT_EDICT(sv.edicts);
-	for (e=1 ; e<sv.num_edicts ; e++, ent = NEXT_EDICT(ent))
+	for (e=1 ; e<sv.num_edicts ; e++)
 	{
+		if (!marks[e >> 5])
+		{
+			e |= 31;	// skip the rest of this word
+			continue;
+		}
+		if (!(marks[e >> 5] & (1u << (e & 31))))
+			continue;
+		ent = EDICT_NUM(e);
 
 		if (ent != clent)	// clent is ALLWAYS sent
 		{
 			// ignore ents without visible models
-			if (!ent->v.modelindex || !PR_GetString(ent->v.model)[0])
+			if (!ent->v.modelindex)
+				continue;
+			model = PR_GetStringQuiet (ent->v.model);
+			if (!model)
+			{	// let the main thread raise the error
+				snap->badmodel = e;
+				return;
+			}
+			if (!model[0])
 				continue;
 
 			//johnfitz -- don't send model>255 entities if protocol is 15
@@ -597,18 +1106,24 @@ void SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg)
 				continue;		// not visible
 		}
 
+		//johnfitz -- alpha (ent->alpha was refreshed by SV_PrepareSnapshots)
+		//don't send invisible entities unless they have effects
+		if (ent->alpha == ENTALPHA_ZERO && !ent->v.effects)
+			continue;
+		//johnfitz
+
+		if (delta)
+		{	// written against the acked frame below
+			snap->visible[numvisible++] = e;
+			continue;
+		}
+
 		//johnfitz -- max size for protocol 15 is 18 bytes, not 16 as originally
 		//assumed here.  And, for protocol 85 the max size is actually 24 bytes.
 		if (msg->cursize + 24 > msg->maxsize)
 		{
-			//johnfitz -- less spammy overflow message
-			if (!dev_overflows.packetsize || dev_overflows.packetsize + CONSOLE_RESPAM_TIME < realtime )
-			{
-				Con_Printf ("Packet overflow!\n");
-				dev_overflows.packetsize = realtime;
-			}
-			goto stats;
-			//johnfitz
+			snap->overflowed = true;
+			return;
 		}
 
 // send an update
@@ -648,21 +1163,6 @@ void SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg)
 		if (ent->baseline.modelindex != ent->v.modelindex)
 			bits |= U_MODEL;
 
-		//johnfitz -- alpha
-		if (pr_alpha_supported)
-		{
-			// TODO: find a cleaner place to put this code
-			eval_t	*val;
-			val = GetEdictFieldValue(ent, "alpha");
-			if (val)
-				ent->alpha = ENTALPHA_ENCODE(val->_float);
-		}
-
-		//don't send invisible entities unless they have effects
-		if (ent->alpha == ENTALPHA_ZERO && !ent->v.effects)
-			continue;
-		//johnfitz
-
 		//johnfitz -- PROTOCOL_FITZQUAKE
 		if (sv.protocol != PROTOCOL_NETQUAKE)
 		{
@@ -737,13 +1237,8 @@ void SV_WriteEntitiesToClient (edict_t	*clent, sizebuf_t *msg)
 		//johnfitz
 	}
 
-	//johnfitz -- devstats
-stats:
-	if (msg->cursize > 1024 && dev_peakstats.packetsize <= 1024)
-		Con_DWarning ("%i byte packet exceeds standard limit of 1024 (max = %d).\n", msg->cursize, msg->maxsize);
-	dev_stats.packetsize = msg->cursize;
-	dev_peakstats.packetsize = q_max(msg->cursize, dev_peakstats.packetsize);
-	//johnfitz
+	if (delta)
+		SV_WriteDeltaEntities (snap, numvisible);
 }
 
 /*
@@ -796,9 +1291,8 @@ void SV_WriteClientdataToMessage (edict_t *ent, sizebuf_t *msg)
 
 //
 // send the current viewpos offset from the view entity
+// (SV_PrepareSnapshots has already set the ideal pitch)
 //
-	SV_SetIdealPitch ();		// how much to look up / down ideally
-
 // a fixangle might get lost in a dropped packet.  Oh well.
 	if ( ent->v.fixangle )
 	{
@@ -818,7 +1312,7 @@ void SV_WriteClientdataToMessage (edict_t *ent, sizebuf_t *msg)
 
 // stuff the sigil bits into the high bits of items for sbar, or else
 // mix in items2
-	val = GetEdictFieldValue(ent, "items2");
+	val = GetEdictFieldEval(ent, items2);
 
 	if (val)
 		items = (int)ent->v.items | ((int)val->_float << 23);
@@ -948,37 +1442,215 @@ void SV_WriteClientdataToMessage (edict_t *ent, sizebuf_t *msg)
 
 /*
 =======================
-SV_SendClientDatagram
+SV_AllocSnapshot
+
+Returns snapshot slot n, set up to build a datagram seen from ent
 =======================
 */
-qboolean SV_SendClientDatagram (client_t *client)
+static snapshot_t *SV_AllocSnapshot (int n, client_t *client, edict_t *ent)
 {
-	byte		buf[MAX_DATAGRAM];
-	sizebuf_t	msg;
+	snapshot_t	*snap;
+	vec3_t		org;
+	byte		*pvs;
+	int			pvsbytes, nummarks;
 
-	msg.data = buf;
-	msg.maxsize = sizeof(buf);
-	msg.cursize = 0;
+	if (n >= sv_maxsnapshots)
+	{
+		sv_snapshots = (snapshot_t **) realloc (sv_snapshots, (n + 1) * sizeof(*sv_snapshots));
+		if (!sv_snapshots)
+			Sys_Error ("SV_AllocSnapshot: realloc() failed on %d snapshots", n + 1);
+		while (sv_maxsnapshots <= n)
+			sv_snapshots[sv_maxsnapshots++] = NULL;
+	}
+	snap = sv_snapshots[n];
+	if (!snap)
+	{
+		snap = (snapshot_t *) calloc (1, sizeof(*snap));
+		if (!snap)
+			Sys_Error ("SV_AllocSnapshot: calloc() failed on %d bytes", (int)sizeof(*snap));
+		sv_snapshots[n] = snap;
+	}
 
-	//johnfitz -- if client is nonlocal, use smaller max size so packets aren't fragmented
-	if (Q_strcmp(NET_QSocketGetAddressString(client->netconnection), "LOCAL") != 0)
-		msg.maxsize = DATAGRAM_MTU;
-	//johnfitz
+	snap->client = client;
+	snap->edict = ent;
+	snap->overflowed = false;
+	snap->nomem = false;
+	snap->badmodel = 0;
 
-	MSG_WriteByte (&msg, svc_time);
-	MSG_WriteFloat (&msg, sv.time);
+	snap->msg.data = snap->buf;
+	snap->msg.maxsize = sizeof(snap->buf);
+	snap->msg.cursize = 0;
+	snap->msg.allowoverflow = false;
+	snap->msg.overflowed = false;
 
-// add the client specific data to the datagram
-	SV_WriteClientdataToMessage (client->edict, &msg);
+// the fat pvs is shared and cached, so each snapshot gets its own copy
+	VectorAdd (ent->v.origin, ent->v.view_ofs, org);
+	pvs = SV_FatPVS (org, sv.worldmodel);
+	pvsbytes = (sv.worldmodel->numleafs + 7) >> 3;
+	if (pvsbytes > snap->pvsbytes)
+	{
+		snap->pvsbytes = pvsbytes;
+		snap->pvs = (byte *) realloc (snap->pvs, pvsbytes);
+		if (!snap->pvs)
+			Sys_Error ("SV_AllocSnapshot: realloc() failed on %d bytes", pvsbytes);
+	}
+	memcpy (snap->pvs, pvs, pvsbytes);
+
+	nummarks = (sv.max_edicts + 31) >> 5;
+	if (nummarks > snap->maxmarks)
+	{
+		snap->maxmarks = nummarks;
+		snap->marks = (unsigned int *) realloc (snap->marks, nummarks * sizeof(*snap->marks));
+		if (!snap->marks)
+			Sys_Error ("SV_AllocSnapshot: realloc() failed on %d marks", nummarks);
+	}
 
-	SV_WriteEntitiesToClient (client->edict, &msg);
+	if (client && client->deltaents && sv.max_edicts > snap->maxvisible)
+	{
+		snap->maxvisible = sv.max_edicts;
+		snap->visible = (int *) realloc (snap->visible, snap->maxvisible * sizeof(*snap->visible));
+		if (!snap->visible)
+			Sys_Error ("SV_AllocSnapshot: realloc() failed on %d entities", snap->maxvisible);
+	}
+
+	return snap;
+}
+
+/*
+=======================
+SV_RefreshAlpha
+
+johnfitz -- alpha.  Done up front so the workers only read ent->alpha
+=======================
+*/
+static void SV_RefreshAlpha (void)
+{
+	int		e;
+	edict_t	*ent;
+
+	if (pr_extfields.alpha < 0)
+		return;
+
+	for (e = 1, ent = NEXT_EDICT(sv.edicts); e < sv.num_edicts; e++, ent = NEXT_EDICT(ent))
+		ent->alpha = ENTALPHA_ENCODE(E_FLOAT(ent, pr_extfields.alpha));
+}
+
+/*
+=======================
+SV_PrepareSnapshots
+
+Sets up a snapshot for every spawned client and returns how many there are
+=======================
+*/
+static int SV_PrepareSnapshots (void)
+{
+	int			i, count;
+	client_t	*client;
+	snapshot_t	*snap;
+
+	count = 0;
+	for (i = 0, client = svs.clients; i < svs.maxclients; i++, client++)
+	{
+		if (!client->active || !client->spawned)
+			continue;
+
+		if (!count)
+		{
+			SV_SetIdealPitch ();	// how much to look up / down ideally
+			SV_RefreshAlpha ();
+		}
+
+		// errors out here rather than on a worker
+		SV_ModelIndex (PR_GetString(client->edict->v.weaponmodel));
+
+		snap = SV_AllocSnapshot (count++, client, client->edict);
+
+		//johnfitz -- if client is nonlocal, use smaller max size so packets aren't fragmented
+		if (Q_strcmp(NET_QSocketGetAddressString(client->netconnection), "LOCAL") != 0)
+			snap->msg.maxsize = DATAGRAM_MTU;
+		//johnfitz
+
+		MSG_WriteByte (&snap->msg, svc_time);
+		MSG_WriteFloat (&snap->msg, sv.time);
+	}
+
+	return count;
+}
+
+/*
+=======================
+SV_BuildSnapshotsTask
+=======================
+*/
+static void SV_BuildSnapshotsTask (void *data, int first, int last)
+{
+	snapshot_t	**snaps = (snapshot_t **) data;
+	snapshot_t	*snap;
+	int			i;
+
+	for (i = first; i < last; i++)
+	{
+		snap = snaps[i];
+
+	// add the client specific data to the datagram
+		if (snap->client)
+			SV_WriteClientdataToMessage (snap->edict, &snap->msg);
+
+		SV_WriteEntitiesToClient (snap);
+	}
+}
+
+/*
+=======================
+SV_FinishSnapshot
+
+Reports what the workers couldn't for one snapshot
+=======================
+*/
+static void SV_FinishSnapshot (snapshot_t *snap)
+{
+	sizebuf_t	*msg = &snap->msg;
+
+	if (snap->badmodel)
+		PR_GetString (EDICT_NUM(snap->badmodel)->v.model);	// raises the error
+
+	if (snap->nomem)
+		Sys_Error ("SV_FinishSnapshot: out of memory for delta entity frames");
+
+	//johnfitz -- less spammy overflow message
+	if (snap->overflowed)
+	{
+		if (!dev_overflows.packetsize || dev_overflows.packetsize + CONSOLE_RESPAM_TIME < realtime )
+		{
+			Con_Printf ("Packet overflow!\n");
+			dev_overflows.packetsize = realtime;
+		}
+	}
+	//johnfitz
+
+	//johnfitz -- devstats
+	if (msg->cursize > 1024 && dev_peakstats.packetsize <= 1024)
+		Con_DWarning ("%i byte packet exceeds standard limit of 1024 (max = %d).\n", msg->cursize, msg->maxsize);
+	dev_stats.packetsize = msg->cursize;
+	dev_peakstats.packetsize = q_max(msg->cursize, dev_peakstats.packetsize);
+	//johnfitz
+}
+
+/*
+=======================
+SV_SendClientDatagram
+=======================
+*/
+static qboolean SV_SendClientDatagram (snapshot_t *snap)
+{
+	sizebuf_t	*msg = &snap->msg;
 
 // copy the server datagram if there is space
-	if (msg.cursize + sv.datagram.cursize < msg.maxsize)
-		SZ_Write (&msg, sv.datagram.data, sv.datagram.cursize);
+	if (msg->cursize + sv.datagram.cursize < msg->maxsize)
+		SZ_Write (msg, sv.datagram.data, sv.datagram.cursize);
 
 // send the datagram
-	if (NET_SendUnreliableMessage (client->netconnection, &msg) == -1)
+	if (NET_SendUnreliableMessage (snap->client->netconnection, msg) == -1)
 	{
 		SV_DropClient (true);// if the message couldn't send, kick off
 		return false;
@@ -987,6 +1659,92 @@ qboolean SV_SendClientDatagram (client_t *client)
 	return true;
 }
 
+/*
+=======================
+SV_Snapshotbench_f
+
+snapshotbench [viewpoints] [frames]: times building entity updates for the
+current frame from that many viewpoints, on the main thread alone and then
+spread over the workers.  The viewpoints are the spawned clients followed by
+any other edicts with a model, standing in for extra clients.
+=======================
+*/
+static void SV_Snapshotbench_f (void)
+{
+	int			i, e, n, count, frames, bytes;
+	double		start, serial, parallel;
+	edict_t		*ent;
+	client_t	*client;
+	snapshot_t	*snap;
+
+	if (!sv.active)
+	{
+		Con_Printf ("Not running a server\n");
+		return;
+	}
+
+	count = (Cmd_Argc() > 1) ? atoi (Cmd_Argv(1)) : 16;
+	frames = (Cmd_Argc() > 2) ? atoi (Cmd_Argv(2)) : 100;
+	count = q_max (count, 1);
+	frames = q_max (frames, 1);
+
+	SV_RefreshAlpha ();
+
+	n = 0;
+	for (i = 0, client = svs.clients; i < svs.maxclients && n < count; i++, client++)
+	{
+		if (client->active && client->spawned)
+			SV_AllocSnapshot (n++, NULL, client->edict);
+	}
+	for (e = svs.maxclients + 1; e < sv.num_edicts && n < count; e++)
+	{
+		ent = EDICT_NUM(e);
+		if (!ent->free && ent->v.modelindex)
+			SV_AllocSnapshot (n++, NULL, ent);
+	}
+	if (!n)
+	{
+		Con_Printf ("No viewpoints\n");
+		return;
+	}
+
+	start = Sys_DoubleTime ();
+	for (i = 0; i < frames; i++)
+	{
+		for (e = 0; e < n; e++)
+			sv_snapshots[e]->msg.cursize = 0;
+		SV_BuildSnapshotsTask (sv_snapshots, 0, n);
+	}
+	serial = Sys_DoubleTime () - start;
+
+	bytes = 0;
+	for (e = 0; e < n; e++)
+		bytes += sv_snapshots[e]->msg.cursize;
+
+	start = Sys_DoubleTime ();
+	for (i = 0; i < frames; i++)
+	{
+		for (e = 0; e < n; e++)
+			sv_snapshots[e]->msg.cursize = 0;
+		Tasks_Run (SV_BuildSnapshotsTask, sv_snapshots, n, 1);
+		Tasks_Wait ();
+	}
+	parallel = Sys_DoubleTime () - start;
+
+	for (e = 0; e < n; e++)
+	{
+		snap = sv_snapshots[e];
+		if (snap->badmodel)
+			PR_GetString (EDICT_NUM(snap->badmodel)->v.model);
+	}
+
+	Con_Printf ("%d viewpoints, %d frames, %d bytes per frame\n", n, frames, bytes);
+	Con_Printf ("1 thread:  %7.3f ms per frame, %8.0f snapshots/s\n",
+		serial * 1000.0 / frames, n * frames / q_max(serial, 1e-9));
+	Con_Printf ("%d threads: %7.3f ms per frame, %8.0f snapshots/s (%.2fx)\n", Tasks_NumThreads (),
+		parallel * 1000.0 / frames, n * frames / q_max(parallel, 1e-9), serial / q_max(parallel, 1e-9));
+}
+
 /*
 =======================
 SV_UpdateToReliableMessages
@@ -1057,12 +1815,24 @@ SV_SendClientMessages
 */
 void SV_SendClientMessages (void)
 {
-	int			i;
+	int			i, count, snap;
 
 // update frags, names, etc
 	SV_UpdateToReliableMessages ();
 
 // build individual updates
+	count = SV_PrepareSnapshots ();
+	if (count)
+	{
+		Tasks_Run (SV_BuildSnapshotsTask, sv_snapshots, count, 1);
+		Tasks_Wait ();
+	}
+
+	for (i = 0; i < count; i++)
+		SV_FinishSnapshot (sv_snapshots[i]);
+
+// send them, along with the reliable messages
+	snap = 0;
 	for (i=0, host_client = svs.clients ; i<svs.maxclients ; i++, host_client++)
 	{
 		if (!host_client->active)
@@ -1070,7 +1840,10 @@ void SV_SendClientMessages (void)
 
 		if (host_client->spawned)
 		{
-			if (!SV_SendClientDatagram (host_client))
+			// skip the snapshots of clients dropped by earlier sends
+			while (snap < count && sv_snapshots[snap]->client < host_client)
+				snap++;
+			if (snap < count && !SV_SendClientDatagram (sv_snapshots[snap++]))
 				continue;
 		}
 		else
@@ -1424,6 +2197,8 @@ void SV_SpawnServer (const char *server)
 // clear world interaction links
 //
 	SV_ClearWorld ();
+	SV_ClearFatPVSCache ();
+	sv_trackchanges = false;	// in case an error cut the last frame short
 
 	sv.sound_precache[0] = dummy;
 	sv.model_precache[0] = dummy;
@@ -38,9 +38,9 @@ int c_yes, c_no;
 
 qboolean SV_CheckBottom (edict_t *ent)
 {
-	vec3_t	mins, maxs, start, stop;
-	trace_t	trace;
-	int		x, y;
+	vec3_t	mins, maxs, start[5], stop[5];
+	trace_t	traces[5], *trace;
+	int		x, y, i;
 	float	mid, bottom;
 
 	VectorAdd (ent->v.origin, ent->v.mins, mins);
@@ -49,13 +49,13 @@ qboolean SV_CheckBottom (edict_t *ent)
 // if all of the points under the corners are solid world, don't bother
 // with the tougher checks
 // the corners must be within 16 of the midpoint
-	start[2] = mins[2] - 1;
+	start[0][2] = mins[2] - 1;
 	for	(x=0 ; x<=1 ; x++)
 		for	(y=0 ; y<=1 ; y++)
 		{
-			start[0] = x ? maxs[0] : mins[0];
-			start[1] = y ? maxs[1] : mins[1];
-			if (SV_PointContents (start) != CONTENTS_SOLID)
+			start[0][0] = x ? maxs[0] : mins[0];
+			start[0][1] = y ? maxs[1] : mins[1];
+			if (SV_PointContents (start[0]) != CONTENTS_SOLID)
 				goto realcheck;
 		}
 
@@ -67,32 +67,38 @@ realcheck:
 //
 // check it for real...
 //
-	start[2] = mins[2];
+// the midpoint and the four corners are traced together, then looked at
+// in the same order as before
+	start[0][0] = stop[0][0] = (mins[0] + maxs[0])*0.5;
+	start[0][1] = stop[0][1] = (mins[1] + maxs[1])*0.5;
+	i = 1;
+	for	(x=0 ; x<=1 ; x++)
+		for	(y=0 ; y<=1 ; y++, i++)
+		{
+			start[i][0] = stop[i][0] = x ? maxs[0] : mins[0];
+			start[i][1] = stop[i][1] = y ? maxs[1] : mins[1];
+		}
+	for (i = 0; i < 5; i++)
+	{
+		start[i][2] = mins[2];
+		stop[i][2] = start[i][2] - 2*STEPSIZE;
+	}
+	SV_MoveBatch (5, start, vec3_origin, vec3_origin, stop, true, ent, traces);
 
 // the midpoint must be within 16 of the bottom
-	start[0] = stop[0] = (mins[0] + maxs[0])*0.5;
-	start[1] = stop[1] = (mins[1] + maxs[1])*0.5;
-	stop[2] = start[2] - 2*STEPSIZE;
-	trace = SV_Move (start, vec3_origin, vec3_origin, stop, true, ent);
-
-	if (trace.fraction == 1.0)
+	if (traces[0].fraction == 1.0)
 		return false;
-	mid = bottom = trace.endpos[2];
+	mid = bottom = traces[0].endpos[2];
 
 // the corners must be within 16 of the midpoint
-	for	(x=0 ; x<=1 ; x++)
-		for	(y=0 ; y<=1 ; y++)
-		{
-			start[0] = stop[0] = x ? maxs[0] : mins[0];
-			start[1] = stop[1] = y ? maxs[1] : mins[1];
-
-			trace = SV_Move (start, vec3_origin, vec3_origin, stop, true, ent);
-
-			if (trace.fraction != 1.0 && trace.endpos[2] > bottom)
-				bottom = trace.endpos[2];
-			if (trace.fraction == 1.0 || mid - trace.endpos[2] > STEPSIZE)
-				return false;
-		}
+	for (i = 1; i < 5; i++)
+	{
+		trace = &traces[i];
+		if (trace->fraction != 1.0 && trace->endpos[2] > bottom)
+			bottom = trace->endpos[2];
+		if (trace->fraction == 1.0 || mid - trace->endpos[2] > STEPSIZE)
+			return false;
+	}
 
 	c_yes++;
 	return true;
@@ -386,18 +386,310 @@ SV_AddGravity
 void SV_AddGravity (edict_t *ent)
 {
 	float	ent_gravity;
-	eval_t	*val;
 
-	val = GetEdictFieldValue(ent, "gravity");
-	if (val && val->_float)
-		ent_gravity = val->_float;
-	else
+	ent_gravity = GetEdictFieldFloat(ent, gravity, 0.f);
+	if (!ent_gravity)
 		ent_gravity = 1.0;
 
 	ent->v.velocity[2] -= ent_gravity * sv_gravity.value * host_frametime;
 }
 
 
+/*
+===============================================================================
+
+PARALLEL TOSS MOVES
+
+With sv_parallelphysics on, the moves of toss, bounce and missile edicts
+that won't think this frame are traced on the task threads before the
+edicts are run.  The frame is still run in order on the main thread, and
+SV_PushEntity takes the move traced ahead only when nothing it depends on
+has changed since: the moving edict must be about to make exactly the
+same move, and no edict whose box was or is in the area the move looked
+at may have been written to, relinked or shuffled in the area tree.
+Otherwise the move is traced again, so the results are the same as with
+sv_parallelphysics 0.  sv_parallelphysics 2 checks every move taken
+against SV_Move as well.
+
+===============================================================================
+*/
+
+cvar_t	sv_parallelphysics = {"sv_parallelphysics", "0", CVAR_NONE};
+
+#define	MIN_TOSSMOVES	16		// not worth waking the workers for fewer
+#define	MAX_CHANGED		1024	// give up on the rest of the frame after this many
+
+typedef struct
+{
+	int			ent;
+	qboolean	traced;			// SV_MoveOnTask managed it
+	vec3_t		start, end, mins, maxs;
+	int			type;
+	int			owner;
+	float		size;
+	vec3_t		boxmins, boxmaxs;	// area the move looked at
+	trace_t		trace;
+} tossmove_t;
+
+typedef struct
+{
+	int			ent;
+	vec3_t		absmin, absmax;	// from before it changed
+} changed_t;
+
+qboolean		sv_trackchanges;
+
+static tossmove_t	*sv_tossmoves;
+static int			sv_numtossmoves;
+static int			*sv_tossmovenums;	// per edict, -1 if nothing was traced
+static byte			*sv_changedents;	// per edict
+static int			sv_maxedicts;
+static changed_t	sv_changed[MAX_CHANGED];
+static int			sv_numchanged;
+static int			sv_tossstats[3];	// traced ahead, taken, wrong
+
+/*
+================
+SV_PushMoveType
+
+The kind of move SV_PushEntity makes for ent
+================
+*/
+static int SV_PushMoveType (edict_t *ent)
+{
+	if (ent->v.movetype == MOVETYPE_FLYMISSILE)
+		return MOVE_MISSILE;
+	if (ent->v.solid == SOLID_TRIGGER || ent->v.solid == SOLID_NOT)
+		return MOVE_NOMONSTERS;	// only clip against bmodels
+	return MOVE_NORMAL;
+}
+
+/*
+================
+SV_EdictChanged
+
+Remembers where ent was before it was first changed this frame
+================
+*/
+void SV_EdictChanged (edict_t *ent)
+{
+	changed_t	*c;
+	int			e;
+
+	e = NUM_FOR_EDICT(ent);
+	if (sv_changedents[e])
+		return;
+	sv_changedents[e] = true;
+
+	if (sv_numchanged == MAX_CHANGED)
+	{	// too busy a frame to be worth checking
+		sv_trackchanges = false;
+		return;
+	}
+
+	c = &sv_changed[sv_numchanged++];
+	c->ent = e;
+	VectorCopy (ent->v.absmin, c->absmin);
+	VectorCopy (ent->v.absmax, c->absmax);
+}
+
+static qboolean SV_BoxesOverlap (vec3_t mins1, vec3_t maxs1, vec3_t mins2, vec3_t maxs2)
+{
+	return !(mins1[0] > maxs2[0] || mins1[1] > maxs2[1] || mins1[2] > maxs2[2]
+		|| maxs1[0] < mins2[0] || maxs1[1] < mins2[1] || maxs1[2] < mins2[2]);
+}
+
+/*
+================
+SV_TossMovesTask
+
+Does the start of SV_Physics_Toss on a scratch copy of each edict, then
+traces the move SV_PushEntity would make
+================
+*/
+static void SV_TossMovesTask (void *data, int first, int last)
+{
+	tossmove_t	*m;
+	edict_t		*ent, *copy;
+	vec3_t		move;
+	int			i;
+
+	(void) data;
+	copy = (edict_t *) alloca (pr_edict_size);
+
+	for (i = first; i < last; i++)
+	{
+		m = &sv_tossmoves[i];
+		ent = EDICT_NUM(m->ent);
+		memcpy (copy, ent, pr_edict_size);
+
+		SV_CheckVelocity (copy);
+		if (copy->v.movetype != MOVETYPE_FLY
+		&& copy->v.movetype != MOVETYPE_FLYMISSILE)
+			SV_AddGravity (copy);
+		VectorScale (copy->v.velocity, host_frametime, move);
+
+		VectorCopy (copy->v.origin, m->start);
+		VectorAdd (copy->v.origin, move, m->end);
+		VectorCopy (copy->v.mins, m->mins);
+		VectorCopy (copy->v.maxs, m->maxs);
+		m->type = SV_PushMoveType (copy);
+		m->owner = copy->v.owner;
+		m->size = copy->v.size[0];
+		m->traced = SV_MoveOnTask (m->start, m->mins, m->maxs, m->end, m->type, ent, &m->trace, m->boxmins, m->boxmaxs);
+	}
+}
+
+/*
+================
+SV_StartTossMoves
+
+Finds the edicts in [first, last) that should make a toss move this frame
+and traces them on the task threads
+================
+*/
+static void SV_StartTossMoves (int first, int last)
+{
+	edict_t		*ent;
+	int			i, movetype;
+
+	if (!sv_parallelphysics.value || Tasks_NumThreads () < 2 || pr_global_struct->force_retouch)
+		return;
+
+	if (sv_maxedicts != sv.max_edicts)
+	{
+		sv_maxedicts = sv.max_edicts;
+		sv_tossmoves = (tossmove_t *) realloc (sv_tossmoves, sv_maxedicts * sizeof(*sv_tossmoves));
+		sv_tossmovenums = (int *) realloc (sv_tossmovenums, sv_maxedicts * sizeof(*sv_tossmovenums));
+		sv_changedents = (byte *) realloc (sv_changedents, sv_maxedicts * sizeof(*sv_changedents));
+		if (!sv_tossmoves || !sv_tossmovenums || !sv_changedents)
+			Sys_Error ("SV_StartTossMoves: out of memory");
+	}
+
+	for (i = 0; i < sv.max_edicts; i++)
+		sv_tossmovenums[i] = -1;
+
+	sv_numtossmoves = 0;
+	for (i = first; i < last; i++)
+	{
+		ent = EDICT_NUM(i);
+		if (ent->free)
+			continue;
+		movetype = ent->v.movetype;
+		if (movetype != MOVETYPE_TOSS && movetype != MOVETYPE_GIB && movetype != MOVETYPE_BOUNCE
+		&& movetype != MOVETYPE_FLY && movetype != MOVETYPE_FLYMISSILE)
+			continue;
+		if ((int)ent->v.flags & FL_ONGROUND)
+			continue;
+		if (ent->v.nextthink > 0 && ent->v.nextthink <= sv.time + host_frametime)
+			continue;	// will think first
+		if (IS_NAN(ent->v.velocity[0]) || IS_NAN(ent->v.velocity[1]) || IS_NAN(ent->v.velocity[2])
+		|| IS_NAN(ent->v.origin[0]) || IS_NAN(ent->v.origin[1]) || IS_NAN(ent->v.origin[2]))
+			continue;	// SV_CheckVelocity has something to say
+
+		sv_tossmovenums[i] = sv_numtossmoves;
+		sv_tossmoves[sv_numtossmoves++].ent = i;
+	}
+
+	if (sv_numtossmoves < MIN_TOSSMOVES)
+	{
+		for (i = 0; i < sv_numtossmoves; i++)
+			sv_tossmovenums[sv_tossmoves[i].ent] = -1;
+		sv_numtossmoves = 0;
+		return;
+	}
+
+	sv_tracesontasks = true;
+	Tasks_Run (SV_TossMovesTask, NULL, sv_numtossmoves, 8);
+	Tasks_Wait ();
+	sv_tracesontasks = false;
+
+	memset (sv_changedents, 0, sv.max_edicts * sizeof(*sv_changedents));
+	sv_numchanged = 0;
+	sv_trackchanges = true;
+	sv_tossstats[0] += sv_numtossmoves;
+}
+
+/*
+================
+SV_FinishTossMoves
+================
+*/
+static void SV_FinishTossMoves (void)
+{
+	int		i;
+
+	sv_trackchanges = false;
+	for (i = 0; i < sv_numtossmoves; i++)
+		sv_tossmovenums[sv_tossmoves[i].ent] = -1;
+	sv_numtossmoves = 0;
+
+	if (sv_parallelphysics.value >= 2 && sv_tossstats[0] >= 1000)
+	{
+		Con_Printf ("parallel toss: %d traced ahead, %d taken, %d wrong\n",
+			sv_tossstats[0], sv_tossstats[1], sv_tossstats[2]);
+		memset (sv_tossstats, 0, sizeof(sv_tossstats));
+	}
+}
+
+/*
+================
+SV_TossMoveTrace
+
+Gives the trace of the move from ent's origin to end if it was traced
+ahead and still holds
+================
+*/
+static qboolean SV_TossMoveTrace (edict_t *ent, vec3_t end, int type, trace_t *trace)
+{
+	tossmove_t	*m;
+	changed_t	*c;
+	edict_t		*check;
+	trace_t		serial;
+	int			e, i;
+
+	if (!sv_trackchanges)
+		return false;
+
+	e = NUM_FOR_EDICT(ent);
+	if (sv_tossmovenums[e] < 0)
+		return false;
+	m = &sv_tossmoves[sv_tossmovenums[e]];
+	sv_tossmovenums[e] = -1;	// one move per frame
+
+	if (!m->traced)
+		return false;
+	if (!VectorCompare (ent->v.origin, m->start) || !VectorCompare (end, m->end)
+	|| !VectorCompare (ent->v.mins, m->mins) || !VectorCompare (ent->v.maxs, m->maxs)
+	|| type != m->type || ent->v.owner != m->owner || ent->v.size[0] != m->size)
+		return false;
+
+	for (i = 0, c = sv_changed; i < sv_numchanged; i++, c++)
+	{
+		if (c->ent == e)
+			continue;
+		check = EDICT_NUM(c->ent);
+		if (SV_BoxesOverlap (c->absmin, c->absmax, m->boxmins, m->boxmaxs)
+		|| SV_BoxesOverlap (check->v.absmin, check->v.absmax, m->boxmins, m->boxmaxs))
+			return false;
+	}
+
+	*trace = m->trace;
+	sv_tossstats[1]++;
+
+	if (sv_parallelphysics.value >= 2)
+	{
+		serial = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, end, type, ent);
+		if (memcmp (&serial, trace, sizeof(trace_t)))
+		{
+			sv_tossstats[2]++;
+			*trace = serial;
+		}
+	}
+
+	return true;
+}
+
 /*
 ===============================================================================
 
@@ -417,16 +709,13 @@ trace_t SV_PushEntity (edict_t *ent, vec3_t push)
 {
 	trace_t	trace;
 	vec3_t	end;
+	int		type;
 
 	VectorAdd (ent->v.origin, push, end);
 
-	if (ent->v.movetype == MOVETYPE_FLYMISSILE)
-		trace = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_MISSILE, ent);
-	else if (ent->v.solid == SOLID_TRIGGER || ent->v.solid == SOLID_NOT)
-	// only clip against bmodels
-		trace = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_NOMONSTERS, ent);
-	else
-		trace = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, end, MOVE_NORMAL, ent);
+	type = SV_PushMoveType (ent);
+	if (!SV_TossMoveTrace (ent, end, type, &trace))
+		trace = SV_Move (ent->v.origin, ent->v.mins, ent->v.maxs, end, type, ent);
 
 	VectorCopy (trace.endpos, ent->v.origin);
 	SV_LinkEdict (ent, true);
@@ -1195,6 +1484,8 @@ void SV_Physics (void)
 	else
 	  entity_cap = sv.num_edicts; 
 
+	SV_StartTossMoves (svs.maxclients + 1, entity_cap);
+
 	//for (i=0 ; i<sv.num_edicts ; i++, ent = NEXT_EDICT(ent))
 	for (i=0 ; i<entity_cap ; i++, ent = NEXT_EDICT(ent))
 	{
@@ -1226,6 +1517,8 @@ void SV_Physics (void)
 			Sys_Error ("SV_Physics: bad movetype %i", (int)ent->v.movetype);
 	}
 
+	SV_FinishTossMoves ();
+
 	if (pr_global_struct->force_retouch)
 		pr_global_struct->force_retouch--;
 
@@ -560,6 +560,8 @@ nextmsg:
 					ret = 1;
 				else if (q_strncasecmp(s, "prespawn", 8) == 0)
 					ret = 1;
+				else if (q_strncasecmp(s, "deltaents", 9) == 0)
+					ret = 1;
 				else if (q_strncasecmp(s, "kick", 4) == 0)
 					ret = 1;
 				else if (q_strncasecmp(s, "ping", 4) == 0)
@@ -582,6 +584,10 @@ nextmsg:
 			case clc_move:
 				SV_ReadClientMove (&host_client->cmd);
 				break;
+
+			case clc_deltaack:
+				SV_AckDeltaFrame (host_client, MSG_ReadLong ());
+				break;
 			}
 		}
 	} while (ret == 1);
@@ -590,6 +596,31 @@ nextmsg:
 }
 
 
+/*
+==================
+SV_PollClients
+
+Reads pending messages from every client without running physics, so a
+dedicated server can latch moves and string commands as they arrive
+between ticks.  SV_RunClients picks up the latest move on the next tick.
+==================
+*/
+void SV_PollClients (void)
+{
+	int				i;
+
+	for (i=0, host_client = svs.clients ; i<svs.maxclients ; i++, host_client++)
+	{
+		if (!host_client->active)
+			continue;
+
+		sv_player = host_client->edict;
+
+		if (!SV_ReadClientMessage ())
+			SV_DropClient (false);	// client misbehaved...
+	}
+}
+
 /*
 ==================
 SV_RunClients
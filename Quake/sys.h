@@ -40,6 +40,12 @@ void Sys_FileSeek (int handle, int position);
 int Sys_FileRead (int handle, void *dest, int count);
 int Sys_FileWrite (int handle,const void *data, int count);
 int Sys_FileTime (const char *path);
+
+// maps length bytes at offset of an open file as a private copy-on-write
+// view; returns NULL if the platform can't, so the caller must fall back
+// to Sys_FileRead.  the view stays valid after the handle is closed.
+void *Sys_FileMap (int handle, int offset, int length);
+void Sys_FileUnmap (void *data, int length);
 void Sys_mkdir (const char *path);
 FILE *Sys_fopen (const char *path, const char *mode);
 
@@ -80,6 +86,10 @@ const char *Sys_ConsoleInput (void);
 void Sys_Sleep (unsigned long msecs);
 // yield for about 'msecs' milliseconds.
 
+qboolean Sys_WaitForInput (double deadline);
+// dedicated server: block until console or network input is pending or the
+// absolute time 'deadline' is reached.  returns true if input may be pending.
+
 void Sys_SendKeyEvents (void);
 // Perform Key_Event () callbacks until the input que is empty
 
@@ -31,8 +31,11 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #include <libgen.h>	/* dirname() and basename() */
 #endif
 #include <sys/stat.h>
+#include <sys/mman.h>
 #include <sys/time.h>
 #include <fcntl.h>
+#include <poll.h>
+#include <sys/ioctl.h>
 #include <time.h>
 #include <dirent.h>
 #ifdef DO_USERDIRS
@@ -146,6 +149,36 @@ int Sys_FileWrite (int handle, const void *data, int count)
 	return fwrite (data, 1, count, sys_handles[handle]);
 }
 
+void *Sys_FileMap (int handle, int offset, int length)
+{
+	long	pagesize = sysconf (_SC_PAGESIZE);
+	int	pad = offset % pagesize;
+	byte	*base;
+
+	if (length <= 0)
+		return NULL;
+
+	// private and writable so loaders may byte swap in place; only the
+	// pages actually written get copied out of the page cache
+	base = (byte *) mmap (NULL, length + pad, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+				fileno (sys_handles[handle]), offset - pad);
+	if (base == (byte *) MAP_FAILED)
+		return NULL;
+#ifdef MADV_WILLNEED
+	madvise (base, length + pad, MADV_WILLNEED);
+#endif
+
+	return base + pad;
+}
+
+void Sys_FileUnmap (void *data, int length)
+{
+	long	pagesize = sysconf (_SC_PAGESIZE);
+	int	pad = (int) ((uintptr_t) data % pagesize);
+
+	munmap ((byte *) data - pad, length + pad);
+}
+
 int Sys_FileTime (const char *path)
 {
 	FILE	*f;
@@ -552,6 +585,78 @@ const char *Sys_ConsoleInput (void)
 	return NULL;
 }
 
+#define	MAX_WAIT_FDS	64
+
+/*
+================
+Sys_WaitForInput
+
+Blocks until stdin or one of the network sockets becomes readable, or until
+the absolute time 'deadline' (in Sys_DoubleTime units) is reached.  Whole
+milliseconds are spent in poll, the sub-millisecond remainder in nanosleep,
+so that dedicated server ticks start on time instead of up to a scheduler
+quantum late.  Returns true if input is pending.
+================
+*/
+qboolean Sys_WaitForInput (double deadline)
+{
+	static qboolean	stdin_closed;
+	struct pollfd	fds[MAX_WAIT_FDS];
+	int		sockets[MAX_WAIT_FDS];
+	struct timespec	ts;
+	double		timeout;
+	int		i, n, count, available;
+	qboolean	pending;
+
+	n = 0;
+	if (!stdin_closed)
+	{
+		fds[n].fd = 0;
+		fds[n].events = POLLIN;
+		fds[n].revents = 0;
+		n++;
+	}
+	count = NET_GetSockets (sockets, MAX_WAIT_FDS - n, &pending);
+	for (i = 0; i < count; i++)
+	{
+		fds[n].fd = sockets[i];
+		fds[n].events = POLLIN;
+		fds[n].revents = 0;
+		n++;
+	}
+
+	timeout = deadline - Sys_DoubleTime ();
+	if (timeout < 0 || pending)
+		timeout = 0;	// datagrams already read in a batch don't show up in poll
+
+	count = poll (fds, n, (int)(timeout * 1000));
+	if (count > 0)
+	{
+	// a closed stdin (eof, hangup, /dev/null) stays readable forever;
+	// stop watching it rather than spinning
+		if (!stdin_closed && fds[0].revents)
+		{
+			if (fds[0].revents & (POLLHUP|POLLERR|POLLNVAL))
+				stdin_closed = true;
+			else if (ioctl (0, FIONREAD, &available) == -1 || !available)
+				stdin_closed = true;
+		}
+		return true;
+	}
+	if (pending)
+		return true;
+
+	timeout = deadline - Sys_DoubleTime ();
+	if (timeout > 0 && timeout < 0.001)
+	{
+		ts.tv_sec = 0;
+		ts.tv_nsec = (long)(timeout * 1e9);
+		nanosleep (&ts, NULL);
+	}
+
+	return false;
+}
+
 void Sys_Sleep (unsigned long msecs)
 {
 /*	usleep (msecs * 1000);*/
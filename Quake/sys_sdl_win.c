@@ -186,6 +186,15 @@ int Sys_FileWrite (int handle, const void *data, int count)
 	return fwrite (data, 1, count, sys_handles[handle]);
 }
 
+void *Sys_FileMap (int handle, int offset, int length)
+{
+	return NULL;	/* not implemented: callers read the file instead */
+}
+
+void Sys_FileUnmap (void *data, int length)
+{
+}
+
 int Sys_FileTime (const char *path)
 {
 	FILE	*f;
@@ -549,6 +558,22 @@ const char *Sys_ConsoleInput (void)
 	return NULL;
 }
 
+/*
+================
+Sys_WaitForInput
+
+No readiness wait over the console and winsock handles here: nap for at
+most a millisecond and let the caller poll the network, which keeps client
+moves flowing between ticks.
+================
+*/
+qboolean Sys_WaitForInput (double deadline)
+{
+	if (deadline - Sys_DoubleTime () >= 0.001)
+		SDL_Delay (1);
+	return true;
+}
+
 void Sys_Sleep (unsigned long msecs)
 {
 /*	Sleep (msecs);*/
@@ -0,0 +1,219 @@
+/*
+ * tasks.c -- a small pool of worker threads for data parallel jobs
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#include "quakedef.h"
+
+#define	MAX_WORKERS		32
+#define	MAX_TASKS		256	/* queue ring size, power of two */
+#define	RANGES_PER_THREAD	4	/* so uneven ranges still balance out */
+
+typedef struct
+{
+	taskfunc_t	func;
+	void		*data;
+	int			first, last;
+} task_t;
+
+static SDL_Thread	*workers[MAX_WORKERS];
+static int			numworkers;
+
+static SDL_mutex	*tasks_lock;
+static SDL_cond		*tasks_wake;	/* signalled when tasks are queued */
+static SDL_cond		*tasks_done;	/* signalled when tasks_pending drops to 0 */
+
+static task_t		tasks_queue[MAX_TASKS];
+static unsigned int	tasks_head, tasks_tail;	/* queue in at head, out at tail */
+static int			tasks_pending;		/* queued or running */
+static qboolean		tasks_quit;
+
+/*
+================
+Tasks_RunOne
+
+Called with tasks_lock held, returns with it held.
+================
+*/
+static void Tasks_RunOne (void)
+{
+	task_t	task;
+
+	task = tasks_queue[tasks_tail++ & (MAX_TASKS - 1)];
+	SDL_UnlockMutex (tasks_lock);
+
+	task.func (task.data, task.first, task.last);
+
+	SDL_LockMutex (tasks_lock);
+	if (--tasks_pending == 0)
+		SDL_CondBroadcast (tasks_done);
+}
+
+static int SDLCALL Tasks_Worker (void *unused)
+{
+	SDL_LockMutex (tasks_lock);
+	while (!tasks_quit)
+	{
+		if (tasks_head == tasks_tail)
+			SDL_CondWait (tasks_wake, tasks_lock);
+		else
+			Tasks_RunOne ();
+	}
+	SDL_UnlockMutex (tasks_lock);
+
+	return 0;
+}
+
+/*
+================
+Tasks_Run
+================
+*/
+void Tasks_Run (taskfunc_t func, void *data, int count, int minchunk)
+{
+	int		i, numranges, first, last;
+
+	if (count <= 0)
+		return;
+
+	if (!numworkers)
+	{
+		func (data, 0, count);
+		return;
+	}
+
+	numranges = Tasks_NumThreads () * RANGES_PER_THREAD;
+	if (minchunk < 1)
+		minchunk = 1;
+	if (numranges > (count + minchunk - 1) / minchunk)
+		numranges = (count + minchunk - 1) / minchunk;
+
+	SDL_LockMutex (tasks_lock);
+	for (i = 0, first = 0; i < numranges; i++, first = last)
+	{
+		last = (int) ((long long) count * (i + 1) / numranges);
+
+		while (tasks_head - tasks_tail == MAX_TASKS)
+			Tasks_RunOne ();	/* queue full: make room ourselves */
+
+		tasks_queue[tasks_head & (MAX_TASKS - 1)].func = func;
+		tasks_queue[tasks_head & (MAX_TASKS - 1)].data = data;
+		tasks_queue[tasks_head & (MAX_TASKS - 1)].first = first;
+		tasks_queue[tasks_head & (MAX_TASKS - 1)].last = last;
+		tasks_head++;
+		tasks_pending++;
+	}
+	SDL_CondBroadcast (tasks_wake);
+	SDL_UnlockMutex (tasks_lock);
+}
+
+/*
+================
+Tasks_Wait
+================
+*/
+void Tasks_Wait (void)
+{
+	if (!numworkers)
+		return;
+
+	SDL_LockMutex (tasks_lock);
+	while (tasks_head != tasks_tail)
+		Tasks_RunOne ();
+	while (tasks_pending)
+		SDL_CondWait (tasks_done, tasks_lock);
+	SDL_UnlockMutex (tasks_lock);
+}
+
+/*
+================
+Tasks_NumThreads
+================
+*/
+int Tasks_NumThreads (void)
+{
+	return numworkers + 1;
+}
+
+/*
+================
+Tasks_Init
+================
+*/
+void Tasks_Init (void)
+{
+	int		i, want;
+
+	want = host_parms->numcpus - 1;
+	i = COM_CheckParm ("-threads");
+	if (i && i < com_argc - 1)
+		want = Q_atoi (com_argv[i + 1]) - 1;
+	want = CLAMP (0, want, MAX_WORKERS);
+	if (!want)
+		return;
+
+	tasks_lock = SDL_CreateMutex ();
+	tasks_wake = SDL_CreateCond ();
+	tasks_done = SDL_CreateCond ();
+	if (!tasks_lock || !tasks_wake || !tasks_done)
+		Sys_Error ("Tasks_Init: couldn't create sync objects: %s", SDL_GetError ());
+
+	for (i = 0; i < want; i++)
+	{
+#if SDL_VERSION_ATLEAST(2,0,0)
+		workers[i] = SDL_CreateThread (Tasks_Worker, "worker", NULL);
+#else
+		workers[i] = SDL_CreateThread (Tasks_Worker, NULL);
+#endif
+		if (!workers[i])
+		{
+			Con_Warning ("Tasks_Init: couldn't create thread: %s\n", SDL_GetError ());
+			break;
+		}
+		numworkers++;
+	}
+
+	Con_Printf ("Using %d worker threads\n", numworkers);
+}
+
+/*
+================
+Tasks_Shutdown
+================
+*/
+void Tasks_Shutdown (void)
+{
+	int		i;
+
+	if (!numworkers)
+		return;
+
+	Tasks_Wait ();
+
+	SDL_LockMutex (tasks_lock);
+	tasks_quit = true;
+	SDL_CondBroadcast (tasks_wake);
+	SDL_UnlockMutex (tasks_lock);
+
+	for (i = 0; i < numworkers; i++)
+		SDL_WaitThread (workers[i], NULL);
+	numworkers = 0;
+
+	SDL_DestroyCond (tasks_done);
+	SDL_DestroyCond (tasks_wake);
+	SDL_DestroyMutex (tasks_lock);
+}
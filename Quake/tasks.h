@@ -0,0 +1,48 @@
+/*
+ * tasks.h -- a small pool of worker threads for data parallel jobs
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or (at
+ * your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.
+ *
+ * See the GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA
+ */
+
+#ifndef __TASKS_H
+#define __TASKS_H
+
+// a task processes the items [first, last) of whatever data it was queued
+// with.  tasks run on worker threads, so they must not touch the hunk,
+// the console, the filesystem or GL, and must not call Sys_Error or
+// Host_Error: they record failures for the main thread to report after
+// Tasks_Wait.
+typedef void (*taskfunc_t) (void *data, int first, int last);
+
+void Tasks_Init (void);
+// starts the workers: one per extra cpu, or as many as -threads <n> says.
+
+void Tasks_Shutdown (void);
+
+int Tasks_NumThreads (void);
+// the number of threads tasks may run on, including the main thread.
+
+void Tasks_Run (taskfunc_t func, void *data, int count, int minchunk);
+// queues func over the items [0, count) in ranges of at least minchunk
+// items and returns right away, so the main thread can get on with work
+// of its own.  without workers func is run to completion before
+// returning.  only the main thread may queue tasks.
+
+void Tasks_Wait (void);
+// helps with whatever is still queued, then waits until every queued
+// task has finished.  returns immediately if nothing is pending.
+
+#endif	/* __TASKS_H */
@@ -33,6 +33,12 @@ line of sight checks trace->crosscontent, but bullets don't
 */
 
 
+typedef struct
+{
+	hull_t		hull;
+	mplane_t	planes[6];
+} boxhull_t;
+
 typedef struct
 {
 	vec3_t		boxmins, boxmaxs;// enclose the test object along entire move
@@ -42,8 +48,13 @@ typedef struct
 	trace_t		trace;
 	int			type;
 	edict_t		*passedict;
+	int			tests;			// edicts looked at, for sv_areastats
+	boxhull_t	*box;			// private box hull on task threads, else NULL
+	qboolean	failed;			// hit an error that only the main thread may raise
 } moveclip_t;
 
+qboolean	sv_tracesontasks;
+
 
 int SV_HullPointContents (hull_t *hull, int num, vec3_t p);
 
@@ -56,9 +67,8 @@ HULL BOXES
 */
 
 
-static	hull_t		box_hull;
+static	boxhull_t	box_hull;
 static	mclipnode_t	box_clipnodes[6]; //johnfitz -- was dclipnode_t
-static	mplane_t	box_planes[6];
 
 /*
 ===================
@@ -73,10 +83,10 @@ void SV_InitBoxHull (void)
 	int		i;
 	int		side;
 
-	box_hull.clipnodes = box_clipnodes;
-	box_hull.planes = box_planes;
-	box_hull.firstclipnode = 0;
-	box_hull.lastclipnode = 5;
+	box_hull.hull.clipnodes = box_clipnodes;
+	box_hull.hull.planes = box_hull.planes;
+	box_hull.hull.firstclipnode = 0;
+	box_hull.hull.lastclipnode = 5;
 
 	for (i=0 ; i<6 ; i++)
 	{
@@ -90,8 +100,8 @@ void SV_InitBoxHull (void)
 		else
 			box_clipnodes[i].children[side^1] = CONTENTS_SOLID;
 
-		box_planes[i].type = i>>1;
-		box_planes[i].normal[i>>1] = 1;
+		box_hull.planes[i].type = i>>1;
+		box_hull.planes[i].normal[i>>1] = 1;
 	}
 
 }
@@ -105,31 +115,34 @@ To keep everything totally uniform, bounding boxes are turned into small
 BSP trees instead of being compared directly.
 ===================
 */
-hull_t	*SV_HullForBox (vec3_t mins, vec3_t maxs)
+static hull_t *SV_FillBoxHull (boxhull_t *box, vec3_t mins, vec3_t maxs)
 {
-	box_planes[0].dist = maxs[0];
-	box_planes[1].dist = mins[0];
-	box_planes[2].dist = maxs[1];
-	box_planes[3].dist = mins[1];
-	box_planes[4].dist = maxs[2];
-	box_planes[5].dist = mins[2];
+	box->planes[0].dist = maxs[0];
+	box->planes[1].dist = mins[0];
+	box->planes[2].dist = maxs[1];
+	box->planes[3].dist = mins[1];
+	box->planes[4].dist = maxs[2];
+	box->planes[5].dist = mins[2];
+
+	return &box->hull;
+}
 
-	return &box_hull;
+hull_t	*SV_HullForBox (vec3_t mins, vec3_t maxs)
+{
+	return SV_FillBoxHull (&box_hull, mins, maxs);
 }
 
 
 
 /*
 ================
-SV_HullForEntity
+SV_HullForEntityBox
 
-Returns a hull that can be used for testing or clipping an object of mins/maxs
-size.
-Offset is filled in to contain the adjustment that must be added to the
-testing object's origin to get a point to use with the returned hull.
+SV_HullForEntity with the box hull to fill in.  Returns NULL for a
+SOLID_BSP entity that can't be clipped against, without raising an error.
 ================
 */
-hull_t *SV_HullForEntity (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset)
+static hull_t *SV_HullForEntityBox (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset, boxhull_t *box)
 {
 	qmodel_t	*model;
 	vec3_t		size;
@@ -140,14 +153,12 @@ hull_t *SV_HullForEntity (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset)
 	if (ent->v.solid == SOLID_BSP)
 	{	// explicit hulls in the BSP model
 		if (ent->v.movetype != MOVETYPE_PUSH)
-			Host_Error ("SOLID_BSP without MOVETYPE_PUSH (%s at %f %f %f)",
-				    PR_GetString(ent->v.classname), ent->v.origin[0], ent->v.origin[1], ent->v.origin[2]);
+			return NULL;
 
 		model = sv.models[ (int)ent->v.modelindex ];
 
 		if (!model || model->type != mod_brush)
-			Host_Error ("SOLID_BSP with a non bsp model (%s at %f %f %f)",
-				    PR_GetString(ent->v.classname), ent->v.origin[0], ent->v.origin[1], ent->v.origin[2]);
+			return NULL;
 
 		VectorSubtract (maxs, mins, size);
 		if (size[0] < 3)
@@ -166,7 +177,7 @@ hull_t *SV_HullForEntity (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset)
 
 		VectorSubtract (ent->v.mins, maxs, hullmins);
 		VectorSubtract (ent->v.maxs, mins, hullmaxs);
-		hull = SV_HullForBox (hullmins, hullmaxs);
+		hull = SV_FillBoxHull (box, hullmins, hullmaxs);
 
 		VectorCopy (ent->v.origin, offset);
 	}
@@ -175,6 +186,34 @@ hull_t *SV_HullForEntity (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset)
 	return hull;
 }
 
+/*
+================
+SV_HullForEntity
+
+Returns a hull that can be used for testing or clipping an object of mins/maxs
+size.
+Offset is filled in to contain the adjustment that must be added to the
+testing object's origin to get a point to use with the returned hull.
+================
+*/
+hull_t *SV_HullForEntity (edict_t *ent, vec3_t mins, vec3_t maxs, vec3_t offset)
+{
+	hull_t		*hull;
+
+	hull = SV_HullForEntityBox (ent, mins, maxs, offset, &box_hull);
+	if (!hull)
+	{
+		if (ent->v.movetype != MOVETYPE_PUSH)
+			Host_Error ("SOLID_BSP without MOVETYPE_PUSH (%s at %f %f %f)",
+				    PR_GetString(ent->v.classname), ent->v.origin[0], ent->v.origin[1], ent->v.origin[2]);
+		else
+			Host_Error ("SOLID_BSP with a non bsp model (%s at %f %f %f)",
+				    PR_GetString(ent->v.classname), ent->v.origin[0], ent->v.origin[1], ent->v.origin[2]);
+	}
+
+	return hull;
+}
+
 /*
 ===============================================================================
 
@@ -190,57 +229,700 @@ typedef struct areanode_s
 	struct areanode_s	*children[2];
 	link_t	trigger_edicts;
 	link_t	solid_edicts;
+	vec3_t	mins, maxs;	// the space the node covers
+	int		numedicts;	// linked to this node itself
+	int		nosplit;	// don't try to split again until numedicts passes this
 } areanode_t;
 
-#define	AREA_DEPTH	7
-#define	AREA_NODES	(2<<AREA_DEPTH)
+// the tree starts as a single node over the world and leafs are split
+// where edicts crowd together, so big maps get deep where they're busy
+// and small ones stay shallow
+#define	AREA_NODES		4096
+#define	AREA_SPLITSIZE	32		// edicts in a leaf before it's split
+#define	AREA_MINSIZE	128		// smallest size of a split node
+
+static	areanode_t	sv_areanodes[AREA_NODES];
+static	int			sv_numareanodes;
+
+static struct
+{
+	int		moves, movetests;		// SV_Move calls and edicts they looked at
+	int		touches, touchtests;	// the same for trigger touching
+} sv_areastats;
+
+/*
+===============
+SV_CreateAreaNode
+
+===============
+*/
+areanode_t *SV_CreateAreaNode (vec3_t mins, vec3_t maxs)
+{
+	areanode_t	*anode;
+
+	if (sv_numareanodes == AREA_NODES)
+		Sys_Error ("SV_CreateAreaNode: AREA_NODES");
+
+	anode = &sv_areanodes[sv_numareanodes];
+	sv_numareanodes++;
+
+	memset (anode, 0, sizeof(*anode));
+	ClearLink (&anode->trigger_edicts);
+	ClearLink (&anode->solid_edicts);
+	anode->axis = -1;
+	VectorCopy (mins, anode->mins);
+	VectorCopy (maxs, anode->maxs);
+
+	return anode;
+}
+
+/*
+===============
+SV_AreaNodeSide
+
+Which child of node the box fits in, or -1 if it crosses the plane
+===============
+*/
+static int SV_AreaNodeSide (areanode_t *node, vec3_t absmin, vec3_t absmax)
+{
+	if (absmin[node->axis] > node->dist)
+		return 0;
+	if (absmax[node->axis] < node->dist)
+		return 1;
+	return -1;
+}
+
+static int SV_CompareFloats (const void *a, const void *b)
+{
+	float	fa = *(const float *)a, fb = *(const float *)b;
+
+	return (fa > fb) - (fa < fb);
+}
+
+/*
+===============
+SV_SplitAreaNode
+
+Splits a crowded leaf through the middle of its edicts along its longest
+side and moves the edicts that fit on one side down into the new leafs.
+If most of them would cross the plane there is no point, so the leaf is
+left alone until it has twice as many.
+===============
+*/
+static void SV_SplitAreaNode (areanode_t *node)
+{
+	link_t		*lists[2], *l, *next;
+	edict_t		*ent;
+	areanode_t	*child;
+	vec3_t		size, mins, maxs;
+	float		*centers, dist;
+	int			i, axis, count, moved, side;
+
+	node->nosplit = node->numedicts * 2;
+
+	if (sv_numareanodes + 2 > AREA_NODES)
+		return;
+
+	VectorSubtract (node->maxs, node->mins, size);
+	axis = 0;
+	for (i = 1; i < 3; i++)
+		if (size[i] > size[axis])
+			axis = i;
+	if (size[axis] < 2*AREA_MINSIZE)
+		return;
+
+// split at the median of the edict centers, keeping both sides big enough
+	lists[0] = &node->solid_edicts;
+	lists[1] = &node->trigger_edicts;
+	centers = (float *) alloca (node->numedicts * sizeof(float));
+	count = 0;
+	for (i = 0; i < 2; i++)
+		for (l = lists[i]->next; l != lists[i] && count < node->numedicts; l = l->next)
+		{
+			ent = EDICT_FROM_AREA(l);
+			centers[count++] = 0.5f * (ent->v.absmin[axis] + ent->v.absmax[axis]);
+		}
+	if (!count)
+		return;
+	qsort (centers, count, sizeof(float), SV_CompareFloats);
+	dist = centers[count / 2];
+	dist = q_max (dist, node->mins[axis] + AREA_MINSIZE);
+	dist = q_min (dist, node->maxs[axis] - AREA_MINSIZE);
+
+	moved = 0;
+	for (i = 0; i < 2; i++)
+		for (l = lists[i]->next; l != lists[i]; l = l->next)
+		{
+			ent = EDICT_FROM_AREA(l);
+			if (ent->v.absmin[axis] > dist || ent->v.absmax[axis] < dist)
+				moved++;
+		}
+	if (moved * 2 < node->numedicts)
+		return;
+
+	node->axis = axis;
+	node->dist = dist;
+	VectorCopy (node->mins, mins);
+	VectorCopy (node->maxs, maxs);
+	mins[axis] = dist;
+	node->children[0] = SV_CreateAreaNode (mins, node->maxs);
+	maxs[axis] = dist;
+	node->children[1] = SV_CreateAreaNode (node->mins, maxs);
+
+// move the edicts down, keeping them in the same order
+	for (i = 0; i < 2; i++)
+		for (l = lists[i]->next; l != lists[i]; l = next)
+		{
+			next = l->next;
+			ent = EDICT_FROM_AREA(l);
+			side = SV_AreaNodeSide (node, ent->v.absmin, ent->v.absmax);
+			if (side < 0)
+				continue;
+			child = node->children[side];
+			if (sv_trackchanges)
+				SV_EdictChanged (ent);	// it will be clipped against in a different order
+			RemoveLink (l);
+			InsertLinkBefore (l, i ? &child->trigger_edicts : &child->solid_edicts);
+			ent->areanode = child;
+			node->numedicts--;
+			child->numedicts++;
+		}
+
+	for (i = 0; i < 2; i++)
+		if (node->children[i]->numedicts > AREA_SPLITSIZE)
+			SV_SplitAreaNode (node->children[i]);
+}
+
+/*
+===============
+SV_AreaStats_f
+
+Shows the shape of the area tree and how many edicts the clipping and
+touching code has looked at since the last time
+===============
+*/
+static void SV_AreaNodeStats (areanode_t *node, int depth, int *leafs, int *maxdepth, int *maxedicts)
+{
+	*maxdepth = q_max (*maxdepth, depth);
+	*maxedicts = q_max (*maxedicts, node->numedicts);
+	if (node->axis == -1)
+	{
+		(*leafs)++;
+		return;
+	}
+	SV_AreaNodeStats (node->children[0], depth + 1, leafs, maxdepth, maxedicts);
+	SV_AreaNodeStats (node->children[1], depth + 1, leafs, maxdepth, maxedicts);
+}
+
+void SV_AreaStats_f (void)
+{
+	int		leafs, maxdepth, maxedicts;
+
+	if (!sv.active)
+	{
+		Con_Printf ("Not running a server\n");
+		return;
+	}
+
+	leafs = maxdepth = maxedicts = 0;
+	SV_AreaNodeStats (sv_areanodes, 0, &leafs, &maxdepth, &maxedicts);
+	Con_Printf ("%d area nodes, %d leafs, depth %d, at most %d edicts in a node\n",
+		sv_numareanodes, leafs, maxdepth, maxedicts);
+	Con_Printf ("%d moves, %.2f edicts tested per move\n", sv_areastats.moves,
+		sv_areastats.moves ? (double)sv_areastats.movetests / sv_areastats.moves : 0.0);
+	Con_Printf ("%d touches, %.2f edicts tested per touch\n", sv_areastats.touches,
+		sv_areastats.touches ? (double)sv_areastats.touchtests / sv_areastats.touches : 0.0);
+
+	memset (&sv_areastats, 0, sizeof(sv_areastats));
+}
+
+/*
+===============================================================================
+
+ENTITY VISIBILITY INDEX
+
+Every world leaf keeps the numbers of the edicts whose leafnums include it,
+so the entities in a pvs can be found without looking at all of them.
+Edicts that touch MAX_ENT_LEAFS leafs can't be culled and go in one more
+list after the leafs.  SV_LinkEdict keeps the lists current.
+
+===============================================================================
+*/
+
+typedef struct
+{
+	int		numents, maxents;
+	int		*ents;
+} leafents_t;
+
+typedef struct
+{
+	int		numlists;
+	int		lists[MAX_ENT_LEAFS];
+} entlists_t;
+
+static leafents_t	*sv_leafents;
+static int			sv_numleafents;
+static entlists_t	*sv_entlists;	// the lists each edict is in, by edict number
+
+/*
+===============
+SV_ClearEntityIndex
+===============
+*/
+static void SV_ClearEntityIndex (void)
+{
+	int		i;
+
+	for (i = 0; i < sv_numleafents; i++)
+		free (sv_leafents[i].ents);
+
+	sv_numleafents = sv.worldmodel->numleafs + 1;
+	sv_leafents = (leafents_t *) realloc (sv_leafents, sv_numleafents * sizeof(*sv_leafents));
+	if (!sv_leafents)
+		Sys_Error ("SV_ClearEntityIndex: realloc() failed on %d leafs", sv_numleafents);
+	memset (sv_leafents, 0, sv_numleafents * sizeof(*sv_leafents));
+
+	sv_entlists = (entlists_t *) Hunk_AllocName (sv.max_edicts * sizeof(*sv_entlists), "entlists");
+}
+
+static void SV_AddToLeafEnts (int e, int list)
+{
+	leafents_t	*le;
+	entlists_t	*el;
+
+	le = &sv_leafents[list];
+	if (le->numents == le->maxents)
+	{
+		le->maxents = q_max (le->maxents * 2, 8);
+		le->ents = (int *) realloc (le->ents, le->maxents * sizeof(int));
+		if (!le->ents)
+			Sys_Error ("SV_AddToLeafEnts: realloc() failed on %d edicts", le->maxents);
+	}
+	le->ents[le->numents++] = e;
+
+	el = &sv_entlists[e];
+	el->lists[el->numlists++] = list;
+}
+
+/*
+===============
+SV_IndexEdict
+
+Moves the edict to the lists of its current leafnums
+===============
+*/
+static void SV_IndexEdict (edict_t *ent)
+{
+	entlists_t	*el;
+	leafents_t	*le;
+	int			e, i, j;
+
+	e = ((byte *)ent - (byte *)sv.edicts) / pr_edict_size;
+	el = &sv_entlists[e];
+
+	for (i = 0; i < el->numlists; i++)
+	{
+		le = &sv_leafents[el->lists[i]];
+		for (j = 0; j < le->numents; j++)
+		{
+			if (le->ents[j] == e)
+			{
+				le->ents[j] = le->ents[--le->numents];
+				break;
+			}
+		}
+	}
+	el->numlists = 0;
+
+	if (ent->num_leafs == MAX_ENT_LEAFS)
+		SV_AddToLeafEnts (e, sv_numleafents - 1);
+	else
+	{
+		for (i = 0; i < ent->num_leafs; i++)
+			SV_AddToLeafEnts (e, ent->leafnums[i]);
+	}
+}
+
+/*
+===============
+SV_MarkPVSEdicts
+===============
+*/
+void SV_MarkPVSEdicts (byte *pvs, unsigned int *marks)
+{
+	leafents_t	*le;
+	int			i, j, leafnum, numbytes;
+
+	numbytes = (sv_numleafents - 1 + 7) >> 3;
+	for (i = 0; i < numbytes; i++)
+	{
+		if (!pvs[i])
+			continue;
+		for (leafnum = i << 3; leafnum < (i << 3) + 8 && leafnum < sv_numleafents - 1; leafnum++)
+		{
+			if (!(pvs[i] & (1 << (leafnum & 7))))
+				continue;
+			le = &sv_leafents[leafnum];
+			for (j = 0; j < le->numents; j++)
+				marks[le->ents[j] >> 5] |= 1u << (le->ents[j] & 31);
+		}
+	}
+
+	le = &sv_leafents[sv_numleafents - 1];
+	for (j = 0; j < le->numents; j++)
+		marks[le->ents[j] >> 5] |= 1u << (le->ents[j] & 31);
+}
+
+/*
+===============================================================================
+
+ENTITY RADIUS INDEX
+
+Solid edicts are hashed by the cell of their bbox center when they are
+linked, so SV_FindRadius only has to look at the cells around the query.
+The index reflects the last link, so an edict moved without relinking may
+be missed until physics relinks it; sv_findradiusgrid 0 goes back to
+checking every edict.
+
+===============================================================================
+*/
+
+#define	RADIUS_CELLSIZE		256
+#define	RADIUS_BUCKETS		4096	// must be a power of two
+
+typedef struct
+{
+	int		bucket;			// -1 when not indexed
+	int		prev, next;		// edict numbers, 0 ends the list
+} radiuslink_t;
+
+cvar_t	sv_findradiusgrid = {"sv_findradiusgrid", "1", CVAR_NONE};
+
+static int			sv_radiusbuckets[RADIUS_BUCKETS];	// first edict number in each
+static radiuslink_t	*sv_radiuslinks;	// by edict number
+
+static unsigned int	*sv_radiusmarks;
+static int			sv_maxradiusmarks;
+
+static int SV_RadiusCell (float v)
+{
+	return (int) floor (v / RADIUS_CELLSIZE);
+}
+
+static int SV_RadiusBucket (int x, int y, int z)
+{
+	return ((unsigned int)x * 73856093u ^ (unsigned int)y * 19349663u ^ (unsigned int)z * 83492791u) & (RADIUS_BUCKETS - 1);
+}
+
+/*
+===============
+SV_ClearRadiusIndex
+===============
+*/
+static void SV_ClearRadiusIndex (void)
+{
+	int		i;
+
+	memset (sv_radiusbuckets, 0, sizeof(sv_radiusbuckets));
+	sv_radiuslinks = (radiuslink_t *) realloc (sv_radiuslinks, sv.max_edicts * sizeof(*sv_radiuslinks));
+	if (!sv_radiuslinks)
+		Sys_Error ("SV_ClearRadiusIndex: realloc() failed on %d edicts", sv.max_edicts);
+	for (i = 0; i < sv.max_edicts; i++)
+		sv_radiuslinks[i].bucket = -1;
+}
+
+/*
+===============
+SV_UnindexRadius
+===============
+*/
+static void SV_UnindexRadius (int e)
+{
+	radiuslink_t	*rl = &sv_radiuslinks[e];
+
+	if (rl->bucket < 0)
+		return;
+	if (rl->prev)
+		sv_radiuslinks[rl->prev].next = rl->next;
+	else
+		sv_radiusbuckets[rl->bucket] = rl->next;
+	if (rl->next)
+		sv_radiuslinks[rl->next].prev = rl->prev;
+	rl->bucket = -1;
+	rl->prev = rl->next = 0;
+}
+
+/*
+===============
+SV_IndexRadius
+===============
+*/
+static void SV_IndexRadius (edict_t *ent)
+{
+	radiuslink_t	*rl;
+	int				e, b, i, cell[3];
+
+	e = NUM_FOR_EDICT(ent);
+	SV_UnindexRadius (e);
+	if (ent->v.solid == SOLID_NOT)
+		return;
+
+	for (i = 0; i < 3; i++)
+		cell[i] = SV_RadiusCell (ent->v.origin[i] + (ent->v.mins[i] + ent->v.maxs[i]) * 0.5);
+	b = SV_RadiusBucket (cell[0], cell[1], cell[2]);
+
+	rl = &sv_radiuslinks[e];
+	rl->bucket = b;
+	rl->prev = 0;
+	rl->next = sv_radiusbuckets[b];
+	if (rl->next)
+		sv_radiuslinks[rl->next].prev = e;
+	sv_radiusbuckets[b] = e;
+}
+
+/*
+===============
+SV_InRadius
+
+The test findradius has always used
+===============
+*/
+static qboolean SV_InRadius (edict_t *ent, vec3_t org, float rad)
+{
+	float	d, lensq;
+
+	if (ent->free)
+		return false;
+	if (ent->v.solid == SOLID_NOT)
+		return false;
+
+	d = org[0] - (ent->v.origin[0] + (ent->v.mins[0] + ent->v.maxs[0]) * 0.5);
+	lensq = d * d;
+	if (lensq > rad)
+		return false;
+	d = org[1] - (ent->v.origin[1] + (ent->v.mins[1] + ent->v.maxs[1]) * 0.5);
+	lensq += d * d;
+	if (lensq > rad)
+		return false;
+	d = org[2] - (ent->v.origin[2] + (ent->v.mins[2] + ent->v.maxs[2]) * 0.5);
+	lensq += d * d;
+	if (lensq > rad)
+		return false;
+
+	return true;
+}
+
+/*
+===============
+SV_FindRadiusAll
+===============
+*/
+static edict_t *SV_FindRadiusAll (vec3_t org, float rad)
+{
+	edict_t	*ent, *chain;
+	int		i;
+
+	chain = (edict_t *)sv.edicts;
+	rad *= rad;
+
+	ent = NEXT_EDICT(sv.edicts);
+	for (i = 1; i < sv.num_edicts; i++, ent = NEXT_EDICT(ent))
+	{
+		if (!SV_InRadius (ent, org, rad))
+			continue;
+		ent->v.chain = EDICT_TO_PROG(chain);
+		chain = ent;
+	}
+
+	return chain;
+}
+
+/*
+===============
+SV_FindRadius
+===============
+*/
+edict_t *SV_FindRadius (vec3_t org, float rad, qboolean useindex)
+{
+	edict_t	*ent, *chain;
+	int		i, e, lo, hi, nummarks;
+	int		mins[3], maxs[3], x, y, z;
+	double	cells;
+
+	if (!useindex || !sv_radiuslinks)
+		return SV_FindRadiusAll (org, rad);
+
+	rad = fabs (rad);
+	cells = 1;
+	for (i = 0; i < 3; i++)
+	{
+		if (!(org[i] - rad >= -1e9 && org[i] + rad <= 1e9))	// catches NaNs too
+			return SV_FindRadiusAll (org, rad);
+		mins[i] = SV_RadiusCell (org[i] - rad);
+		maxs[i] = SV_RadiusCell (org[i] + rad);
+		cells *= maxs[i] - mins[i] + 1;
+	}
+	// walking the buckets wouldn't beat looking at everything
+	if (cells > RADIUS_BUCKETS || cells * 4 > sv.num_edicts)
+		return SV_FindRadiusAll (org, rad);
+
+	nummarks = (sv.max_edicts + 31) >> 5;
+	if (nummarks > sv_maxradiusmarks)
+	{
+		sv_maxradiusmarks = nummarks;
+		sv_radiusmarks = (unsigned int *) realloc (sv_radiusmarks, nummarks * sizeof(*sv_radiusmarks));
+		if (!sv_radiusmarks)
+			Sys_Error ("SV_FindRadius: realloc() failed on %d marks", nummarks);
+		memset (sv_radiusmarks, 0, nummarks * sizeof(*sv_radiusmarks));
+	}
+
+// mark the candidates, then visit them in edict order so the chain comes
+// out the same as walking every edict would give
+	lo = sv.max_edicts;
+	hi = 0;
+	for (z = mins[2]; z <= maxs[2]; z++)
+		for (y = mins[1]; y <= maxs[1]; y++)
+			for (x = mins[0]; x <= maxs[0]; x++)
+			{
+				for (e = sv_radiusbuckets[SV_RadiusBucket (x, y, z)]; e; e = sv_radiuslinks[e].next)
+				{
+					sv_radiusmarks[e >> 5] |= 1u << (e & 31);
+					lo = q_min (lo, e);
+					hi = q_max (hi, e);
+				}
+			}
+
+	chain = (edict_t *)sv.edicts;
+	rad *= rad;
+	for (e = lo; e <= hi; e++)
+	{
+		if (!sv_radiusmarks[e >> 5])
+		{
+			e |= 31;
+			continue;
+		}
+		if (!(sv_radiusmarks[e >> 5] & (1u << (e & 31))))
+			continue;
+		if (e >= sv.num_edicts)
+			break;
+		ent = EDICT_NUM(e);
+		if (!SV_InRadius (ent, org, rad))
+			continue;
+		ent->v.chain = EDICT_TO_PROG(chain);
+		chain = ent;
+	}
+	if (lo <= hi)
+		memset (sv_radiusmarks + (lo >> 5), 0, ((hi >> 5) - (lo >> 5) + 1) * sizeof(*sv_radiusmarks));
 
-static	areanode_t	sv_areanodes[AREA_NODES];
-static	int			sv_numareanodes;
+	return chain;
+}
 
 /*
 ===============
-SV_CreateAreaNode
+SV_FindRadiusBench_f
 
+findradiusbench [edicts] [queries]: spawns that many small solid edicts at
+random spots in the world, times radius queries against them with and
+without the index, checks both agree and removes the edicts again.
 ===============
 */
-areanode_t *SV_CreateAreaNode (int depth, vec3_t mins, vec3_t maxs)
+void SV_FindRadiusBench_f (void)
 {
-	areanode_t	*anode;
-	vec3_t		size;
-	vec3_t		mins1, maxs1, mins2, maxs2;
-
-	anode = &sv_areanodes[sv_numareanodes];
-	sv_numareanodes++;
-
-	ClearLink (&anode->trigger_edicts);
-	ClearLink (&anode->solid_edicts);
-
-	if (depth == AREA_DEPTH)
+	int		i, j, n, count, queries, found, room, oldnum, numedicts;
+	int		*chain;
+	edict_t	**ents, *ent, *a;
+	vec3_t	*orgs, size;
+	float	*rads;
+	double	start, indexed, all;
+
+	if (!sv.active)
 	{
-		anode->axis = -1;
-		anode->children[0] = anode->children[1] = NULL;
-		return anode;
+		Con_Printf ("Not running a server\n");
+		return;
 	}
 
-	VectorSubtract (maxs, mins, size);
-	if (size[0] > size[1])
-		anode->axis = 0;
-	else
-		anode->axis = 1;
+	count = (Cmd_Argc() > 1) ? atoi (Cmd_Argv(1)) : 10000;
+	queries = (Cmd_Argc() > 2) ? atoi (Cmd_Argv(2)) : 10000;
+	room = sv.max_edicts - sv.num_edicts - 64;
+	if (count > room)
+	{
+		Con_Printf ("Only room for %d more edicts (see max_edicts)\n", q_max (room, 0));
+		count = room;
+	}
+	count = q_max (count, 0);
+	queries = q_max (queries, 1);
+
+	ents = (edict_t **) malloc (count * sizeof(*ents));
+	orgs = (vec3_t *) malloc (queries * sizeof(*orgs));
+	rads = (float *) malloc (queries * sizeof(*rads));
+	chain = (int *) malloc (sv.max_edicts * sizeof(*chain));
+	if (!ents || !orgs || !rads || !chain)
+		Sys_Error ("SV_FindRadiusBench_f: malloc() failed");
+
+	VectorSubtract (sv.worldmodel->maxs, sv.worldmodel->mins, size);
+	oldnum = sv.num_edicts;
+	for (i = 0; i < count; i++)
+	{
+		ent = ents[i] = ED_Alloc ();
+		for (j = 0; j < 3; j++)
+		{
+			ent->v.origin[j] = sv.worldmodel->mins[j] + size[j] * (rand () & 0x7fff) / 0x8000;
+			ent->v.mins[j] = -8;
+			ent->v.maxs[j] = 8;
+		}
+		ent->v.solid = SOLID_BBOX;
+		SV_LinkEdict (ent, false);
+	}
+	for (i = 0; i < queries; i++)
+	{
+		for (j = 0; j < 3; j++)
+			orgs[i][j] = sv.worldmodel->mins[j] + size[j] * (rand () & 0x7fff) / 0x8000;
+		rads[i] = 64 + (rand () & 255);	// explosions and the like
+	}
 
-	anode->dist = 0.5 * (maxs[anode->axis] + mins[anode->axis]);
-	VectorCopy (mins, mins1);
-	VectorCopy (mins, mins2);
-	VectorCopy (maxs, maxs1);
-	VectorCopy (maxs, maxs2);
+	found = 0;
+	start = Sys_DoubleTime ();
+	for (i = 0; i < queries; i++)
+		for (a = SV_FindRadius (orgs[i], rads[i], true); a != sv.edicts; a = PROG_TO_EDICT(a->v.chain))
+			found++;
+	indexed = Sys_DoubleTime () - start;
 
-	maxs1[anode->axis] = mins2[anode->axis] = anode->dist;
+	start = Sys_DoubleTime ();
+	for (i = 0; i < queries; i++)
+		SV_FindRadius (orgs[i], rads[i], false);
+	all = Sys_DoubleTime () - start;
 
-	anode->children[0] = SV_CreateAreaNode (depth+1, mins2, maxs2);
-	anode->children[1] = SV_CreateAreaNode (depth+1, mins1, maxs1);
+	// both write the chain field, so keep the first chain to compare with
+	for (i = 0; i < queries; i++)
+	{
+		n = 0;
+		for (a = SV_FindRadius (orgs[i], rads[i], true); a != sv.edicts; a = PROG_TO_EDICT(a->v.chain))
+			chain[n++] = NUM_FOR_EDICT(a);
+		for (a = SV_FindRadius (orgs[i], rads[i], false), j = 0; a != sv.edicts; a = PROG_TO_EDICT(a->v.chain), j++)
+			if (j >= n || chain[j] != NUM_FOR_EDICT(a))
+				break;
+		if (a != sv.edicts || j != n)
+		{
+			Con_Printf ("findradius mismatch at query %d\n", i);
+			break;
+		}
+	}
 
-	return anode;
+	// give back the edicts past the old end, or every later loop over the
+	// edicts would keep walking them
+	numedicts = sv.num_edicts;
+	for (i = 0; i < count; i++)
+		ED_Free (ents[i]);
+	ED_ShrinkEdicts (oldnum);
+	free (chain);
+	free (rads);
+	free (orgs);
+	free (ents);
+
+	Con_Printf ("%d edicts, %d queries, %d found\n", numedicts, queries, found);
+	Con_Printf ("indexed: %7.3f ms (%.2f us per query)\n", indexed * 1000.0, indexed * 1e6 / queries);
+	Con_Printf ("all:     %7.3f ms (%.2f us per query)\n", all * 1000.0, all * 1e6 / queries);
 }
 
 /*
@@ -255,7 +937,11 @@ void SV_ClearWorld (void)
 
 	memset (sv_areanodes, 0, sizeof(sv_areanodes));
 	sv_numareanodes = 0;
-	SV_CreateAreaNode (0, sv.worldmodel->mins, sv.worldmodel->maxs);
+	SV_CreateAreaNode (sv.worldmodel->mins, sv.worldmodel->maxs);
+	memset (&sv_areastats, 0, sizeof(sv_areastats));
+
+	SV_ClearEntityIndex ();
+	SV_ClearRadiusIndex ();
 }
 
 
@@ -267,10 +953,16 @@ SV_UnlinkEdict
 */
 void SV_UnlinkEdict (edict_t *ent)
 {
+	if (sv_trackchanges)
+		SV_EdictChanged (ent);
+	if (sv_radiuslinks)
+		SV_UnindexRadius (NUM_FOR_EDICT(ent));
 	if (!ent->area.prev)
 		return;		// not linked in anywhere
 	RemoveLink (&ent->area);
 	ent->area.prev = ent->area.next = NULL;
+	ent->areanode->numedicts--;
+	ent->areanode = NULL;
 }
 
 
@@ -293,6 +985,7 @@ SV_AreaTriggerEdicts ( edict_t *ent, areanode_t *node, edict_t **list, int *list
 	{
 		next = l->next;
 		touch = EDICT_FROM_AREA(l);
+		sv_areastats.touchtests++;
 		if (touch == ent)
 			continue;
 		if (!touch->v.touch || touch->v.solid != SOLID_TRIGGER)
@@ -342,6 +1035,7 @@ void SV_TouchLinks (edict_t *ent)
 	list = alloca (sv.num_edicts*sizeof(edict_t *));
 
 	listcount = 0;
+	sv_areastats.touches++;
 	SV_AreaTriggerEdicts (ent, sv_areanodes, list, &listcount, sv.num_edicts);
 
 	for (i = 0; i < listcount; i++)
@@ -427,6 +1121,10 @@ SV_LinkEdict
 void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 {
 	areanode_t	*node;
+	int			side;
+
+	if (sv_trackchanges)
+		SV_EdictChanged (ent);
 
 	if (ent->area.prev)
 		SV_UnlinkEdict (ent);	// unlink from old position
@@ -467,6 +1165,8 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 	ent->num_leafs = 0;
 	if (ent->v.modelindex)
 		SV_FindTouchedLeafs (ent, sv.worldmodel->nodes);
+	SV_IndexEdict (ent);
+	SV_IndexRadius (ent);
 
 	if (ent->v.solid == SOLID_NOT)
 		return;
@@ -477,12 +1177,10 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 	{
 		if (node->axis == -1)
 			break;
-		if (ent->v.absmin[node->axis] > node->dist)
-			node = node->children[0];
-		else if (ent->v.absmax[node->axis] < node->dist)
-			node = node->children[1];
-		else
+		side = SV_AreaNodeSide (node, ent->v.absmin, ent->v.absmax);
+		if (side < 0)
 			break;		// crosses the node
+		node = node->children[side];
 	}
 
 // link it in
@@ -491,6 +1189,12 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers)
 		InsertLinkBefore (&ent->area, &node->trigger_edicts);
 	else
 		InsertLinkBefore (&ent->area, &node->solid_edicts);
+	ent->areanode = node;
+	node->numedicts++;
+
+// split the leaf if it's getting crowded
+	if (node->axis == -1 && node->numedicts > q_max (AREA_SPLITSIZE, node->nosplit))
+		SV_SplitAreaNode (node);
 
 // if touch_triggers, touch all entities at this node and decend for more
 	if (touch_triggers)
@@ -716,7 +1420,8 @@ qboolean SV_RecursiveHullCheck (hull_t *hull, int num, float p1f, float p2f, vec
 		{
 			trace->fraction = midf;
 			VectorCopy (mid, trace->endpos);
-			Con_DPrintf ("backup past 0\n");
+			if (!sv_tracesontasks)
+				Con_DPrintf ("backup past 0\n");
 			return false;
 		}
 		midf = p1f + (p2f - p1f)*frac;
@@ -739,7 +1444,7 @@ Handles selection or creation of a clipping hull, and offseting (and
 eventually rotation) of the end points
 ==================
 */
-trace_t SV_ClipMoveToEntity (edict_t *ent, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end)
+static trace_t SV_ClipMoveToEntityBox (edict_t *ent, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, moveclip_t *clip)
 {
 	trace_t		trace;
 	vec3_t		offset;
@@ -753,7 +1458,17 @@ trace_t SV_ClipMoveToEntity (edict_t *ent, vec3_t start, vec3_t mins, vec3_t max
 	VectorCopy (end, trace.endpos);
 
 // get the clipping hull
-	hull = SV_HullForEntity (ent, mins, maxs, offset);
+	if (clip && clip->box)
+	{
+		hull = SV_HullForEntityBox (ent, mins, maxs, offset, clip->box);
+		if (!hull)
+		{
+			clip->failed = true;
+			return trace;
+		}
+	}
+	else
+		hull = SV_HullForEntity (ent, mins, maxs, offset);
 
 	VectorSubtract (start, offset, start_l);
 	VectorSubtract (end, offset, end_l);
@@ -772,6 +1487,11 @@ trace_t SV_ClipMoveToEntity (edict_t *ent, vec3_t start, vec3_t mins, vec3_t max
 	return trace;
 }
 
+trace_t SV_ClipMoveToEntity (edict_t *ent, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end)
+{
+	return SV_ClipMoveToEntityBox (ent, start, mins, maxs, end, NULL);
+}
+
 //===========================================================================
 
 /*
@@ -792,12 +1512,20 @@ void SV_ClipToLinks ( areanode_t *node, moveclip_t *clip )
 	{
 		next = l->next;
 		touch = EDICT_FROM_AREA(l);
+		clip->tests++;
 		if (touch->v.solid == SOLID_NOT)
 			continue;
 		if (touch == clip->passedict)
 			continue;
 		if (touch->v.solid == SOLID_TRIGGER)
+		{
+			if (clip->box)
+			{
+				clip->failed = true;
+				return;
+			}
 			Sys_Error ("Trigger in clipping list");
+		}
 
 		if (clip->type == MOVE_NOMONSTERS && touch->v.solid != SOLID_BSP)
 			continue;
@@ -825,9 +1553,11 @@ void SV_ClipToLinks ( areanode_t *node, moveclip_t *clip )
 		}
 
 		if ((int)touch->v.flags & FL_MONSTER)
-			trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins2, clip->maxs2, clip->end);
+			trace = SV_ClipMoveToEntityBox (touch, clip->start, clip->mins2, clip->maxs2, clip->end, clip);
 		else
-			trace = SV_ClipMoveToEntity (touch, clip->start, clip->mins, clip->maxs, clip->end);
+			trace = SV_ClipMoveToEntityBox (touch, clip->start, clip->mins, clip->maxs, clip->end, clip);
+		if (clip->failed)
+			return;
 		if (trace.allsolid || trace.startsolid ||
 		trace.fraction < clip->trace.fraction)
 		{
@@ -850,7 +1580,7 @@ void SV_ClipToLinks ( areanode_t *node, moveclip_t *clip )
 
 	if ( clip->boxmaxs[node->axis] > node->dist )
 		SV_ClipToLinks ( node->children[0], clip );
-	if ( clip->boxmins[node->axis] < node->dist )
+	if ( clip->boxmins[node->axis] < node->dist && !clip->failed )
 		SV_ClipToLinks ( node->children[1], clip );
 }
 
@@ -887,46 +1617,502 @@ boxmaxs[0] = boxmaxs[1] = boxmaxs[2] = 9999;
 
 /*
 ==================
-SV_Move
+SV_InitMoveClip
+
+Everything but the trace
 ==================
 */
-trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
+static void SV_InitMoveClip (moveclip_t *clip, vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
 {
-	moveclip_t	clip;
 	int			i;
 
-	memset ( &clip, 0, sizeof ( moveclip_t ) );
-
-// clip to world
-	clip.trace = SV_ClipMoveToEntity ( sv.edicts, start, mins, maxs, end );
+	memset ( clip, 0, sizeof ( moveclip_t ) );
 
-	clip.start = start;
-	clip.end = end;
-	clip.mins = mins;
-	clip.maxs = maxs;
-	clip.type = type;
-	clip.passedict = passedict;
+	clip->start = start;
+	clip->end = end;
+	clip->mins = mins;
+	clip->maxs = maxs;
+	clip->type = type;
+	clip->passedict = passedict;
 
 	if (type == MOVE_MISSILE)
 	{
 		for (i=0 ; i<3 ; i++)
 		{
-			clip.mins2[i] = -15;
-			clip.maxs2[i] = 15;
+			clip->mins2[i] = -15;
+			clip->maxs2[i] = 15;
 		}
 	}
 	else
 	{
-		VectorCopy (mins, clip.mins2);
-		VectorCopy (maxs, clip.maxs2);
+		VectorCopy (mins, clip->mins2);
+		VectorCopy (maxs, clip->maxs2);
 	}
 
 // create the bounding box of the entire move
-	SV_MoveBounds ( start, clip.mins2, clip.maxs2, end, clip.boxmins, clip.boxmaxs );
+	SV_MoveBounds ( start, clip->mins2, clip->maxs2, end, clip->boxmins, clip->boxmaxs );
+}
+
+/*
+==================
+SV_Move
+==================
+*/
+trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict)
+{
+	moveclip_t	clip;
+
+	SV_InitMoveClip (&clip, start, mins, maxs, end, type, passedict);
+
+// clip to world
+	clip.trace = SV_ClipMoveToEntity ( sv.edicts, start, mins, maxs, end );
 
 // clip to entities
 	SV_ClipToLinks ( sv_areanodes, &clip );
 
+	sv_areastats.moves++;
+	sv_areastats.movetests += clip.tests;
+
 	return clip.trace;
 }
 
+/*
+==================
+SV_MoveOnTask
+
+SV_Move for task threads.  Clips against a box hull of its own, doesn't
+count for sv_areastats, and returns false instead of raising an error so
+the main thread can do the move again and raise it.  boxmins and boxmaxs
+get the area searched for edicts.
+==================
+*/
+qboolean SV_MoveOnTask (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict, trace_t *trace, vec3_t boxmins, vec3_t boxmaxs)
+{
+	moveclip_t	clip;
+	boxhull_t	box;
+
+	box = box_hull;
+	box.hull.planes = box.planes;
+
+	SV_InitMoveClip (&clip, start, mins, maxs, end, type, passedict);
+	clip.box = &box;
+
+	clip.trace = SV_ClipMoveToEntityBox ( sv.edicts, start, mins, maxs, end, &clip );
+	if (!clip.failed)
+		SV_ClipToLinks ( sv_areanodes, &clip );
+
+	*trace = clip.trace;
+	VectorCopy (clip.boxmins, boxmins);
+	VectorCopy (clip.boxmaxs, boxmaxs);
+
+	return !clip.failed;
+}
+
+/*
+===============================================================================
+
+BATCHED TRACES
+
+SV_MoveBatch walks up to MAX_TRACE_BATCH rays through the world hull
+together.  At each node the plane distances of all the rays are found at
+once, the rays wholly on one side go down that side together, and a ray
+that crosses the plane carries on alone with SV_RecursiveHullCheck from
+that node, which is just what a single trace would have done.  The
+results are the same as tracing the rays one by one.
+
+The SIMD versions work in double precision like DoublePrecisionDotProduct,
+so they need a compiler that does scalar float math with SSE2 as well,
+or the distances could round differently.
+
+===============================================================================
+*/
+
+#define	MAX_TRACE_BATCH		8
+
+#if defined(USE_SSE2) && (defined(__SSE2_MATH__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define	SV_SIMDTRACE
+#include <immintrin.h>
+#if defined(__GNUC__) || defined(_MSC_VER)
+#define	SV_SIMDTRACE_AVX
+#endif
+#endif
+
+typedef struct
+{
+	float	p1[3][MAX_TRACE_BATCH];	// start and end of each ray, in hull space
+	float	p2[3][MAX_TRACE_BATCH];
+	trace_t	*traces[MAX_TRACE_BATCH];
+} tracebatch_t;
+
+typedef void (*planedistsfunc_t) (mplane_t *plane, tracebatch_t *tb, const int *rays, int n, float *t1, float *t2);
+
+cvar_t	sv_simdtraces = {"sv_simdtraces", "1", CVAR_NONE};
+
+/*
+==================
+SV_PlaneDists
+
+Plane distances of the rays' ends, the way SV_RecursiveHullCheck finds them
+==================
+*/
+static void SV_PlaneDists (mplane_t *plane, tracebatch_t *tb, const int *rays, int n, float *t1, float *t2)
+{
+	vec3_t	p1, p2;
+	int		i, r;
+
+	for (i = 0; i < n; i++)
+	{
+		r = rays[i];
+		if (plane->type < 3)
+		{
+			t1[i] = tb->p1[plane->type][r] - plane->dist;
+			t2[i] = tb->p2[plane->type][r] - plane->dist;
+		}
+		else
+		{
+			p1[0] = tb->p1[0][r]; p1[1] = tb->p1[1][r]; p1[2] = tb->p1[2][r];
+			p2[0] = tb->p2[0][r]; p2[1] = tb->p2[1][r]; p2[2] = tb->p2[2][r];
+			t1[i] = DoublePrecisionDotProduct (plane->normal, p1) - plane->dist;
+			t2[i] = DoublePrecisionDotProduct (plane->normal, p2) - plane->dist;
+		}
+	}
+}
+
+#ifdef SV_SIMDTRACE
+/*
+==================
+SV_PlaneDistsSSE2
+
+Two rays at a time
+==================
+*/
+static void SV_PlaneDistsSSE2 (mplane_t *plane, tracebatch_t *tb, const int *rays, int n, float *t1, float *t2)
+{
+	__m128d	nx, ny, nz, dist, x, y, z, d;
+	int		i, a, b;
+
+	if (plane->type < 3)
+	{
+		SV_PlaneDists (plane, tb, rays, n, t1, t2);
+		return;
+	}
+
+	nx = _mm_set1_pd (plane->normal[0]);
+	ny = _mm_set1_pd (plane->normal[1]);
+	nz = _mm_set1_pd (plane->normal[2]);
+	dist = _mm_set1_pd (plane->dist);
+
+	for (i = 0; i + 2 <= n; i += 2)
+	{
+		a = rays[i];
+		b = rays[i + 1];
+
+		x = _mm_set_pd (tb->p1[0][b], tb->p1[0][a]);
+		y = _mm_set_pd (tb->p1[1][b], tb->p1[1][a]);
+		z = _mm_set_pd (tb->p1[2][b], tb->p1[2][a]);
+		d = _mm_add_pd (_mm_add_pd (_mm_mul_pd (nx, x), _mm_mul_pd (ny, y)), _mm_mul_pd (nz, z));
+		_mm_storel_pi ((__m64 *)&t1[i], _mm_cvtpd_ps (_mm_sub_pd (d, dist)));
+
+		x = _mm_set_pd (tb->p2[0][b], tb->p2[0][a]);
+		y = _mm_set_pd (tb->p2[1][b], tb->p2[1][a]);
+		z = _mm_set_pd (tb->p2[2][b], tb->p2[2][a]);
+		d = _mm_add_pd (_mm_add_pd (_mm_mul_pd (nx, x), _mm_mul_pd (ny, y)), _mm_mul_pd (nz, z));
+		_mm_storel_pi ((__m64 *)&t2[i], _mm_cvtpd_ps (_mm_sub_pd (d, dist)));
+	}
+
+	if (i < n)
+		SV_PlaneDists (plane, tb, rays + i, n - i, t1 + i, t2 + i);
+}
+
+#ifdef SV_SIMDTRACE_AVX
+/*
+==================
+SV_PlaneDistsAVX
+
+Four rays at a time
+==================
+*/
+#ifdef __GNUC__
+__attribute__((target("avx")))
+#endif
+static void SV_PlaneDistsAVX (mplane_t *plane, tracebatch_t *tb, const int *rays, int n, float *t1, float *t2)
+{
+	__m256d	nx, ny, nz, dist, x, y, z, d;
+	int		i, a, b, c, e;
+
+	if (plane->type < 3)
+	{
+		SV_PlaneDists (plane, tb, rays, n, t1, t2);
+		return;
+	}
+
+	nx = _mm256_set1_pd (plane->normal[0]);
+	ny = _mm256_set1_pd (plane->normal[1]);
+	nz = _mm256_set1_pd (plane->normal[2]);
+	dist = _mm256_set1_pd (plane->dist);
+
+	for (i = 0; i + 4 <= n; i += 4)
+	{
+		a = rays[i];
+		b = rays[i + 1];
+		c = rays[i + 2];
+		e = rays[i + 3];
+
+		x = _mm256_set_pd (tb->p1[0][e], tb->p1[0][c], tb->p1[0][b], tb->p1[0][a]);
+		y = _mm256_set_pd (tb->p1[1][e], tb->p1[1][c], tb->p1[1][b], tb->p1[1][a]);
+		z = _mm256_set_pd (tb->p1[2][e], tb->p1[2][c], tb->p1[2][b], tb->p1[2][a]);
+		d = _mm256_add_pd (_mm256_add_pd (_mm256_mul_pd (nx, x), _mm256_mul_pd (ny, y)), _mm256_mul_pd (nz, z));
+		_mm_storeu_ps (&t1[i], _mm256_cvtpd_ps (_mm256_sub_pd (d, dist)));
+
+		x = _mm256_set_pd (tb->p2[0][e], tb->p2[0][c], tb->p2[0][b], tb->p2[0][a]);
+		y = _mm256_set_pd (tb->p2[1][e], tb->p2[1][c], tb->p2[1][b], tb->p2[1][a]);
+		z = _mm256_set_pd (tb->p2[2][e], tb->p2[2][c], tb->p2[2][b], tb->p2[2][a]);
+		d = _mm256_add_pd (_mm256_add_pd (_mm256_mul_pd (nx, x), _mm256_mul_pd (ny, y)), _mm256_mul_pd (nz, z));
+		_mm_storeu_ps (&t2[i], _mm256_cvtpd_ps (_mm256_sub_pd (d, dist)));
+	}
+
+	if (i < n)
+		SV_PlaneDistsSSE2 (plane, tb, rays + i, n - i, t1 + i, t2 + i);
+}
+#endif	/* SV_SIMDTRACE_AVX */
+#endif	/* SV_SIMDTRACE */
+
+static planedistsfunc_t	sv_planedists = SV_PlaneDists;
+
+/*
+==================
+SV_SIMDTraces_f
+
+Picks the widest plane distance code the cpu has, unless sv_simdtraces is 0
+==================
+*/
+void SV_SIMDTraces_f (cvar_t *var)
+{
+	sv_planedists = SV_PlaneDists;
+#ifdef SV_SIMDTRACE
+	if (!var->value || !SDL_HasSSE2 ())
+		return;
+	sv_planedists = SV_PlaneDistsSSE2;
+#ifdef SV_SIMDTRACE_AVX
+	if (SDL_HasAVX ())
+		sv_planedists = SV_PlaneDistsAVX;
+#endif
+#endif
+}
+
+/*
+==================
+SV_HullCheckBatch
+==================
+*/
+static void SV_HullCheckBatch (hull_t *hull, int num, tracebatch_t *tb, const int *rays, int n)
+{
+	mclipnode_t	*node;
+	float		t1[MAX_TRACE_BATCH], t2[MAX_TRACE_BATCH];
+	int			front[MAX_TRACE_BATCH], back[MAX_TRACE_BATCH];
+	int			i, r, numfront, numback;
+	vec3_t		p1, p2;
+	trace_t		*trace;
+
+// check for empty
+	if (num < 0)
+	{
+		for (i = 0; i < n; i++)
+		{
+			trace = tb->traces[rays[i]];
+			if (num != CONTENTS_SOLID)
+			{
+				trace->allsolid = false;
+				if (num == CONTENTS_EMPTY)
+					trace->inopen = true;
+				else
+					trace->inwater = true;
+			}
+			else
+				trace->startsolid = true;
+		}
+		return;
+	}
+
+	if (num < hull->firstclipnode || num > hull->lastclipnode)
+		Sys_Error ("SV_HullCheckBatch: bad node number");
+
+	node = hull->clipnodes + num;
+	sv_planedists (hull->planes + node->planenum, tb, rays, n, t1, t2);
+
+	numfront = numback = 0;
+	for (i = 0; i < n; i++)
+	{
+		r = rays[i];
+		if (t1[i] >= 0 && t2[i] >= 0)
+			front[numfront++] = r;
+		else if (t1[i] < 0 && t2[i] < 0)
+			back[numback++] = r;
+		else
+		{	// splits here, so it goes on alone
+			p1[0] = tb->p1[0][r]; p1[1] = tb->p1[1][r]; p1[2] = tb->p1[2][r];
+			p2[0] = tb->p2[0][r]; p2[1] = tb->p2[1][r]; p2[2] = tb->p2[2][r];
+			SV_RecursiveHullCheck (hull, num, 0, 1, p1, p2, tb->traces[r]);
+		}
+	}
+
+	if (numfront)
+		SV_HullCheckBatch (hull, node->children[0], tb, front, numfront);
+	if (numback)
+		SV_HullCheckBatch (hull, node->children[1], tb, back, numback);
+}
+
+/*
+==================
+SV_MoveBatch
+==================
+*/
+void SV_MoveBatch (int count, vec3_t *start, vec3_t mins, vec3_t maxs, vec3_t *end, int type, edict_t *passedict, trace_t *traces)
+{
+	tracebatch_t	tb;
+	moveclip_t		clip;
+	int				rays[MAX_TRACE_BATCH];
+	int				i, j, n;
+	vec3_t			offset;
+	hull_t			*hull;
+	trace_t			*trace;
+
+	hull = SV_HullForEntity (sv.edicts, mins, maxs, offset);
+
+	for ( ; count > 0; count -= n, start += n, end += n, traces += n)
+	{
+		n = q_min (count, MAX_TRACE_BATCH);
+
+	// clip to world, like SV_ClipMoveToEntity
+		for (i = 0; i < n; i++)
+		{
+			trace = &traces[i];
+			memset (trace, 0, sizeof(trace_t));
+			trace->fraction = 1;
+			trace->allsolid = true;
+			VectorCopy (end[i], trace->endpos);
+
+			for (j = 0; j < 3; j++)
+			{
+				tb.p1[j][i] = start[i][j] - offset[j];
+				tb.p2[j][i] = end[i][j] - offset[j];
+			}
+			tb.traces[i] = trace;
+			rays[i] = i;
+		}
+
+		SV_HullCheckBatch (hull, hull->firstclipnode, &tb, rays, n);
+
+		for (i = 0; i < n; i++)
+		{
+			trace = &traces[i];
+			if (trace->fraction != 1)
+				VectorAdd (trace->endpos, offset, trace->endpos);
+			if (trace->fraction < 1 || trace->startsolid)
+				trace->ent = sv.edicts;
+
+		// clip to entities
+			SV_InitMoveClip (&clip, start[i], mins, maxs, end[i], type, passedict);
+			clip.trace = *trace;
+			SV_ClipToLinks (sv_areanodes, &clip);
+			*trace = clip.trace;
+
+			sv_areastats.moves++;
+			sv_areastats.movetests += clip.tests;
+		}
+	}
+}
+
+/*
+==================
+SV_TraceBench_f
+
+tracebench [rays]: traces random rays through the current map, one at a
+time and then batched with each plane distance version, checks they all
+agree and prints the throughput.
+==================
+*/
+void SV_TraceBench_f (void)
+{
+	static const char	*names[] = {"scalar", "sse2", "avx"};
+	planedistsfunc_t	funcs[3];
+	planedistsfunc_t	saved;
+	vec3_t		*starts, *ends, size;
+	trace_t		*single, *batched;
+	int			i, j, count, numfuncs;
+	double		start, time;
+
+	if (!sv.active)
+	{
+		Con_Printf ("Not running a server\n");
+		return;
+	}
+
+	count = (Cmd_Argc() > 1) ? atoi (Cmd_Argv(1)) : 100000;
+	count = q_max (count, 1);
+
+	numfuncs = 0;
+	funcs[numfuncs++] = SV_PlaneDists;
+#ifdef SV_SIMDTRACE
+	if (SDL_HasSSE2 ())
+		funcs[numfuncs++] = SV_PlaneDistsSSE2;
+#ifdef SV_SIMDTRACE_AVX
+	if (SDL_HasSSE2 () && SDL_HasAVX ())
+		funcs[numfuncs++] = SV_PlaneDistsAVX;
+#endif
+#endif
+
+	starts = (vec3_t *) malloc (count * sizeof(vec3_t));
+	ends = (vec3_t *) malloc (count * sizeof(vec3_t));
+	single = (trace_t *) malloc (count * sizeof(trace_t));
+	batched = (trace_t *) malloc (count * sizeof(trace_t));
+	if (!starts || !ends || !single || !batched)
+		Sys_Error ("SV_TraceBench_f: malloc() failed");
+
+// rays from random spots in the map, mostly short ones like monsters use
+	VectorSubtract (sv.worldmodel->maxs, sv.worldmodel->mins, size);
+	for (i = 0; i < count; i++)
+	{
+		for (j = 0; j < 3; j++)
+		{
+			starts[i][j] = sv.worldmodel->mins[j] + size[j] * (rand () & 0x7fff) / 0x8000;
+			ends[i][j] = starts[i][j] + ((rand () & 511) - 256);
+		}
+	}
+
+	start = Sys_DoubleTime ();
+	for (i = 0; i < count; i++)
+		single[i] = SV_Move (starts[i], vec3_origin, vec3_origin, ends[i], MOVE_NOMONSTERS, NULL);
+	time = Sys_DoubleTime () - start;
+	Con_Printf ("%-8s %8.3f ms, %6.2f Mtraces/s\n", "single", time * 1000.0, count / q_max (time, 1e-9) / 1e6);
+
+	saved = sv_planedists;
+	for (i = 0; i < numfuncs; i++)
+	{
+		sv_planedists = funcs[i];
+		start = Sys_DoubleTime ();
+		SV_MoveBatch (count, starts, vec3_origin, vec3_origin, ends, MOVE_NOMONSTERS, NULL, batched);
+		time = Sys_DoubleTime () - start;
+		Con_Printf ("%-8s %8.3f ms, %6.2f Mtraces/s\n", names[i], time * 1000.0, count / q_max (time, 1e-9) / 1e6);
+
+		for (j = 0; j < count; j++)
+		{
+			if (memcmp (&single[j].fraction, &batched[j].fraction, sizeof(float))
+			 || !VectorCompare (single[j].endpos, batched[j].endpos)
+			 || !VectorCompare (single[j].plane.normal, batched[j].plane.normal)
+			 || single[j].allsolid != batched[j].allsolid || single[j].startsolid != batched[j].startsolid
+			 || single[j].inopen != batched[j].inopen || single[j].inwater != batched[j].inwater
+			 || single[j].ent != batched[j].ent)
+			{
+				Con_Printf ("%s: trace %d differs\n", names[i], j);
+				break;
+			}
+		}
+	}
+	sv_planedists = saved;
+
+	free (batched);
+	free (single);
+	free (ends);
+	free (starts);
+}
@@ -60,6 +60,26 @@ void SV_LinkEdict (edict_t *ent, qboolean touch_triggers);
 // sets ent->v.absmin and ent->v.absmax
 // if touchtriggers, calls prog functions for the intersected triggers
 
+void SV_AreaStats_f (void);
+// prints the shape of the area tree and the average number of edicts
+// looked at per SV_Move and per trigger touch since the last call
+
+void SV_MarkPVSEdicts (byte *pvs, unsigned int *marks);
+// sets the bits in marks (one per edict number) for the edicts linked into
+// a leaf in the pvs, and for those in too many leafs to cull.  edicts that
+// were cleared without being relinked can be marked too, so callers still
+// check the leafnums.
+
+extern	cvar_t	sv_findradiusgrid;
+extern	cvar_t	sv_simdtraces;
+
+edict_t *SV_FindRadius (vec3_t org, float rad, qboolean useindex);
+// returns the chain of solid edicts whose bbox centers are within rad of org,
+// linked through v.chain and ended by the world, for findradius.  with
+// useindex only the edicts indexed near org are looked at.
+
+void SV_FindRadiusBench_f (void);
+
 int SV_PointContents (vec3_t p);
 int SV_TruePointContents (vec3_t p);
 // returns the CONTENTS_* value from the world at the given point.
@@ -81,6 +101,20 @@ trace_t SV_Move (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, e
 
 // passedict is explicitly excluded from clipping checks (normally NULL)
 
+void SV_MoveBatch (int count, vec3_t *start, vec3_t mins, vec3_t maxs, vec3_t *end, int type, edict_t *passedict, trace_t *traces);
+// the same as calling SV_Move for each start and end pair, with the rays
+// walked through the world hull together
+
+qboolean SV_MoveOnTask (vec3_t start, vec3_t mins, vec3_t maxs, vec3_t end, int type, edict_t *passedict, trace_t *trace, vec3_t boxmins, vec3_t boxmaxs);
+// SV_Move that can run on a task thread while the main thread waits.
+// returns false where SV_Move would raise an error.  boxmins and boxmaxs
+// are set to the area searched for edicts
+
+extern	qboolean	sv_tracesontasks;	// keeps SV_RecursiveHullCheck quiet
+
+void SV_SIMDTraces_f (cvar_t *var);
+void SV_TraceBench_f (void);
+
 qboolean SV_RecursiveHullCheck (hull_t *hull, int num, float p1f, float p2f, vec3_t p1, vec3_t p2, trace_t *trace);
 
 #endif	/* _QUAKE_WORLD_H */
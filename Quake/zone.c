@@ -26,15 +26,17 @@ Foundation, Inc., 59 Temple Place - Suite 330, Boston, MA  02111-1307, USA.
 #define	DYNAMIC_SIZE	(4 * 1024 * 1024) // ericw -- was 512KB (64-bit) / 384KB (32-bit)
 
 #define	ZONEID	0x1d4a11
+#define	SLABID	0x1d4a12	// an allocated slab object
+#define	SLABFREEID	0x1d4a13	// a free one
 #define MINFRAGMENT	64
 
 typedef struct memblock_s
 {
 	int	size;		// including the header and possibly tiny fragments
 	int	tag;		// a tag of 0 is a free block
-	int	id;		// should be ZONEID
-	int	pad;		// pad to 64 bit boundary
 	struct	memblock_s	*next, *prev;
+	int	pad;		// pad to 64 bit boundary
+	int	id;		// should be ZONEID.  last, so it's next to the data like a slab object's
 } memblock_t;
 
 typedef struct
@@ -65,6 +67,208 @@ all big things are allocated on the hunk.
 
 static memzone_t	*mainzone;
 
+static void *Z_TagMalloc (int size, int tag);
+
+/*
+==============================================================================
+
+						ZONE SLABS
+
+Small allocations are handed out from slabs of same sized objects, one
+list of slabs for each size class, so they don't chop up the block list
+or make Z_TagMalloc scan further.  A slab is a SLAB_SIZE block of the
+zone with the SLABTAG tag, and goes back to the zone when the last object
+in it is freed, unless it's the only slab in its class with room.
+
+Each object is preceded by a slabobj_t, whose id lines up with the id of a
+memblock_t so Z_Free can tell the two apart.
+
+==============================================================================
+*/
+
+#define	SLAB_SIZE		4096
+#define	SLAB_MAXOBJECT	256		// bigger things go on the block list
+#define	SLABTAG			2
+
+typedef struct
+{
+	int		offset;		// back to the slab_t
+	int		id;			// SLABID or SLABFREEID
+} slabobj_t;
+
+typedef struct slab_s
+{
+	struct slab_s	*next, *prev;	// slabs of the class that have room
+	int		sizeclass;
+	int		used;
+	slabobj_t	*free;		// first free object, the next is stored in its data
+	int		pad;
+} slab_t;
+
+typedef struct
+{
+	int		size;		// of the objects, not counting the slabobj_t
+	int		perslab;
+	slab_t	partial;	// start / end cap for the slabs with room
+	int		slabs;
+	int		used;
+	int		allocs;		// since startup
+} slabclass_t;
+
+static slabclass_t	z_slabclasses[] =
+{
+	{16}, {32}, {48}, {64}, {96}, {128}, {192}, {SLAB_MAXOBJECT}
+};
+#define	NUM_SLABCLASSES	(int)(sizeof(z_slabclasses) / sizeof(z_slabclasses[0]))
+
+static byte		z_sizeclass[SLAB_MAXOBJECT / 8 + 1];	// size class of each size / 8, rounded up
+static qboolean	z_noslabs;		// for zonebench
+
+#define	SLAB_DATA(o)	((void *)((slabobj_t *)(o) + 1))
+#define	SLAB_OBJ(ptr)	((slabobj_t *)(ptr) - 1)
+
+/*
+========================
+Z_InitSlabs
+========================
+*/
+static void Z_InitSlabs (void)
+{
+	slabclass_t	*sc;
+	int		i, c;
+
+	for (i = 0, c = 0; i <= SLAB_MAXOBJECT / 8; i++)
+	{
+		while (z_slabclasses[c].size < i * 8)
+			c++;
+		z_sizeclass[i] = c;
+	}
+
+	for (c = 0; c < NUM_SLABCLASSES; c++)
+	{
+		sc = &z_slabclasses[c];
+		sc->perslab = (SLAB_SIZE - sizeof(slab_t)) / (sizeof(slabobj_t) + sc->size);
+		sc->partial.next = sc->partial.prev = &sc->partial;
+	}
+}
+
+/*
+========================
+Z_SlabMalloc
+
+Returns NULL if the zone has no room for another slab
+========================
+*/
+static void *Z_SlabMalloc (int size)
+{
+	slabclass_t	*sc;
+	slab_t		*slab;
+	slabobj_t	*obj;
+	byte		*data;
+	int			i, stride;
+
+	sc = &z_slabclasses[z_sizeclass[(size + 7) >> 3]];
+
+	slab = sc->partial.next;
+	if (slab == &sc->partial)
+	{	// carve up a new slab
+		slab = (slab_t *) Z_TagMalloc (SLAB_SIZE, SLABTAG);
+		if (!slab)
+			return NULL;
+		slab->sizeclass = sc - z_slabclasses;
+		slab->used = 0;
+		slab->free = NULL;
+
+		stride = sizeof(slabobj_t) + sc->size;
+		data = (byte *)(slab + 1) + (sc->perslab - 1) * stride;
+		for (i = 0; i < sc->perslab; i++, data -= stride)
+		{
+			obj = (slabobj_t *) data;
+			obj->offset = data - (byte *)slab;
+			obj->id = SLABFREEID;
+			*(slabobj_t **)SLAB_DATA(obj) = slab->free;
+			slab->free = obj;
+		}
+
+		slab->next = sc->partial.next;
+		slab->prev = &sc->partial;
+		slab->next->prev = slab;
+		slab->prev->next = slab;
+		sc->slabs++;
+	}
+
+	obj = slab->free;
+	slab->free = *(slabobj_t **)SLAB_DATA(obj);
+	obj->id = SLABID;
+	slab->used++;
+	sc->used++;
+	sc->allocs++;
+
+	if (!slab->free)
+	{	// full, so take it off the list
+		slab->prev->next = slab->next;
+		slab->next->prev = slab->prev;
+		slab->next = slab->prev = NULL;
+	}
+
+	memset (SLAB_DATA(obj), 0, sc->size);
+	return SLAB_DATA(obj);
+}
+
+/*
+========================
+Z_SlabFree
+========================
+*/
+static void Z_SlabFree (slabobj_t *obj)
+{
+	slabclass_t	*sc;
+	slab_t		*slab;
+
+	slab = (slab_t *)((byte *)obj - obj->offset);
+	sc = &z_slabclasses[slab->sizeclass];
+
+	obj->id = SLABFREEID;
+	*(slabobj_t **)SLAB_DATA(obj) = slab->free;
+	slab->free = obj;
+	slab->used--;
+	sc->used--;
+
+	if (!slab->next)
+	{	// had been full
+		slab->next = sc->partial.next;
+		slab->prev = &sc->partial;
+		slab->next->prev = slab;
+		slab->prev->next = slab;
+	}
+
+	if (!slab->used && (sc->partial.next != slab || sc->partial.prev != slab))
+	{	// empty and not the only one with room
+		slab->prev->next = slab->next;
+		slab->next->prev = slab->prev;
+		sc->slabs--;
+		Z_Free (slab);
+	}
+}
+
+/*
+========================
+Z_PrintSlabs
+========================
+*/
+static void Z_PrintSlabs (void)
+{
+	slabclass_t	*sc;
+	int		c;
+
+	Con_Printf ("class  slabs    used/capacity     allocs\n");
+	for (c = 0; c < NUM_SLABCLASSES; c++)
+	{
+		sc = &z_slabclasses[c];
+		Con_Printf ("%5i %6i %7i/%-8i %10i\n", sc->size, sc->slabs, sc->used, sc->slabs * sc->perslab, sc->allocs);
+	}
+}
+
 
 /*
 ========================
@@ -78,6 +282,15 @@ void Z_Free (void *ptr)
 	if (!ptr)
 		Sys_Error ("Z_Free: NULL pointer");
 
+	switch (SLAB_OBJ(ptr)->id)
+	{
+	case SLABID:
+		Z_SlabFree (SLAB_OBJ(ptr));
+		return;
+	case SLABFREEID:
+		Sys_Error ("Z_Free: freed a freed pointer");
+	}
+
 	block = (memblock_t *) ( (byte *)ptr - sizeof(memblock_t));
 	if (block->id != ZONEID)
 		Sys_Error ("Z_Free: freed a pointer without ZONEID");
@@ -199,6 +412,13 @@ void *Z_Malloc (int size)
 {
 	void	*buf;
 
+	if (size <= SLAB_MAXOBJECT && size >= 0 && !z_noslabs)
+	{
+		buf = Z_SlabMalloc (size);
+		if (buf)
+			return buf;
+	}
+
 	Z_CheckHeap ();	// DEBUG
 	buf = Z_TagMalloc (size, 1);
 	if (!buf)
@@ -222,6 +442,23 @@ void *Z_Realloc(void *ptr, int size)
 	if (!ptr)
 		return Z_Malloc (size);
 
+	if (SLAB_OBJ(ptr)->id == SLABID)
+	{	// slab objects can't grow, and Z_SlabFree writes over the data,
+		// so copy before freeing
+		slab_t *slab = (slab_t *)((byte *)SLAB_OBJ(ptr) - SLAB_OBJ(ptr)->offset);
+		old_size = z_slabclasses[slab->sizeclass].size;
+		if (size <= old_size && z_sizeclass[(q_max(size, 0) + 7) >> 3] == slab->sizeclass)
+		{	// fits where it is, and the rest is kept zeroed for growing back
+			memset ((byte *)ptr + q_max(size, 0), 0, old_size - q_max(size, 0));
+			return ptr;
+		}
+		old_ptr = ptr;
+		ptr = Z_Malloc (size);
+		memcpy (ptr, old_ptr, q_min(old_size, size));
+		Z_Free (old_ptr);
+		return ptr;
+	}
+
 	block = (memblock_t *) ((byte *) ptr - sizeof (memblock_t));
 	if (block->id != ZONEID)
 		Sys_Error ("Z_Realloc: realloced a pointer without ZONEID");
@@ -264,6 +501,7 @@ void Z_Print (memzone_t *zone)
 	memblock_t	*block;
 
 	Con_Printf ("zone size: %i  location: %p\n",mainzone->size,mainzone);
+	Z_PrintSlabs ();
 
 	for (block = zone->blocklist.next ; ; block = block->next)
 	{
@@ -282,6 +520,91 @@ void Z_Print (memzone_t *zone)
 }
 
 
+/*
+========================
+Z_PrintSummary
+
+The shape of the block list and the slab classes
+========================
+*/
+static void Z_PrintSummary (void)
+{
+	memblock_t	*block;
+	int		blocks, freeblocks, freebytes, largest, slabs;
+
+	blocks = freeblocks = freebytes = largest = slabs = 0;
+	for (block = mainzone->blocklist.next ; block != &mainzone->blocklist ; block = block->next)
+	{
+		blocks++;
+		if (block->tag == SLABTAG)
+			slabs++;
+		else if (!block->tag)
+		{
+			freeblocks++;
+			freebytes += block->size;
+			largest = q_max (largest, block->size);
+		}
+	}
+
+	Con_Printf ("zone: %i blocks (%i slabs), %i bytes free in %i blocks, largest %i\n",
+		blocks, slabs, freebytes, freeblocks, largest);
+	Z_PrintSlabs ();
+}
+
+/*
+========================
+Z_Bench_f
+
+zonebench [count]: churns through count allocations and frees of mostly
+small, mixed sizes, first with the block list alone and then with the
+slabs in front of it
+========================
+*/
+static void Z_Bench_f (void)
+{
+	enum { LIVE = 2048 };
+	static void	*live[LIVE];
+	double	start, time;
+	int		count, pass, i, j, size;
+	unsigned int	seed;
+
+	count = (Cmd_Argc() > 1) ? Q_atoi (Cmd_Argv(1)) : 100000;
+
+	for (pass = 0; pass < 2; pass++)
+	{
+		z_noslabs = !pass;
+		seed = 1;
+		memset (live, 0, sizeof(live));
+
+		start = Sys_DoubleTime ();
+		for (i = 0; i < count; i++)
+		{
+			seed = seed * 1103515245 + 12345;
+			j = (seed >> 8) % LIVE;
+			if (live[j])
+				Z_Free (live[j]);
+			seed = seed * 1103515245 + 12345;
+			size = (seed >> 8) & 1023;
+			if (size < 960)
+				size = 4 + (size & 127);		// strings, cvars, aliases
+			else
+				size = 256 + (size & 63) * 32;	// the odd bigger thing
+			live[j] = Z_Malloc (size);
+		}
+		time = Sys_DoubleTime () - start;
+
+		Con_Printf ("%s: %.3f s, %.1f ns per malloc and free\n", pass ? "slabs" : "blocks",
+			time, time * 1e9 / q_max (count, 1));
+		Z_PrintSummary ();
+
+		for (j = 0; j < LIVE; j++)
+			if (live[j])
+				Z_Free (live[j]);
+	}
+
+	z_noslabs = false;
+}
+
 //============================================================================
 
 #define	HUNK_SENTINEL	0x1df001ed
@@ -418,6 +741,7 @@ Hunk_Print_f -- johnfitz -- console command to call hunk_print
 void Hunk_Print_f (void)
 {
 	Hunk_Print (false);
+	Z_PrintSummary ();
 }
 
 /*
@@ -983,7 +1307,9 @@ void Memory_Init (void *buf, int size)
 	}
 	mainzone = (memzone_t *) Hunk_AllocName (zonesize, "zone" );
 	Memory_InitZone (mainzone, zonesize);
+	Z_InitSlabs ();
 
 	Cmd_AddCommand ("hunk_print", Hunk_Print_f); //johnfitz
+	Cmd_AddCommand ("zonebench", Z_Bench_f);
 }
 